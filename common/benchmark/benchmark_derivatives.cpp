@@ -0,0 +1,127 @@
+/*! @file benchmark_derivatives.cpp
+ *  @brief Time the analytical forward dynamics derivatives against central
+ *  finite differencing of the ABA
+ *
+ * Run with an optional number of iterations:  benchmark-derivatives [n]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "Dynamics/Cheetah3.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Math/orientation_tools.h"
+#include "Utilities/Timer.h"
+
+using namespace ori;
+
+/*!
+ * Arbitrary orientation, velocity and joint positions
+ */
+static FBModelState<double> benchmarkState() {
+  RotMat<double> rBody = coordinateRotation(CoordinateAxis::X, .123) *
+                         coordinateRotation(CoordinateAxis::Z, .232) *
+                         coordinateRotation(CoordinateAxis::Y, .111);
+  FBModelState<double> x;
+  x.bodyOrientation = rotationMatrixToQuaternion(rBody.transpose());
+  x.bodyPosition = Vec3<double>(.1, .2, .3);
+  x.bodyVelocity << .4, -.5, .6, 1.1, -.2, .3;
+  x.q = DVec<double>(12);
+  x.qd = DVec<double>(12);
+  for (size_t i = 0; i < 12; i++) {
+    x.q[i] = .1 * (i + 1) - .4;
+    x.qd[i] = .5 * i - 2.;
+  }
+  return x;
+}
+
+/*!
+ * Perturb the state along generalized coordinate j, the same way as the
+ * finite difference check in test_dynamics.cpp
+ */
+static void perturbState(const FBModelState<double>& x, size_t j,
+                         bool velocity, double h, FBModelState<double>& xp) {
+  xp = x;
+  if (velocity) {
+    if (j < 6)
+      xp.bodyVelocity[j] += h;
+    else
+      xp.qd[j - 6] += h;
+  } else if (j < 3) {
+    RotMat<double> R = quaternionToRotationMatrix(x.bodyOrientation);
+    RotMat<double> dR =
+        Eigen::AngleAxis<double>(-h, Vec3<double>::Unit(j)).toRotationMatrix();
+    xp.bodyOrientation = rotationMatrixToQuaternion(RotMat<double>(dR * R));
+  } else if (j < 6) {
+    RotMat<double> R = quaternionToRotationMatrix(x.bodyOrientation);
+    xp.bodyPosition += R.transpose() * Vec3<double>::Unit(j - 3) * h;
+  } else {
+    xp.q[j - 6] += h;
+  }
+}
+
+/*!
+ * Time both ways of getting the forward dynamics derivatives of a model
+ */
+static void benchmark(const char* name, FloatingBaseModel<double> model,
+                      int iterations) {
+  FBModelState<double> x = benchmarkState();
+  FBModelState<double> xp;
+  DVec<double> tau = DVec<double>::Constant(12, 5.);
+  const double h = 1e-6;
+
+  FBModelStateDerivative<double> dx, dp, dm;
+  DMat<double> dqdd_dq, dqdd_dqd, dqdd_dtau;
+  DMat<double> fd_dq(18, 18), fd_dqd(18, 18), fd_dtau(18, 12);
+  Timer analyticalTimer;
+  for (int k = 0; k < iterations; k++) {
+    model.setState(x);
+    model.forwardDynamicsDerivatives(tau, dx, dqdd_dq, dqdd_dqd, dqdd_dtau);
+  }
+  double analyticalUs = 1e3 * analyticalTimer.getMs() / iterations;
+
+  Timer fdTimer;
+  for (int k = 0; k < iterations; k++) {
+    for (int velocity = 0; velocity < 2; velocity++) {
+      DMat<double>& d = velocity ? fd_dqd : fd_dq;
+      for (size_t j = 0; j < 18; j++) {
+        perturbState(x, j, velocity, h, xp);
+        model.setState(xp);
+        model.runABA(tau, dp);
+        perturbState(x, j, velocity, -h, xp);
+        model.setState(xp);
+        model.runABA(tau, dm);
+        d.col(j).head<6>() = (dp.dBodyVelocity - dm.dBodyVelocity) / (2 * h);
+        d.col(j).tail(12) = (dp.qdd - dm.qdd) / (2 * h);
+      }
+    }
+    model.setState(x);
+    for (size_t j = 0; j < 12; j++) {
+      tau[j] += h;
+      model.runABA(tau, dp);
+      tau[j] -= 2 * h;
+      model.runABA(tau, dm);
+      tau[j] += h;
+      fd_dtau.col(j).head<6>() =
+          (dp.dBodyVelocity - dm.dBodyVelocity) / (2 * h);
+      fd_dtau.col(j).tail(12) = (dp.qdd - dm.qdd) / (2 * h);
+    }
+  }
+  double fdUs = 1e3 * fdTimer.getMs() / iterations;
+
+  printf("%-14s analytical %8.2f us   finite difference %8.2f us   (%.1fx)\n",
+         name, analyticalUs, fdUs, fdUs / analyticalUs);
+}
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+  if (iterations <= 0) {
+    printf("usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  printf("[Dynamics Derivatives] %d iterations\n", iterations);
+  benchmark("Mini Cheetah", buildMiniCheetah<double>().buildModel(),
+            iterations);
+  benchmark("Cheetah 3", buildCheetah3<double>().buildModel(), iterations);
+  return 0;
+}
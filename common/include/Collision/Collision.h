@@ -8,6 +8,10 @@
 #ifndef COLLISION_H
 #define COLLISION_H
 
+#include <stdint.h>
+#include <limits>
+#include <vector>
+
 #include "cppTypes.h"
 
 /*!
@@ -35,6 +39,35 @@ class Collision {
   virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
                                 Mat3<T>& cp_frame) = 0;
 
+  /*!
+   * Check many points for contact in one pass.  Objects that can do this
+   * faster than one point at a time override it; the default does nothing.
+   * This only says which points are in contact, use ContactDetection to get
+   * the penetration and contact frame of those points.
+   * @param cp_pos : contact points in the global frame
+   * @param in_contact : set to 1 for points in contact and 0 otherwise
+   * @return false if batch detection is not supported
+   */
+  virtual bool BatchContactDetection(const std::vector<Vec3<T>>& cp_pos,
+                                     std::vector<uint8_t>& in_contact) {
+    (void)cp_pos;
+    (void)in_contact;
+    return false;
+  }
+
+  /*!
+   * Get an axis aligned box in the global frame that contains every point
+   * ContactDetection can return true for.  Used by the broad phase to skip
+   * objects that are far from a contact point.  Bounds may be infinite; the
+   * default is unbounded in every direction.
+   * @param lo : minimum corner
+   * @param hi : maximum corner
+   */
+  virtual void getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+    lo.setConstant(-std::numeric_limits<T>::infinity());
+    hi.setConstant(std::numeric_limits<T>::infinity());
+  }
+
   const T& getFrictionCoeff() { return _mu; }
   const T& getRestitutionCoeff() { return _restitution_coeff; }
 
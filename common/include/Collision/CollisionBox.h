@@ -42,6 +42,7 @@ class CollisionBox : public Collision<T> {
   virtual ~CollisionBox() {}
   virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
                                 Mat3<T>& cp_frame);
+  virtual void getBoundingBox(Vec3<T>& lo, Vec3<T>& hi);
 
  private:
   T _size[3];
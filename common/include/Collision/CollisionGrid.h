@@ -0,0 +1,67 @@
+/*!
+ * @file CollisionGrid.h
+ * @brief Broad phase for contact detection against static collision objects
+ *
+ * Terrains can be made of hundreds of collision boxes, but a contact point is
+ * only ever near a few of them.  The grid divides the x-y extent of all
+ * bounded collision objects into uniform cells and stores, for each cell, the
+ * objects whose bounding boxes overlap it.  Objects that are unbounded in x or
+ * y (like planes) are in every cell.
+ */
+
+#ifndef COLLISION_GRID_H
+#define COLLISION_GRID_H
+
+#include <vector>
+
+#include "Collision/Collision.h"
+#include "cppTypes.h"
+
+/*!
+ * Uniform x-y grid over a list of static collision objects
+ */
+template <typename T>
+class CollisionGrid {
+ public:
+  /*!
+   * Range of collision object indices, in increasing order
+   */
+  struct Candidates {
+    const size_t* first;
+    const size_t* last;
+    const size_t* begin() const { return first; }
+    const size_t* end() const { return last; }
+    size_t size() const { return last - first; }
+  };
+
+  void build(const std::vector<Collision<T>*>& collisions,
+             size_t maxCellsPerAxis = 256);
+  Candidates query(const Vec3<T>& p) const;
+
+  /*!
+   * Check if a point is inside the bounding box of a collision object
+   * @param idx : index of the collision object
+   * @param p : point in the global frame
+   */
+  bool overlaps(size_t idx, const Vec3<T>& p) const {
+    return (p.array() >= _lo[idx].array()).all() &&
+           (p.array() <= _hi[idx].array()).all();
+  }
+
+  /*!
+   * Get the number of cells in the x and y directions
+   */
+  size_t getCellCountX() const { return _nx; }
+  size_t getCellCountY() const { return _ny; }
+
+ private:
+  vectorAligned<Vec3<T>> _lo, _hi;  // bounding box of each collision object
+  std::vector<size_t> _unbounded;    // objects in every cell
+  std::vector<size_t> _cellStart;    // _cellObjects index of each cell
+  std::vector<size_t> _cellObjects;  // objects in each cell, back to back
+  Vec2<T> _origin;
+  T _cellSize = 1;
+  size_t _nx = 0, _ny = 0;
+};
+
+#endif  // COLLISION_GRID_H
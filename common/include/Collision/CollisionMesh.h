@@ -1,11 +1,18 @@
 /*!
  * @file CollisionMesh.h
  * @brief Collision logic for a mesh/height map
+ *
+ * Each grid cell of the height map is split into two triangles along the
+ * diagonal from (x_idx, y_idx) to (x_idx + 1, y_idx + 1), so the surface is
+ * continuous and piecewise planar.  The contact frames of the triangles are
+ * computed the first time a tile of cells is touched and kept, so large
+ * height maps only pay for the area the robot actually visits.
  */
 
 #ifndef COLLISION_MESH_H
 #define COLLISION_MESH_H
 
+#include <memory>
 #include <vector>
 
 #include "Collision/Collision.h"
@@ -37,14 +44,31 @@ class CollisionMesh : public Collision<T> {
         _grid(grid) {
     _x_max = (_height_map.rows() - 1) * _grid;
     _y_max = (_height_map.cols() - 1) * _grid;
+    _nTilesX = (_height_map.rows() - 1 + _tileSize - 1) / _tileSize;
+    _nTilesY = (_height_map.cols() - 1 + _tileSize - 1) / _tileSize;
+    _frameTiles.resize(_nTilesX * _nTilesY);
   }
 
   virtual ~CollisionMesh() {}
   virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
                                 Mat3<T>& cp_frame);
+  virtual bool BatchContactDetection(const std::vector<Vec3<T>>& cp_pos,
+                                     std::vector<uint8_t>& in_contact);
+  virtual void getBoundingBox(Vec3<T>& lo, Vec3<T>& hi);
+
+  T surfaceHeight(T x, T y);
+
+  const DMat<T>& getHeightMap() const { return _height_map; }
+  const Vec3<T>& getLeftCorner() const { return _left_corner_loc; }
+  const T& getGridSize() const { return _grid; }
 
  private:
-  T _size[3];
+  static constexpr size_t _tileSize = 16;  // cells per tile side
+
+  bool _locate(const Vec3<T>& cp_pos, size_t& x_idx, size_t& y_idx, T& u,
+               T& v);
+  T _cellHeight(size_t x_idx, size_t y_idx, T u, T v);
+  const Mat3<T>& _triangleFrame(size_t x_idx, size_t y_idx, bool lower);
 
   Vec3<T> _left_corner_loc;
   DMat<T> _height_map;
@@ -52,6 +76,10 @@ class CollisionMesh : public Collision<T> {
   T _grid;
   T _x_max;
   T _y_max;
+
+  // contact frames of the two triangles of each cell, computed per tile
+  size_t _nTilesX, _nTilesY;
+  std::vector<std::unique_ptr<std::vector<Mat3<T>>>> _frameTiles;
 };
 
 #endif  // COLLISION_MESH_H
@@ -35,6 +35,14 @@ class CollisionPlane : public Collision<T> {
   virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
                                 Mat3<T>& cp_frame);
 
+  /*!
+   * The plane only makes contact with points below it
+   */
+  virtual void getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+    Collision<T>::getBoundingBox(lo, hi);
+    hi[2] = _height;
+  }
+
  private:
   T _height;
 };
@@ -0,0 +1,70 @@
+/*!
+ * @file CollisionTerrain.h
+ * @brief Collision logic for an endless procedural terrain
+ *
+ * Keeps the chunks of a ProceduralTerrain around the last contact point as
+ * height map meshes.  The chunks are in a ring indexed by chunk position, so
+ * finding the chunk of a point is a lookup, and moving to a new chunk only
+ * generates the row or column of chunks that came into range, overwriting
+ * chunks that went out of range.  The ring is one chunk wider than the range,
+ * so going back and forth across a chunk edge never regenerates anything.
+ * Memory use depends only on the load radius, not on how far the robot goes.
+ */
+
+#ifndef COLLISION_TERRAIN_H
+#define COLLISION_TERRAIN_H
+
+#include <memory>
+#include <vector>
+
+#include "Collision/Collision.h"
+#include "Collision/ProceduralTerrain.h"
+#include "cppTypes.h"
+
+/*!
+ * Class to represent collision with a procedural terrain
+ */
+template <typename T>
+class CollisionTerrain : public Collision<T> {
+ public:
+  /*!
+   * Construct a collision with a procedural terrain.  No chunks are generated
+   * until the first contact check.
+   * @param terrain : the terrain, which may be shared with other simulators
+   */
+  explicit CollisionTerrain(std::shared_ptr<const ProceduralTerrain> terrain);
+
+  virtual ~CollisionTerrain() {}
+  virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
+                                Mat3<T>& cp_frame);
+
+  /*!
+   * Get the loaded chunks.  Slots which were never loaded are null.  The
+   * chunks are replaced (not changed) as the robot moves, so the height map of
+   * a chunk can be read from another thread as long as it holds the pointer.
+   */
+  const std::vector<std::shared_ptr<TerrainChunk<T>>>& getChunks() const {
+    return _chunks;
+  }
+
+  /*!
+   * Get the number of chunks generated so far
+   */
+  size_t getChunksGenerated() const { return _chunksGenerated; }
+
+ private:
+  size_t _slot(s64 x, s64 y) const {
+    s64 w = _width;
+    return ((x % w + w) % w) * _width + ((y % w + w) % w);
+  }
+  void _recenter(s64 x, s64 y);
+
+  std::shared_ptr<const ProceduralTerrain> _terrain;
+  size_t _width;  // chunks on each side of the ring
+  std::vector<std::shared_ptr<TerrainChunk<T>>> _chunks;
+  s64 _centerX = 0, _centerY = 0;
+  bool _centered = false;
+  size_t _chunksGenerated = 0;
+};
+
+#endif  // COLLISION_TERRAIN_H
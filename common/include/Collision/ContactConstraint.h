@@ -12,6 +12,7 @@
 #include <iostream>
 
 #include "Collision/Collision.h"
+#include "Collision/CollisionGrid.h"
 #include "Dynamics/FloatingBaseModel.h"
 #include "Utilities/Utilities_print.h"
 #include "cppTypes.h"
@@ -35,17 +36,20 @@ class ContactConstraint {
     for (size_t i(0); i < _model->_nGroundContact; ++i) {
       _cp_force_list.push_back(Vec3<T>::Zero());
     }
+    _reserveContactLists(_model->_nGroundContact);
   }
 
   virtual ~ContactConstraint() {}
 
   /*!
-   * Add collision object
+   * Add collision object.  Collision objects are static, the broad phase is
+   * rebuilt before the next contact check.
    * @param collision : collision objects
    */
   void AddCollision(Collision<T>* collision) {
     _collision_list.push_back(collision);
     ++_nCollision;
+    _broadPhaseUpToDate = false;
   }
 
   /*!
@@ -64,6 +68,13 @@ class ContactConstraint {
    */
   virtual void UpdateQdot(FBModelState<T>& state) = 0;
 
+  /*!
+   * Check which contact points touch a collision object, using the contact
+   * point positions from the last forward kinematics of the model
+   * @return number of points in contact
+   */
+  size_t CheckContact() { return _nContact = _CheckContact(); }
+
   /*!
    * For visualization
    * @return cp_pos_list : all contact point position in the global frame.
@@ -77,11 +88,26 @@ class ContactConstraint {
    */
   const Vec3<T>& getGCForce(size_t idx) { return _cp_force_list[idx]; }
 
+  /*!
+   * Get the contact state which is carried from one step to the next, such as
+   * ground deflections or warm start impulses
+   * @param state : flattened contact state, empty if there is none
+   */
+  virtual void getPersistentState(DVec<T>& state) const { state.resize(0); }
+
+  /*!
+   * Restore contact state from getPersistentState.  State of the wrong size
+   * (from a different contact model) resets the contact state instead.
+   */
+  virtual void setPersistentState(const DVec<T>& state) { (void)state; }
+
  protected:
   vectorAligned<Vec2<T>> deflectionRate;
   void _groundContactWithOffset(T K, T D);
 
   size_t _CheckContact();
+  void _reserveContactLists(size_t n);
+  void _findBatchCollisions();
 
   vectorAligned<Vec2<T>> _tangentialDeflections;
 
@@ -91,6 +117,12 @@ class ContactConstraint {
   FloatingBaseModel<T>* _model;
 
   std::vector<Collision<T>*> _collision_list;
+  CollisionGrid<T> _broadPhase;
+  bool _broadPhaseUpToDate = false;
+  std::vector<int> _batchSlot;  // index into _batchInContact, or -1
+  std::vector<size_t> _batchCollisions;
+  std::vector<std::vector<uint8_t>> _batchInContact;
+
   std::vector<size_t> _idx_list;
   std::vector<T> _cp_resti_list;
   std::vector<T> _cp_mu_list;
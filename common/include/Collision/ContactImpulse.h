@@ -13,6 +13,16 @@
 
 /*!
  * Impulse-based contact dynamics for a FloatingBaseModel
+ *
+ * Each step, the contact Jacobians of the k points in contact are stacked into
+ * J (3k x nDof, in the local frame of each contact) and the Delassus matrix
+ * W = J H^-1 J^T is assembled once.  The impulses are then found with a
+ * projected Gauss-Seidel iteration that solves the normal impulse of a contact
+ * and then its two tangential impulses, projected onto the friction cone.  The
+ * impulses of the previous step are used as the initial guess for ground
+ * contacts that are still in contact.  All buffers are kept between steps, so
+ * once the largest number of contacts has been seen the solver does not
+ * allocate.
  */
 template <typename T>
 class ContactImpulse : public ContactConstraint<T> {
@@ -23,9 +33,11 @@ class ContactImpulse : public ContactConstraint<T> {
    * @param model : The floating base model used for contacts
    */
   ContactImpulse(FloatingBaseModel<T>* model) : ContactConstraint<T>(model) {
-    _iter_lim = 10;
+    _iter_lim = 50;
     _nDof = CC::_model->_nDof;
     _b_debug = false;
+    _qdot = DVec<T>::Zero(_nDof);
+    _warmStart.resize(CC::_model->_nGroundContact, Vec3<T>::Zero());
   }
 
   virtual ~ContactImpulse() {}
@@ -49,6 +61,48 @@ class ContactImpulse : public ContactConstraint<T> {
 
   virtual void UpdateQdot(FBModelState<T>& state);
 
+  /*!
+   * Get the number of Gauss-Seidel sweeps used by the last UpdateQdot
+   */
+  size_t getIterations() const { return _iterations; }
+
+  /*!
+   * Get the largest change in any impulse component during the last
+   * Gauss-Seidel sweep of the last UpdateQdot
+   */
+  T getResidual() const { return _residual; }
+
+  /*!
+   * Set the maximum number of Gauss-Seidel sweeps per step
+   */
+  void setIterationLimit(size_t iter_lim) { _iter_lim = iter_lim; }
+
+  /*!
+   * Set the impulse change below which the solver is considered converged
+   */
+  void setTolerance(T tol) { _tol = tol; }
+
+  /*!
+   * The warm start impulse of each ground contact point
+   */
+  virtual void getPersistentState(DVec<T>& state) const {
+    state.resize(3 * _warmStart.size());
+    for (size_t i(0); i < _warmStart.size(); ++i) {
+      state.template segment<3>(3 * i) = _warmStart[i];
+    }
+  }
+
+  virtual void setPersistentState(const DVec<T>& state) {
+    bool match = (size_t)state.rows() == 3 * _warmStart.size();
+    for (size_t i(0); i < _warmStart.size(); ++i) {
+      if (match) {
+        _warmStart[i] = state.template segment<3>(3 * i);
+      } else {
+        _warmStart[i].setZero();
+      }
+    }
+  }
+
  protected:
   size_t _iter_lim;
   bool _b_debug;
@@ -56,13 +110,23 @@ class ContactImpulse : public ContactConstraint<T> {
   T _penetration_recover_ratio;
   size_t _nDof;
   void _UpdateVelocity(DVec<T>& qdot);
-  void _UpdateQdotOneDirection(size_t idx,
-                               const vectorAligned<D3Mat<T> >& Jc_list,
-                               const T* lambda_list,
-                               const vectorAligned<DVec<T> > AinvB_list,
-                               const T* des_vel_list, const T* min_list,
-                               const T* max_list, DVec<T>& qdot);
-  size_t _iter_sum;
+  void _ReserveBuffers(size_t nContact);
+  void _AssembleDelassus(const DVec<T>& qdot);
+  void _SolveImpulses();
+
+  size_t _iterations = 0;
+  T _residual = 0;
+
+  DVec<T> _qdot;
+  DMat<T> _J;       // stacked contact Jacobians, local frames (3k x nDof)
+  DMat<T> _HinvJt;  // H^-1 * J^T (nDof x 3k)
+  DMat<T> _W;       // Delassus matrix J * H^-1 * J^T (3k x 3k)
+  DVec<T> _bias;    // contact velocity with zero impulse, minus desired
+  DVec<T> _lambda;  // contact impulses, local frames
+  vectorAligned<Eigen::Matrix<T, 2, 2>>
+      _WtangentInv;  // inverses of the tangential 2x2 diagonal blocks
+  vectorAligned<Vec3<T>> _warmStart;  // last impulse of each ground contact
+                                      // point, world frame
 
  private:
   T _dt;
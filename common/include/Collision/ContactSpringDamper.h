@@ -47,6 +47,27 @@ class ContactSpringDamper : public ContactConstraint<T> {
     (void)state; /* Do nothing */
   }
 
+  /*!
+   * The tangential deflection of the ground at each contact point
+   */
+  virtual void getPersistentState(DVec<T>& state) const {
+    state.resize(2 * _nGC);
+    for (size_t i(0); i < _nGC; ++i) {
+      state.template segment<2>(2 * i) = _tangentialDeflections[i];
+    }
+  }
+
+  virtual void setPersistentState(const DVec<T>& state) {
+    bool match = (size_t)state.rows() == 2 * _nGC;
+    for (size_t i(0); i < _nGC; ++i) {
+      if (match) {
+        _tangentialDeflections[i] = state.template segment<2>(2 * i);
+      } else {
+        _tangentialDeflections[i].setZero();
+      }
+    }
+  }
+
  protected:
   size_t _nGC;
 
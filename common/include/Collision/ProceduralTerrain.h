@@ -0,0 +1,107 @@
+/*!
+ * @file ProceduralTerrain.h
+ * @brief Endless terrain generated from a seed, in square chunks
+ *
+ * The height of the ground is a function of (x, y): smooth noise, plus
+ * features (slopes, stairs and gaps) placed in a grid of square feature cells.
+ * Nothing is stored, so the terrain can be sampled anywhere; CollisionTerrain
+ * samples it into height map chunks around the robot as it moves.  The same
+ * seed always gives the same terrain.
+ */
+
+#ifndef PROCEDURAL_TERRAIN_H
+#define PROCEDURAL_TERRAIN_H
+
+#include <cmath>
+#include <memory>
+
+#include "Collision/CollisionMesh.h"
+#include "cTypes.h"
+#include "cppTypes.h"
+
+/*!
+ * Settings of a procedural terrain.  Lengths are in meters.
+ */
+struct ProceduralTerrainParameters {
+  double mu = 0.7;
+  double restitution = 0;
+  u64 seed = 1;
+
+  double grid = 0.02;       // height map resolution
+  double chunkSize = 4;     // side of a chunk
+  size_t loadRadius = 2;    // chunks kept on each side of the robot's chunk
+  double height = 0;        // height of flat ground
+  double flatRadius = 2;    // ground within this distance of the origin is flat
+
+  double noiseAmplitude = 0.02;
+  double noiseWavelength = 1;
+  size_t noiseOctaves = 3;
+
+  // each feature cell holds one feature, chosen with these probabilities
+  double featureSize = 6;
+  double slopeProbability = 0.25;
+  double slopeHeight = 0.3;  // height of the hill (or depth of the valley)
+  double slopeGrade = 0.25;  // rise over run
+  double stairsProbability = 0.25;
+  double stairRise = 0.08;
+  double stairRun = 0.3;
+  size_t stairSteps = 4;  // steps up to the landing, then as many down
+  double gapProbability = 0.2;
+  double gapWidth = 0.2;  // widest gap, gaps are 50 to 100% of this
+  double gapDepth = 0.5;
+};
+
+/*!
+ * A square piece of terrain, sampled into a collision height map.  Chunk
+ * (x, y) covers [x, x + 1) * chunkSize by [y, y + 1) * chunkSize, with one
+ * extra sample on each side so that points on the edge of the chunk are
+ * inside the height map.
+ */
+template <typename T>
+struct TerrainChunk {
+  TerrainChunk(s64 x_, s64 y_, T mu, T restitution, T grid,
+               const Vec3<T>& leftCorner, const DMat<T>& heightMap)
+      : x(x_),
+        y(y_),
+        minHeight(heightMap.minCoeff()),
+        maxHeight(heightMap.maxCoeff()),
+        mesh(mu, restitution, grid, leftCorner, heightMap) {}
+
+  s64 x, y;
+  T minHeight, maxHeight;
+  CollisionMesh<T> mesh;
+};
+
+/*!
+ * Height function of a procedural terrain.  All functions are const, so one
+ * terrain can be shared by several simulators on different threads.
+ */
+class ProceduralTerrain {
+ public:
+  explicit ProceduralTerrain(const ProceduralTerrainParameters& params);
+
+  double height(double x, double y) const;
+
+  /*!
+   * Get the chunk index of a point
+   */
+  s64 chunkIndex(double x) const {
+    return (s64)std::floor(x / _params.chunkSize);
+  }
+
+  template <typename T>
+  std::shared_ptr<TerrainChunk<T>> generateChunk(s64 x, s64 y) const;
+
+  const ProceduralTerrainParameters& getParameters() const { return _params; }
+
+ private:
+  double noise(double x, double y) const;
+  double feature(double x, double y) const;
+  double hashUniform(s64 i, s64 j, u64 salt) const;
+
+  ProceduralTerrainParameters _params;
+  double _grid;  // grid size that fits a whole number of cells in a chunk
+  size_t _samplesPerChunk;
+};
+
+#endif  // PROCEDURAL_TERRAIN_H
@@ -28,14 +28,27 @@ class SimulatorControlParameters : public ControlParameters {
         INIT_PARAMETER(game_controller_deadband),
         INIT_PARAMETER(simulation_speed),
         INIT_PARAMETER(simulation_paused),
+        INIT_PARAMETER(unlimited_speed),
+        INIT_PARAMETER(render_dt),
         INIT_PARAMETER(high_level_dt),
         INIT_PARAMETER(low_level_dt),
         INIT_PARAMETER(dynamics_dt),
+        INIT_PARAMETER(dynamics_integrator),
+        INIT_PARAMETER(adaptive_contact_dt),
         INIT_PARAMETER(floor_kp),
         INIT_PARAMETER(floor_kd),
         INIT_PARAMETER(use_spring_damper),
+        INIT_PARAMETER(use_fixed_size_dynamics),
         INIT_PARAMETER(sim_state_lcm),
         INIT_PARAMETER(sim_lcm_ttl),
+        INIT_PARAMETER(robot_handoff),
+        INIT_PARAMETER(record_trajectory),
+        INIT_PARAMETER(num_robots),
+        INIT_PARAMETER(robot_spacing),
+        INIT_PARAMETER(motor_thermal_model),
+        INIT_PARAMETER(motor_thermal_capacity),
+        INIT_PARAMETER(motor_thermal_resistance),
+        INIT_PARAMETER(ambient_temperature),
         INIT_PARAMETER(go_home),
         INIT_PARAMETER(home_pos),
         INIT_PARAMETER(home_rpy),
@@ -52,15 +65,29 @@ class SimulatorControlParameters : public ControlParameters {
 
   DECLARE_PARAMETER(double, simulation_speed)
   DECLARE_PARAMETER(s64, simulation_paused)
+  DECLARE_PARAMETER(s64, unlimited_speed)
+  DECLARE_PARAMETER(double, render_dt)
   DECLARE_PARAMETER(double, high_level_dt)
   DECLARE_PARAMETER(double, low_level_dt)
   DECLARE_PARAMETER(double, dynamics_dt)
+  DECLARE_PARAMETER(s64, dynamics_integrator)
+  DECLARE_PARAMETER(double, adaptive_contact_dt)
 
   DECLARE_PARAMETER(double, floor_kp)
   DECLARE_PARAMETER(double, floor_kd)
   DECLARE_PARAMETER(s64, use_spring_damper)
+  DECLARE_PARAMETER(s64, use_fixed_size_dynamics)
   DECLARE_PARAMETER(s64, sim_state_lcm)
   DECLARE_PARAMETER(s64, sim_lcm_ttl)
+  DECLARE_PARAMETER(s64, robot_handoff)
+  DECLARE_PARAMETER(s64, record_trajectory)
+  DECLARE_PARAMETER(s64, num_robots)
+  DECLARE_PARAMETER(double, robot_spacing)
+
+  DECLARE_PARAMETER(s64, motor_thermal_model)
+  DECLARE_PARAMETER(double, motor_thermal_capacity)
+  DECLARE_PARAMETER(double, motor_thermal_resistance)
+  DECLARE_PARAMETER(double, ambient_temperature)
 
   DECLARE_PARAMETER(s64, go_home)
   DECLARE_PARAMETER(Vec3<double>,home_pos)
@@ -118,6 +118,9 @@ class DesiredStateCommand {
 
   // Track the number of iterations since last info print
   int printIter = 0;
+
+  // Set the previous desired state from the estimate on the first command
+  bool b_firstVisit = true;
 };
 
 #endif
@@ -76,6 +76,16 @@ class ActuatorModel {
    */
   void setFriction(bool enabled) { _frictionEnabled = enabled; }
 
+  // parameters
+  T getGearRatio() const { return _gr; }
+  T getMotorKT() const { return _kt; }
+  T getMotorR() const { return _R; }
+  T getBatteryV() const { return _V; }
+  T getDamping() const { return _damping; }
+  T getDryFriction() const { return _dryFriction; }
+  T getTauMax() const { return _tauMax; }
+  bool getFriction() const { return _frictionEnabled; }
+
  private:
   T _gr, _kt, _R, _V, _damping, _dryFriction, _tauMax;
   bool _frictionEnabled = true;
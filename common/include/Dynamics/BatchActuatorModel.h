@@ -0,0 +1,79 @@
+/*! @file BatchActuatorModel.h
+ *  @brief Actuator model of all 12 joints of a quadruped at once
+ *
+ * Same model as ActuatorModel, but the parameters are stored per joint as a
+ * structure of arrays and the voltage and torque limits are branch free
+ * min/max, so the loop over the 12 joints vectorizes.  The simulator runs the
+ * actuator model every dynamics step, so this is a hot loop in turbo mode.
+ *
+ * Optionally tracks the winding temperature of each motor with a first order
+ * thermal model (copper loss heating a thermal capacity, which cools to
+ * ambient through a thermal resistance).  The motor resistance rises with the
+ * winding temperature, which reduces the torque available at speed.
+ */
+
+#ifndef PROJECT_BATCHACTUATORMODEL_H
+#define PROJECT_BATCHACTUATORMODEL_H
+
+#include <vector>
+
+#include "Dynamics/ActuatorModel.h"
+
+/*!
+ * Thermal model of one motor
+ */
+template <typename T>
+struct MotorThermalParameters {
+  T capacity = 100;    // heat capacity of the winding (J/K)
+  T resistance = 1;    // thermal resistance from winding to ambient (K/W)
+  T ambient = 25;      // ambient temperature (C), the motor R is at ambient
+  T rTempCo = 0.0039;  // increase in motor R per degree (1/K), for copper
+};
+
+/*!
+ * Actuator models of the 12 joints.  Joint j of leg i is entry i * 3 + j, the
+ * same order as the joint torques of the simulator.
+ */
+template <typename T>
+class BatchActuatorModel {
+ public:
+  static constexpr size_t kJoints = 12;
+
+  BatchActuatorModel() {}
+  explicit BatchActuatorModel(const std::vector<ActuatorModel<T>>& legModels);
+
+  void getTorques(const T* tauDes, const T* qd, T* tau);
+
+  void setFriction(bool enabled);
+  void enableThermalModel(const MotorThermalParameters<T>& params);
+  void disableThermalModel();
+  void updateTemperatures(T dt);
+
+  bool thermalModelEnabled() const { return _thermalEnabled; }
+
+  /*!
+   * Get the winding temperature of each motor.  Stays at ambient if the
+   * thermal model is disabled.
+   */
+  const T* getTemperatures() const { return _temperature; }
+  void setTemperatures(const T* temperatures);
+
+  /*!
+   * Get the copper loss of each motor in the last getTorques (W)
+   */
+  const T* getPowerLoss() const { return _powerLoss; }
+
+ private:
+  T _gr[kJoints], _kt[kJoints], _R0[kJoints], _R[kJoints], _V[kJoints];
+  T _tauMax[kJoints];
+  T _damping0[kJoints], _dryFriction0[kJoints];
+  T _damping[kJoints], _dryFriction[kJoints];  // zero if friction is disabled
+
+  bool _thermalEnabled = false;
+  MotorThermalParameters<T> _thermal;
+  T _temperature[kJoints] = {};
+  T _powerLoss[kJoints] = {};
+  T _decayDt = 0, _decay = 1;  // cached exp(-dt / time constant)
+};
+
+#endif  // PROJECT_BATCHACTUATORMODEL_H
@@ -0,0 +1,243 @@
+/*! @file BatchFloatingBaseModel.h
+ *  @brief Batched dynamics for evaluating many states of one floating base
+ * model at once
+ *
+ * FloatingBaseModel runs the tree recursions for a single state.  Planners
+ * that sample, finite difference, or roll out many perturbed states end up
+ * calling it thousands of times per control cycle.  The classes here take a
+ * structure-of-arrays block of states and run the ABA and RNEA on W states at
+ * a time, with the W states laid out as SIMD lanes (4 doubles / 8 floats for
+ * AVX2).  BatchDynamicsEngine splits large batches across a pool of threads.
+ *
+ * The model must only have revolute joints (true for all of the quadrupeds).
+ * External forces are not supported; use FixedFloatingBaseModel for that.
+ */
+
+#ifndef LIBBIOMIMETICS_BATCHFLOATINGBASEMODEL_H
+#define LIBBIOMIMETICS_BATCHFLOATINGBASEMODEL_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Dynamics/FloatingBaseModel.h"
+
+/*!
+ * Number of states evaluated together in one batch block: one 256-bit
+ * register worth of T
+ */
+template <typename T>
+struct BatchLanes {
+  static constexpr int value = 32 / sizeof(T);
+};
+
+/*!
+ * Array with one row per state in a batch
+ */
+template <typename T>
+using BatchArray = Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+/*!
+ * A batch of floating base model states, stored as a structure of arrays.
+ * Row i of each member is the state of batch entry i.
+ */
+template <typename T>
+struct FBModelStateBatch {
+  Eigen::Array<T, Eigen::Dynamic, 4> bodyOrientation;
+  Eigen::Array<T, Eigen::Dynamic, 3> bodyPosition;
+  Eigen::Array<T, Eigen::Dynamic, 6> bodyVelocity;  // body coordinates
+  BatchArray<T> q;
+  BatchArray<T> qd;
+
+  /*!
+   * Resize for n states of a model with nJoints joints
+   */
+  void resize(size_t n, size_t nJoints) {
+    bodyOrientation.resize(n, 4);
+    bodyPosition.resize(n, 3);
+    bodyVelocity.resize(n, 6);
+    q.resize(n, nJoints);
+    qd.resize(n, nJoints);
+  }
+
+  size_t size() const { return bodyOrientation.rows(); }
+
+  /*!
+   * Copy a single state into entry i
+   */
+  void setState(size_t i, const FBModelState<T>& state) {
+    bodyOrientation.row(i) = state.bodyOrientation.transpose().array();
+    bodyPosition.row(i) = state.bodyPosition.transpose().array();
+    bodyVelocity.row(i) = state.bodyVelocity.transpose().array();
+    q.row(i) = state.q.transpose().array();
+    qd.row(i) = state.qd.transpose().array();
+  }
+
+  /*!
+   * Copy entry i out into a single state
+   */
+  void getState(size_t i, FBModelState<T>& state) const {
+    state.bodyOrientation = bodyOrientation.row(i).transpose().matrix();
+    state.bodyPosition = bodyPosition.row(i).transpose().matrix();
+    state.bodyVelocity = bodyVelocity.row(i).transpose().matrix();
+    state.q = q.row(i).transpose().matrix();
+    state.qd = qd.row(i).transpose().matrix();
+  }
+};
+
+/*!
+ * A batch of floating base model state derivatives, stored as a structure of
+ * arrays.  Row i of each member belongs to batch entry i.
+ */
+template <typename T>
+struct FBModelStateDerivativeBatch {
+  Eigen::Array<T, Eigen::Dynamic, 3> dBodyPosition;  // world coordinates
+  Eigen::Array<T, Eigen::Dynamic, 6> dBodyVelocity;  // body coordinates
+  BatchArray<T> qdd;
+
+  /*!
+   * Resize for n states of a model with nJoints joints
+   */
+  void resize(size_t n, size_t nJoints) {
+    dBodyPosition.resize(n, 3);
+    dBodyVelocity.resize(n, 6);
+    qdd.resize(n, nJoints);
+  }
+
+  size_t size() const { return dBodyVelocity.rows(); }
+
+  /*!
+   * Copy a single state derivative into entry i
+   */
+  void setDerivative(size_t i, const FBModelStateDerivative<T>& dstate) {
+    dBodyPosition.row(i) = dstate.dBodyPosition.transpose().array();
+    dBodyVelocity.row(i) = dstate.dBodyVelocity.transpose().array();
+    qdd.row(i) = dstate.qdd.transpose().array();
+  }
+
+  /*!
+   * Copy entry i out into a single state derivative
+   */
+  void getDerivative(size_t i, FBModelStateDerivative<T>& dstate) const {
+    dstate.dBodyPosition = dBodyPosition.row(i).transpose().matrix();
+    dstate.dBodyVelocity = dBodyVelocity.row(i).transpose().matrix();
+    dstate.qdd = qdd.row(i).transpose().matrix();
+  }
+};
+
+/*!
+ * Runs the dynamics algorithms of a floating base model on W states at once.
+ * Every intermediate quantity is stored with one row per lane, so each
+ * arithmetic operation in the recursions is a W-wide SIMD operation.
+ *
+ * One instance only handles one block at a time; use one per thread.
+ */
+template <typename T, int NDOF, int W = BatchLanes<T>::value>
+class BatchFloatingBaseModel {
+  static_assert(NDOF > 6, "must have at least one joint");
+
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr int nJoints = NDOF - 6;
+  static constexpr int lanes = W;
+
+  using Lanes = Eigen::Array<T, W, 1>;
+  using LaneSVec = Eigen::Array<T, W, 6>;
+  using LaneMat6 = Eigen::Array<T, W, 36>;  // element (r, c) in column 6r + c
+
+  BatchFloatingBaseModel() : _gravity(0, 0, -9.81) {}
+
+  /*!
+   * Initialize from a finished floating base model
+   */
+  explicit BatchFloatingBaseModel(const FloatingBaseModel<T>& model)
+      : BatchFloatingBaseModel() {
+    setModel(model);
+  }
+
+  void setModel(const FloatingBaseModel<T>& model);
+
+  /*!
+   * Set the gravity
+   */
+  void setGravity(const Vec3<T>& g) { _gravity = g; }
+
+  void runABA(const FBModelStateBatch<T>& x, const BatchArray<T>& tau,
+              FBModelStateDerivativeBatch<T>& dx, size_t first);
+  void inverseDynamics(const FBModelStateBatch<T>& x,
+                       const FBModelStateDerivativeBatch<T>& dx,
+                       BatchArray<T>& genForce, size_t first);
+
+ private:
+  void loadState(const FBModelStateBatch<T>& x, size_t first);
+  void forwardKinematics();
+
+  Vec3<T> _gravity;
+  std::array<int, NDOF> _parents;
+  std::array<int, NDOF> _axes;
+  std::array<T, NDOF> _gearRatios;
+  std::array<Mat6<T>, NDOF> _Xtree, _Xrot, _Ibody, _Irot;
+
+  // per lane state
+  Eigen::Array<T, W, 9> _Rbody;  // body to world rotation, row major
+  Eigen::Array<T, W, nJoints> _q, _qd;
+
+  std::array<Lanes, NDOF> _cq, _sq, _cqrot, _sqrot, _d, _u;
+  std::array<LaneSVec, NDOF> _v, _vrot, _c, _crot, _a, _pA, _pArot, _Utot;
+  std::array<LaneMat6, NDOF> _IA;
+};
+
+/*!
+ * Multi-threaded front end for BatchFloatingBaseModel.  Splits a batch into
+ * blocks of W states and hands the blocks out to a persistent pool of worker
+ * threads (the calling thread works too).
+ */
+template <typename T, int NDOF>
+class BatchDynamicsEngine {
+ public:
+  using Kernel = BatchFloatingBaseModel<T, NDOF>;
+  static constexpr int nJoints = NDOF - 6;
+
+  BatchDynamicsEngine(const FloatingBaseModel<T>& model, size_t nThreads = 0);
+  ~BatchDynamicsEngine();
+  BatchDynamicsEngine(const BatchDynamicsEngine&) = delete;
+  BatchDynamicsEngine& operator=(const BatchDynamicsEngine&) = delete;
+
+  void setGravity(const Vec3<T>& g);
+
+  void runABA(const FBModelStateBatch<T>& x, const BatchArray<T>& tau,
+              FBModelStateDerivativeBatch<T>& dx);
+  void inverseDynamics(const FBModelStateBatch<T>& x,
+                       const FBModelStateDerivativeBatch<T>& dx,
+                       BatchArray<T>& genForce);
+
+  /*!
+   * Get the number of threads used, including the calling thread
+   */
+  size_t getNumThreads() const { return _kernels.size(); }
+
+ private:
+  void runBlocks(size_t nStates);
+  void workerLoop(size_t id);
+  void doBlocks(Kernel& kernel);
+
+  std::vector<std::unique_ptr<Kernel>> _kernels;
+  std::vector<std::thread> _workers;
+
+  std::mutex _mutex;
+  std::condition_variable _startCv, _doneCv;
+  std::function<void(Kernel&, size_t)> _job;
+  std::atomic<size_t> _nextBlock{0};
+  size_t _nBlocks = 0;
+  size_t _busyWorkers = 0;
+  uint64_t _generation = 0;
+  bool _stop = false;
+};
+
+#endif  // LIBBIOMIMETICS_BATCHFLOATINGBASEMODEL_H
@@ -12,8 +12,10 @@
 #include "Collision/CollisionBox.h"
 #include "Collision/CollisionMesh.h"
 #include "Collision/CollisionPlane.h"
+#include "Collision/CollisionTerrain.h"
 #include "Collision/ContactConstraint.h"
 #include "FloatingBaseModel.h"
+#include "Quadruped.h"
 #include "Math/orientation_tools.h"
 #include "spatial.h"
 
@@ -35,6 +37,32 @@ struct RobotHomingInfo {
   bool active_flag;
 };
 
+/*!
+ * Time integration schemes for DynamicsSimulator
+ */
+enum class DynamicsIntegrator {
+  SEMI_IMPLICIT_EULER = 0,  // velocities, then positions with new velocities
+  SYMPLECTIC = 1,           // position Verlet: half drift, kick, half drift
+  RK4 = 2,       // 4th order Runge-Kutta when nothing is in contact
+  ADAPTIVE = 3,  // RK4 in free flight, short Euler substeps near contact
+};
+
+/*!
+ * Everything a DynamicsSimulator carries from one step to the next, for
+ * saving and restoring a simulation.  The model, collision objects and
+ * settings are not included.
+ */
+template <typename T>
+struct DynamicsSimulatorState {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  FBModelState<T> state;
+  FBModelStateDerivative<T> dstate;
+  SVec<T> lastBodyVelocity;
+  FBModelStateDerivative<T> midpointDState;  // symplectic integrator only
+  bool midpointPredictionValid = false;
+  DVec<T> contactState;  // see ContactConstraint::getPersistentState
+};
+
 /*!
  * Class (containing state) for dynamics simulation of a floating-base system
  */
@@ -45,11 +73,51 @@ class DynamicsSimulator {
   DynamicsSimulator(
       FloatingBaseModel<T>& model,
       bool useSpringDamper = false);  //! Initialize simulator with given model
+  DynamicsSimulator(const DynamicsSimulator&) = delete;
+  ~DynamicsSimulator();
   void step(T dt, const DVec<T>& tau, T kp,
             T kd);  //! Simulate forward one step
 
   //! Find _dstate with the articulated body algorithm
-  void runABA(const DVec<T>& tau) { _model.runABA(tau, _dstate); }
+  void runABA(const DVec<T>& tau);
+
+  void setUseFixedSizeDynamics(bool useFixedSize);
+
+  void setIntegrator(DynamicsIntegrator integrator, T contactDt = 0.001);
+
+  /*!
+   * Get the integration scheme used by step
+   */
+  DynamicsIntegrator getIntegrator() const { return _integrator; }
+
+  /*!
+   * Get the average number of integration steps (including substeps) taken
+   * per simulated second since the last resetStepCounter
+   */
+  T getStepsPerSimSecond() const {
+    return _stepCounterTime > 0 ? _stepCounter / _stepCounterTime : 0;
+  }
+
+  /*!
+   * Get the wall time spent finding contacts and contact forces since the last
+   * resetStepCounter (s)
+   */
+  double getCollisionSeconds() const { return _collisionNs / 1.e9; }
+
+  /*!
+   * Restart counting integration steps for getStepsPerSimSecond, and the
+   * collision time
+   */
+  void resetStepCounter() {
+    _stepCounter = 0;
+    _stepCounterTime = 0;
+    _collisionNs = 0;
+  }
+
+  /*!
+   * Check if the ABA is run on the fixed-size quadruped model
+   */
+  bool usingFixedSizeDynamics() const { return _fixedModel != nullptr; }
 
   //! Do forward kinematics for feet
   void forwardKinematics() { _model.forwardKinematics(); }
@@ -63,8 +131,12 @@ class DynamicsSimulator {
   void setState(const FBModelState<T>& state) {
     _state = state;
     _model.setState(state);  // force recalculate dynamics
+    _midpointPredictionValid = false;
   }
 
+  void getSimulatorState(DynamicsSimulatorState<T>& state) const;
+  void setSimulatorState(const DynamicsSimulatorState<T>& state);
+
   /*!
    * Set the homing parameters of the simulator
    * @param homing : homing parameters
@@ -135,6 +207,18 @@ class DynamicsSimulator {
         new CollisionMesh<T>(mu, rest, grid_size, left_corner_loc, height_map));
   }
 
+  /*!
+   * Add a procedural terrain, which is generated around the robot as it moves
+   * @param terrain : the terrain, which may be shared with other simulators
+   * @return the collision object, to get the loaded chunks from
+   */
+  CollisionTerrain<T>* addCollisionTerrain(
+      std::shared_ptr<const ProceduralTerrain> terrain) {
+    CollisionTerrain<T>* collision = new CollisionTerrain<T>(terrain);
+    _contact_constr->AddCollision(collision);
+    return collision;
+  }
+
   /*!
    * Get the number of bodies (not including rotors)
    * @return number of bodies
@@ -164,14 +248,38 @@ class DynamicsSimulator {
 
  private:
   void updateCollisions(T dt, T kp, T kd);  //! Update ground collision list
+  void applyHoming();
+  void stepEuler(T dt, const DVec<T>& tau, T kp, T kd);
+  void stepSymplectic(T dt, const DVec<T>& tau, T kp, T kd);
+  void stepRK4(T dt, const DVec<T>& tau);
+  void stepAdaptive(T dt, const DVec<T>& tau, T kp, T kd);
+  void drift(T dt);
+  void packState(const FBModelState<T>& state, DVec<T>& x);
+  void unpackState(const DVec<T>& x, FBModelState<T>& state);
+  void stateDerivative(const DVec<T>& x, const DVec<T>& tau, DVec<T>& dx);
   FBModelState<T> _state;
   FBModelStateDerivative<T> _dstate;
   FloatingBaseModel<T>& _model;
+  FixedQuadrupedModel<T>* _fixedModel = nullptr;
   vector<CollisionPlane<T>> _collisionPlanes;
   ContactConstraint<T>* _contact_constr;
   SVec<T> _lastBodyVelocity;
   bool _useSpringDamper;
 
+  DynamicsIntegrator _integrator = DynamicsIntegrator::SEMI_IMPLICIT_EULER;
+  T _contactDt = 0.001;
+  bool _midpointPredictionValid = false;
+  T _stepCounter = 0;
+  T _stepCounterTime = 0;
+  int64_t _collisionNs = 0;
+
+  // scratch for the multi-stage integrators
+  vectorAligned<SVec<T>> _externalForcesNoContact;
+  FBModelState<T> _savedState, _stageState;
+  FBModelStateDerivative<T> _savedDState, _midpointDState;
+  SVec<T> _savedLastBodyVelocity;
+  DVec<T> _x0, _xStage, _k, _kSum;
+
   RobotHomingInfo<T> _homing;
 };
 
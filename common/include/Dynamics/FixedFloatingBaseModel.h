@@ -0,0 +1,145 @@
+/*! @file FixedFloatingBaseModel.h
+ *  @brief Fixed-size version of the rigid body floating base model
+ *
+ * FloatingBaseModel stores its tree in std::vectors and its system matrices in
+ * dynamically sized Eigen objects so that bodies can be added one at a time.
+ * Once a model is built the tree never changes, so this class copies a
+ * finished FloatingBaseModel into compile-time sized storage (std::array of
+ * Mat6 and NDOF x NDOF matrices).  This lets Eigen unroll and vectorize the
+ * recursions and keeps every algorithm free of heap allocations.
+ *
+ * Only the dynamics algorithms are provided (CRBA, RNEA, bias forces and ABA).
+ * Contact points, Jacobians and the operational space algorithms stay on the
+ * FloatingBaseModel this was built from.
+ */
+
+#ifndef LIBBIOMIMETICS_FIXEDFLOATINGBASEMODEL_H
+#define LIBBIOMIMETICS_FIXEDFLOATINGBASEMODEL_H
+
+#include <array>
+
+#include "Dynamics/FloatingBaseModel.h"
+
+/*!
+ * Floating base rigid body model with rotors, with the number of degrees of
+ * freedom fixed at compile time.  The body numbering is the same as
+ * FloatingBaseModel (bodies 0-4 are unused, 5 is the floating base).
+ */
+template <typename T, int NDOF>
+class FixedFloatingBaseModel {
+  static_assert(NDOF > 6, "must have at least one joint");
+
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr int nJoints = NDOF - 6;
+
+  using MassMatrix = Eigen::Matrix<T, NDOF, NDOF>;
+  using GeneralizedVec = Eigen::Matrix<T, NDOF, 1>;
+  using JointVec = Eigen::Matrix<T, NDOF - 6, 1>;
+
+  /*!
+   * Initialize an empty model with default gravity.  Use setModel before
+   * running any algorithms.
+   */
+  FixedFloatingBaseModel() : _gravity(0, 0, -9.81) {}
+
+  /*!
+   * Initialize from a finished floating base model
+   */
+  explicit FixedFloatingBaseModel(const FloatingBaseModel<T>& model)
+      : FixedFloatingBaseModel() {
+    setModel(model);
+  }
+
+  void setModel(const FloatingBaseModel<T>& model);
+  void setState(const FBModelState<T>& state);
+
+  /*!
+   * Set the gravity
+   */
+  void setGravity(const Vec3<T>& g) { _gravity = g; }
+
+  /*!
+   * Mark all previously calculated values as invalid
+   */
+  void resetCalculationFlags() {
+    _kinematicsUpToDate = false;
+    _biasAccelerationsUpToDate = false;
+    _compositeInertiasUpToDate = false;
+    _articulatedBodiesUpToDate = false;
+    _accelerationsUpToDate = false;
+  }
+
+  void setExternalForces(const vectorAligned<SVec<T>>& forces);
+
+  /*!
+   * Set all external forces to zero
+   */
+  void resetExternalForces() {
+    for (auto& f : _externalForces) f.setZero();
+  }
+
+  void forwardKinematics();
+  void biasAccelerations();
+  void compositeInertias();
+  void forwardAccelerationKinematics();
+
+  const GeneralizedVec& generalizedGravityForce();
+  const GeneralizedVec& generalizedCoriolisForce();
+  const MassMatrix& massMatrix();
+  const GeneralizedVec& inverseDynamics(const FBModelStateDerivative<T>& dState);
+  void runABA(const DVec<T>& tau, FBModelStateDerivative<T>& dstate);
+
+  /*!
+   * Get the mass matrix computed by the last call to massMatrix()
+   */
+  const MassMatrix& getMassMatrix() const { return _H; }
+
+  /*!
+   * Get the gravity term computed by the last call to generalizedGravityForce()
+   */
+  const GeneralizedVec& getGravityForce() const { return _G; }
+
+  /*!
+   * Get the coriolis term computed by the last call to
+   * generalizedCoriolisForce()
+   */
+  const GeneralizedVec& getCoriolisForce() const { return _Cqd; }
+
+  Vec3<T> _gravity;
+  std::array<int, NDOF> _parents;
+  std::array<T, NDOF> _gearRatios;
+  std::array<JointType, NDOF> _jointTypes;
+  std::array<CoordinateAxis, NDOF> _jointAxes;
+  std::array<Mat6<T>, NDOF> _Xtree, _Xrot, _Ibody, _Irot;
+
+  /// BEGIN ALGORITHM SUPPORT VARIABLES
+  Quat<T> _bodyOrientation;
+  Vec3<T> _bodyPosition;
+  SVec<T> _bodyVelocity;
+  JointVec _q, _qd, _qdd;
+  SVec<T> _dBodyVelocity;
+
+  std::array<SVec<T>, NDOF> _v, _vrot, _a, _arot, _avp, _avprot, _c, _crot,
+      _S, _Srot, _fvp, _fvprot, _ag, _agrot, _f, _frot;
+  std::array<SVec<T>, NDOF> _U, _Urot, _Utot, _pA, _pArot;
+  std::array<SVec<T>, NDOF> _externalForces;
+  std::array<Mat6<T>, NDOF> _Xup, _Xa, _Xuprot, _IA, _IC;
+  std::array<T, NDOF> _d, _u;
+
+  MassMatrix _H;
+  GeneralizedVec _Cqd, _G, _genForce;
+
+  Eigen::LLT<Mat6<T>> _invIA5;
+
+  bool _kinematicsUpToDate = false;
+  bool _biasAccelerationsUpToDate = false;
+  bool _compositeInertiasUpToDate = false;
+  bool _articulatedBodiesUpToDate = false;
+  bool _accelerationsUpToDate = false;
+
+  void updateArticulatedBodies();
+};
+
+#endif  // LIBBIOMIMETICS_FIXEDFLOATINGBASEMODEL_H
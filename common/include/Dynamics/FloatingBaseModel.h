@@ -136,6 +136,8 @@ class FloatingBaseModel {
 
   DMat<T> invContactInertia(const int gc_index,
                             const D6Mat<T>& force_directions);
+  void invContactInertia(const int gc_index, const D6Mat<T>& force_directions,
+                         DMat<T>& LambdaInv);
   T invContactInertia(const int gc_index, const Vec3<T>& force_ics_at_contact);
 
   T applyTestForce(const int gc_index, const Vec3<T>& force_ics_at_contact,
@@ -170,6 +172,8 @@ class FloatingBaseModel {
     _forcePropagatorsUpToDate = false;
     _qddEffectsUpToDate = false;
     _accelerationsUpToDate = false;
+    _massMatrixFactorUpToDate = false;
+    _massMatrixInverseUpToDate = false;
   }
 
   /*!
@@ -205,8 +209,39 @@ class FloatingBaseModel {
   DVec<T> generalizedCoriolisForce();
   DMat<T> massMatrix();
   DVec<T> inverseDynamics(const FBModelStateDerivative<T>& dState);
+
+  void generalizedGravityForce(DVec<T>& G);
+  void generalizedCoriolisForce(DVec<T>& Cqd);
+  void massMatrix(DMat<T>& H);
+  void inverseDynamics(const FBModelStateDerivative<T>& dState,
+                       DVec<T>& genForce);
   void runABA(const DVec<T>& tau, FBModelStateDerivative<T>& dstate);
 
+  void inverseDynamicsDerivatives(const FBModelStateDerivative<T>& dState,
+                                  DMat<T>& dtau_dq, DMat<T>& dtau_dqd);
+  void forwardDynamicsDerivatives(const DVec<T>& tau,
+                                  FBModelStateDerivative<T>& dstate,
+                                  DMat<T>& dqdd_dq, DMat<T>& dqdd_dqd,
+                                  DMat<T>& dqdd_dtau);
+
+  void factorMassMatrix();
+  DVec<T> solveMassMatrix(const DVec<T>& rhs);
+  DMat<T> solveMassMatrix(const DMat<T>& rhs);
+  void solveMassMatrix(const DVec<T>& rhs, DVec<T>& x);
+  void solveMassMatrix(const DMat<T>& rhs, DMat<T>& x);
+  const DMat<T>& massMatrixInverse();
+  DMat<T> inverseOperationalSpaceInertia(const DMat<T>& J);
+  void inverseOperationalSpaceInertia(const DMat<T>& J, DMat<T>& LambdaInv);
+
+  /*!
+   * Get the parent of a degree of freedom in the tree used by the sparse mass
+   * matrix factorization.  The six floating base dofs are treated as a chain.
+   * @return parent dof, or -1 for the first dof
+   */
+  int dofParent(size_t i) const {
+    return i < 6 ? (int)i - 1 : _parents[i];
+  }
+
   size_t _nDof = 0;
   Vec3<T> _gravity;
   vector<int> _parents;
@@ -218,6 +253,9 @@ class FloatingBaseModel {
   vector<Mat6<T>, Eigen::aligned_allocator<Mat6<T>>> _Xtree, _Xrot;
   vector<SpatialInertia<T>, Eigen::aligned_allocator<SpatialInertia<T>>> _Ibody,
       _Irot;
+  // compact copies of _Xtree, _Xrot, _Ibody and _Irot used by the recursions
+  vector<SpatialTransform<T>> _XtreeCompact, _XrotCompact;
+  vectorAligned<RigidBodyInertia<T>> _IbodyCompact, _IrotCompact;
   vector<std::string> _bodyNames;
 
   size_t _nGroundContact = 0;
@@ -256,11 +294,16 @@ class FloatingBaseModel {
   vectorAligned<SVec<T>> _U, _Urot, _Utot, _pA, _pArot;
   vectorAligned<SVec<T>> _externalForces;
 
-  vectorAligned<SpatialInertia<T>> _IC;
+  vectorAligned<SVec<T>> _dv, _da, _df, _dfrot;
+  vector<bool> _dActive;
+
+  vectorAligned<RigidBodyInertia<T>> _IC;
   vectorAligned<Mat6<T>> _Xup, _Xa, _Xuprot, _IA, _ChiUp;
+  vector<SpatialTransform<T>> _XupCompact, _XaCompact, _XuprotCompact;
 
   DMat<T> _H, _C;
   DVec<T> _Cqd, _G;
+  DMat<T> _L, _Hinv;
 
   vectorAligned<D6Mat<T>> _J;
   vectorAligned<SVec<T>> _Jdqd;
@@ -277,6 +320,7 @@ class FloatingBaseModel {
   void updateArticulatedBodies();
   void updateForcePropagators();
   void udpateQddEffects();
+  void inverseDynamicsDirection(size_t j, bool velocity, DMat<T>& dtau);
 
   /*!
    * Set all external forces to zero
@@ -290,9 +334,21 @@ class FloatingBaseModel {
   bool _articulatedBodiesUpToDate = false;
   bool _forcePropagatorsUpToDate = false;
   bool _qddEffectsUpToDate = false;
+  bool _massMatrixFactorUpToDate = false;
+  bool _massMatrixInverseUpToDate = false;
+
+  template <typename Derived>
+  void solveLT(Eigen::MatrixBase<Derived>& x);
+  template <typename Derived>
+  void solveL(Eigen::MatrixBase<Derived>& x);
 
   DMat<T> _qdd_from_base_accel;
   DMat<T> _qdd_from_subqdd;
+
+  // scratch space, so the out-parameter algorithms don't allocate once warm
+  D6Mat<T> _contactDirections, _contactDirectionsTmp;
+  DMat<T> _opspWork;
+  DVec<T> _genForce;
   Eigen::ColPivHouseholderQR<Mat6<T>> _invIA5;
 };
 
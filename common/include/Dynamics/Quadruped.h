@@ -12,6 +12,7 @@
 
 #include <vector>
 #include "Dynamics/ActuatorModel.h"
+#include "Dynamics/FixedFloatingBaseModel.h"
 #include "Dynamics/FloatingBaseModel.h"
 #include "Dynamics/SpatialInertia.h"
 
@@ -30,6 +31,13 @@ constexpr size_t num_leg = 4;
 constexpr size_t num_leg_joint = 3;
 }  // namespace cheetah
 
+/*!
+ * Fixed-size dynamics model for cheetah-shaped robots.  Construct it from the
+ * result of Quadruped::buildModel()
+ */
+template <typename T>
+using FixedQuadrupedModel = FixedFloatingBaseModel<T, cheetah::dim_config>;
+
 /*!
  * Link indices for cheetah-shaped robots
  */
@@ -170,4 +170,120 @@ class SpatialInertia {
   Mat6<T> _inertia;
 };
 
+/*!
+ * Rigid body spatial inertia stored as its 10 inertial parameters instead of a
+ * 6x6 matrix: mass, first mass moment h = m * com, and the rotational inertia
+ * about the frame origin, in the MassProperties order.  Sums of rigid body
+ * inertias (composite inertias) have the same form; articulated body inertias
+ * do not.
+ */
+template <typename T>
+class RigidBodyInertia {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  /*!
+   * If no argument is given, zero.
+   */
+  RigidBodyInertia() { _a.setZero(); }
+
+  /*!
+   * Construct from mass property vector
+   */
+  explicit RigidBodyInertia(const MassProperties<T>& a) : _a(a) {}
+
+  /*!
+   * Construct from a 6x6 spatial inertia of a rigid body
+   */
+  explicit RigidBodyInertia(const Mat6<T>& I) {
+    Vec3<T> h = matToSkewVec(I.template topRightCorner<3, 3>());
+    _a << I(5, 5), h(0), h(1), h(2), I(0, 0), I(1, 1), I(2, 2), I(2, 1),
+        I(2, 0), I(1, 0);
+  }
+
+  /*!
+   * Construct from a spatial inertia
+   */
+  explicit RigidBodyInertia(const SpatialInertia<T>& I)
+      : RigidBodyInertia(I.getMatrix()) {}
+
+  /*!
+   * Get the mass property vector
+   */
+  const MassProperties<T>& asMassPropertyVector() const { return _a; }
+
+  /*!
+   * Get mass
+   */
+  T getMass() const { return _a(0); }
+
+  /*!
+   * Get first mass moment (mass times center of mass)
+   */
+  Vec3<T> getFirstMoment() const { return _a.template segment<3>(1); }
+
+  /*!
+   * Get 3x3 rotational inertia about the frame origin
+   */
+  Mat3<T> getRotationalInertia() const {
+    Mat3<T> I;
+    I << _a(4), _a(9), _a(8), _a(9), _a(5), _a(7), _a(8), _a(7), _a(6);
+    return I;
+  }
+
+  /*!
+   * Convert to a 6x6 spatial inertia matrix
+   */
+  Mat6<T> toMatrix() const {
+    Mat6<T> I;
+    Mat3<T> hSkew = vectorToSkewMat(getFirstMoment());
+    I.template topLeftCorner<3, 3>() = getRotationalInertia();
+    I.template topRightCorner<3, 3>() = hSkew;
+    I.template bottomLeftCorner<3, 3>() = hSkew.transpose();
+    I.template bottomRightCorner<3, 3>() = getMass() * Mat3<T>::Identity();
+    return I;
+  }
+
+  /*!
+   * Multiply a motion vector: I * v
+   */
+  SVec<T> operator*(const SVec<T>& v) const {
+    Vec3<T> w = v.template head<3>();
+    Vec3<T> vLin = v.template tail<3>();
+    Vec3<T> h = getFirstMoment();
+    SVec<T> f;
+    f.template head<3>() = getRotationalInertia() * w + h.cross(vLin);
+    f.template tail<3>() = getMass() * vLin - h.cross(w);
+    return f;
+  }
+
+  /*!
+   * Add another rigid body inertia expressed in the same frame
+   */
+  RigidBodyInertia& operator+=(const RigidBodyInertia& b) {
+    _a += b._a;
+    return *this;
+  }
+
+  /*!
+   * Express this inertia in the parent frame of X: X^T * I * X
+   */
+  RigidBodyInertia transform(const SpatialTransform<T>& X) const {
+    T m = getMass();
+    Vec3<T> y = X.R.transpose() * getFirstMoment();
+    const Vec3<T>& r = X.p;
+    Mat3<T> I = X.R.transpose() * getRotationalInertia() * X.R -
+                r * y.transpose() - y * r.transpose() -
+                m * r * r.transpose();
+    I.diagonal().array() += 2 * y.dot(r) + m * r.squaredNorm();
+    Vec3<T> h = y + m * r;
+    MassProperties<T> a;
+    a << m, h(0), h(1), h(2), I(0, 0), I(1, 1), I(2, 2), I(2, 1), I(2, 0),
+        I(1, 0);
+    return RigidBodyInertia(a);
+  }
+
+ private:
+  MassProperties<T> _a;
+};
+
 #endif  // LIBBIOMIMETICS_SPATIALINERTIA_H
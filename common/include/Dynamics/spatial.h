@@ -234,6 +234,117 @@ Mat6<T> jointXform(JointType joint, CoordinateAxis axis, T q) {
   return X;
 }
 
+/*!
+ * Plucker coordinate transform stored as a rotation and a translation instead
+ * of a 6x6 matrix.  Represents the same transform as createSXform(R, p):
+ *   X = [R, 0; -R * skew(p), R]
+ * Applying it to a spatial vector takes 24 multiply-adds instead of 36 and
+ * composing two of them takes 36 instead of 216.  Inertias are transformed with
+ * RigidBodyInertia::transform.
+ */
+template <typename T>
+class SpatialTransform {
+ public:
+  /*!
+   * Identity transform
+   */
+  SpatialTransform() : R(RotMat<T>::Identity()), p(Vec3<T>::Zero()) {}
+
+  /*!
+   * Transform to a frame rotated by R and translated by p
+   */
+  SpatialTransform(const RotMat<T>& rot, const Vec3<T>& trans)
+      : R(rot), p(trans) {}
+
+  /*!
+   * Construct from a 6x6 spatial transform matrix
+   */
+  explicit SpatialTransform(const Mat6<T>& X)
+      : R(rotationFromSXform(X)), p(translationFromSXform(X)) {}
+
+  /*!
+   * Convert to a 6x6 spatial transform matrix
+   */
+  Mat6<T> toMatrix() const { return createSXform(R, p); }
+
+  /*!
+   * Transform a motion vector: X * v
+   */
+  SVec<T> apply(const SVec<T>& v) const {
+    Vec3<T> w = v.template head<3>();
+    SVec<T> out;
+    out.template head<3>() = R * w;
+    out.template tail<3>() = R * (v.template tail<3>() - p.cross(w));
+    return out;
+  }
+
+  /*!
+   * Transform a force vector backwards: X^T * f
+   */
+  SVec<T> applyTranspose(const SVec<T>& f) const {
+    Vec3<T> fLin = R.transpose() * f.template tail<3>();
+    SVec<T> out;
+    out.template head<3>() =
+        R.transpose() * f.template head<3>() + p.cross(fLin);
+    out.template tail<3>() = fLin;
+    return out;
+  }
+
+  /*!
+   * Transform a motion vector backwards: X^-1 * v
+   */
+  SVec<T> applyInverse(const SVec<T>& v) const {
+    Vec3<T> w = R.transpose() * v.template head<3>();
+    SVec<T> out;
+    out.template head<3>() = w;
+    out.template tail<3>() = R.transpose() * v.template tail<3>() + p.cross(w);
+    return out;
+  }
+
+  /*!
+   * Transform a point into the new frame
+   */
+  Vec3<T> transformPoint(const Vec3<T>& x) const { return R * (x - p); }
+
+  /*!
+   * Compose transforms: (*this) * b, which applies b first
+   */
+  SpatialTransform operator*(const SpatialTransform& b) const {
+    return SpatialTransform(R * b.R, b.p + b.R.transpose() * p);
+  }
+
+  /*!
+   * Inverse transform (same as invertSXform)
+   */
+  SpatialTransform inverse() const {
+    return SpatialTransform(R.transpose(), -R * p);
+  }
+
+  RotMat<T> R;  // coordinate rotation
+  Vec3<T> p;    // origin of the new frame, in the old frame
+};
+
+/*!
+ * Compute joint transformation as a SpatialTransform (see jointXform)
+ */
+template <typename T>
+SpatialTransform<T> jointTransform(JointType joint, CoordinateAxis axis, T q) {
+  if (joint == JointType::Revolute) {
+    return SpatialTransform<T>(coordinateRotation(axis, q), Vec3<T>::Zero());
+  } else if (joint == JointType::Prismatic) {
+    Vec3<T> v(0, 0, 0);
+    if (axis == CoordinateAxis::X)
+      v(0) = q;
+    else if (axis == CoordinateAxis::Y)
+      v(1) = q;
+    else if (axis == CoordinateAxis::Z)
+      v(2) = q;
+    return SpatialTransform<T>(RotMat<T>::Identity(), v);
+  } else {
+    throw std::runtime_error("Unknown joint xform\n");
+  }
+}
+
 /*!
  * Construct the rotational inertia of a uniform density box with a given mass.
  * @param mass Mass of the box
@@ -48,6 +48,16 @@ class ImuSimulator {
                           const FBModelStateDerivative<T>& robotStateD,
                           CheaterState<T>& state);
 
+  /*!
+   * Get the random number generator for the sensor noise, to save its state
+   */
+  const std::mt19937& getNoiseGenerator() const { return _mt; }
+
+  /*!
+   * Restore the sensor noise random number generator
+   */
+  void setNoiseGenerator(const std::mt19937& mt) { _mt = mt; }
+
  private:
   SimulatorControlParameters& _simSettings;
   std::mt19937 _mt;
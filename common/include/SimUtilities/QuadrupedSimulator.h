@@ -0,0 +1,104 @@
+/*! @file QuadrupedSimulator.h
+ *  @brief The simulator side of one robot: rigid body dynamics, low level
+ *  boards, actuator models and IMU
+ *
+ *  This is everything the simulator GUI (SimulatedRobot) and the headless
+ *  batch simulator (BatchSimulation) do for a robot each dynamics step, apart
+ *  from reaching the controller.  The caller runs the controller between
+ *  writeSensorData and readCommands, through shared memory or directly.
+ */
+
+#ifndef PROJECT_QUADRUPEDSIMULATOR_H
+#define PROJECT_QUADRUPEDSIMULATOR_H
+
+#include <string>
+
+#include "ControlParameters/SimulatorParameters.h"
+#include "Dynamics/BatchActuatorModel.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/Quadruped.h"
+#include "SimUtilities/ImuSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
+#include "SimUtilities/SimulatorMessage.h"
+#include "SimUtilities/SpineBoard.h"
+#include "SimUtilities/TrajectoryRecorder.h"
+#include "SimUtilities/ti_boardcontrol.h"
+
+/*!
+ * One simulated Mini Cheetah or Cheetah 3.  A dynamics step is:
+ *   lowLevelControl()                      when the boards are due
+ *   writeSensorData(), controller,
+ *   readCommands()                         when the controller is due
+ *   updateActuators(), integrate()         every step
+ */
+class QuadrupedSimulator {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  QuadrupedSimulator(RobotType robot, SimulatorControlParameters& params,
+                     const Vec3<double>& offset = Vec3<double>::Zero(),
+                     u64 imuSeed = 0);
+  ~QuadrupedSimulator();
+  QuadrupedSimulator(const QuadrupedSimulator&) = delete;
+  QuadrupedSimulator& operator=(const QuadrupedSimulator&) = delete;
+
+  RobotType getRobotType() const { return _robot; }
+
+  /*!
+   * Get where the robot starts in the world.  The controller sees positions
+   * relative to this.
+   */
+  const Vec3<double>& getOffset() const { return _offset; }
+
+  Quadruped<double>& getQuadruped() { return _quadruped; }
+  DynamicsSimulator<double>& getSimulator() { return *_simulator; }
+  const DynamicsSimulator<double>& getSimulator() const { return *_simulator; }
+  const FBModelState<double>& getState() { return _simulator->getState(); }
+  void setState(const FBModelState<double>& state) {
+    _simulator->setState(state);
+  }
+
+  /*!
+   * Get the joint torques applied in the last step
+   */
+  const DVec<double>& getTorques() const { return _tau; }
+
+  /*!
+   * Get the number of controller ticks so far
+   */
+  u64 getHighLevelIterations() const { return _highLevelIterations; }
+
+  void lowLevelControl();
+  void writeSensorData(SimulatorToRobotMessage& message);
+  void readCommands(const RobotToSimulatorMessage& message);
+  void updateActuators(double dt);
+  void integrate(double time, double dt);
+
+  SimulationSnapshot snapshot(double time, double timeOfNextLowLevelControl,
+                              double timeOfNextHighLevelControl);
+  void restore(const SimulationSnapshot& snapshot);
+
+  void openTrajectory(const std::string& fileName, double duration);
+  TrajectoryRecorder& getTrajectory() { return _trajectoryRecorder; }
+
+ private:
+  void updateThermalModel();
+
+  RobotType _robot;
+  Vec3<double> _offset;
+  SimulatorControlParameters& _simParams;
+
+  Quadruped<double> _quadruped;
+  FloatingBaseModel<double> _model;
+  DynamicsSimulator<double>* _simulator = nullptr;
+  ImuSimulator<double>* _imuSimulator = nullptr;
+  BatchActuatorModel<double> _actuators;
+  DVec<double> _tau;
+  SpiCommand _spiCommand;
+  SpiData _spiData;
+  SpineBoard _spineBoards[4];
+  TI_BoardControl _tiBoards[4];
+  TrajectoryRecorder _trajectoryRecorder;
+  u64 _highLevelIterations = 0;
+};
+
+#endif  // PROJECT_QUADRUPEDSIMULATOR_H
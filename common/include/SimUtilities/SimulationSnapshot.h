@@ -0,0 +1,53 @@
+/*! @file SimulationSnapshot.h
+ *  @brief Saved state of a running simulation
+ *
+ *  A SimulationSnapshot holds everything the simulator changes while it runs:
+ *  the rigid body and contact state, the low level board state, the IMU noise
+ *  generator and the simulation clock.  Restoring it into a simulation of the
+ *  same robot on the same terrain continues exactly where the snapshot was
+ *  taken.  The robot controller is not included.
+ */
+
+#ifndef PROJECT_SIMULATIONSNAPSHOT_H
+#define PROJECT_SIMULATIONSNAPSHOT_H
+
+#include <random>
+#include <string>
+
+#include "Dynamics/DynamicsSimulator.h"
+#include "SimUtilities/SpineBoard.h"
+#include "SimUtilities/ti_boardcontrol.h"
+#include "cppTypes.h"
+
+/*!
+ * State of the simulator side of a simulation at one instant
+ */
+struct SimulationSnapshot {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  RobotType robot = RobotType::MINI_CHEETAH;
+  double currentSimTime = 0;
+  double timeOfNextLowLevelControl = 0;
+  double timeOfNextHighLevelControl = 0;
+  u64 highLevelIterations = 0;
+
+  DynamicsSimulatorState<double> dynamics;
+  std::mt19937 imuNoise;
+
+  // Mini Cheetah spine boards
+  SpiCommand spiCommand;
+  SpiData spiData;
+  float spineTorque[4][3];
+  s32 spineIterations[4];
+
+  // Cheetah 3 TI boards
+  TiBoardCommand tiBoardCommand[4];
+  TiBoardData tiBoardData[4];
+
+  // motor winding temperatures, if the thermal model is enabled
+  double motorTemperature[12];
+
+  void save(const std::string& fileName) const;
+  void load(const std::string& fileName);
+};
+
+#endif  // PROJECT_SIMULATIONSNAPSHOT_H
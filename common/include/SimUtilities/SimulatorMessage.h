@@ -17,6 +17,15 @@
 #include "SimUtilities/ti_boardcontrol.h"
 #include "Utilities/SharedMemory.h"
 
+/*!
+ * Name of the shared memory connecting the simulator to the controller of one
+ * of its robots.  Robot 0 uses the name robot programs have always used.
+ */
+inline std::string simulatorSharedMemoryName(size_t robot) {
+  if (robot == 0) return DEVELOPMENT_SIMULATOR_SHARED_MEMORY_NAME;
+  return DEVELOPMENT_SIMULATOR_SHARED_MEMORY_NAME "-" + std::to_string(robot);
+}
+
 /*!
  * The mode for the simulator
  */
@@ -63,6 +72,14 @@ struct RobotToSimulatorMessage {
   char errorMessage[2056];
 };
 
+/*!
+ * How the simulator and robot wait for each other
+ */
+enum class SimulatorHandoff {
+  SEMAPHORE,  // POSIX semaphores, always sleeps
+  SPIN_FUTEX  // spin, then sleep with a futex, see SharedMemoryFutex
+};
+
 /*!
  * All the data shared between the robot and the simulator
  */
@@ -95,44 +112,128 @@ struct SimulatorSyncronizedMessage : public SimulatorMessage {
   void init() {
     robotToSimSemaphore.init(0);
     simToRobotSemaphore.init(0);
+    robotToSimFutex.init(0);
+    simToRobotFutex.init(0);
   }
 
+  /*!
+   * Select how the simulator and robot hand off the message.  The simulator
+   * should do this right after creating the shared memory, before the robot
+   * connects.
+   */
+  void setHandoff(SimulatorHandoff h) { handoff = h; }
+
   /*!
    * Wait for the simulator to respond
    */
-  void waitForSimulator() { simToRobotSemaphore.decrement(); }
+  void waitForSimulator() {
+    if (handoff == SimulatorHandoff::SPIN_FUTEX) {
+      simToRobotFutex.decrement();
+    } else {
+      simToRobotSemaphore.decrement();
+    }
+    robotWakeTime = handoffClock();
+  }
 
   /*!
    * Simulator signals that it is done
    */
-  void simulatorIsDone() { simToRobotSemaphore.increment(); }
+  void simulatorIsDone() {
+    simSignalTime = handoffClock();
+    if (handoff == SimulatorHandoff::SPIN_FUTEX) {
+      simToRobotFutex.increment();
+    } else {
+      simToRobotSemaphore.increment();
+    }
+  }
 
   /*!
    * Wait for the robot to finish
    */
-  void waitForRobot() { robotToSimSemaphore.decrement(); }
+  void waitForRobot() {
+    if (handoff == SimulatorHandoff::SPIN_FUTEX) {
+      robotToSimFutex.decrement();
+    } else {
+      robotToSimSemaphore.decrement();
+    }
+    simWakeTime = handoffClock();
+  }
 
   /*!
    * Check if the robot is done
    * @return if the robot is done
    */
-  bool tryWaitForRobot() { return robotToSimSemaphore.tryDecrement(); }
+  bool tryWaitForRobot() {
+    bool done = handoff == SimulatorHandoff::SPIN_FUTEX
+                    ? robotToSimFutex.tryDecrement()
+                    : robotToSimSemaphore.tryDecrement();
+    simWakeTime = handoffClock();
+    return done;
+  }
 
   /*!
    * Wait for the robot to finish with a timeout
    * @return if we finished before timing out
    */
   bool waitForRobotWithTimeout() {
-    return robotToSimSemaphore.decrementTimeout(1, 0);
+    bool done = handoff == SimulatorHandoff::SPIN_FUTEX
+                    ? robotToSimFutex.decrementTimeout(1, 0)
+                    : robotToSimSemaphore.decrementTimeout(1, 0);
+    simWakeTime = handoffClock();
+    return done;
   }
 
   /*!
    * Signal that the robot is done
    */
-  void robotIsDone() { robotToSimSemaphore.increment(); }
+  void robotIsDone() {
+    robotSignalTime = handoffClock();
+    if (handoff == SimulatorHandoff::SPIN_FUTEX) {
+      robotToSimFutex.increment();
+    } else {
+      robotToSimSemaphore.increment();
+    }
+  }
+
+  /*!
+   * Time spent handing the message to the robot and back during the last
+   * exchange, not counting the time the robot spent running.  Only valid after
+   * the simulator has successfully waited for the robot.
+   * @return latency in nanoseconds
+   */
+  s64 lastHandoffLatency() {
+    return (robotWakeTime - simSignalTime) + (simWakeTime - robotSignalTime);
+  }
 
  private:
+  static s64 handoffClock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (s64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+
+  SimulatorHandoff handoff = SimulatorHandoff::SEMAPHORE;
   SharedMemorySemaphore robotToSimSemaphore, simToRobotSemaphore;
+  SharedMemoryFutex robotToSimFutex, simToRobotFutex;
+  s64 simSignalTime = 0, robotWakeTime = 0, robotSignalTime = 0,
+      simWakeTime = 0;
+};
+
+/*!
+ * The robot side of the simulator/robot exchange, linked into the simulator
+ * process.  Instead of signalling the robot process and waiting for it, the
+ * simulator calls handleSimulatorMessage() on the same message, so each
+ * control tick avoids two context switches between processes.
+ */
+class InProcessRobot {
+ public:
+  virtual ~InProcessRobot() = default;
+
+  /*!
+   * Do what the robot process does between waitForSimulator() and
+   * robotIsDone(), on the simulator's message
+   */
+  virtual void handleSimulatorMessage(SimulatorSyncronizedMessage& message) = 0;
 };
 
 #endif  // PROJECT_SIMULATORTOROBOTMESSAGE_H
@@ -58,12 +58,16 @@ class SpineBoard {
   SpineBoard() {}
   void init(float side_sign, s32 board);
   void run();
+  static void runAll(SpineBoard (&boards)[4]);
   void resetData();
   void resetCommand();
   SpiCommand* cmd = nullptr;
   SpiData* data = nullptr;
   float torque_out[3];
 
+  s32 getIterationCount() const { return iter_counter; }
+  void setIterationCount(s32 count) { iter_counter = count; }
+
  private:
   float side_sign;
   s32 board_num;
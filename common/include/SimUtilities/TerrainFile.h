@@ -0,0 +1,40 @@
+/*! @file TerrainFile.h
+ *  @brief Parser for simulator terrain files
+ *
+ *  Reads the collision geometry described in a terrain yaml file (see
+ *  config/default-terrain.yaml) without any graphics, so that both the
+ *  simulator GUI and headless simulations can load the same terrains.
+ */
+
+#ifndef PROJECT_TERRAINFILE_H
+#define PROJECT_TERRAINFILE_H
+
+#include <functional>
+#include <string>
+
+#include "Collision/ProceduralTerrain.h"
+#include "cppTypes.h"
+
+/*!
+ * Functions called for each element found in a terrain file
+ */
+struct TerrainFileCallbacks {
+  std::function<void(double mu, double resti, double height, double sizeX,
+                     double sizeY, double checkerX, double checkerY)>
+      addPlane;
+  std::function<void(double mu, double resti, double depth, double width,
+                     double height, const Vec3<double>& pos,
+                     const Mat3<double>& ori, bool transparent)>
+      addBox;
+  std::function<void(double mu, double resti, double grid,
+                     const Vec3<double>& leftCorner,
+                     const DMat<double>& heightMap, bool transparent)>
+      addMesh;
+  std::function<void(const ProceduralTerrainParameters& params)>
+      addProceduralTerrain;
+};
+
+void parseTerrainFile(const std::string& terrainFileName,
+                      const TerrainFileCallbacks& callbacks);
+
+#endif  // PROJECT_TERRAINFILE_H
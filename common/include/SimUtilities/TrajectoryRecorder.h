@@ -0,0 +1,121 @@
+/*! @file TrajectoryRecorder.h
+ *  @brief Record every dynamics step of a simulation to a file, and play it
+ *  back
+ *
+ *  Trajectory files are a 64 byte header followed by fixed size records of
+ *  doubles, one per dynamics step.  The recorder writes through a memory
+ *  mapping of a preallocated file, so recording a step is a copy into memory
+ *  with no system calls.  See scripts/read_trajectory.py for the layout.
+ */
+
+#ifndef PROJECT_TRAJECTORYRECORDER_H
+#define PROJECT_TRAJECTORYRECORDER_H
+
+#include <string>
+
+#include "Dynamics/DynamicsSimulator.h"
+#include "cppTypes.h"
+
+/*!
+ * Header at the start of a trajectory file
+ */
+struct TrajectoryFileHeader {
+  char magic[8];      // "CHTRAJ\0\0"
+  u32 version;
+  u32 nQ;             // number of joints
+  u32 nContacts;      // number of ground contact points
+  u32 recordSize;     // bytes per record
+  u64 nRecords;       // number of records written so far
+  double dt;          // nominal time between records
+  u8 reserved[24];
+};
+
+/*!
+ * Read access to the records in a memory-mapped trajectory file.  Each record
+ * holds, in order: time, body orientation quaternion (w, x, y, z), body
+ * position, body velocity (angular, linear, body coordinates), q, qd, joint
+ * torques and the contact force on each ground contact point (world frame).
+ */
+class TrajectoryFile {
+ public:
+  TrajectoryFile() = default;
+  TrajectoryFile(const TrajectoryFile&) = delete;
+  TrajectoryFile& operator=(const TrajectoryFile&) = delete;
+
+  /*!
+   * Check if there is a file open
+   */
+  bool isOpen() const { return _header != nullptr; }
+
+  /*!
+   * Get the number of records in the file
+   */
+  size_t size() const { return _header ? _header->nRecords : 0; }
+
+  size_t getNumJoints() const { return _header->nQ; }
+  size_t getNumContacts() const { return _header->nContacts; }
+
+  /*!
+   * Get the time of a record
+   */
+  double getTime(size_t i) const { return record(i)[0]; }
+
+  size_t findRecord(double time) const;
+  void getRecord(size_t i, FBModelState<double>& state, DVec<double>& tau,
+                 vectorAligned<Vec3<double>>& contactForces) const;
+
+ protected:
+  static size_t recordDoubles(size_t nQ, size_t nContacts) {
+    return 14 + 3 * nQ + 3 * nContacts;
+  }
+
+  const double* record(size_t i) const {
+    return reinterpret_cast<const double*>(_data + sizeof(TrajectoryFileHeader) +
+                                           i * _header->recordSize);
+  }
+
+  TrajectoryFileHeader* _header = nullptr;
+  u8* _data = nullptr;
+  size_t _mappedSize = 0;
+  int _fd = -1;
+};
+
+/*!
+ * Appends a record for each dynamics step to a trajectory file.  The file
+ * grows by doubling when it is full, so give a capacity which is large enough
+ * for the whole run to never make a system call while recording.
+ */
+class TrajectoryRecorder : public TrajectoryFile {
+ public:
+  TrajectoryRecorder() = default;
+  ~TrajectoryRecorder() { close(); }
+
+  void open(const std::string& fileName, size_t nQ, size_t nContacts,
+            double dt, size_t capacity = 1 << 16);
+  void record(double time, DynamicsSimulator<double>& sim,
+              const DVec<double>& tau);
+  void truncate(double time);
+  void close();
+
+ private:
+  void grow();
+
+  size_t _capacity = 0;
+};
+
+/*!
+ * Opens a trajectory file read-only, to look at a finished recording
+ */
+class TrajectoryReplayer : public TrajectoryFile {
+ public:
+  TrajectoryReplayer() = default;
+  ~TrajectoryReplayer() { close(); }
+
+  void open(const std::string& fileName);
+  void close();
+
+ private:
+  TrajectoryFileHeader _headerCopy;
+};
+
+#endif  // PROJECT_TRAJECTORYRECORDER_H
@@ -0,0 +1,39 @@
+/*! @file AllocationCounter.h
+ *  @brief Debug tool for counting heap allocations made by a block of code
+ *
+ * With glibc, malloc and friends are wrapped so that every allocation made by
+ * a thread that is currently counting is recorded.  operator new and Eigen both
+ * allocate through malloc, so they are counted too.  A thread which isn't
+ * counting only pays for checking a thread local flag.  With other C libraries
+ * nothing is wrapped and the counter always reads zero.
+ */
+
+#ifndef PROJECT_ALLOCATIONCOUNTER_H
+#define PROJECT_ALLOCATIONCOUNTER_H
+
+#include <stdint.h>
+
+/*!
+ * Counts heap allocations made by the calling thread between start() and
+ * stop()
+ */
+class AllocationCounter {
+ public:
+  /*!
+   * Construct and start counting
+   */
+  explicit AllocationCounter() { start(); }
+
+  ~AllocationCounter() { stop(); }
+
+  void start();
+  uint64_t stop();
+  uint64_t getCount() const;
+
+  static bool hooksInstalled();
+
+ private:
+  bool _running = false;
+};
+
+#endif  // PROJECT_ALLOCATIONCOUNTER_H
@@ -8,15 +8,23 @@
 #define PROJECT_SHAREDMEMORY_H
 
 #include <fcntl.h>
+#include <sched.h>
 #include <semaphore.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <atomic>
 #include <cassert>
 #include <cstring>
+#include <ctime>
 #include <stdexcept>
 #include <string>
 
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 #include "cTypes.h"
 
 
@@ -96,6 +104,143 @@ class SharedMemorySemaphore {
   bool _init = false;
 };
 
+/*!
+ * A counting semaphore for shared memory which spins before sleeping.
+ * Waiting first polls the count for a while, which costs about a cache line
+ * transfer when the other process posts soon, and then sleeps with a futex.
+ * The spin time adapts to how long recent waits took, so a waiter which
+ * usually has to sleep (for example, when the simulator is running in real
+ * time) stops burning its core. There is no spinning on a single core machine.
+ * It has the same interface as SharedMemorySemaphore, and must only have one
+ * waiting process.
+ */
+class SharedMemoryFutex {
+ public:
+  /*!
+   * Set the initial value, if it hasn't been set.  See
+   * SharedMemorySemaphore::init
+   */
+  void init(unsigned int value) {
+    if (!_init) {
+      _value.store(value);
+      _init = true;
+    }
+  }
+
+  /*!
+   * Increment the value, waking the waiter if it is asleep
+   */
+  void increment() {
+    _value.fetch_add(1);
+    if (_sleeping.load()) {
+#ifdef __linux__
+      syscall(SYS_futex, &_value, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+    }
+  }
+
+  /*!
+   * Wait until the value is > 0, then decrement
+   */
+  void decrement() { wait(nullptr); }
+
+  /*!
+   * If the value is > 0, decrement it and return true.  Otherwise return false.
+   */
+  bool tryDecrement() {
+    u32 value = _value.load(std::memory_order_relaxed);
+    while (value > 0) {
+      if (_value.compare_exchange_weak(value, value - 1,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*!
+   * Like decrement, but gives up after the given time (on CLOCK_MONOTONIC)
+   * Returns true if the value was decremented
+   */
+  bool decrementTimeout(u64 seconds, u64 nanoseconds) {
+    s64 deadline = nowNs() + (s64)(seconds * 1000000000 + nanoseconds);
+    return wait(&deadline);
+  }
+
+  /*!
+   * Nothing to free, this is here to match SharedMemorySemaphore
+   */
+  void destroy() {}
+
+ private:
+  static constexpr s64 kMaxSpinNs = 250000;
+
+  static s64 nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (s64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+
+  static bool canSpin() {
+    static const bool multiCore = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+    return multiCore;
+  }
+
+  bool wait(const s64* deadline) {
+    if (tryDecrement()) return true;
+
+    // reading the clock isn't free, so only do it if we need to
+    bool spin = canSpin();
+    s64 start = (spin || deadline) ? nowNs() : 0;
+    bool done = false;
+
+    // spin for about twice as long as waits have been taking recently
+    if (spin && 2 * _averageWaitNs <= kMaxSpinNs) {
+      for (u32 i = 1; !done; i++) {
+        done = tryDecrement();
+        if (!(i & 63) && nowNs() - start >= 2 * _averageWaitNs) break;
+      }
+    }
+
+    while (!done) {
+      struct timespec timeout;
+      if (deadline) {
+        s64 remaining = *deadline - nowNs();
+        if (remaining <= 0) break;
+        timeout.tv_sec = remaining / 1000000000;
+        timeout.tv_nsec = remaining % 1000000000;
+      }
+
+      // the waker checks _sleeping after changing _value, so either it sees
+      // us here, or the futex sees that _value has changed and won't sleep
+      _sleeping.store(1);
+      if (_value.load() == 0) {
+#ifdef __linux__
+        // relative timeouts are measured against CLOCK_MONOTONIC
+        syscall(SYS_futex, &_value, FUTEX_WAIT, 0,
+                deadline ? &timeout : nullptr, nullptr, 0);
+#else
+        sched_yield();
+#endif
+      }
+      _sleeping.store(0);
+      done = tryDecrement();
+    }
+
+    // keep a running average of how long waits take
+    if (spin) {
+      _averageWaitNs += (nowNs() - start - _averageWaitNs) / 8;
+    }
+    return done;
+  }
+
+  std::atomic<u32> _value;
+  std::atomic<u32> _sleeping;
+  s64 _averageWaitNs = 0;
+  bool _init = false;
+};
+
 /*!
  * A container class for an object which is stored in shared memory.  This
  * object can then be viewed in multiple processes or programs.  Note that there
@@ -0,0 +1,66 @@
+/*! @file TripleBuffer.h
+ *  @brief Lock-free single producer, single consumer triple buffer
+ *
+ *  The producer always has a buffer to write to and the consumer always has a
+ *  buffer to read from, so neither ever waits on the other.  The consumer
+ *  sees the most recently published buffer; older ones are dropped.
+ */
+
+#ifndef PROJECT_TRIPLEBUFFER_H
+#define PROJECT_TRIPLEBUFFER_H
+
+#include <atomic>
+
+#include "cTypes.h"
+
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  /*!
+   * Get the buffer to fill.  Only the producer may call this, and the buffer
+   * belongs to the producer until publish.
+   */
+  T& writeBuffer() { return _buffers[_writeIndex]; }
+
+  /*!
+   * Make the write buffer the latest buffer and get a new write buffer.
+   * Only the producer may call this.
+   */
+  void publish() {
+    u8 old = _middle.exchange(_writeIndex | kFresh, std::memory_order_acq_rel);
+    _writeIndex = old & kIndexMask;
+  }
+
+  /*!
+   * Take the latest published buffer as the read buffer.  Only the consumer
+   * may call this.
+   * @return true if a new buffer was published since the last consume
+   */
+  bool consume() {
+    if (!(_middle.load(std::memory_order_acquire) & kFresh)) return false;
+    u8 old = _middle.exchange(_readIndex, std::memory_order_acq_rel);
+    _readIndex = old & kIndexMask;
+    return true;
+  }
+
+  /*!
+   * Get the buffer taken by the last consume.  It is not changed by the
+   * producer until the next consume.
+   */
+  T& readBuffer() { return _buffers[_readIndex]; }
+
+ private:
+  static constexpr u8 kIndexMask = 0x3;
+  static constexpr u8 kFresh = 0x4;
+
+  T _buffers[3];
+  u8 _writeIndex = 0;
+  u8 _readIndex = 1;
+  std::atomic<u8> _middle{2};
+};
+
+#endif  // PROJECT_TRIPLEBUFFER_H
@@ -93,5 +93,16 @@ bool CollisionBox<T>::ContactDetection(const Vec3<T>& cp_pos, T& penetration,
   return false;
 }
 
+/*!
+ * Get the axis aligned bounding box of the (possibly rotated) box
+ */
+template <typename T>
+void CollisionBox<T>::getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+  Vec3<T> halfSize(_size[0] / 2., _size[1] / 2., _size[2] / 2.);
+  Vec3<T> extent = _orientation.cwiseAbs() * halfSize;
+  lo = _position - extent;
+  hi = _position + extent;
+}
+
 template class CollisionBox<double>;
 template class CollisionBox<float>;
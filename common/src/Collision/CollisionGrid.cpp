@@ -0,0 +1,111 @@
+/*!
+ * @file CollisionGrid.cpp
+ * @brief Broad phase for contact detection against static collision objects
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "Collision/CollisionGrid.h"
+
+/*!
+ * Build the grid.  The cell size is the average x-y size of the bounded
+ * objects, enlarged if needed to keep the grid within maxCellsPerAxis.
+ * @param collisions : collision objects, must not move after this is called
+ * @param maxCellsPerAxis : limit on the number of cells in x and in y
+ */
+template <typename T>
+void CollisionGrid<T>::build(const std::vector<Collision<T>*>& collisions,
+                             size_t maxCellsPerAxis) {
+  size_t n = collisions.size();
+  _lo.resize(n);
+  _hi.resize(n);
+  _unbounded.clear();
+  _cellStart.clear();
+  _cellObjects.clear();
+  _nx = 0;
+  _ny = 0;
+
+  Vec2<T> lo, hi;
+  lo.setConstant(std::numeric_limits<T>::infinity());
+  hi.setConstant(-std::numeric_limits<T>::infinity());
+  T sizeSum = 0;
+  size_t nBounded = 0;
+  std::vector<bool> bounded(n);
+  for (size_t j = 0; j < n; j++) {
+    collisions[j]->getBoundingBox(_lo[j], _hi[j]);
+    Vec2<T> objLo = _lo[j].template head<2>();
+    Vec2<T> objHi = _hi[j].template head<2>();
+    bounded[j] = objLo.allFinite() && objHi.allFinite();
+    if (bounded[j]) {
+      lo = lo.cwiseMin(objLo);
+      hi = hi.cwiseMax(objHi);
+      sizeSum += (objHi - objLo).maxCoeff();
+      nBounded++;
+    } else {
+      _unbounded.push_back(j);
+    }
+  }
+  if (nBounded == 0) return;
+
+  Vec2<T> extent = hi - lo;
+  size_t maxCells = std::max(maxCellsPerAxis, (size_t)2);
+  _cellSize = std::max(sizeSum / nBounded, extent.maxCoeff() / (maxCells - 1));
+  if (!(_cellSize > 0)) _cellSize = 1;
+  _origin = lo;
+  _nx = (size_t)(extent[0] / _cellSize) + 1;
+  _ny = (size_t)(extent[1] / _cellSize) + 1;
+
+  // bucket the objects into cells, then flatten into _cellObjects in order
+  std::vector<std::vector<size_t>> cells(_nx * _ny);
+  for (size_t j = 0; j < n; j++) {
+    if (!bounded[j]) {
+      for (auto& cell : cells) cell.push_back(j);
+      continue;
+    }
+    size_t x0 = (size_t)std::floor((_lo[j][0] - _origin[0]) / _cellSize);
+    size_t y0 = (size_t)std::floor((_lo[j][1] - _origin[1]) / _cellSize);
+    size_t x1 = (size_t)std::floor((_hi[j][0] - _origin[0]) / _cellSize);
+    size_t y1 = (size_t)std::floor((_hi[j][1] - _origin[1]) / _cellSize);
+    x0 = std::min(x0, _nx - 1);
+    y0 = std::min(y0, _ny - 1);
+    x1 = std::min(x1, _nx - 1);
+    y1 = std::min(y1, _ny - 1);
+    for (size_t x = x0; x <= x1; x++) {
+      for (size_t y = y0; y <= y1; y++) {
+        cells[x * _ny + y].push_back(j);
+      }
+    }
+  }
+
+  _cellStart.resize(cells.size() + 1);
+  _cellStart[0] = 0;
+  for (size_t c = 0; c < cells.size(); c++) {
+    _cellStart[c + 1] = _cellStart[c] + cells[c].size();
+  }
+  _cellObjects.reserve(_cellStart.back());
+  for (auto& cell : cells) {
+    _cellObjects.insert(_cellObjects.end(), cell.begin(), cell.end());
+  }
+}
+
+/*!
+ * Get the collision objects that may contain a point.  Points outside the
+ * grid can only touch the unbounded objects.
+ * @param p : point in the global frame
+ */
+template <typename T>
+typename CollisionGrid<T>::Candidates CollisionGrid<T>::query(
+    const Vec3<T>& p) const {
+  T x = std::floor((p[0] - _origin[0]) / _cellSize);
+  T y = std::floor((p[1] - _origin[1]) / _cellSize);
+  if (_nx == 0 || !(x >= 0 && x < _nx && y >= 0 && y < _ny)) {
+    return {_unbounded.data(), _unbounded.data() + _unbounded.size()};
+  }
+  size_t c = (size_t)x * _ny + (size_t)y;
+  return {_cellObjects.data() + _cellStart[c],
+          _cellObjects.data() + _cellStart[c + 1]};
+}
+
+template class CollisionGrid<double>;
+template class CollisionGrid<float>;
@@ -7,63 +7,185 @@
 #include "Utilities/Utilities_print.h"
 
 /*!
- * check whether the contact happens or not
- * cp_frame let you know which direction is normal (z) and which directions are
- * x and y. The frame is basically contact coordinate w.r.t global.
+ * Find the cell a point is above
+ * @param cp_pos : point in the global frame
+ * @param x_idx : cell index in x
+ * @param y_idx : cell index in y
+ * @param u : position inside the cell in x, from 0 to 1
+ * @param v : position inside the cell in y, from 0 to 1
+ * @return false if the point is outside of the height map
  */
 template <typename T>
-bool CollisionMesh<T>::ContactDetection(const Vec3<T>& cp_pos, T& penetration,
-                                        Mat3<T>& cp_frame) {
-  // Contact detection
-  Vec3<T> cp_pos_in_height_map = cp_pos - _left_corner_loc;
-  if ((0 < cp_pos_in_height_map[0]) && (cp_pos_in_height_map[0] < _x_max)) {
-    if ((0 < cp_pos_in_height_map[1]) && (cp_pos_in_height_map[1] < _y_max)) {
-      int x_idx = floor(cp_pos_in_height_map[0] / _grid);
-      int y_idx = floor(cp_pos_in_height_map[1] / _grid);
+bool CollisionMesh<T>::_locate(const Vec3<T>& cp_pos, size_t& x_idx,
+                               size_t& y_idx, T& u, T& v) {
+  T x = cp_pos[0] - _left_corner_loc[0];
+  T y = cp_pos[1] - _left_corner_loc[1];
+  if (!((0 < x) && (x < _x_max) && (0 < y) && (y < _y_max))) return false;
 
-      Vec3<T> vec1;
-      vec1[0] = _grid;
-      vec1[1] = _grid;
-      vec1[2] = _height_map(x_idx + 1, y_idx + 1) - _height_map(x_idx, y_idx);
+  T fx = x / _grid;
+  T fy = y / _grid;
+  x_idx = std::min((size_t)fx, (size_t)_height_map.rows() - 2);
+  y_idx = std::min((size_t)fy, (size_t)_height_map.cols() - 2);
+  u = fx - x_idx;
+  v = fy - y_idx;
+  return true;
+}
 
-      Vec3<T> vec2;
-      vec2[0] = _grid;
-      vec2[1] = -_grid;
-      vec2[2] = _height_map(x_idx + 1, y_idx) - _height_map(x_idx, y_idx + 1);
+/*!
+ * Get the contact frame of one of the triangles of a cell.  The normal is z
+ * and x is the surface tangent in the global x-z plane.
+ * @param lower : the triangle with u >= v, with corners (0,0), (1,0), (1,1)
+ */
+template <typename T>
+const Mat3<T>& CollisionMesh<T>::_triangleFrame(size_t x_idx, size_t y_idx,
+                                                bool lower) {
+  size_t tx = x_idx / _tileSize, ty = y_idx / _tileSize;
+  auto& tile = _frameTiles[tx * _nTilesY + ty];
+  if (!tile) {
+    tile.reset(new std::vector<Mat3<T>>(2 * _tileSize * _tileSize));
+    size_t xEnd = std::min((tx + 1) * _tileSize, (size_t)_height_map.rows() - 1);
+    size_t yEnd = std::min((ty + 1) * _tileSize, (size_t)_height_map.cols() - 1);
+    for (size_t i = tx * _tileSize; i < xEnd; i++) {
+      for (size_t j = ty * _tileSize; j < yEnd; j++) {
+        T h00 = _height_map(i, j), h10 = _height_map(i + 1, j);
+        T h01 = _height_map(i, j + 1), h11 = _height_map(i + 1, j + 1);
+        size_t k = 2 * ((i % _tileSize) * _tileSize + (j % _tileSize));
+        // surface slopes dz/dx, dz/dy of each triangle
+        T slopes[2][2] = {{h10 - h00, h11 - h10}, {h11 - h01, h01 - h00}};
+        for (size_t t = 0; t < 2; t++) {
+          Vec3<T> normal(-slopes[t][0] / _grid, -slopes[t][1] / _grid, 1);
+          normal.normalize();
+          Vec3<T> x_axis(normal[2], 0, -normal[0]);  // e_y cross normal
+          x_axis.normalize();
+          Mat3<T>& frame = (*tile)[k + t];
+          frame.template block<3, 1>(0, 0) = x_axis;
+          frame.template block<3, 1>(0, 1) = normal.cross(x_axis);
+          frame.template block<3, 1>(0, 2) = normal;
+        }
+      }
+    }
+  }
+  size_t k = 2 * ((x_idx % _tileSize) * _tileSize + (y_idx % _tileSize));
+  return (*tile)[k + (lower ? 0 : 1)];
+}
 
-      vec1.normalize();
-      vec2.normalize();
+/*!
+ * Get the height of the surface, relative to the corner of the height map
+ * @param x : global x position
+ * @param y : global y position
+ * @return height, or NaN if (x, y) is outside of the height map
+ */
+template <typename T>
+T CollisionMesh<T>::surfaceHeight(T x, T y) {
+  size_t x_idx, y_idx;
+  T u, v;
+  if (!_locate(Vec3<T>(x, y, 0), x_idx, y_idx, u, v)) {
+    return std::numeric_limits<T>::quiet_NaN();
+  }
+  return _cellHeight(x_idx, y_idx, u, v);
+}
 
-      Vec3<T> normal = vec2.cross(vec1);
-      // vec2 is x axis
-      Vec3<T> y_axis = normal.cross(vec2);
+/*!
+ * (Support Function) Height of the surface at (u, v) inside a cell
+ */
+template <typename T>
+T CollisionMesh<T>::_cellHeight(size_t x_idx, size_t y_idx, T u, T v) {
+  T h00 = _height_map(x_idx, y_idx);
+  if (u >= v) {
+    return h00 + u * (_height_map(x_idx + 1, y_idx) - h00) +
+           v * (_height_map(x_idx + 1, y_idx + 1) -
+                _height_map(x_idx + 1, y_idx));
+  }
+  return h00 + v * (_height_map(x_idx, y_idx + 1) - h00) +
+         u * (_height_map(x_idx + 1, y_idx + 1) - _height_map(x_idx, y_idx + 1));
+}
 
-      cp_frame.template block<3, 1>(0, 0) = vec2;
-      cp_frame.template block<3, 1>(0, 1) = y_axis;
-      cp_frame.template block<3, 1>(0, 2) = normal;
+/*!
+ * check whether the contact happens or not
+ * cp_frame let you know which direction is normal (z) and which directions are
+ * x and y. The frame is basically contact coordinate w.r.t global.
+ */
+template <typename T>
+bool CollisionMesh<T>::ContactDetection(const Vec3<T>& cp_pos, T& penetration,
+                                        Mat3<T>& cp_frame) {
+  size_t x_idx, y_idx;
+  T u, v;
+  if (!_locate(cp_pos, x_idx, y_idx, u, v)) return false;
 
-      // Vector pointing middle of four points
-      T height_ave = 0.25 * _height_map(x_idx, y_idx) +
-                     0.25 * _height_map(x_idx, y_idx + 1) +
-                     0.25 * _height_map(x_idx + 1, y_idx) +
-                     0.25 * _height_map(x_idx + 1, y_idx + 1);
+  T dz = cp_pos[2] - _left_corner_loc[2] - _cellHeight(x_idx, y_idx, u, v);
+  if (dz < 0.) {
+    cp_frame = _triangleFrame(x_idx, y_idx, u >= v);
+    // distance to the plane of the triangle along its normal
+    penetration = dz * cp_frame(2, 2);
+    return true;
+  }
+  return false;
+}
 
-      Vec3<T> middle_pt;
-      middle_pt[0] = _grid * x_idx + 0.5 * _grid;
-      middle_pt[1] = _grid * y_idx + 0.5 * _grid;
-      middle_pt[2] = height_ave;
+/*!
+ * (Support Function) Check if each of n points (x, y, z packed) is below the
+ * surface of a column-major height map.  The loop is branch free and the
+ * pointers don't alias, so it vectorizes, with the four corner heights of each
+ * cell gathered from the height map.  Points outside of the map are clamped to
+ * its last cell (index xLast, yLast) for the gather and then reported as not
+ * in contact.  gcc only if-converts the double version of the loop when the
+ * cell limits are arguments and the function isn't inlined into the caller.
+ */
+template <typename T>
+__attribute__((noinline)) static void pointsBelowHeightMap(
+    const T* __restrict p, size_t n, const T* __restrict h, int rows, T xLast,
+    T yLast, T xMax, T yMax, const T* __restrict corner, T grid,
+    uint8_t* __restrict below) {
+  const T invGrid = 1 / grid;
+  const T x0 = corner[0], y0 = corner[1], z0 = corner[2];
+  for (size_t k = 0; k < n; k++) {
+    T x = p[3 * k] - x0;
+    T y = p[3 * k + 1] - y0;
+    T z = p[3 * k + 2] - z0;
+    bool inside = (0 < x) & (x < xMax) & (0 < y) & (y < yMax);
 
-      Vec3<T> local_diff =
-          cp_frame.transpose() * (cp_pos_in_height_map - middle_pt);
+    T fx = x * invGrid, fy = y * invGrid;
+    T cx = fx < 0 ? T(0) : fx, cy = fy < 0 ? T(0) : fy;
+    int ix = (int)(cx > xLast ? xLast : cx);
+    int iy = (int)(cy > yLast ? yLast : cy);
+    T u = fx - ix, v = fy - iy;
 
-      if (local_diff[2] < 0.) {
-        penetration = local_diff[2];
-        return true;
-      }
-    }
+    int c = ix + iy * rows;
+    T h00 = h[c], h10 = h[c + 1], h01 = h[c + rows], h11 = h[c + rows + 1];
+    T lower = h00 + u * (h10 - h00) + v * (h11 - h10);
+    T upper = h00 + v * (h01 - h00) + u * (h11 - h01);
+    T height = (u >= v) ? lower : upper;
+    below[k] = inside & (z < height);
   }
+}
 
-  return false;
+/*!
+ * Check if each point is below the surface
+ */
+template <typename T>
+bool CollisionMesh<T>::BatchContactDetection(
+    const std::vector<Vec3<T>>& cp_pos, std::vector<uint8_t>& in_contact) {
+  size_t n = cp_pos.size();
+  in_contact.resize(n);
+  if (n == 0) return true;
+  int rows = _height_map.rows();
+  T xLast = rows - 2, yLast = _height_map.cols() - 2;
+  pointsBelowHeightMap(cp_pos[0].data(), n, _height_map.data(), rows, xLast,
+                       yLast, _x_max, _y_max, _left_corner_loc.data(), _grid,
+                       in_contact.data());
+  return true;
+}
+
+/*!
+ * Get the bounding box of the height map.  Points below the surface are in
+ * contact no matter how deep they are, so the box has no lower limit in z.
+ */
+template <typename T>
+void CollisionMesh<T>::getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+  Collision<T>::getBoundingBox(lo, hi);
+  lo.template head<2>() = _left_corner_loc.template head<2>();
+  hi[0] = _left_corner_loc[0] + _x_max;
+  hi[1] = _left_corner_loc[1] + _y_max;
 }
 
 template class CollisionMesh<double>;
@@ -0,0 +1,54 @@
+/*!
+ * @file CollisionTerrain.cpp
+ * @brief Collision logic for an endless procedural terrain
+ */
+
+#include "Collision/CollisionTerrain.h"
+
+#include <cmath>
+
+template <typename T>
+CollisionTerrain<T>::CollisionTerrain(
+    std::shared_ptr<const ProceduralTerrain> terrain)
+    : Collision<T>(terrain->getParameters().mu,
+                   terrain->getParameters().restitution),
+      _terrain(terrain),
+      _width(2 * terrain->getParameters().loadRadius + 2),
+      _chunks(_width * _width) {}
+
+/*!
+ * Make sure every chunk within the load radius of chunk (x, y) is loaded
+ */
+template <typename T>
+void CollisionTerrain<T>::_recenter(s64 x, s64 y) {
+  s64 radius = _terrain->getParameters().loadRadius;
+  for (s64 cx = x - radius; cx <= x + radius; cx++) {
+    for (s64 cy = y - radius; cy <= y + radius; cy++) {
+      auto& chunk = _chunks[_slot(cx, cy)];
+      if (!chunk || chunk->x != cx || chunk->y != cy) {
+        chunk = _terrain->generateChunk<T>(cx, cy);
+        _chunksGenerated++;
+      }
+    }
+  }
+  _centerX = x;
+  _centerY = y;
+  _centered = true;
+}
+
+/*!
+ * Check for contact with the chunk under the point, loading the chunks
+ * around it if the point is in a different chunk than the last point
+ */
+template <typename T>
+bool CollisionTerrain<T>::ContactDetection(const Vec3<T>& cp_pos,
+                                           T& penetration, Mat3<T>& cp_frame) {
+  if (!std::isfinite(cp_pos[0]) || !std::isfinite(cp_pos[1])) return false;
+  s64 x = _terrain->chunkIndex(cp_pos[0]), y = _terrain->chunkIndex(cp_pos[1]);
+  if (!_centered || x != _centerX || y != _centerY) _recenter(x, y);
+  return _chunks[_slot(x, y)]->mesh.ContactDetection(cp_pos, penetration,
+                                                     cp_frame);
+}
+
+template class CollisionTerrain<double>;
+template class CollisionTerrain<float>;
@@ -7,10 +7,24 @@
 
 /*!
  * Check all points for contact.  If contact occurs, add to list of in-contact points
+ * Each point is only checked against the collision objects the broad phase
+ * finds near it.
  * @return Number of points in contact
  */
 template <typename T>
 size_t ContactConstraint<T>::_CheckContact() {
+  if (!_broadPhaseUpToDate) {
+    _broadPhase.build(_collision_list);
+    _findBatchCollisions();
+    _broadPhaseUpToDate = true;
+  }
+
+  // Objects that check all points at once
+  for (size_t k(0); k < _batchCollisions.size(); ++k) {
+    _collision_list[_batchCollisions[k]]->BatchContactDetection(
+        _model->_pGC, _batchInContact[k]);
+  }
+
   _cp_pos_list.clear();
   _cp_local_force_list.clear();
   _cp_penetration_list.clear();
@@ -26,11 +40,13 @@ size_t ContactConstraint<T>::_CheckContact() {
   T penetration;
   for (size_t i(0); i < _model->_nGroundContact; ++i) {
     _cp_force_list[i].setZero();
-    for (size_t j(0); j < _nCollision; ++j) {
-      if (_collision_list[j]->ContactDetection(_model->_pGC[i], penetration,
-                                               cp_frame)) {
+    const Vec3<T>& pGC = _model->_pGC[i];
+    for (size_t j : _broadPhase.query(pGC)) {
+      if (!_broadPhase.overlaps(j, pGC)) continue;
+      if (_batchSlot[j] >= 0 && !_batchInContact[_batchSlot[j]][i]) continue;
+      if (_collision_list[j]->ContactDetection(pGC, penetration, cp_frame)) {
         // Contact Happens
-        _cp_pos_list.push_back(_model->_pGC[i]);
+        _cp_pos_list.push_back(pGC);
         _cp_local_force_list.push_back(Vec3<T>::Zero());
         _cp_frame_list.push_back(cp_frame);
         _cp_penetration_list.push_back(penetration);
@@ -45,5 +61,41 @@ size_t ContactConstraint<T>::_CheckContact() {
   return _cp_pos_list.size();
 }
 
+/*!
+ * Find the collision objects that support batch contact detection
+ */
+template <typename T>
+void ContactConstraint<T>::_findBatchCollisions() {
+  std::vector<Vec3<T>> noPoints;
+  std::vector<uint8_t> noResults;
+  _batchSlot.assign(_nCollision, -1);
+  _batchCollisions.clear();
+  for (size_t j(0); j < _nCollision; ++j) {
+    if (_collision_list[j]->BatchContactDetection(noPoints, noResults)) {
+      _batchSlot[j] = _batchCollisions.size();
+      _batchCollisions.push_back(j);
+    }
+  }
+  _batchInContact.resize(_batchCollisions.size());
+  for (auto& inContact : _batchInContact) {
+    inContact.reserve(_model->_nGroundContact);
+  }
+}
+
+/*!
+ * Reserve space in the per-step contact lists so that checking for contact
+ * does not reallocate them until more than n points are in contact at once
+ */
+template <typename T>
+void ContactConstraint<T>::_reserveContactLists(size_t n) {
+  _cp_pos_list.reserve(n);
+  _cp_local_force_list.reserve(n);
+  _cp_penetration_list.reserve(n);
+  _cp_frame_list.reserve(n);
+  _cp_resti_list.reserve(n);
+  _cp_mu_list.reserve(n);
+  _idx_list.reserve(n);
+}
+
 template class ContactConstraint<double>;
 template class ContactConstraint<float>;
@@ -16,23 +16,13 @@ template <typename T>
 void ContactImpulse<T>::UpdateQdot(FBModelState<T>& state) {
   CC::_nContact = CC::_CheckContact();
   if (CC::_nContact > 0) {
-    DVec<T> qdot(_nDof);
+    _qdot.template head<6>() = state.bodyVelocity;
+    _qdot.tail(_nDof - 6) = state.qd;
 
-    for (size_t i(0); i < 6; ++i) {
-      qdot[i] = state.bodyVelocity[i];
-    }
-    for (size_t i(0); i < _nDof - 6; ++i) {
-      qdot[i + 6] = state.qd[i];
-    }
-
-    _UpdateVelocity(qdot);
+    _UpdateVelocity(_qdot);
 
-    for (size_t i(0); i < 6; ++i) {
-      state.bodyVelocity[i] = qdot[i];
-    }
-    for (size_t i(0); i < _nDof - 6; ++i) {
-      state.qd[i] = qdot[i + 6];
-    }
+    state.bodyVelocity = _qdot.template head<6>();
+    state.qd = _qdot.tail(_nDof - 6);
 
     // Update contact force w.r.t. global frame
     // This is not neccessary for dynamics, but
@@ -43,145 +33,148 @@ void ContactImpulse<T>::UpdateQdot(FBModelState<T>& state) {
       CC::_cp_force_list[CC::_idx_list[i]] =
           CC::_cp_frame_list[i] * CC::_cp_local_force_list[i] / _dt;
     }
+  } else {
+    for (auto& impulse : _warmStart) impulse.setZero();
+    _iterations = 0;
+    _residual = 0;
   }
 }
 
+/*!
+ * Find the contact impulses and apply them to qdot
+ * @param qdot : generalized velocity, updated in place
+ */
 template <typename T>
 void ContactImpulse<T>::_UpdateVelocity(DVec<T>& qdot) {
-  T* lambda_list_x = new T[CC::_nContact];
-  T* lambda_list_y = new T[CC::_nContact];
-  T* lambda_list_z = new T[CC::_nContact];
-
-  T* des_vel_list_z = new T[CC::_nContact];
-  T* des_vel_list_tan = new T[CC::_nContact];
-
-  T* min_list_z = new T[CC::_nContact];
-  T* max_list_z = new T[CC::_nContact];
+  size_t m = 3 * CC::_nContact;
+  _ReserveBuffers(CC::_nContact);
+  _AssembleDelassus(qdot);
+  _SolveImpulses();
 
-  T* min_list_tan = new T[CC::_nContact];
-  T* max_list_tan = new T[CC::_nContact];
+  qdot.noalias() += _HinvJt.leftCols(m) * _lambda.head(m);
 
-  vectorAligned<DVec<T> > AinvB_list_x(CC::_nContact);
-  vectorAligned<DVec<T> > AinvB_list_y(CC::_nContact);
-  vectorAligned<DVec<T> > AinvB_list_z(CC::_nContact);
+  // Save the impulses for the next step, keyed by ground contact point
+  for (auto& impulse : _warmStart) impulse.setZero();
+  for (size_t i(0); i < CC::_nContact; ++i) {
+    CC::_cp_local_force_list[i] = _lambda.template segment<3>(3 * i);
+    _warmStart[CC::_idx_list[i]] =
+        CC::_cp_frame_list[i] * CC::_cp_local_force_list[i];
+  }
+}
 
-  vectorAligned<D3Mat<T> > Jc_list(CC::_nContact);
-  // For check
-  vectorAligned<Vec3<T> > cp_vel_list(CC::_nContact);
+/*!
+ * Grow the solver buffers so they can hold nContact contacts.  The buffers
+ * are never shrunk, so this only allocates when a new largest number of
+ * contacts is seen.
+ */
+template <typename T>
+void ContactImpulse<T>::_ReserveBuffers(size_t nContact) {
+  if (_WtangentInv.size() >= nContact) return;
+  size_t m = 3 * nContact;
+  _J.setZero(m, _nDof);
+  _HinvJt.setZero(_nDof, m);
+  _W.setZero(m, m);
+  _bias.setZero(m);
+  _lambda.setZero(m);
+  _WtangentInv.resize(nContact);
+}
 
-  DVec<T> AinvB;
-  Vec3<T> cp_local_vel;
-  Vec3<T> direction;
+/*!
+ * Build the stacked contact Jacobian, the Delassus matrix W = J H^-1 J^T and
+ * the velocity bias, and warm start the impulses.
+ * @param qdot : generalized velocity before the contact impulses
+ */
+template <typename T>
+void ContactImpulse<T>::_AssembleDelassus(const DVec<T>& qdot) {
+  size_t m = 3 * CC::_nContact;
   CC::_model->contactJacobians();
 
-  // Prepare Matrix and Vector
+  Vec3<T> cp_local_vel;
   for (size_t i(0); i < CC::_nContact; ++i) {
-    // Lambda & Ainv*J'
-    lambda_list_x[i] = CC::_model->applyTestForce(
-        CC::_idx_list[i], CC::_cp_frame_list[i].template block<3, 1>(0, 0),
-        AinvB_list_x[i]);
-    lambda_list_x[i] = 1. / lambda_list_x[i];
-
-    lambda_list_y[i] = CC::_model->applyTestForce(
-        CC::_idx_list[i], CC::_cp_frame_list[i].template block<3, 1>(0, 1),
-        AinvB_list_y[i]);
-    lambda_list_y[i] = 1. / lambda_list_y[i];
-
-    lambda_list_z[i] = CC::_model->applyTestForce(
-        CC::_idx_list[i], CC::_cp_frame_list[i].template block<3, 1>(0, 2),
-        AinvB_list_z[i]);
-    lambda_list_z[i] = 1. / lambda_list_z[i];
-
-    // Local Velocity
-    cp_local_vel =
-        CC::_cp_frame_list[i].transpose() * CC::_model->_vGC[CC::_idx_list[i]];
+    size_t gc = CC::_idx_list[i];
+    const Mat3<T>& R = CC::_cp_frame_list[i];
+    _J.middleRows(3 * i, 3).noalias() = R.transpose() * CC::_model->_Jc[gc];
 
     // Desired Velocity
-    des_vel_list_tan[i] = 0.;
+    cp_local_vel = R.transpose() * CC::_model->_vGC[gc];
+    T des_vel_z;
     if (cp_local_vel[2] < 0.) {
-      des_vel_list_z[i] =
-          -CC::_cp_resti_list[i] * cp_local_vel[2] -
-          _penetration_recover_ratio * CC::_cp_penetration_list[i];
+      des_vel_z = -CC::_cp_resti_list[i] * cp_local_vel[2] -
+                  _penetration_recover_ratio * CC::_cp_penetration_list[i];
     } else {
-      des_vel_list_z[i] =
+      des_vel_z =
           std::max(cp_local_vel[2],
                    -_penetration_recover_ratio * CC::_cp_penetration_list[i]);
     }
 
-    // Contact Jacobian
-    Jc_list[i] =
-        CC::_cp_frame_list[i].transpose() * CC::_model->_Jc[CC::_idx_list[i]];
+    _bias.template segment<3>(3 * i).noalias() = _J.middleRows(3 * i, 3) * qdot;
+    _bias[3 * i + 2] -= des_vel_z;
 
-    min_list_z[i] = 0.;
-    max_list_z[i] = 1.e5;
+    // Warm start from the last impulse on this ground contact point
+    _lambda.template segment<3>(3 * i).noalias() = R.transpose() * _warmStart[gc];
   }
 
-  // Update Velocity & Find Impulse Force
-  for (size_t iter(0); iter < _iter_lim; ++iter) {
-    _iter_sum = 0;
-    // Normal (Z) *********************************************************
-    _UpdateQdotOneDirection(2, Jc_list, lambda_list_z, AinvB_list_z,
-                            des_vel_list_z, min_list_z, max_list_z, qdot);
-
-    // X ******************************************************************
-    for (size_t i(0); i < CC::_nContact; ++i) {
-      max_list_tan[i] = CC::_cp_mu_list[i] * CC::_cp_local_force_list[i][2];
-      min_list_tan[i] = -max_list_tan[i];
-    }
-    _UpdateQdotOneDirection(0, Jc_list, lambda_list_x, AinvB_list_x,
-                            des_vel_list_tan, min_list_tan, max_list_tan, qdot);
-
-    // Y ******************************************************************
-    _UpdateQdotOneDirection(1, Jc_list, lambda_list_y, AinvB_list_y,
-                            des_vel_list_tan, min_list_tan, max_list_tan, qdot);
+  // H^-1 from the sparse factorization of the mass matrix
+  const DMat<T>& Hinv = CC::_model->massMatrixInverse();
+  _HinvJt.leftCols(m).noalias() = Hinv * _J.topRows(m).transpose();
+  _W.topLeftCorner(m, m).noalias() = _J.topRows(m) * _HinvJt.leftCols(m);
 
-    if (_iter_sum < 1) {
-      // printf("converged: %lu \n", _iter_sum);
-      break;
-    }
-    _iter_sum = 0;
+  for (size_t i(0); i < CC::_nContact; ++i) {
+    _WtangentInv[i] = _W.template block<2, 2>(3 * i, 3 * i).inverse();
   }
-
-  delete[] lambda_list_x;
-  delete[] lambda_list_y;
-  delete[] lambda_list_z;
-
-  delete[] des_vel_list_z;
-  delete[] des_vel_list_tan;
-
-  delete[] min_list_z;
-  delete[] max_list_z;
-
-  delete[] min_list_tan;
-  delete[] max_list_tan;
 }
 
+/*!
+ * Projected Gauss-Seidel on the Delassus matrix.  Each sweep visits one
+ * contact at a time: the normal impulse is solved first and clamped to be
+ * non-negative, then the two tangential impulses are solved together and
+ * projected onto the friction disk |lambda_t| <= mu * lambda_n.  Solving the
+ * normal before the friction keeps a sliding contact from pushing the normal
+ * impulse above what is needed to stop penetration, which would add energy.
+ */
 template <typename T>
-void ContactImpulse<T>::_UpdateQdotOneDirection(
-    size_t idx, const vectorAligned<D3Mat<T> >& Jc_list, const T* lambda_list,
-    const vectorAligned<DVec<T> > AinvB_list, const T* des_vel_list,
-    const T* min_list, const T* max_list, DVec<T>& qdot) {
-  T dforce, pre_force, cp_vel, dforce_sum;
+void ContactImpulse<T>::_SolveImpulses() {
+  size_t m = 3 * CC::_nContact;
+  Vec3<T> vel, pre_impulse, impulse;
+  Vec2<T> tan_impulse;
+
+  _iterations = 0;
+  _residual = 0;
   for (size_t iter(0); iter < _iter_lim; ++iter) {
-    dforce_sum = 0;
+    _residual = 0;
     for (size_t i(0); i < CC::_nContact; ++i) {
-      cp_vel = (Jc_list[i].block(idx, 0, 1, _nDof) * qdot)(0, 0);
-
-      dforce = (des_vel_list[i] - cp_vel) * lambda_list[i];
-      pre_force = CC::_cp_local_force_list[i][idx];
-      CC::_cp_local_force_list[i][idx] =
-          std::max(min_list[i], std::min(pre_force + dforce, max_list[i]));
-
-      dforce = CC::_cp_local_force_list[i][idx] - pre_force;
-
-      qdot += (AinvB_list[i] * dforce);
-      dforce_sum += fabs(dforce);
-    }
-    if (dforce_sum < _tol) {
-      _iter_sum += iter;
-      // printf("dforce sum is small enough: %f\n", dforce_sum);
-      break;
+      vel = _bias.template segment<3>(3 * i);
+      vel.noalias() += _W.middleRows(3 * i, 3).leftCols(m) * _lambda.head(m);
+      pre_impulse = _lambda.template segment<3>(3 * i);
+      impulse = pre_impulse;
+
+      // Normal
+      impulse[2] = std::max(
+          T(0), pre_impulse[2] - vel[2] / _W(3 * i + 2, 3 * i + 2));
+      vel += _W.template block<3, 1>(3 * i, 3 * i + 2) *
+             (impulse[2] - pre_impulse[2]);
+
+      // Tangential, projected onto the friction disk
+      tan_impulse = pre_impulse.template head<2>() -
+                    _WtangentInv[i] * vel.template head<2>();
+      T max_tan = CC::_cp_mu_list[i] * impulse[2];
+      T tan = tan_impulse.norm();
+      if (tan > max_tan) {
+        tan_impulse *= tan > 0 ? max_tan / tan : T(0);
+      }
+      impulse.template head<2>() = tan_impulse;
+
+      _lambda.template segment<3>(3 * i) = impulse;
+      _residual =
+          std::max(_residual, (impulse - pre_impulse).cwiseAbs().maxCoeff());
     }
+    _iterations = iter + 1;
+    if (_residual < _tol) break;
+  }
+
+  if (_b_debug && _residual >= _tol) {
+    printf("[ContactImpulse] not converged after %lu sweeps: %g\n",
+           (unsigned long)_iterations, (double)_residual);
   }
 }
 
@@ -0,0 +1,158 @@
+/*!
+ * @file ProceduralTerrain.cpp
+ * @brief Endless terrain generated from a seed, in square chunks
+ */
+
+#include "Collision/ProceduralTerrain.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+/*!
+ * Check the settings and fit the height map grid to the chunk size
+ */
+ProceduralTerrain::ProceduralTerrain(const ProceduralTerrainParameters& params)
+    : _params(params) {
+  if (!(params.grid > 0) || !(params.chunkSize > 0) ||
+      !(params.featureSize > 0) || !(params.noiseWavelength > 0)) {
+    throw std::runtime_error(
+        "procedural terrain grid, chunk, feature and noise sizes must be "
+        "positive");
+  }
+  if (!(params.slopeGrade > 0) || !(params.stairRun > 0)) {
+    throw std::runtime_error(
+        "procedural terrain slope grade and stair run must be positive");
+  }
+  size_t cells = std::max(1., std::round(params.chunkSize / params.grid));
+  _grid = params.chunkSize / cells;
+  _samplesPerChunk = cells + 3;
+}
+
+/*!
+ * Get a uniform random number in [0, 1) which only depends on the seed and
+ * the arguments (splitmix64)
+ */
+double ProceduralTerrain::hashUniform(s64 i, s64 j, u64 salt) const {
+  u64 z = (u64)i * 0x100000001b3ull + (u64)j * 0xc2b2ae3d27d4eb4full + salt;
+  z = _params.seed + 0x9e3779b97f4a7c15ull * (z + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  z = z ^ (z >> 31);
+  return (z >> 11) * (1. / 9007199254740992.);
+}
+
+/*!
+ * Smooth noise: the sum of octaves of value noise, each with half the
+ * wavelength and half the amplitude of the last.
+ * @return height, from -noiseAmplitude to noiseAmplitude
+ */
+double ProceduralTerrain::noise(double x, double y) const {
+  double sum = 0, total = 0, amplitude = 1;
+  double wavelength = _params.noiseWavelength;
+  for (size_t octave = 0; octave < _params.noiseOctaves; octave++) {
+    double fx = x / wavelength, fy = y / wavelength;
+    s64 ix = (s64)std::floor(fx), iy = (s64)std::floor(fy);
+    double u = fx - ix, v = fy - iy;
+    u = u * u * (3 - 2 * u);
+    v = v * v * (3 - 2 * v);
+    u64 salt = 16 + octave;
+    double h00 = hashUniform(ix, iy, salt);
+    double h10 = hashUniform(ix + 1, iy, salt);
+    double h01 = hashUniform(ix, iy + 1, salt);
+    double h11 = hashUniform(ix + 1, iy + 1, salt);
+    double h = (1 - v) * ((1 - u) * h00 + u * h10) +
+               v * ((1 - u) * h01 + u * h11);
+    sum += amplitude * (2 * h - 1);
+    total += amplitude;
+    amplitude /= 2;
+    wavelength /= 2;
+  }
+  return total > 0 ? _params.noiseAmplitude * sum / total : 0;
+}
+
+/*!
+ * Height of the feature in the feature cell of a point.  Each cell has a flat
+ * border of 10% of its size, so features never meet.  Slopes and stairs go up
+ * to a landing in the middle of the cell and back down, and gaps cross the
+ * middle of the cell.  Cells near the origin have no feature, so that the
+ * robot starts on flat ground.
+ */
+double ProceduralTerrain::feature(double x, double y) const {
+  const ProceduralTerrainParameters& p = _params;
+  const double size = p.featureSize;
+  s64 i = (s64)std::floor(x / size), j = (s64)std::floor(y / size);
+  double cornerX = i * size, cornerY = j * size;
+
+  double nearX = std::min(std::max(0., cornerX), cornerX + size);
+  double nearY = std::min(std::max(0., cornerY), cornerY + size);
+  if (nearX * nearX + nearY * nearY < p.flatRadius * p.flatRadius) return 0;
+
+  // s is along the feature and t is across it
+  bool alongX = hashUniform(i, j, 1) < .5;
+  double s = alongX ? x - cornerX : y - cornerY;
+  double t = alongX ? y - cornerY : x - cornerX;
+  double margin = .1 * size;
+  if (t < margin || t > size - margin) return 0;
+  double d = std::min(s - margin, size - margin - s);  // distance in from edge
+  if (d < 0) return 0;
+
+  double pick = hashUniform(i, j, 0);
+  if (pick < p.slopeProbability) {
+    double sign = hashUniform(i, j, 2) < .5 ? 1 : -1;
+    return sign * std::min(d * p.slopeGrade, p.slopeHeight);
+  }
+  pick -= p.slopeProbability;
+  if (pick < p.stairsProbability) {
+    return p.stairRise *
+           std::min(std::floor(d / p.stairRun) + 1, (double)p.stairSteps);
+  }
+  pick -= p.stairsProbability;
+  if (pick < p.gapProbability) {
+    double width = p.gapWidth * (.5 + .5 * hashUniform(i, j, 3));
+    return std::abs(s - size / 2) < width / 2 ? -p.gapDepth : 0;
+  }
+  return 0;
+}
+
+/*!
+ * Get the height of the ground.  The noise fades in over one noise wavelength
+ * outside of flatRadius from the origin.
+ * @param x : global x position
+ * @param y : global y position
+ */
+double ProceduralTerrain::height(double x, double y) const {
+  double h = _params.height + feature(x, y);
+  if (_params.noiseAmplitude != 0) {
+    double r = std::sqrt(x * x + y * y);
+    double fade = (r - _params.flatRadius) / _params.noiseWavelength;
+    fade = std::min(std::max(fade, 0.), 1.);
+    if (fade > 0) h += fade * fade * (3 - 2 * fade) * noise(x, y);
+  }
+  return h;
+}
+
+/*!
+ * Sample a chunk of the terrain into a collision height map
+ * @param x : chunk index in x
+ * @param y : chunk index in y
+ */
+template <typename T>
+std::shared_ptr<TerrainChunk<T>> ProceduralTerrain::generateChunk(s64 x,
+                                                                  s64 y) const {
+  size_t n = _samplesPerChunk;
+  double x0 = x * _params.chunkSize - _grid, y0 = y * _params.chunkSize - _grid;
+  DMat<T> heightMap(n, n);
+  for (size_t j = 0; j < n; j++) {
+    for (size_t i = 0; i < n; i++) {
+      heightMap(i, j) = height(x0 + i * _grid, y0 + j * _grid);
+    }
+  }
+  return std::shared_ptr<TerrainChunk<T>>(new TerrainChunk<T>(
+      x, y, _params.mu, _params.restitution, _grid, Vec3<T>(x0, y0, 0),
+      heightMap));
+}
+
+template std::shared_ptr<TerrainChunk<double>>
+ProceduralTerrain::generateChunk<double>(s64 x, s64 y) const;
+template std::shared_ptr<TerrainChunk<float>>
+ProceduralTerrain::generateChunk<float>(s64 x, s64 y) const;
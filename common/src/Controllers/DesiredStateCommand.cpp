@@ -26,7 +26,6 @@ template <typename T>
 void DesiredStateCommand<T>::convertToStateCommands() {
   data.zero();
 
-  static bool b_firstVisit(true);
   if(b_firstVisit){
     data.pre_stateDes(0) = stateEstimate->position(0);
     data.pre_stateDes(1) = stateEstimate->position(1);
@@ -0,0 +1,144 @@
+/*! @file BatchActuatorModel.cpp
+ *  @brief Actuator model of all 12 joints of a quadruped at once
+ */
+
+#include "Dynamics/BatchActuatorModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/*!
+ * Construct the actuator models of all joints
+ * @param legModels : models of the abad, hip and knee actuators, the same for
+ * every leg (see Quadruped::buildActuatorModels)
+ */
+template <typename T>
+BatchActuatorModel<T>::BatchActuatorModel(
+    const std::vector<ActuatorModel<T>>& legModels) {
+  if (legModels.size() != 3) {
+    throw std::runtime_error("batch actuator model needs 3 models per leg");
+  }
+  for (size_t i = 0; i < kJoints; i++) {
+    const ActuatorModel<T>& model = legModels[i % 3];
+    _gr[i] = model.getGearRatio();
+    _kt[i] = model.getMotorKT();
+    _R0[i] = model.getMotorR();
+    _R[i] = _R0[i];
+    _V[i] = model.getBatteryV();
+    _tauMax[i] = model.getTauMax();
+    _damping0[i] = model.getDamping();
+    _dryFriction0[i] = model.getDryFriction();
+    _damping[i] = model.getFriction() ? _damping0[i] : 0;
+    _dryFriction[i] = model.getFriction() ? _dryFriction0[i] : 0;
+    _temperature[i] = _thermal.ambient;
+  }
+}
+
+/*!
+ * Compute the actual torque of every joint, like ActuatorModel::getTorque.
+ * The loop is branch free so that it vectorizes.
+ * @param tauDes : desired torque of each joint
+ * @param qd : velocity of each joint
+ * @param tau : actual torque of each joint
+ */
+template <typename T>
+void BatchActuatorModel<T>::getTorques(const T* tauDes, const T* qd, T* tau) {
+  for (size_t i = 0; i < kJoints; i++) {
+    T tauDesMotor = tauDes[i] / _gr[i];
+    T iDes = tauDesMotor / (_kt[i] * 1.5);
+    T bemf = qd[i] * _gr[i] * _kt[i] * 2.;
+    T vDes = iDes * _R[i] + bemf;
+    T vActual = std::min(std::max(vDes, -_V[i]), _V[i]);
+    T tauActMotor = 1.5 * _kt[i] * (vActual - bemf) / _R[i];
+    tauActMotor = std::min(std::max(tauActMotor, -_tauMax[i]), _tauMax[i]);
+
+    T current = tauActMotor / (_kt[i] * 1.5);
+    _powerLoss[i] = 1.5 * current * current * _R[i];
+
+    T sign = T(0 < qd[i]) - T(qd[i] < 0);
+    tau[i] = _gr[i] * tauActMotor - _damping[i] * qd[i] -
+             _dryFriction[i] * sign;
+  }
+}
+
+/*!
+ * Control friction effects of all joints
+ * @param enabled : enable/disable both dry and damping friction terms
+ */
+template <typename T>
+void BatchActuatorModel<T>::setFriction(bool enabled) {
+  for (size_t i = 0; i < kJoints; i++) {
+    _damping[i] = enabled ? _damping0[i] : 0;
+    _dryFriction[i] = enabled ? _dryFriction0[i] : 0;
+  }
+}
+
+/*!
+ * Start tracking motor temperatures, with all motors at ambient
+ */
+template <typename T>
+void BatchActuatorModel<T>::enableThermalModel(
+    const MotorThermalParameters<T>& params) {
+  if (!(params.capacity > 0) || !(params.resistance > 0)) {
+    throw std::runtime_error(
+        "motor thermal capacity and resistance must be positive");
+  }
+  _thermal = params;
+  _thermalEnabled = true;
+  _decayDt = 0;
+  _decay = 1;
+  for (size_t i = 0; i < kJoints; i++) {
+    _temperature[i] = params.ambient;
+    _R[i] = _R0[i];
+  }
+}
+
+/*!
+ * Stop tracking motor temperatures and go back to the nominal motor R
+ */
+template <typename T>
+void BatchActuatorModel<T>::disableThermalModel() {
+  _thermalEnabled = false;
+  for (size_t i = 0; i < kJoints; i++) {
+    _temperature[i] = _thermal.ambient;
+    _R[i] = _R0[i];
+  }
+}
+
+/*!
+ * Heat the motors with the copper loss of the last getTorques for dt seconds.
+ * The loss is constant over the step, so the exact solution is used, which is
+ * stable for any dt.
+ */
+template <typename T>
+void BatchActuatorModel<T>::updateTemperatures(T dt) {
+  if (!_thermalEnabled) return;
+  if (dt != _decayDt) {
+    _decay = std::exp(-dt / (_thermal.capacity * _thermal.resistance));
+    _decayDt = dt;
+  }
+  for (size_t i = 0; i < kJoints; i++) {
+    T steady = _thermal.ambient + _powerLoss[i] * _thermal.resistance;
+    _temperature[i] = steady + (_temperature[i] - steady) * _decay;
+    _R[i] = _R0[i] *
+            (1 + _thermal.rTempCo * (_temperature[i] - _thermal.ambient));
+  }
+}
+
+/*!
+ * Set the winding temperature of each motor, for restoring a snapshot.  Does
+ * nothing if the thermal model is disabled.
+ */
+template <typename T>
+void BatchActuatorModel<T>::setTemperatures(const T* temperatures) {
+  if (!_thermalEnabled) return;
+  for (size_t i = 0; i < kJoints; i++) {
+    _temperature[i] = temperatures[i];
+    _R[i] = _R0[i] *
+            (1 + _thermal.rTempCo * (_temperature[i] - _thermal.ambient));
+  }
+}
+
+template class BatchActuatorModel<double>;
+template class BatchActuatorModel<float>;
@@ -0,0 +1,587 @@
+/*! @file BatchFloatingBaseModel.cpp
+ *  @brief Batched dynamics for evaluating many states of one floating base
+ * model at once
+ *
+ * The recursions are the same as FloatingBaseModel::runABA and
+ * FloatingBaseModel::inverseDynamics, with external forces left out.  Each
+ * spatial vector is stored as a W x 6 array and each spatial matrix as a W x 36
+ * array, so one column holds one element for all W states.
+ *
+ * Joint transforms are never formed: for a revolute joint, Xup = XJ(q) * Xtree
+ * where XJ = diag(R, R) and R is a rotation about a coordinate axis.  Products
+ * with Xtree are W x 6 by 6 x 6 matrix products shared by all lanes, and
+ * products with XJ only touch two of the three coordinates of each half.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "Dynamics/BatchFloatingBaseModel.h"
+#include "Dynamics/Quadruped.h"
+
+namespace {
+
+/*!
+ * Apply a coordinate rotation to columns a and b of every lane.
+ * Pass -s to apply the transposed rotation.
+ */
+template <typename Derived, typename Lanes>
+void rotateColumns(Eigen::ArrayBase<Derived>& m, int a, int b, const Lanes& c,
+                   const Lanes& s) {
+  Lanes ma = m.col(a);
+  m.col(a) = c * ma + s * m.col(b);
+  m.col(b) = c * m.col(b) - s * ma;
+}
+
+/*!
+ * Apply the revolute joint transform diag(R, R) to a lane spatial vector, where
+ * R = coordinateRotation(axis, q), c = cos(q) and s = sin(q).
+ * Pass -s to apply the transpose.
+ */
+template <typename LaneSVec, typename Lanes>
+void rotateJoint(LaneSVec& v, int axis, const Lanes& c, const Lanes& s) {
+  const int a = (axis + 1) % 3;
+  const int b = (axis + 2) % 3;
+  rotateColumns(v, a, b, c, s);
+  rotateColumns(v, a + 3, b + 3, c, s);
+}
+
+/*!
+ * Computes X^T M X for a revolute joint transform X = XJ * Xtree and adds it
+ * to out.  M is overwritten.
+ */
+template <typename T, typename LaneMat6, typename Lanes>
+void addCongruence(const Mat6<T>& Xtree, int axis, const Lanes& c,
+                   const Lanes& s, LaneMat6& M, LaneMat6& out) {
+  const int a = (axis + 1) % 3;
+  const int b = (axis + 2) % 3;
+  const Lanes ms = -s;
+
+  // M <- XJ^T M XJ, first each row, then each column
+  for (int r = 0; r < 6; r++) {
+    rotateColumns(M, 6 * r + a, 6 * r + b, c, ms);
+    rotateColumns(M, 6 * r + a + 3, 6 * r + b + 3, c, ms);
+  }
+  for (int k = 0; k < 6; k++) {
+    rotateColumns(M, 6 * a + k, 6 * b + k, c, ms);
+    rotateColumns(M, 6 * (a + 3) + k, 6 * (b + 3) + k, c, ms);
+  }
+
+  // out += Xtree^T M Xtree
+  for (int r = 0; r < 6; r++) {
+    M.template middleCols<6>(6 * r) =
+        (M.template middleCols<6>(6 * r).matrix() * Xtree).array();
+  }
+  for (int i = 0; i < 6; i++) {
+    for (int r = 0; r < 6; r++) {
+      if (Xtree(r, i) != T(0)) {
+        out.template middleCols<6>(6 * i) +=
+            Xtree(r, i) * M.template middleCols<6>(6 * r);
+      }
+    }
+  }
+}
+
+/*!
+ * Spatial matrix (one per lane) times spatial vector (one per lane)
+ */
+template <typename LaneMat6, typename LaneSVec>
+LaneSVec laneMatVec(const LaneMat6& M, const LaneSVec& v) {
+  LaneSVec out;
+  for (int r = 0; r < 6; r++) {
+    out.col(r) = M.col(6 * r) * v.col(0);
+    for (int k = 1; k < 6; k++) out.col(r) += M.col(6 * r + k) * v.col(k);
+  }
+  return out;
+}
+
+/*!
+ * Lane version of spatial::motionCrossProduct
+ */
+template <typename LaneSVec>
+LaneSVec laneMotionCross(const LaneSVec& a, const LaneSVec& b) {
+  LaneSVec mv;
+  mv.col(0) = a.col(1) * b.col(2) - a.col(2) * b.col(1);
+  mv.col(1) = a.col(2) * b.col(0) - a.col(0) * b.col(2);
+  mv.col(2) = a.col(0) * b.col(1) - a.col(1) * b.col(0);
+  mv.col(3) = a.col(1) * b.col(5) - a.col(2) * b.col(4) +
+              a.col(4) * b.col(2) - a.col(5) * b.col(1);
+  mv.col(4) = a.col(2) * b.col(3) - a.col(0) * b.col(5) -
+              a.col(3) * b.col(2) + a.col(5) * b.col(0);
+  mv.col(5) = a.col(0) * b.col(4) - a.col(1) * b.col(3) +
+              a.col(3) * b.col(1) - a.col(4) * b.col(0);
+  return mv;
+}
+
+/*!
+ * Lane version of spatial::forceCrossProduct
+ */
+template <typename LaneSVec>
+LaneSVec laneForceCross(const LaneSVec& a, const LaneSVec& b) {
+  LaneSVec mv;
+  mv.col(0) = b.col(2) * a.col(1) - b.col(1) * a.col(2) -
+              b.col(4) * a.col(5) + b.col(5) * a.col(4);
+  mv.col(1) = b.col(0) * a.col(2) - b.col(2) * a.col(0) +
+              b.col(3) * a.col(5) - b.col(5) * a.col(3);
+  mv.col(2) = b.col(1) * a.col(0) - b.col(0) * a.col(1) -
+              b.col(3) * a.col(4) + b.col(4) * a.col(3);
+  mv.col(3) = b.col(5) * a.col(1) - b.col(4) * a.col(2);
+  mv.col(4) = b.col(3) * a.col(2) - b.col(5) * a.col(0);
+  mv.col(5) = b.col(4) * a.col(0) - b.col(3) * a.col(1);
+  return mv;
+}
+
+/*!
+ * Solve A x = b in every lane, for symmetric positive definite A (Cholesky)
+ */
+template <typename LaneMat6, typename LaneSVec>
+LaneSVec laneCholeskySolve(const LaneMat6& A, const LaneSVec& b) {
+  LaneMat6 L = A;
+  for (int j = 0; j < 6; j++) {
+    for (int k = 0; k < j; k++) L.col(6 * j + j) -= L.col(6 * j + k).square();
+    L.col(6 * j + j) = L.col(6 * j + j).sqrt();
+    for (int i = j + 1; i < 6; i++) {
+      for (int k = 0; k < j; k++)
+        L.col(6 * i + j) -= L.col(6 * i + k) * L.col(6 * j + k);
+      L.col(6 * i + j) /= L.col(6 * j + j);
+    }
+  }
+
+  LaneSVec x = b;
+  for (int i = 0; i < 6; i++) {
+    for (int k = 0; k < i; k++) x.col(i) -= L.col(6 * i + k) * x.col(k);
+    x.col(i) /= L.col(6 * i + i);
+  }
+  for (int i = 5; i >= 0; i--) {
+    for (int k = i + 1; k < 6; k++) x.col(i) -= L.col(6 * k + i) * x.col(k);
+    x.col(i) /= L.col(6 * i + i);
+  }
+  return x;
+}
+
+}  // namespace
+
+/*!
+ * Copy the kinematic tree and inertias out of a finished floating base model.
+ * @param model : model to copy.  Must have exactly NDOF degrees of freedom and
+ * only revolute joints.
+ */
+template <typename T, int NDOF, int W>
+void BatchFloatingBaseModel<T, NDOF, W>::setModel(
+    const FloatingBaseModel<T>& model) {
+  if (model._nDof != (size_t)NDOF) {
+    throw std::runtime_error(
+        "BatchFloatingBaseModel expected " + std::to_string(NDOF) +
+        " dofs, but the model has " + std::to_string(model._nDof) + "\n");
+  }
+
+  _gravity = model._gravity;
+  for (int i = 0; i < NDOF; i++) {
+    _parents[i] = model._parents[i];
+    _axes[i] = (int)model._jointAxes[i];
+    _gearRatios[i] = model._gearRatios[i];
+    _Xtree[i] = model._Xtree[i];
+    _Xrot[i] = model._Xrot[i];
+    _Ibody[i] = model._Ibody[i].getMatrix();
+    _Irot[i] = model._Irot[i].getMatrix();
+    if (i > 5 && model._jointTypes[i] != JointType::Revolute) {
+      throw std::runtime_error(
+          "BatchFloatingBaseModel only supports revolute joints\n");
+    }
+  }
+}
+
+/*!
+ * Load states first ... first + W - 1 of a batch into the lanes.  Lanes past
+ * the end of the batch repeat the last state.
+ */
+template <typename T, int NDOF, int W>
+void BatchFloatingBaseModel<T, NDOF, W>::loadState(
+    const FBModelStateBatch<T>& x, size_t first) {
+  const size_t n = x.size();
+  Eigen::Array<T, W, 4> quat;
+  for (int l = 0; l < W; l++) {
+    size_t row = std::min(first + l, n - 1);
+    quat.row(l) = x.bodyOrientation.row(row);
+    _v[5].row(l) = x.bodyVelocity.row(row);
+    _q.row(l) = x.q.row(row);
+    _qd.row(l) = x.qd.row(row);
+  }
+
+  // body to world rotation, same as ori::quaternionToRotationMatrix transposed
+  auto e0 = quat.col(0), e1 = quat.col(1), e2 = quat.col(2), e3 = quat.col(3);
+  _Rbody.col(0) = T(1) - T(2) * (e2 * e2 + e3 * e3);
+  _Rbody.col(1) = T(2) * (e1 * e2 - e0 * e3);
+  _Rbody.col(2) = T(2) * (e1 * e3 + e0 * e2);
+  _Rbody.col(3) = T(2) * (e1 * e2 + e0 * e3);
+  _Rbody.col(4) = T(1) - T(2) * (e1 * e1 + e3 * e3);
+  _Rbody.col(5) = T(2) * (e2 * e3 - e0 * e1);
+  _Rbody.col(6) = T(2) * (e1 * e3 - e0 * e2);
+  _Rbody.col(7) = T(2) * (e2 * e3 + e0 * e1);
+  _Rbody.col(8) = T(1) - T(2) * (e1 * e1 + e2 * e2);
+}
+
+/*!
+ * Compute joint rotations, velocities and velocity product accelerations
+ */
+template <typename T, int NDOF, int W>
+void BatchFloatingBaseModel<T, NDOF, W>::forwardKinematics() {
+  for (int i = 6; i < NDOF; i++) {
+    const int p = _parents[i];
+    const int k = _axes[i];
+    const T gr = _gearRatios[i];
+    Lanes q = _q.col(i - 6);
+    Lanes qd = _qd.col(i - 6);
+    _cq[i] = q.cos();
+    _sq[i] = q.sin();
+    _cqrot[i] = (q * gr).cos();
+    _sqrot[i] = (q * gr).sin();
+
+    LaneSVec vJ = LaneSVec::Zero();
+    vJ.col(k) = qd;
+    _v[i] = (_v[p].matrix() * _Xtree[i].transpose()).array();
+    rotateJoint(_v[i], k, _cq[i], _sq[i]);
+    _v[i] += vJ;
+
+    LaneSVec vJrot = LaneSVec::Zero();
+    vJrot.col(k) = qd * gr;
+    _vrot[i] = (_v[p].matrix() * _Xrot[i].transpose()).array();
+    rotateJoint(_vrot[i], k, _cqrot[i], _sqrot[i]);
+    _vrot[i] += vJrot;
+
+    _c[i] = laneMotionCross(_v[i], vJ);
+    _crot[i] = laneMotionCross(_vrot[i], vJrot);
+  }
+}
+
+/*!
+ * Run the articulated body algorithm on W states of a batch.
+ * @param x : batch of states
+ * @param tau : joint torques, one row per state
+ * @param dx : output, must already be sized for the batch
+ * @param first : index of the first state in the block
+ */
+template <typename T, int NDOF, int W>
+void BatchFloatingBaseModel<T, NDOF, W>::runABA(
+    const FBModelStateBatch<T>& x, const BatchArray<T>& tau,
+    FBModelStateDerivativeBatch<T>& dx, size_t first) {
+  loadState(x, first);
+  forwardKinematics();
+
+  const size_t n = x.size();
+  Eigen::Array<T, W, nJoints> tauLanes;
+  for (int l = 0; l < W; l++) {
+    tauLanes.row(l) = tau.row(std::min(first + l, n - 1));
+  }
+
+  // articulated inertias and bias forces of each body by itself
+  for (int i = 5; i < NDOF; i++) {
+    for (int r = 0; r < 6; r++)
+      for (int k = 0; k < 6; k++)
+        _IA[i].col(6 * r + k).setConstant(_Ibody[i](r, k));
+
+    LaneSVec h = (_v[i].matrix() * _Ibody[i].transpose()).array();
+    _pA[i] = laneForceCross(_v[i], h);
+    if (i > 5) {
+      h = (_vrot[i].matrix() * _Irot[i].transpose()).array();
+      _pArot[i] = laneForceCross(_vrot[i], h);
+    }
+  }
+
+  LaneMat6 M;
+  LaneSVec tmp;
+  for (int i = NDOF - 1; i >= 6; i--) {
+    const int p = _parents[i];
+    const int k = _axes[i];
+    const T gr = _gearRatios[i];
+    const Lanes msq = -_sq[i];
+    const Lanes msqrot = -_sqrot[i];
+
+    // U = IA * S, Urot = Irot * Srot, with S a unit vector along the axis
+    LaneSVec U;
+    for (int r = 0; r < 6; r++) U.col(r) = _IA[i].col(6 * r + k);
+    SVec<T> Urot = _Irot[i].col(k) * gr;
+
+    _d[i] = U.col(k) + gr * Urot[k];
+    _u[i] = tauLanes.col(i - 6) - _pA[i].col(k) - gr * _pArot[i].col(k);
+    for (int r = 0; r < 6; r++) {
+      _u[i] -= U.col(r) * _c[i].col(r) + Urot[r] * _crot[i].col(r);
+    }
+
+    // Utot = Xup^T U + Xuprot^T Urot
+    rotateJoint(U, k, _cq[i], msq);
+    _Utot[i] = (U.matrix() * _Xtree[i]).array();
+    tmp = Urot.transpose().replicate(W, 1).array();
+    rotateJoint(tmp, k, _cqrot[i], msqrot);
+    _Utot[i] += (tmp.matrix() * _Xrot[i]).array();
+
+    // IA[p] += Xup^T IA Xup + Xuprot^T Irot Xuprot - Utot Utot^T / d
+    M = _IA[i];
+    addCongruence(_Xtree[i], k, _cq[i], _sq[i], M, _IA[p]);
+    for (int r = 0; r < 6; r++)
+      for (int c = 0; c < 6; c++) M.col(6 * r + c).setConstant(_Irot[i](r, c));
+    addCongruence(_Xrot[i], k, _cqrot[i], _sqrot[i], M, _IA[p]);
+    Lanes invD = _d[i].inverse();
+    for (int r = 0; r < 6; r++) {
+      Lanes ur = _Utot[i].col(r) * invD;
+      for (int c = 0; c < 6; c++) _IA[p].col(6 * r + c) -= ur * _Utot[i].col(c);
+    }
+
+    // pA[p] += Xup^T (pA + IA c) + Xuprot^T (pArot + Irot crot) + Utot u / d
+    tmp = _pA[i] + laneMatVec(_IA[i], _c[i]);
+    rotateJoint(tmp, k, _cq[i], msq);
+    _pA[p] += (tmp.matrix() * _Xtree[i]).array();
+    tmp = _pArot[i] + (_crot[i].matrix() * _Irot[i].transpose()).array();
+    rotateJoint(tmp, k, _cqrot[i], msqrot);
+    _pA[p] += (tmp.matrix() * _Xrot[i]).array();
+    _pA[p] += _Utot[i].colwise() * (_u[i] * invD);
+  }
+
+  // floating base: a5 = -Xup5 * aGravity = [0; -R g]
+  _a[5].setZero();
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      _a[5].col(3 + r) -= _Rbody.col(3 * c + r) * _gravity[c];
+    }
+  }
+  LaneSVec afb =
+      laneCholeskySolve(_IA[5], LaneSVec(-_pA[5] - laneMatVec(_IA[5], _a[5])));
+  _a[5] += afb;
+
+  Eigen::Array<T, W, nJoints> qdd;
+  for (int i = 6; i < NDOF; i++) {
+    const int p = _parents[i];
+    const int k = _axes[i];
+    qdd.col(i - 6) =
+        (_u[i] - (_Utot[i] * _a[p]).rowwise().sum()) / _d[i];
+    _a[i] = (_a[p].matrix() * _Xtree[i].transpose()).array();
+    rotateJoint(_a[i], k, _cq[i], _sq[i]);
+    _a[i].col(k) += qdd.col(i - 6);
+    _a[i] += _c[i];
+  }
+
+  const int valid = (int)std::min((size_t)W, n - first);
+  for (int l = 0; l < valid; l++) {
+    for (int r = 0; r < 3; r++) {
+      dx.dBodyPosition(first + l, r) = _Rbody(l, 3 * r) * _v[5](l, 3) +
+                                       _Rbody(l, 3 * r + 1) * _v[5](l, 4) +
+                                       _Rbody(l, 3 * r + 2) * _v[5](l, 5);
+    }
+    dx.dBodyVelocity.row(first + l) = afb.row(l);
+    dx.qdd.row(first + l) = qdd.row(l);
+  }
+}
+
+/*!
+ * Run the recursive Newton-Euler algorithm on W states of a batch.
+ * @param x : batch of states
+ * @param dx : state derivatives (only dBodyVelocity and qdd are used)
+ * @param genForce : output, must already be sized for the batch.  The first
+ * six columns are the wrench on the base, the rest the joint torques
+ * @param first : index of the first state in the block
+ */
+template <typename T, int NDOF, int W>
+void BatchFloatingBaseModel<T, NDOF, W>::inverseDynamics(
+    const FBModelStateBatch<T>& x, const FBModelStateDerivativeBatch<T>& dx,
+    BatchArray<T>& genForce, size_t first) {
+  loadState(x, first);
+  forwardKinematics();
+
+  const size_t n = x.size();
+  Eigen::Array<T, W, nJoints> qdd;
+  for (int l = 0; l < W; l++) {
+    size_t row = std::min(first + l, n - 1);
+    _a[5].row(l) = dx.dBodyVelocity.row(row);
+    qdd.row(l) = dx.qdd.row(row);
+  }
+  for (int r = 0; r < 3; r++) {
+    for (int c = 0; c < 3; c++) {
+      _a[5].col(3 + r) -= _Rbody.col(3 * c + r) * _gravity[c];
+    }
+  }
+
+  // forces on each body are accumulated into _pA and the rotor forces into
+  // _pArot, reusing the ABA storage
+  LaneSVec h = (_v[5].matrix() * _Ibody[5].transpose()).array();
+  _pA[5] = (_a[5].matrix() * _Ibody[5].transpose()).array() +
+           laneForceCross(_v[5], h);
+  LaneSVec arot;
+  for (int i = 6; i < NDOF; i++) {
+    const int p = _parents[i];
+    const int k = _axes[i];
+    const T gr = _gearRatios[i];
+
+    _a[i] = (_a[p].matrix() * _Xtree[i].transpose()).array();
+    rotateJoint(_a[i], k, _cq[i], _sq[i]);
+    _a[i].col(k) += qdd.col(i - 6);
+    _a[i] += _c[i];
+
+    arot = (_a[p].matrix() * _Xrot[i].transpose()).array();
+    rotateJoint(arot, k, _cqrot[i], _sqrot[i]);
+    arot.col(k) += qdd.col(i - 6) * gr;
+    arot += _crot[i];
+
+    h = (_v[i].matrix() * _Ibody[i].transpose()).array();
+    _pA[i] = (_a[i].matrix() * _Ibody[i].transpose()).array() +
+             laneForceCross(_v[i], h);
+    h = (_vrot[i].matrix() * _Irot[i].transpose()).array();
+    _pArot[i] = (arot.matrix() * _Irot[i].transpose()).array() +
+                laneForceCross(_vrot[i], h);
+  }
+
+  Eigen::Array<T, W, NDOF> gf;
+  for (int i = NDOF - 1; i > 5; i--) {
+    const int p = _parents[i];
+    const int k = _axes[i];
+    const Lanes msq = -_sq[i];
+    const Lanes msqrot = -_sqrot[i];
+    gf.col(i) = _pA[i].col(k) + _gearRatios[i] * _pArot[i].col(k);
+
+    // f[p] += Xup^T f + Xuprot^T frot
+    rotateJoint(_pA[i], k, _cq[i], msq);
+    _pA[p] += (_pA[i].matrix() * _Xtree[i]).array();
+    rotateJoint(_pArot[i], k, _cqrot[i], msqrot);
+    _pA[p] += (_pArot[i].matrix() * _Xrot[i]).array();
+  }
+  gf.template leftCols<6>() = _pA[5];
+
+  const int valid = (int)std::min((size_t)W, n - first);
+  for (int l = 0; l < valid; l++) genForce.row(first + l) = gf.row(l);
+}
+
+/*!
+ * Build the engine for a model.
+ * @param model : floating base model to evaluate
+ * @param nThreads : total number of threads, including the caller.  0 uses one
+ * per hardware thread.
+ */
+template <typename T, int NDOF>
+BatchDynamicsEngine<T, NDOF>::BatchDynamicsEngine(
+    const FloatingBaseModel<T>& model, size_t nThreads) {
+  if (nThreads == 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t i = 0; i < nThreads; i++) {
+    _kernels.emplace_back(new Kernel(model));
+  }
+  for (size_t i = 1; i < nThreads; i++) {
+    _workers.emplace_back(&BatchDynamicsEngine<T, NDOF>::workerLoop, this, i);
+  }
+}
+
+template <typename T, int NDOF>
+BatchDynamicsEngine<T, NDOF>::~BatchDynamicsEngine() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _startCv.notify_all();
+  for (auto& worker : _workers) worker.join();
+}
+
+/*!
+ * Set the gravity for all threads
+ */
+template <typename T, int NDOF>
+void BatchDynamicsEngine<T, NDOF>::setGravity(const Vec3<T>& g) {
+  for (auto& kernel : _kernels) kernel->setGravity(g);
+}
+
+/*!
+ * Run the articulated body algorithm on every state in a batch.
+ * @param x : batch of states
+ * @param tau : joint torques, one row per state
+ * @param dx : output state derivatives.  Resized only if needed.
+ */
+template <typename T, int NDOF>
+void BatchDynamicsEngine<T, NDOF>::runABA(const FBModelStateBatch<T>& x,
+                                          const BatchArray<T>& tau,
+                                          FBModelStateDerivativeBatch<T>& dx) {
+  if (dx.size() != x.size() || dx.qdd.cols() != nJoints) {
+    dx.resize(x.size(), nJoints);
+  }
+  _job = [&](Kernel& kernel, size_t first) {
+    kernel.runABA(x, tau, dx, first);
+  };
+  runBlocks(x.size());
+}
+
+/*!
+ * Run the recursive Newton-Euler algorithm on every state in a batch.
+ * @param x : batch of states
+ * @param dx : state derivatives (only dBodyVelocity and qdd are used)
+ * @param genForce : output generalized forces, one row per state.  Resized
+ * only if needed.
+ */
+template <typename T, int NDOF>
+void BatchDynamicsEngine<T, NDOF>::inverseDynamics(
+    const FBModelStateBatch<T>& x, const FBModelStateDerivativeBatch<T>& dx,
+    BatchArray<T>& genForce) {
+  if ((size_t)genForce.rows() != x.size() || genForce.cols() != NDOF) {
+    genForce.resize(x.size(), NDOF);
+  }
+  _job = [&](Kernel& kernel, size_t first) {
+    kernel.inverseDynamics(x, dx, genForce, first);
+  };
+  runBlocks(x.size());
+}
+
+/*!
+ * Run _job on every block of a batch of nStates and wait for it to finish
+ */
+template <typename T, int NDOF>
+void BatchDynamicsEngine<T, NDOF>::runBlocks(size_t nStates) {
+  const size_t nBlocks = (nStates + Kernel::lanes - 1) / Kernel::lanes;
+  if (nBlocks == 0) return;
+
+  if (_workers.empty() || nBlocks == 1) {
+    for (size_t b = 0; b < nBlocks; b++) _job(*_kernels[0], b * Kernel::lanes);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _nBlocks = nBlocks;
+    _nextBlock = 0;
+    _busyWorkers = _workers.size();
+    _generation++;
+  }
+  _startCv.notify_all();
+
+  doBlocks(*_kernels[0]);
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _doneCv.wait(lock, [this] { return _busyWorkers == 0; });
+}
+
+/*!
+ * Take blocks until there are none left
+ */
+template <typename T, int NDOF>
+void BatchDynamicsEngine<T, NDOF>::doBlocks(Kernel& kernel) {
+  for (size_t b = _nextBlock++; b < _nBlocks; b = _nextBlock++) {
+    _job(kernel, b * Kernel::lanes);
+  }
+}
+
+template <typename T, int NDOF>
+void BatchDynamicsEngine<T, NDOF>::workerLoop(size_t id) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _startCv.wait(lock, [&] { return _stop || _generation != seen; });
+      if (_stop) return;
+      seen = _generation;
+    }
+
+    doBlocks(*_kernels[id]);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (--_busyWorkers == 0) _doneCv.notify_one();
+  }
+}
+
+template class BatchFloatingBaseModel<double, cheetah::dim_config>;
+template class BatchFloatingBaseModel<float, cheetah::dim_config>;
+template class BatchDynamicsEngine<double, cheetah::dim_config>;
+template class BatchDynamicsEngine<float, cheetah::dim_config>;
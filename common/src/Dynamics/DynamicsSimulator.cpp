@@ -8,6 +8,7 @@
 #include "Dynamics/DynamicsSimulator.h"
 #include "Collision/ContactImpulse.h"
 #include "Collision/ContactSpringDamper.h"
+#include "Utilities/Timer.h"
 #include "Utilities/Utilities_print.h"
 
 /*!
@@ -30,6 +31,91 @@ DynamicsSimulator<T>::DynamicsSimulator(FloatingBaseModel<T> &model,
   _state.qd = DVec<T>::Zero(_model._nDof - 6);
   _dstate.qdd = DVec<T>::Zero(_model._nDof - 6);
   _lastBodyVelocity.setZero();
+  _homing.active_flag = false;
+}
+
+template <typename T>
+DynamicsSimulator<T>::~DynamicsSimulator() {
+  delete _fixedModel;
+}
+
+/*!
+ * Run the articulated body algorithm on the fixed-size quadruped model instead
+ * of the dynamically sized one.  Contacts are still computed with the
+ * FloatingBaseModel.  Only possible for models with cheetah::dim_config dofs.
+ * @param useFixedSize : enable/disable the fixed-size model
+ */
+template <typename T>
+void DynamicsSimulator<T>::setUseFixedSizeDynamics(bool useFixedSize) {
+  delete _fixedModel;
+  _fixedModel = nullptr;
+  if (useFixedSize) {
+    _fixedModel = new FixedQuadrupedModel<T>(_model);
+  }
+}
+
+/*!
+ * Find _dstate with the articulated body algorithm
+ * @param tau : joint torques
+ */
+template <typename T>
+void DynamicsSimulator<T>::runABA(const DVec<T> &tau) {
+  if (_fixedModel) {
+    _fixedModel->setState(_model._state);
+    _fixedModel->setExternalForces(_model._externalForces);
+    _fixedModel->runABA(tau, _dstate);
+  } else {
+    _model.runABA(tau, _dstate);
+  }
+}
+
+/*!
+ * Select the time integration scheme used by step
+ * @param integrator : integration scheme
+ * @param contactDt : longest substep used near contact by the adaptive
+ * integrator
+ */
+template <typename T>
+void DynamicsSimulator<T>::setIntegrator(DynamicsIntegrator integrator,
+                                         T contactDt) {
+  if (contactDt <= 0) {
+    throw std::runtime_error("DynamicsSimulator contact dt must be positive");
+  }
+  if (integrator != _integrator) _midpointPredictionValid = false;
+  _integrator = integrator;
+  _contactDt = contactDt;
+}
+
+/*!
+ * Save the state of the simulation, including the contact state and the
+ * integrator history
+ * @param state : filled with the current state
+ */
+template <typename T>
+void DynamicsSimulator<T>::getSimulatorState(
+    DynamicsSimulatorState<T> &state) const {
+  state.state = _state;
+  state.dstate = _dstate;
+  state.lastBodyVelocity = _lastBodyVelocity;
+  state.midpointDState = _midpointDState;
+  state.midpointPredictionValid = _midpointPredictionValid;
+  _contact_constr->getPersistentState(state.contactState);
+}
+
+/*!
+ * Restore a state saved with getSimulatorState.  Stepping from here gives the
+ * same result as stepping the simulator the state was saved from.
+ * @param state : state to restore
+ */
+template <typename T>
+void DynamicsSimulator<T>::setSimulatorState(
+    const DynamicsSimulatorState<T> &state) {
+  setState(state.state);
+  _dstate = state.dstate;
+  _lastBodyVelocity = state.lastBodyVelocity;
+  _midpointDState = state.midpointDState;
+  _midpointPredictionValid = state.midpointPredictionValid;
+  _contact_constr->setPersistentState(state.contactState);
 }
 
 /*!
@@ -43,9 +129,38 @@ void DynamicsSimulator<T>::step(T dt, const DVec<T> &tau, T kp, T kd ) {
   // compute ground contact forces
   // aba
   // integrate
-  forwardKinematics();           // compute forward kinematics
-  updateCollisions(dt, kp, kd);  // process collisions
-  // Process Homing
+  forwardKinematics();  // compute forward kinematics
+  applyHoming();
+
+  switch (_integrator) {
+    case DynamicsIntegrator::SYMPLECTIC:
+      stepSymplectic(dt, tau, kp, kd);
+      break;
+    case DynamicsIntegrator::RK4:
+      if (_contact_constr->CheckContact() > 0) {
+        stepEuler(dt, tau, kp, kd);
+      } else {
+        stepRK4(dt, tau);
+      }
+      break;
+    case DynamicsIntegrator::ADAPTIVE:
+      stepAdaptive(dt, tau, kp, kd);
+      break;
+    default:
+      stepEuler(dt, tau, kp, kd);
+  }
+  _stepCounterTime += dt;
+
+  _model.setState(_state);
+  _model.resetExternalForces();  // clear external forces
+  _model.resetCalculationFlags();
+}
+
+/*!
+ * Add the homing forces to the external forces, if homing is active
+ */
+template <typename T>
+void DynamicsSimulator<T>::applyHoming() {
   if( _homing.active_flag) {
 
     Mat3<T> R10_des = rpyToRotMat(_homing.rpy);              // R10_des
@@ -63,14 +178,190 @@ void DynamicsSimulator<T>::step(T dt, const DVec<T> &tau, T kp, T kd ) {
     _model._externalForces.at(5).head(3) += _homing.kp_ang*angle_axis - _homing.kd_ang*_model.getAngularVelocity(5);
 
   }
+}
 
-
+/*!
+ * Semi-implicit Euler step: collisions, ABA, then integrate.  The model must
+ * be at _state with its forward kinematics done.
+ */
+template <typename T>
+void DynamicsSimulator<T>::stepEuler(T dt, const DVec<T> &tau, T kp, T kd) {
+  updateCollisions(dt, kp, kd);  // process collisions
   runABA(tau);                   // dynamics algorithm
   integrate(dt);                 // step forward
+  _stepCounter++;
+}
 
-  _model.setState(_state);
-  _model.resetExternalForces();  // clear external forces
-  _model.resetCalculationFlags();
+/*!
+ * Position Verlet step.  The positions are advanced half a step with the old
+ * velocities, the velocities are updated with the dynamics (and contacts) at
+ * the midpoint, then the positions are advanced the other half step with the
+ * new velocities.  The dynamics at the midpoint are evaluated with the
+ * velocities predicted from the acceleration of the last step, which keeps
+ * the step second order with velocity dependent (Coriolis) forces while
+ * still using one ABA per step.
+ */
+template <typename T>
+void DynamicsSimulator<T>::stepSymplectic(T dt, const DVec<T> &tau, T kp,
+                                          T kd) {
+  _lastBodyVelocity = _state.bodyVelocity;
+  drift(dt / 2);
+  _stageState = _state;
+  if (_midpointPredictionValid) {
+    _stageState.qd += _midpointDState.qdd * (dt / 2);
+    _stageState.bodyVelocity += _midpointDState.dBodyVelocity * (dt / 2);
+  }
+  _model.setState(_stageState);
+  updateCollisions(dt, kp, kd);
+  runABA(tau);
+  _midpointDState = _dstate;
+  _midpointPredictionValid = true;
+
+  _state.qd += _dstate.qdd * dt;
+  _state.bodyVelocity += _dstate.dBodyVelocity * dt;
+  if (!_useSpringDamper) {
+    _contact_constr->UpdateQdot(_state);
+    _dstate.dBodyVelocity = (_state.bodyVelocity - _lastBodyVelocity) / dt;
+  }
+  drift(dt / 2);
+  _lastBodyVelocity = _state.bodyVelocity;
+  _stepCounter++;
+}
+
+/*!
+ * Fourth order Runge-Kutta step without contact forces, for when nothing is
+ * in contact.  _dstate is left as the derivative at the start of the step.
+ */
+template <typename T>
+void DynamicsSimulator<T>::stepRK4(T dt, const DVec<T> &tau) {
+  _externalForcesNoContact = _model._externalForces;
+  packState(_state, _x0);
+
+  stateDerivative(_x0, tau, _k);  // k1
+  _savedDState = _dstate;
+  _kSum = _k;
+  _xStage = _x0 + (dt / 2) * _k;
+  stateDerivative(_xStage, tau, _k);  // k2
+  _kSum += 2 * _k;
+  _xStage = _x0 + (dt / 2) * _k;
+  stateDerivative(_xStage, tau, _k);  // k3
+  _kSum += 2 * _k;
+  _xStage = _x0 + dt * _k;
+  stateDerivative(_xStage, tau, _k);  // k4
+  _kSum += _k;
+
+  _xStage = _x0 + (dt / 6) * _kSum;
+  unpackState(_xStage, _state);
+  _state.bodyOrientation.normalize();
+  _dstate = _savedDState;
+  _lastBodyVelocity = _state.bodyVelocity;
+  _stepCounter++;
+}
+
+/*!
+ * Adaptive step.  A single RK4 step is tried if nothing is in contact at the
+ * start; it is kept if nothing is in contact at the end either.  Otherwise the
+ * step is split into semi-implicit Euler substeps no longer than the contact
+ * dt, so long flight phases run with the full step and only touchdowns,
+ * liftoffs and stance pay for short steps.
+ */
+template <typename T>
+void DynamicsSimulator<T>::stepAdaptive(T dt, const DVec<T> &tau, T kp,
+                                        T kd) {
+  _externalForcesNoContact = _model._externalForces;
+  if (_contact_constr->CheckContact() == 0) {
+    _savedState = _state;
+    _savedDState = _dstate;
+    _savedLastBodyVelocity = _lastBodyVelocity;
+
+    stepRK4(dt, tau);
+    _model.setState(_state);
+    _model.forwardKinematics();
+    if (_contact_constr->CheckContact() == 0) return;
+
+    // touched down during the step, redo it with substeps
+    _state = _savedState;
+    _dstate = _savedDState;
+    _lastBodyVelocity = _savedLastBodyVelocity;
+  }
+
+  size_t nSubsteps = (size_t)std::ceil(dt / _contactDt - 1e-6);
+  if (nSubsteps < 1) nSubsteps = 1;
+  T h = dt / nSubsteps;
+  for (size_t i = 0; i < nSubsteps; i++) {
+    _model.setState(_state);
+    _model._externalForces = _externalForcesNoContact;
+    stepEuler(h, tau, kp, kd);
+  }
+}
+
+/*!
+ * Advance the positions with the current velocities
+ * @param dt : time to advance
+ */
+template <typename T>
+void DynamicsSimulator<T>::drift(T dt) {
+  RotMat<T> R_body = quaternionToRotationMatrix(_state.bodyOrientation);
+  Vec3<T> omegaBody = _state.bodyVelocity.template block<3, 1>(0, 0);
+  _state.q += _state.qd * dt;
+  _state.bodyPosition +=
+      R_body.transpose() * _state.bodyVelocity.template block<3, 1>(3, 0) * dt;
+  _state.bodyOrientation =
+      integrateQuatImplicit(_state.bodyOrientation, omegaBody, dt);
+}
+
+/*!
+ * Flatten a state into [quaternion, position, body velocity, q, qd]
+ */
+template <typename T>
+void DynamicsSimulator<T>::packState(const FBModelState<T> &state,
+                                     DVec<T> &x) {
+  size_t nq = state.q.rows();
+  x.resize(13 + 2 * nq);
+  x.template segment<4>(0) = state.bodyOrientation;
+  x.template segment<3>(4) = state.bodyPosition;
+  x.template segment<6>(7) = state.bodyVelocity;
+  x.segment(13, nq) = state.q;
+  x.segment(13 + nq, nq) = state.qd;
+}
+
+/*!
+ * Inverse of packState
+ */
+template <typename T>
+void DynamicsSimulator<T>::unpackState(const DVec<T> &x,
+                                       FBModelState<T> &state) {
+  size_t nq = (x.rows() - 13) / 2;
+  state.bodyOrientation = x.template segment<4>(0);
+  state.bodyPosition = x.template segment<3>(4);
+  state.bodyVelocity = x.template segment<6>(7);
+  state.q = x.segment(13, nq);
+  state.qd = x.segment(13 + nq, nq);
+}
+
+/*!
+ * Time derivative of a packed state, with no contact forces
+ * @param x : packed state
+ * @param tau : joint torques
+ * @param dx : derivative of x.  The ABA result is also left in _dstate.
+ */
+template <typename T>
+void DynamicsSimulator<T>::stateDerivative(const DVec<T> &x,
+                                           const DVec<T> &tau, DVec<T> &dx) {
+  unpackState(x, _stageState);
+  _model.setState(_stageState);
+  _model._externalForces = _externalForcesNoContact;
+  runABA(tau);
+
+  size_t nq = _stageState.q.rows();
+  dx.resize(x.rows());
+  dx.template segment<4>(0) =
+      quatDerivative(_stageState.bodyOrientation,
+                     _stageState.bodyVelocity.template head<3>());
+  dx.template segment<3>(4) = _dstate.dBodyPosition;
+  dx.template segment<6>(7) = _dstate.dBodyVelocity;
+  dx.segment(13, nq) = _stageState.qd;
+  dx.segment(13 + nq, nq) = _dstate.qdd;
 }
 
 /*!
@@ -81,8 +372,10 @@ void DynamicsSimulator<T>::step(T dt, const DVec<T> &tau, T kp, T kd ) {
  */
 template <typename T>
 void DynamicsSimulator<T>::updateCollisions(T dt, T kp, T kd) {
+  Timer timer;
   _model.forwardKinematics();
   _contact_constr->UpdateExternalForces(kp, kd, dt);
+  _collisionNs += timer.getNs();
 }
 
 /*!
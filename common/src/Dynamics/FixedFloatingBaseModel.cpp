@@ -0,0 +1,398 @@
+/*! @file FixedFloatingBaseModel.cpp
+ *  @brief Fixed-size version of the rigid body floating base model
+ *
+ * The algorithms here are the same as the ones in FloatingBaseModel.cpp, but
+ * operate on compile-time sized storage.  See FloatingBaseModel.cpp for the
+ * derivations and references.
+ */
+
+#include <stdexcept>
+#include <string>
+
+#include "Dynamics/FixedFloatingBaseModel.h"
+#include "Dynamics/Quadruped.h"
+
+using namespace ori;
+using namespace spatial;
+
+/*!
+ * Copy the kinematic tree and inertias out of a finished floating base model.
+ * @param model : model to copy.  Must have exactly NDOF degrees of freedom
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::setModel(
+    const FloatingBaseModel<T>& model) {
+  if (model._nDof != (size_t)NDOF) {
+    throw std::runtime_error(
+        "FixedFloatingBaseModel expected " + std::to_string(NDOF) +
+        " dofs, but the model has " + std::to_string(model._nDof) + "\n");
+  }
+
+  _gravity = model._gravity;
+  for (int i = 0; i < NDOF; i++) {
+    _parents[i] = model._parents[i];
+    _gearRatios[i] = model._gearRatios[i];
+    _jointTypes[i] = model._jointTypes[i];
+    _jointAxes[i] = model._jointAxes[i];
+    _Xtree[i] = model._Xtree[i];
+    _Xrot[i] = model._Xrot[i];
+    _Ibody[i] = model._Ibody[i].getMatrix();
+    _Irot[i] = model._Irot[i].getMatrix();
+
+    _Xup[i].setIdentity();
+    _Xuprot[i].setIdentity();
+    _Xa[i].setIdentity();
+    _IA[i].setIdentity();
+    _IC[i].setZero();
+    _S[i].setZero();
+    _Srot[i].setZero();
+    _v[i].setZero();
+    _vrot[i].setZero();
+    _a[i].setZero();
+    _arot[i].setZero();
+    _avp[i].setZero();
+    _avprot[i].setZero();
+    _c[i].setZero();
+    _crot[i].setZero();
+    _d[i] = 0;
+    _u[i] = 0;
+  }
+
+  // the motion subspaces never change, so compute them once
+  for (int i = 6; i < NDOF; i++) {
+    _S[i] = jointMotionSubspace<T>(_jointTypes[i], _jointAxes[i]);
+    _Srot[i] = _S[i] * _gearRatios[i];
+  }
+
+  _bodyOrientation << 1, 0, 0, 0;
+  _bodyPosition.setZero();
+  _bodyVelocity.setZero();
+  _q.setZero();
+  _qd.setZero();
+  _qdd.setZero();
+  _dBodyVelocity.setZero();
+  _H.setZero();
+  _Cqd.setZero();
+  _G.setZero();
+  _genForce.setZero();
+  resetExternalForces();
+  resetCalculationFlags();
+}
+
+/*!
+ * Update the state, invalidating previous results
+ * @param state : the new state
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::setState(const FBModelState<T>& state) {
+  assert(state.q.rows() == nJoints && state.qd.rows() == nJoints);
+  _bodyOrientation = state.bodyOrientation;
+  _bodyPosition = state.bodyPosition;
+  _bodyVelocity = state.bodyVelocity;
+  _q = state.q;
+  _qd = state.qd;
+  resetCalculationFlags();
+}
+
+/*!
+ * Set the external spatial forces (in absolute coordinates) on each body
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::setExternalForces(
+    const vectorAligned<SVec<T>>& forces) {
+  assert(forces.size() == (size_t)NDOF);
+  for (int i = 0; i < NDOF; i++) {
+    _externalForces[i] = forces[i];
+  }
+  _articulatedBodiesUpToDate = false;
+}
+
+/*!
+ * Forward kinematics of all bodies.  Computes _Xup, _Xuprot, _Xa, _v, _vrot,
+ * _c and _crot
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::forwardKinematics() {
+  if (_kinematicsUpToDate) return;
+
+  _Xup[5] = createSXform(quaternionToRotationMatrix(_bodyOrientation),
+                         _bodyPosition);
+  _v[5] = _bodyVelocity;
+  _Xa[5] = _Xup[5];
+
+  for (int i = 6; i < NDOF; i++) {
+    const int p = _parents[i];
+    _Xup[i] = jointXform(_jointTypes[i], _jointAxes[i], _q[i - 6]) * _Xtree[i];
+    SVec<T> vJ = _S[i] * _qd[i - 6];
+    _v[i] = _Xup[i] * _v[p] + vJ;
+
+    _Xuprot[i] = jointXform(_jointTypes[i], _jointAxes[i],
+                            _q[i - 6] * _gearRatios[i]) *
+                 _Xrot[i];
+    SVec<T> vJrot = _Srot[i] * _qd[i - 6];
+    _vrot[i] = _Xuprot[i] * _v[p] + vJrot;
+
+    _c[i] = motionCrossProduct(_v[i], vJ);
+    _crot[i] = motionCrossProduct(_vrot[i], vJrot);
+
+    _Xa[i] = _Xup[i] * _Xa[p];
+  }
+  _kinematicsUpToDate = true;
+}
+
+/*!
+ * (Support Function) Computes velocity product accelerations _avp and _avprot
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::biasAccelerations() {
+  if (_biasAccelerationsUpToDate) return;
+  forwardKinematics();
+  _avp[5].setZero();
+  for (int i = 6; i < NDOF; i++) {
+    _avp[i] = _Xup[i] * _avp[_parents[i]] + _c[i];
+    _avprot[i] = _Xuprot[i] * _avp[_parents[i]] + _crot[i];
+  }
+  _biasAccelerationsUpToDate = true;
+}
+
+/*!
+ * (Support Function) Computes the composite rigid body inertia of each subtree
+ * (_IC[i] does not contain rotor i)
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::compositeInertias() {
+  if (_compositeInertiasUpToDate) return;
+  forwardKinematics();
+  for (int i = 5; i < NDOF; i++) {
+    _IC[i] = _Ibody[i];
+  }
+  for (int i = NDOF - 1; i > 5; i--) {
+    _IC[_parents[i]].noalias() += _Xup[i].transpose() * _IC[i] * _Xup[i];
+    _IC[_parents[i]].noalias() +=
+        _Xuprot[i].transpose() * _Irot[i] * _Xuprot[i];
+  }
+  _compositeInertiasUpToDate = true;
+}
+
+/*!
+ * Computes the generalized gravitational force (G) in the inverse dynamics
+ * @return G (NDOF x 1 vector)
+ */
+template <typename T, int NDOF>
+auto FixedFloatingBaseModel<T, NDOF>::generalizedGravityForce()
+    -> const GeneralizedVec& {
+  compositeInertias();
+
+  SVec<T> aGravity;
+  aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
+  _ag[5] = _Xup[5] * aGravity;
+
+  _G.template head<6>() = -_IC[5] * _ag[5];
+  for (int i = 6; i < NDOF; i++) {
+    _ag[i] = _Xup[i] * _ag[_parents[i]];
+    _agrot[i] = _Xuprot[i] * _ag[_parents[i]];
+    _G[i] = -_S[i].dot(_IC[i] * _ag[i]) - _Srot[i].dot(_Irot[i] * _agrot[i]);
+  }
+  return _G;
+}
+
+/*!
+ * Computes the generalized coriolis forces (Cqd) in the inverse dynamics
+ * @return Cqd (NDOF x 1 vector)
+ */
+template <typename T, int NDOF>
+auto FixedFloatingBaseModel<T, NDOF>::generalizedCoriolisForce()
+    -> const GeneralizedVec& {
+  biasAccelerations();
+
+  SVec<T> hfb = _Ibody[5] * _v[5];
+  _fvp[5] = _Ibody[5] * _avp[5] + forceCrossProduct(_v[5], hfb);
+
+  for (int i = 6; i < NDOF; i++) {
+    SVec<T> hi = _Ibody[i] * _v[i];
+    _fvp[i] = _Ibody[i] * _avp[i] + forceCrossProduct(_v[i], hi);
+
+    SVec<T> hr = _Irot[i] * _vrot[i];
+    _fvprot[i] = _Irot[i] * _avprot[i] + forceCrossProduct(_vrot[i], hr);
+  }
+
+  for (int i = NDOF - 1; i > 5; i--) {
+    _Cqd[i] = _S[i].dot(_fvp[i]) + _Srot[i].dot(_fvprot[i]);
+    _fvp[_parents[i]] += _Xup[i].transpose() * _fvp[i];
+    _fvp[_parents[i]] += _Xuprot[i].transpose() * _fvprot[i];
+  }
+
+  _Cqd.template head<6>() = _fvp[5];
+  return _Cqd;
+}
+
+/*!
+ * Computes the Mass Matrix (H) with the composite rigid body algorithm
+ * @return H (NDOF x NDOF matrix)
+ */
+template <typename T, int NDOF>
+auto FixedFloatingBaseModel<T, NDOF>::massMatrix() -> const MassMatrix& {
+  compositeInertias();
+  _H.setZero();
+  _H.template topLeftCorner<6, 6>() = _IC[5];
+
+  for (int j = 6; j < NDOF; j++) {
+    SVec<T> f = _IC[j] * _S[j];
+    SVec<T> frot = _Irot[j] * _Srot[j];
+    _H(j, j) = _S[j].dot(f) + _Srot[j].dot(frot);
+
+    f = _Xup[j].transpose() * f + _Xuprot[j].transpose() * frot;
+    int i = _parents[j];
+    while (i > 5) {
+      _H(i, j) = _S[i].dot(f);
+      _H(j, i) = _H(i, j);
+      f = _Xup[i].transpose() * f;
+      i = _parents[i];
+    }
+
+    _H.template block<6, 1>(0, j) = f;
+    _H.template block<1, 6>(j, 0) = f.transpose();
+  }
+  return _H;
+}
+
+/*!
+ * Computes the spatial accelerations of each body from the state derivative
+ * set by inverseDynamics
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::forwardAccelerationKinematics() {
+  if (_accelerationsUpToDate) return;
+  forwardKinematics();
+  biasAccelerations();
+
+  SVec<T> aGravity = SVec<T>::Zero();
+  aGravity.template tail<3>() = _gravity;
+  _a[5] = -_Xup[5] * aGravity + _dBodyVelocity;
+
+  for (int i = 6; i < NDOF; i++) {
+    _a[i] = _Xup[i] * _a[_parents[i]] + _S[i] * _qdd[i - 6] + _c[i];
+    _arot[i] = _Xuprot[i] * _a[_parents[i]] + _Srot[i] * _qdd[i - 6] + _crot[i];
+  }
+  _accelerationsUpToDate = true;
+}
+
+/*!
+ * Computes the inverse dynamics of the system (RNEA)
+ * @return an NDOF x 1 vector. The first six entries give the external wrench on
+ * the base, with the remaining giving the joint torques
+ */
+template <typename T, int NDOF>
+auto FixedFloatingBaseModel<T, NDOF>::inverseDynamics(
+    const FBModelStateDerivative<T>& dState) -> const GeneralizedVec& {
+  _dBodyVelocity = dState.dBodyVelocity;
+  _qdd = dState.qdd;
+  _accelerationsUpToDate = false;
+  forwardAccelerationKinematics();
+
+  SVec<T> hb = _Ibody[5] * _v[5];
+  _f[5] = _Ibody[5] * _a[5] + forceCrossProduct(_v[5], hb);
+
+  for (int i = 6; i < NDOF; i++) {
+    SVec<T> hi = _Ibody[i] * _v[i];
+    SVec<T> hr = _Irot[i] * _vrot[i];
+    _f[i] = _Ibody[i] * _a[i] + forceCrossProduct(_v[i], hi);
+    _frot[i] = _Irot[i] * _arot[i] + forceCrossProduct(_vrot[i], hr);
+  }
+
+  for (int i = NDOF - 1; i > 5; i--) {
+    _genForce[i] = _S[i].dot(_f[i]) + _Srot[i].dot(_frot[i]);
+    _f[_parents[i]] += _Xup[i].transpose() * _f[i];
+    _f[_parents[i]] += _Xuprot[i].transpose() * _frot[i];
+  }
+  _genForce.template head<6>() = _f[5];
+  return _genForce;
+}
+
+/*!
+ * Support function for the ABA.  Computes articulated body inertias.
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::updateArticulatedBodies() {
+  if (_articulatedBodiesUpToDate) return;
+  forwardKinematics();
+
+  for (int i = 5; i < NDOF; i++) {
+    _IA[i] = _Ibody[i];
+  }
+
+  for (int i = NDOF - 1; i >= 6; i--) {
+    _U[i] = _IA[i] * _S[i];
+    _Urot[i] = _Irot[i] * _Srot[i];
+    _Utot[i] = _Xup[i].transpose() * _U[i] + _Xuprot[i].transpose() * _Urot[i];
+    _d[i] = _Srot[i].dot(_Urot[i]) + _S[i].dot(_U[i]);
+
+    _IA[_parents[i]].noalias() += _Xup[i].transpose() * _IA[i] * _Xup[i];
+    _IA[_parents[i]].noalias() +=
+        _Xuprot[i].transpose() * _Irot[i] * _Xuprot[i];
+    _IA[_parents[i]].noalias() -= _Utot[i] * _Utot[i].transpose() / _d[i];
+  }
+
+  _invIA5.compute(_IA[5]);
+  _articulatedBodiesUpToDate = true;
+}
+
+/*!
+ * Run the articulated body algorithm
+ * @param tau : joint torques (nJoints x 1)
+ * @param dstate : output state derivative.  qdd is resized only if it is not
+ * already the right size.
+ */
+template <typename T, int NDOF>
+void FixedFloatingBaseModel<T, NDOF>::runABA(const DVec<T>& tau,
+                                             FBModelStateDerivative<T>& dstate) {
+  forwardKinematics();
+  updateArticulatedBodies();
+
+  SVec<T> aGravity;
+  aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
+
+  SVec<T> ivProduct = _Ibody[5] * _v[5];
+  _pA[5] = forceCrossProduct(_v[5], ivProduct);
+  for (int i = 6; i < NDOF; i++) {
+    ivProduct = _Ibody[i] * _v[i];
+    _pA[i] = forceCrossProduct(_v[i], ivProduct);
+    ivProduct = _Irot[i] * _vrot[i];
+    _pArot[i] = forceCrossProduct(_vrot[i], ivProduct);
+  }
+
+  // adjust pA for external forces (expressed in absolute coordinates)
+  for (int i = 5; i < NDOF; i++) {
+    Mat3<T> R = rotationFromSXform(_Xa[i]);
+    Vec3<T> p = translationFromSXform(_Xa[i]);
+    Mat6<T> iX = createSXform(R.transpose(), -R * p);
+    _pA[i] -= iX.transpose() * _externalForces[i];
+  }
+
+  for (int i = NDOF - 1; i >= 6; i--) {
+    _u[i] = tau[i - 6] - _S[i].dot(_pA[i]) - _Srot[i].dot(_pArot[i]) -
+            _U[i].dot(_c[i]) - _Urot[i].dot(_crot[i]);
+
+    _pA[_parents[i]] +=
+        _Xup[i].transpose() * (_pA[i] + _IA[i] * _c[i]) +
+        _Xuprot[i].transpose() * (_pArot[i] + _Irot[i] * _crot[i]) +
+        _Utot[i] * _u[i] / _d[i];
+  }
+
+  _a[5] = -(_Xup[5] * aGravity);
+  SVec<T> afb = _invIA5.solve(-_pA[5] - _IA[5].transpose() * _a[5]);
+  _a[5] += afb;
+
+  if (dstate.qdd.rows() != nJoints) dstate.qdd.resize(nJoints);
+  for (int i = 6; i < NDOF; i++) {
+    dstate.qdd[i - 6] = (_u[i] - _Utot[i].dot(_a[_parents[i]])) / _d[i];
+    _a[i] = _Xup[i] * _a[_parents[i]] + _S[i] * dstate.qdd[i - 6] + _c[i];
+  }
+
+  RotMat<T> Rup = rotationFromSXform(_Xup[5]);
+  dstate.dBodyPosition = Rup.transpose() * _bodyVelocity.template tail<3>();
+  dstate.dBodyVelocity = afb;
+}
+
+template class FixedFloatingBaseModel<double, cheetah::dim_config>;
+template class FixedFloatingBaseModel<float, cheetah::dim_config>;
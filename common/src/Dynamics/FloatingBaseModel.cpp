@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <cmath>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -48,7 +49,8 @@ T FloatingBaseModel<T>::applyTestForce(const int gc_index,
   size_t i_opsp = _gcParent.at(gc_index);
   size_t i = i_opsp;
 
-  dstate_out = DVec<T>::Zero(_nDof);
+  dstate_out.resize(_nDof);
+  dstate_out.setZero();
 
   // Rotation to absolute coords
   Mat3<T> Rai = _Xa[i].template block<3, 3>(0, 0).transpose();
@@ -78,7 +80,8 @@ T FloatingBaseModel<T>::applyTestForce(const int gc_index,
 
   dstate_out.head(6) = _invIA5.solve(F);
   LambdaInv += F.dot(dstate_out.head(6));
-  dstate_out.tail(_nDof - 6) += _qdd_from_base_accel * dstate_out.head(6);
+  dstate_out.tail(_nDof - 6).noalias() +=
+      _qdd_from_base_accel * dstate_out.head(6);
 
   return LambdaInv;
 }
@@ -146,27 +149,26 @@ void FloatingBaseModel<T>::updateArticulatedBodies() {
 
   _IA[5] = _Ibody[5].getMatrix();
 
-  // loop 1, down the tree
+  // loop 1, down the tree (rotor transforms come from forwardKinematics)
   for (size_t i = 6; i < _nDof; i++) {
     _IA[i] = _Ibody[i].getMatrix();  // initialize
-    Mat6<T> XJrot = jointXform(_jointTypes[i], _jointAxes[i],
-                               _state.q[i - 6] * _gearRatios[i]);
-    _Xuprot[i] = XJrot * _Xrot[i];
-    _Srot[i] = _S[i] * _gearRatios[i];
   }
 
   // Pat's magic principle of least constraint (Guass too!)
   for (size_t i = _nDof - 1; i >= 6; i--) {
     _U[i] = _IA[i] * _S[i];
     _Urot[i] = _Irot[i].getMatrix() * _Srot[i];
-    _Utot[i] = _Xup[i].transpose() * _U[i] + _Xuprot[i].transpose() * _Urot[i];
+    _Utot[i] = _XupCompact[i].applyTranspose(_U[i]) +
+               _XuprotCompact[i].applyTranspose(_Urot[i]);
 
     _d[i] = _Srot[i].transpose() * _Urot[i];
     _d[i] += _S[i].transpose() * _U[i];
 
-    // articulated inertia recursion
+    // articulated inertia recursion.  The articulated inertia is a general
+    // symmetric matrix, and the vectorized 6x6 product is faster for it than
+    // a blockwise congruence with the compact transform.
     Mat6<T> Ia = _Xup[i].transpose() * _IA[i] * _Xup[i] +
-                 _Xuprot[i].transpose() * _Irot[i].getMatrix() * _Xuprot[i] -
+                 _IrotCompact[i].transform(_XuprotCompact[i]).toMatrix() -
                  _Utot[i] * _Utot[i].transpose() / _d[i];
     _IA[_parents[i]] += Ia;
   }
@@ -191,9 +193,7 @@ void FloatingBaseModel<T>::addDynamicsVars(int count) {
 
   Mat6<T> eye6 = Mat6<T>::Identity();
   SVec<T> zero6 = SVec<T>::Zero();
-  Mat6<T> zero66 = Mat6<T>::Zero();
 
-  SpatialInertia<T> zeroInertia(zero66);
   for (int i = 0; i < count; i++) {
     _v.push_back(zero6);
     _vrot.push_back(zero6);
@@ -211,10 +211,13 @@ void FloatingBaseModel<T>::addDynamicsVars(int count) {
     _fvprot.push_back(zero6);
     _ag.push_back(zero6);
     _agrot.push_back(zero6);
-    _IC.push_back(zeroInertia);
+    _IC.push_back(RigidBodyInertia<T>());
     _Xup.push_back(eye6);
     _Xuprot.push_back(eye6);
     _Xa.push_back(eye6);
+    _XupCompact.push_back(SpatialTransform<T>());
+    _XuprotCompact.push_back(SpatialTransform<T>());
+    _XaCompact.push_back(SpatialTransform<T>());
 
     _ChiUp.push_back(eye6);
     _d.push_back(0.);
@@ -227,6 +230,12 @@ void FloatingBaseModel<T>::addDynamicsVars(int count) {
     _pA.push_back(zero6);
     _pArot.push_back(zero6);
     _externalForces.push_back(zero6);
+
+    _dv.push_back(zero6);
+    _da.push_back(zero6);
+    _df.push_back(zero6);
+    _dfrot.push_back(zero6);
+    _dActive.push_back(false);
   }
 
   _J.push_back(D6Mat<T>::Zero(6, _nDof));
@@ -242,6 +251,8 @@ template <typename T>
 void FloatingBaseModel<T>::resizeSystemMatricies() {
   _H.setZero(_nDof, _nDof);
   _C.setZero(_nDof, _nDof);
+  _L.setZero(_nDof, _nDof);
+  _Hinv.setZero(_nDof, _nDof);
   _Cqd.setZero(_nDof);
   _G.setZero(_nDof);
   for (size_t i = 0; i < _J.size(); i++) {
@@ -284,11 +295,16 @@ void FloatingBaseModel<T>::addBase(const SpatialInertia<T> &inertia) {
     _Ibody.push_back(zeroInertia);
     _Xrot.push_back(eye6);
     _Irot.push_back(zeroInertia);
+    _XtreeCompact.push_back(SpatialTransform<T>());
+    _XrotCompact.push_back(SpatialTransform<T>());
+    _IbodyCompact.push_back(RigidBodyInertia<T>());
+    _IrotCompact.push_back(RigidBodyInertia<T>());
     _bodyNames.push_back("N/A");
   }
 
   _jointTypes[5] = JointType::FloatingBase;
   _Ibody[5] = inertia;
+  _IbodyCompact[5] = RigidBodyInertia<T>(inertia);
   _gearRatios[5] = 1;
   _bodyNames[5] = "Floating Base";
 
@@ -408,6 +424,10 @@ int FloatingBaseModel<T>::addBody(const SpatialInertia<T> &inertia,
   _Xrot.push_back(Xrot);
   _Ibody.push_back(inertia);
   _Irot.push_back(rotorInertia);
+  _XtreeCompact.push_back(SpatialTransform<T>(Xtree));
+  _XrotCompact.push_back(SpatialTransform<T>(Xrot));
+  _IbodyCompact.push_back(RigidBodyInertia<T>(inertia));
+  _IrotCompact.push_back(RigidBodyInertia<T>(rotorInertia));
   _nDof++;
 
   addDynamicsVars(1);
@@ -479,26 +499,31 @@ template <typename T>
 void FloatingBaseModel<T>::forwardKinematics() {
   if (_kinematicsUpToDate) return;
 
-  // calculate joint transformations
-  _Xup[5] = createSXform(quaternionToRotationMatrix(_state.bodyOrientation),
-                         _state.bodyPosition);
+  // calculate joint transformations.  The recursions use the compact
+  // transforms, the 6x6 versions are kept for the other algorithms.
+  _XupCompact[5] = SpatialTransform<T>(
+      quaternionToRotationMatrix(_state.bodyOrientation), _state.bodyPosition);
+  _Xup[5] = _XupCompact[5].toMatrix();
   _v[5] = _state.bodyVelocity;
   for (size_t i = 6; i < _nDof; i++) {
     // joint xform
-    Mat6<T> XJ = jointXform(_jointTypes[i], _jointAxes[i], _state.q[i - 6]);
-    _Xup[i] = XJ * _Xtree[i];
+    _XupCompact[i] =
+        jointTransform(_jointTypes[i], _jointAxes[i], _state.q[i - 6]) *
+        _XtreeCompact[i];
+    _Xup[i] = _XupCompact[i].toMatrix();
     _S[i] = jointMotionSubspace<T>(_jointTypes[i], _jointAxes[i]);
     SVec<T> vJ = _S[i] * _state.qd[i - 6];
     // total velocity of body i
-    _v[i] = _Xup[i] * _v[_parents[i]] + vJ;
+    _v[i] = _XupCompact[i].apply(_v[_parents[i]]) + vJ;
 
     // Same for rotors
-    Mat6<T> XJrot = jointXform(_jointTypes[i], _jointAxes[i],
-                               _state.q[i - 6] * _gearRatios[i]);
+    _XuprotCompact[i] = jointTransform(_jointTypes[i], _jointAxes[i],
+                                       _state.q[i - 6] * _gearRatios[i]) *
+                        _XrotCompact[i];
+    _Xuprot[i] = _XuprotCompact[i].toMatrix();
     _Srot[i] = _S[i] * _gearRatios[i];
     SVec<T> vJrot = _Srot[i] * _state.qd[i - 6];
-    _Xuprot[i] = XJrot * _Xrot[i];
-    _vrot[i] = _Xuprot[i] * _v[_parents[i]] + vJrot;
+    _vrot[i] = _XuprotCompact[i].apply(_v[_parents[i]]) + vJrot;
 
     // Coriolis accelerations
     _c[i] = motionCrossProduct(_v[i], vJ);
@@ -508,10 +533,11 @@ void FloatingBaseModel<T>::forwardKinematics() {
   // calculate from absolute transformations
   for (size_t i = 5; i < _nDof; i++) {
     if (_parents[i] == 0) {
-      _Xa[i] = _Xup[i];  // float base
+      _XaCompact[i] = _XupCompact[i];  // float base
     } else {
-      _Xa[i] = _Xup[i] * _Xa[_parents[i]];
+      _XaCompact[i] = _XupCompact[i] * _XaCompact[_parents[i]];
     }
+    _Xa[i] = _XaCompact[i].toMatrix();
   }
 
   // ground contact points
@@ -520,11 +546,12 @@ void FloatingBaseModel<T>::forwardKinematics() {
   for (size_t j = 0; j < _nGroundContact; j++) {
     if (!_compute_contact_info[j]) continue;
     size_t i = _gcParent.at(j);
-    Mat6<T> Xai = invertSXform(_Xa[i]);  // from link to absolute
-    SVec<T> vSpatial = Xai * _v[i];
+    // from link to absolute
+    SpatialTransform<T> Xai = _XaCompact[i].inverse();
+    SVec<T> vSpatial = Xai.apply(_v[i]);
 
     // foot position in world
-    _pGC.at(j) = sXFormPoint(Xai, _gcLocation.at(j));
+    _pGC.at(j) = Xai.transformPoint(_gcLocation.at(j));
     _vGC.at(j) = spatialToLinearVelocity(vSpatial, _pGC.at(j));
   }
   _kinematicsUpToDate = true;
@@ -570,7 +597,7 @@ void FloatingBaseModel<T>::contactJacobians() {
     _Jcdqd[k] = spatialToLinearAcceleration(ac, vc);
 
     // rows for linear velcoity in the world
-    D3Mat<T> Xout = Xc.template bottomRows<3>();
+    Eigen::Matrix<T, 3, 6> Xout = Xc.template bottomRows<3>();
 
     // from tips to base
     while (i > 5) {
@@ -608,24 +635,35 @@ void FloatingBaseModel<T>::biasAccelerations() {
  */
 template <typename T>
 DVec<T> FloatingBaseModel<T>::generalizedGravityForce() {
+  DVec<T> G;
+  generalizedGravityForce(G);
+  return G;
+}
+
+/*!
+ * Computes the generalized gravitational force (G) in the inverse dynamics
+ * @param G : result (_nDof x 1 vector), only resized if it is the wrong size
+ */
+template <typename T>
+void FloatingBaseModel<T>::generalizedGravityForce(DVec<T> &G) {
   compositeInertias();
 
   SVec<T> aGravity;
   aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
-  _ag[5] = _Xup[5] * aGravity;
+  _ag[5] = _XupCompact[5].apply(aGravity);
 
   // Gravity comp force is the same as force required to accelerate
   // oppostite gravity
-  _G.template topRows<6>() = -_IC[5].getMatrix() * _ag[5];
+  _G.template topRows<6>() = -(_IC[5] * _ag[5]);
   for (size_t i = 6; i < _nDof; i++) {
-    _ag[i] = _Xup[i] * _ag[_parents[i]];
-    _agrot[i] = _Xuprot[i] * _ag[_parents[i]];
+    _ag[i] = _XupCompact[i].apply(_ag[_parents[i]]);
+    _agrot[i] = _XuprotCompact[i].apply(_ag[_parents[i]]);
 
     // body and rotor
-    _G[i] = -_S[i].dot(_IC[i].getMatrix() * _ag[i]) -
-            _Srot[i].dot(_Irot[i].getMatrix() * _agrot[i]);
+    _G[i] = -_S[i].dot(_IC[i] * _ag[i]) -
+            _Srot[i].dot(_IrotCompact[i] * _agrot[i]);
   }
-  return _G;
+  G = _G;
 }
 
 /*!
@@ -634,6 +672,17 @@ DVec<T> FloatingBaseModel<T>::generalizedGravityForce() {
  */
 template <typename T>
 DVec<T> FloatingBaseModel<T>::generalizedCoriolisForce() {
+  DVec<T> Cqd;
+  generalizedCoriolisForce(Cqd);
+  return Cqd;
+}
+
+/*!
+ * Computes the generalized coriolis forces (Cqd) in the inverse dynamics
+ * @param Cqd : result (_nDof x 1 vector), only resized if it is the wrong size
+ */
+template <typename T>
+void FloatingBaseModel<T>::generalizedCoriolisForce(DVec<T> &Cqd) {
   biasAccelerations();
 
   // Floating base force
@@ -664,7 +713,7 @@ DVec<T> FloatingBaseModel<T>::generalizedCoriolisForce() {
 
   // Force on floating base
   _Cqd.template topRows<6>() = _fvp[5];
-  return _Cqd;
+  Cqd = _Cqd;
 }
 
 template <typename T>
@@ -756,16 +805,14 @@ void FloatingBaseModel<T>::compositeInertias() {
   forwardKinematics();
   // initialize
   for (size_t i = 5; i < _nDof; i++) {
-    _IC[i].setMatrix(_Ibody[i].getMatrix());
+    _IC[i] = _IbodyCompact[i];
   }
 
   // backward loop
   for (size_t i = _nDof - 1; i > 5; i--) {
     // Propagate inertia down the tree
-    _IC[_parents[i]].addMatrix(_Xup[i].transpose() * _IC[i].getMatrix() *
-                               _Xup[i]);
-    _IC[_parents[i]].addMatrix(_Xuprot[i].transpose() * _Irot[i].getMatrix() *
-                               _Xuprot[i]);
+    _IC[_parents[i]] += _IC[i].transform(_XupCompact[i]);
+    _IC[_parents[i]] += _IrotCompact[i].transform(_XuprotCompact[i]);
   }
   _compositeInertiasUpToDate = true;
 }
@@ -776,21 +823,34 @@ void FloatingBaseModel<T>::compositeInertias() {
  */
 template <typename T>
 DMat<T> FloatingBaseModel<T>::massMatrix() {
+  DMat<T> H;
+  massMatrix(H);
+  return H;
+}
+
+/*!
+ * Computes the Mass Matrix (H) in the inverse dynamics formulation
+ * @param H : result (_nDof x _nDof matrix), only resized if it is the wrong
+ * size
+ */
+template <typename T>
+void FloatingBaseModel<T>::massMatrix(DMat<T> &H) {
   compositeInertias();
   _H.setZero();
 
   // Top left corner is the locked inertia of the whole system
-  _H.template topLeftCorner<6, 6>() = _IC[5].getMatrix();
+  _H.template topLeftCorner<6, 6>() = _IC[5].toMatrix();
 
   for (size_t j = 6; j < _nDof; j++) {
     // f = spatial force required for a unit qdd_j
-    SVec<T> f = _IC[j].getMatrix() * _S[j];
-    SVec<T> frot = _Irot[j].getMatrix() * _Srot[j];
+    SVec<T> f = _IC[j] * _S[j];
+    SVec<T> frot = _IrotCompact[j] * _Srot[j];
 
     _H(j, j) = _S[j].dot(f) + _Srot[j].dot(frot);
 
     // Propagate down the tree
-    f = _Xup[j].transpose() * f + _Xuprot[j].transpose() * frot;
+    f = _XupCompact[j].applyTranspose(f) +
+        _XuprotCompact[j].applyTranspose(frot);
     size_t i = _parents[j];
     while (i > 5) {
       // in here f is expressed in frame {i}
@@ -798,7 +858,7 @@ DMat<T> FloatingBaseModel<T>::massMatrix() {
       _H(j, i) = _H(i, j);
 
       // Propagate down the tree
-      f = _Xup[i].transpose() * f;
+      f = _XupCompact[i].applyTranspose(f);
       i = _parents[i];
     }
 
@@ -806,7 +866,7 @@ DMat<T> FloatingBaseModel<T>::massMatrix() {
     _H.template block<6, 1>(0, j) = f;
     _H.template block<1, 6>(j, 0) = f.adjoint();
   }
-  return _H;
+  H = _H;
 }
 
 template <typename T>
@@ -823,14 +883,15 @@ void FloatingBaseModel<T>::forwardAccelerationKinematics() {
   aGravity.template tail<3>() = _gravity;
 
   // Spatial force for floating base
-  _a[5] = -_Xup[5] * aGravity + _dState.dBodyVelocity;
+  _a[5] = -_XupCompact[5].apply(aGravity) + _dState.dBodyVelocity;
 
   // loop through joints
   for (size_t i = 6; i < _nDof; i++) {
     // spatial acceleration
-    _a[i] = _Xup[i] * _a[_parents[i]] + _S[i] * _dState.qdd[i - 6] + _c[i];
-    _arot[i] =
-        _Xuprot[i] * _a[_parents[i]] + _Srot[i] * _dState.qdd[i - 6] + _crot[i];
+    _a[i] = _XupCompact[i].apply(_a[_parents[i]]) +
+            _S[i] * _dState.qdd[i - 6] + _c[i];
+    _arot[i] = _XuprotCompact[i].apply(_a[_parents[i]]) +
+               _Srot[i] * _dState.qdd[i - 6] + _crot[i];
   }
   _accelerationsUpToDate = true;
 }
@@ -844,36 +905,48 @@ void FloatingBaseModel<T>::forwardAccelerationKinematics() {
 template <typename T>
 DVec<T> FloatingBaseModel<T>::inverseDynamics(
     const FBModelStateDerivative<T> &dState) {
+  DVec<T> genForce;
+  inverseDynamics(dState, genForce);
+  return genForce;
+}
+
+/*!
+ * Computes the inverse dynamics of the system
+ * @param dState : state derivative
+ * @param genForce : result (_nDof x 1 vector), only resized if it is the wrong
+ * size
+ */
+template <typename T>
+void FloatingBaseModel<T>::inverseDynamics(
+    const FBModelStateDerivative<T> &dState, DVec<T> &genForce) {
   setDState(dState);
   forwardAccelerationKinematics();
 
   // Spatial force for floating base
-  SVec<T> hb = _Ibody[5].getMatrix() * _v[5];
-  _f[5] = _Ibody[5].getMatrix() * _a[5] + forceCrossProduct(_v[5], hb);
+  SVec<T> hb = _IbodyCompact[5] * _v[5];
+  _f[5] = _IbodyCompact[5] * _a[5] + forceCrossProduct(_v[5], hb);
 
   // loop through joints
   for (size_t i = 6; i < _nDof; i++) {
     // spatial momentum
-    SVec<T> hi = _Ibody[i].getMatrix() * _v[i];
-    SVec<T> hr = _Irot[i].getMatrix() * _vrot[i];
+    SVec<T> hi = _IbodyCompact[i] * _v[i];
+    SVec<T> hr = _IrotCompact[i] * _vrot[i];
 
     // spatial force
-    _f[i] = _Ibody[i].getMatrix() * _a[i] + forceCrossProduct(_v[i], hi);
-    _frot[i] =
-        _Irot[i].getMatrix() * _arot[i] + forceCrossProduct(_vrot[i], hr);
+    _f[i] = _IbodyCompact[i] * _a[i] + forceCrossProduct(_v[i], hi);
+    _frot[i] = _IrotCompact[i] * _arot[i] + forceCrossProduct(_vrot[i], hr);
   }
 
-  DVec<T> genForce(_nDof);
+  genForce.resize(_nDof);
   for (size_t i = _nDof - 1; i > 5; i--) {
     // Pull off compoents of force along the joint
     genForce[i] = _S[i].dot(_f[i]) + _Srot[i].dot(_frot[i]);
 
     // Propagate down the tree
-    _f[_parents[i]] += _Xup[i].transpose() * _f[i];
-    _f[_parents[i]] += _Xuprot[i].transpose() * _frot[i];
+    _f[_parents[i]] += _XupCompact[i].applyTranspose(_f[i]);
+    _f[_parents[i]] += _XuprotCompact[i].applyTranspose(_frot[i]);
   }
   genForce.template head<6>() = _f[5];
-  return genForce;
 }
 
 template <typename T>
@@ -888,29 +961,23 @@ void FloatingBaseModel<T>::runABA(const DVec<T> &tau,
   aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
 
   // float-base articulated inertia
-  SVec<T> ivProduct = _Ibody[5].getMatrix() * _v[5];
+  SVec<T> ivProduct = _IbodyCompact[5] * _v[5];
   _pA[5] = forceCrossProduct(_v[5], ivProduct);
 
-  // loop 1, down the tree
+  // loop 1, down the tree (_vrot and _crot come from forwardKinematics)
   for (size_t i = 6; i < _nDof; i++) {
-    ivProduct = _Ibody[i].getMatrix() * _v[i];
+    ivProduct = _IbodyCompact[i] * _v[i];
     _pA[i] = forceCrossProduct(_v[i], ivProduct);
 
     // same for rotors
-    SVec<T> vJrot = _Srot[i] * _state.qd[i - 6];
-    _vrot[i] = _Xuprot[i] * _v[_parents[i]] + vJrot;
-    _crot[i] = motionCrossProduct(_vrot[i], vJrot);
-    ivProduct = _Irot[i].getMatrix() * _vrot[i];
+    ivProduct = _IrotCompact[i] * _vrot[i];
     _pArot[i] = forceCrossProduct(_vrot[i], ivProduct);
   }
 
   // adjust pA for external forces
   for (size_t i = 5; i < _nDof; i++) {
     // TODO add if statement (avoid these calculations if the force is zero)
-    Mat3<T> R = rotationFromSXform(_Xa[i]);
-    Vec3<T> p = translationFromSXform(_Xa[i]);
-    Mat6<T> iX = createSXform(R.transpose(), -R * p);
-    _pA[i] = _pA[i] - iX.transpose() * _externalForces.at(i);
+    _pA[i] -= _XaCompact[i].inverse().applyTranspose(_externalForces.at(i));
   }
 
   // Pat's magic principle of least constraint
@@ -921,8 +988,9 @@ void FloatingBaseModel<T>::runABA(const DVec<T> &tau,
 
     // articulated inertia recursion
     SVec<T> pa =
-        _Xup[i].transpose() * (_pA[i] + _IA[i] * _c[i]) +
-        _Xuprot[i].transpose() * (_pArot[i] + _Irot[i].getMatrix() * _crot[i]) +
+        _XupCompact[i].applyTranspose(_pA[i] + _IA[i] * _c[i]) +
+        _XuprotCompact[i].applyTranspose(_pArot[i] +
+                                         _IrotCompact[i] * _crot[i]) +
         _Utot[i] * _u[i] / _d[i];
     _pA[_parents[i]] += pa;
   }
@@ -930,26 +998,217 @@ void FloatingBaseModel<T>::runABA(const DVec<T> &tau,
   // include gravity and compute acceleration of floating base
   SVec<T> a0 = -aGravity;
   SVec<T> ub = -_pA[5];
-  _a[5] = _Xup[5] * a0;
+  _a[5] = _XupCompact[5].apply(a0);
   SVec<T> afb = _invIA5.solve(ub - _IA[5].transpose() * _a[5]);
   _a[5] += afb;
 
   // joint accelerations
-  dstate.qdd = DVec<T>(_nDof - 6);
+  dstate.qdd.resize(_nDof - 6);
   for (size_t i = 6; i < _nDof; i++) {
     dstate.qdd[i - 6] =
         (_u[i] - _Utot[i].transpose() * _a[_parents[i]]) / _d[i];
-    _a[i] = _Xup[i] * _a[_parents[i]] + _S[i] * dstate.qdd[i - 6] + _c[i];
+    _a[i] = _XupCompact[i].apply(_a[_parents[i]]) +
+            _S[i] * dstate.qdd[i - 6] + _c[i];
   }
 
   // output
-  RotMat<T> Rup = rotationFromSXform(_Xup[5]);
+  const RotMat<T> &Rup = _XupCompact[5].R;
   dstate.dBodyPosition =
       Rup.transpose() * _state.bodyVelocity.template block<3, 1>(3, 0);
   dstate.dBodyVelocity = afb;
   // qdd is set in the for loop above
 }
 
+/*!
+ * Computes the partial derivatives of the inverse dynamics (RNEA) with respect
+ * to the generalized positions and velocities.
+ *
+ * The derivatives are taken in the tangent space of the configuration.  Joint
+ * columns are with respect to q and qd.  The first six columns are with
+ * respect to a perturbation of the floating base expressed in body coordinates:
+ * for positions, a small rotation (first 3) and translation (last 3) of the
+ * body frame, and for velocities, the entries of bodyVelocity.  External
+ * forces are not included, like inverseDynamics.
+ *
+ * Each column is found with one forward pass over the subtree of the
+ * perturbed joint and one backward pass to the base, reusing the kinematics and
+ * forces from inverseDynamics.  See "Analytical Derivatives of Rigid Body
+ * Dynamics Algorithms" by Carpentier and Mansard for the underlying identities.
+ *
+ * @param dState : the state derivative (qdd) to linearize about
+ * @param dtau_dq : output, _nDof x _nDof.  Resized only if needed.
+ * @param dtau_dqd : output, _nDof x _nDof.  Resized only if needed.
+ */
+template <typename T>
+void FloatingBaseModel<T>::inverseDynamicsDerivatives(
+    const FBModelStateDerivative<T> &dState, DMat<T> &dtau_dq,
+    DMat<T> &dtau_dqd) {
+  // computes _v, _a, _c and the subtree forces _f
+  inverseDynamics(dState, _genForce);
+
+  if (dtau_dq.rows() != (Eigen::Index)_nDof ||
+      dtau_dq.cols() != (Eigen::Index)_nDof) {
+    dtau_dq.resize(_nDof, _nDof);
+  }
+  if (dtau_dqd.rows() != (Eigen::Index)_nDof ||
+      dtau_dqd.cols() != (Eigen::Index)_nDof) {
+    dtau_dqd.resize(_nDof, _nDof);
+  }
+
+  for (size_t j = 0; j < _nDof; j++) {
+    inverseDynamicsDirection(j, false, dtau_dq);
+    inverseDynamicsDirection(j, true, dtau_dqd);
+  }
+}
+
+/*!
+ * (Support Function) Computes one column of the RNEA derivatives.  Only the
+ * bodies in the subtree of the perturbed joint are visited in the forward
+ * pass, and only their ancestors in the backward pass.
+ * @param j : coordinate to differentiate with respect to (0-5 is the base)
+ * @param velocity : differentiate with respect to velocity instead of position
+ * @param dtau : output matrix, column j is written
+ */
+template <typename T>
+void FloatingBaseModel<T>::inverseDynamicsDirection(size_t j, bool velocity,
+                                                    DMat<T> &dtau) {
+  const size_t root = j < 6 ? 5 : j;
+
+  for (size_t i = 5; i < _nDof; i++) {
+    _dActive[i] = (i == root) || (i > root && _dActive[_parents[i]]);
+    _df[i].setZero();
+  }
+
+  // perturbation of the root body
+  if (root == 5) {
+    SVec<T> ej = SVec<T>::Zero();
+    ej[j] = 1;
+    if (velocity) {
+      // a5 does not depend on the base velocity
+      _dv[5] = ej;
+      _da[5].setZero();
+    } else {
+      // derivative of -Xup[5] * aGravity as the body frame rotates/translates
+      _dv[5].setZero();
+      _da[5] = motionCrossProduct(SVec<T>(_a[5] - _dState.dBodyVelocity), ej);
+    }
+  } else {
+    SVec<T> vJ = _S[j] * _state.qd[j - 6];
+    SVec<T> vJrot = _Srot[j] * _state.qd[j - 6];
+    SVec<T> dvrot, dcrot, darot;
+    if (velocity) {
+      _dv[j] = _S[j];
+      _da[j] = motionCrossProduct(_v[j], _S[j]);
+      dvrot = _Srot[j];
+      darot = motionCrossProduct(_vrot[j], _Srot[j]);
+    } else {
+      // d(Xup)/dq = -S x Xup
+      _dv[j] = motionCrossProduct(_v[j], _S[j]);
+      SVec<T> dc = motionCrossProduct(_dv[j], vJ);
+      _da[j] = motionCrossProduct(SVec<T>(_a[j] - _c[j]), _S[j]) + dc;
+      dvrot = motionCrossProduct(_vrot[j], _Srot[j]);
+      dcrot = motionCrossProduct(dvrot, vJrot);
+      darot = motionCrossProduct(SVec<T>(_arot[j] - _crot[j]), _Srot[j]) + dcrot;
+    }
+
+    Mat6<T> Ir = _Irot[j].getMatrix();
+    _dfrot[j] = Ir * darot +
+                forceCrossProduct(dvrot, SVec<T>(Ir * _vrot[j])) +
+                forceCrossProduct(_vrot[j], SVec<T>(Ir * dvrot));
+  }
+
+  Mat6<T> Ii = _Ibody[root].getMatrix();
+  _df[root] = Ii * _da[root] +
+              forceCrossProduct(_dv[root], SVec<T>(Ii * _v[root])) +
+              forceCrossProduct(_v[root], SVec<T>(Ii * _dv[root]));
+
+  // forward pass over the rest of the subtree
+  for (size_t i = root + 1; i < _nDof; i++) {
+    if (!_dActive[i]) continue;
+    const size_t p = _parents[i];
+
+    _dv[i] = _Xup[i] * _dv[p];
+    SVec<T> dc = motionCrossProduct(_dv[i], SVec<T>(_S[i] * _state.qd[i - 6]));
+    _da[i] = _Xup[i] * _da[p] + dc;
+
+    SVec<T> dvrot = _Xuprot[i] * _dv[p];
+    SVec<T> dcrot =
+        motionCrossProduct(dvrot, SVec<T>(_Srot[i] * _state.qd[i - 6]));
+    SVec<T> darot = _Xuprot[i] * _da[p] + dcrot;
+
+    Ii = _Ibody[i].getMatrix();
+    _df[i] = Ii * _da[i] + forceCrossProduct(_dv[i], SVec<T>(Ii * _v[i])) +
+             forceCrossProduct(_v[i], SVec<T>(Ii * _dv[i]));
+    Mat6<T> Ir = _Irot[i].getMatrix();
+    _dfrot[i] = Ir * darot + forceCrossProduct(dvrot, SVec<T>(Ir * _vrot[i])) +
+                forceCrossProduct(_vrot[i], SVec<T>(Ir * dvrot));
+  }
+
+  // backward pass: subtree forces and joint torques
+  dtau.col(j).setZero();
+  for (size_t i = _nDof - 1; i > 5; i--) {
+    if (!_dActive[i]) continue;
+    const size_t p = _parents[i];
+    dtau(i, j) = _S[i].dot(_df[i]) + _Srot[i].dot(_dfrot[i]);
+    _df[p] += _Xup[i].transpose() * _df[i] +
+              _Xuprot[i].transpose() * _dfrot[i];
+    if (i == root && !velocity) {
+      // d(Xup^T)/dq * f = Xup^T (S x* f)
+      _df[p] += _Xup[i].transpose() * forceCrossProduct(_S[i], _f[i]) +
+                _Xuprot[i].transpose() * forceCrossProduct(_Srot[i], _frot[i]);
+    }
+  }
+
+  // ancestors of the perturbed joint only see the propagated force
+  if (root > 5) {
+    for (size_t i = _parents[root]; i > 5; i = _parents[i]) {
+      dtau(i, j) = _S[i].dot(_df[i]);
+      _df[_parents[i]] += _Xup[i].transpose() * _df[i];
+    }
+  }
+  dtau.col(j).template head<6>() = _df[5];
+}
+
+/*!
+ * Computes the forward dynamics and its partial derivatives with respect to the
+ * generalized positions, velocities and joint torques.  The RNEA derivatives
+ * are mapped through the inverse of the mass matrix:
+ *   dqdd/dq = -H^-1 dtau/dq,  dqdd/dqd = -H^-1 dtau/dqd,  dqdd/dtau = H^-1
+ * See inverseDynamicsDerivatives for the coordinates used for the floating
+ * base.  External forces are not included.
+ * @param tau : joint torques
+ * @param dstate : output state derivative (same as runABA without external
+ * forces)
+ * @param dqdd_dq : output, _nDof x _nDof.  Resized only if needed.
+ * @param dqdd_dqd : output, _nDof x _nDof.  Resized only if needed.
+ * @param dqdd_dtau : output, _nDof x (_nDof - 6).  Resized only if needed.
+ */
+template <typename T>
+void FloatingBaseModel<T>::forwardDynamicsDerivatives(
+    const DVec<T> &tau, FBModelStateDerivative<T> &dstate, DMat<T> &dqdd_dq,
+    DMat<T> &dqdd_dqd, DMat<T> &dqdd_dtau) {
+  generalizedGravityForce(_G);
+  generalizedCoriolisForce(_Cqd);
+
+  DVec<T> &qdd = _genForce;
+  qdd = -_Cqd - _G;
+  qdd.tail(_nDof - 6) += tau;
+  solveMassMatrix(qdd, qdd);
+
+  RotMat<T> Rup = rotationFromSXform(_Xup[5]);
+  dstate.dBodyPosition =
+      Rup.transpose() * _state.bodyVelocity.template block<3, 1>(3, 0);
+  dstate.dBodyVelocity = qdd.template head<6>();
+  dstate.qdd = qdd.tail(_nDof - 6);
+
+  inverseDynamicsDerivatives(dstate, dqdd_dq, dqdd_dqd);
+  solveMassMatrix(dqdd_dq, dqdd_dq);
+  solveMassMatrix(dqdd_dqd, dqdd_dqd);
+  dqdd_dq *= -1;
+  dqdd_dqd *= -1;
+  dqdd_dtau = massMatrixInverse().rightCols(_nDof - 6);
+}
+
 /*!
  * Apply a unit test force at a contact. Returns the inv contact inertia  in
  * that direction and computes the resultant qdd
@@ -1001,7 +1260,7 @@ T FloatingBaseModel<T>::applyTestForce(const int gc_index,
   // TODO: Only carry out the QR once within update Aritculated Bodies
   dstate_out.dBodyVelocity = _invIA5.solve(F);
   LambdaInv += F.dot(dstate_out.dBodyVelocity);
-  dstate_out.qdd += _qdd_from_base_accel * dstate_out.dBodyVelocity;
+  dstate_out.qdd.noalias() += _qdd_from_base_accel * dstate_out.dBodyVelocity;
 
   return LambdaInv;
 }
@@ -1064,6 +1323,20 @@ T FloatingBaseModel<T>::invContactInertia(const int gc_index,
 template <typename T>
 DMat<T> FloatingBaseModel<T>::invContactInertia(
     const int gc_index, const D6Mat<T> &force_directions) {
+  DMat<T> LambdaInv;
+  invContactInertia(gc_index, force_directions, LambdaInv);
+  return LambdaInv;
+}
+
+/*!
+ * Compute the inverse of the contact inertia matrix (mxm)
+ * @param force_directions (6xm) each column denotes a direction of interest
+ * @param LambdaInv : result (mxm), only resized if it is the wrong size
+ */
+template <typename T>
+void FloatingBaseModel<T>::invContactInertia(const int gc_index,
+                                             const D6Mat<T> &force_directions,
+                                             DMat<T> &LambdaInv) {
   forwardKinematics();
   updateArticulatedBodies();
   updateForcePropagators();
@@ -1077,32 +1350,224 @@ DMat<T> FloatingBaseModel<T>::invContactInertia(
 
   // D is a subslice of an extended force propagator matrix (See Wensing, 2012
   // ICRA)
-  D6Mat<T> D = Xc.transpose() * force_directions;
+  D6Mat<T> &D = _contactDirections;
+  D.noalias() = Xc.transpose() * force_directions;
 
   size_t m = force_directions.cols();
 
-  DMat<T> LambdaInv = DMat<T>::Zero(m, m);
-  DVec<T> tmp = DVec<T>::Zero(m);
+  LambdaInv.setZero(m, m);
 
   // from tips to base
   while (i > 5) {
-    tmp = D.transpose() * _S[i];
-    LambdaInv += tmp * tmp.transpose() / _d[i];
+    for (size_t b = 0; b < m; b++) {
+      T sb = D.col(b).dot(_S[i]) / _d[i];
+      for (size_t a = 0; a < m; a++) {
+        LambdaInv(a, b) += D.col(a).dot(_S[i]) * sb;
+      }
+    }
 
     // Apply force propagator (see Pat's ICRA 2012 paper)
     // essentially, since the joint is articulated, only a portion of the force
     // is felt on the predecessor. So, while Xup^T sends a force backwards as if
     // the joint was locked, ChiUp^T sends the force backward as if the joint
     // were free
-    D = _ChiUp[i].transpose() * D;
+    _contactDirectionsTmp.noalias() = _ChiUp[i].transpose() * D;
+    D.swap(_contactDirectionsTmp);
     i = _parents[i];
   }
 
-  // TODO: Only carry out the QR once within update Aritculated Bodies
-  LambdaInv += D.transpose() * _invIA5.solve(D);
+  for (size_t b = 0; b < m; b++) {
+    SVec<T> a5 = _invIA5.solve(SVec<T>(D.col(b)));
+    for (size_t a = 0; a < m; a++) {
+      LambdaInv(a, b) += D.col(a).dot(a5);
+    }
+  }
+}
+
+/*!
+ * Computes the sparse factorization H = L^T * L of the mass matrix, where L is
+ * lower triangular (Featherstone, "Rigid Body Dynamics Algorithms", Chapter
+ * 6.5).  Because H(i,j) is only nonzero when dof i is an ancestor of dof j (or
+ * the reverse), L has the same sparsity and the factorization only visits
+ * pairs of dofs on the same branch.  For the quadruped, each leg only couples
+ * to its own joints and the base.
+ */
+template <typename T>
+void FloatingBaseModel<T>::factorMassMatrix() {
+  if (_massMatrixFactorUpToDate) return;
+  massMatrix(_L);
+
+  for (int k = _nDof - 1; k >= 0; k--) {
+    _L(k, k) = std::sqrt(_L(k, k));
+    for (int i = dofParent(k); i >= 0; i = dofParent(i)) {
+      _L(k, i) /= _L(k, k);
+    }
+    for (int i = dofParent(k); i >= 0; i = dofParent(i)) {
+      for (int j = i; j >= 0; j = dofParent(j)) {
+        _L(i, j) -= _L(k, i) * _L(k, j);
+      }
+    }
+  }
+  _L.template triangularView<Eigen::StrictlyUpper>().setZero();
+  _massMatrixFactorUpToDate = true;
+}
+
+/*!
+ * (Support Function) x = L^-T * x, using the branch sparsity of L
+ */
+template <typename T>
+template <typename Derived>
+void FloatingBaseModel<T>::solveLT(Eigen::MatrixBase<Derived> &x) {
+  for (int i = _nDof - 1; i >= 0; i--) {
+    x.row(i) /= _L(i, i);
+    for (int j = dofParent(i); j >= 0; j = dofParent(j)) {
+      x.row(j) -= _L(i, j) * x.row(i);
+    }
+  }
+}
+
+/*!
+ * (Support Function) x = L^-1 * x, using the branch sparsity of L
+ */
+template <typename T>
+template <typename Derived>
+void FloatingBaseModel<T>::solveL(Eigen::MatrixBase<Derived> &x) {
+  for (size_t i = 0; i < _nDof; i++) {
+    for (int j = dofParent(i); j >= 0; j = dofParent(j)) {
+      x.row(i) -= _L(i, j) * x.row(j);
+    }
+    x.row(i) /= _L(i, i);
+  }
+}
 
+/*!
+ * Solve H * x = rhs using the sparse factorization of the mass matrix
+ * @param rhs : _nDof x 1 vector
+ * @return x = H^-1 * rhs
+ */
+template <typename T>
+DVec<T> FloatingBaseModel<T>::solveMassMatrix(const DVec<T> &rhs) {
+  DVec<T> x;
+  solveMassMatrix(rhs, x);
+  return x;
+}
+
+/*!
+ * Solve H * x = rhs using the sparse factorization of the mass matrix
+ * @param rhs : _nDof x 1 vector
+ * @param x : result, only resized if it is the wrong size.  May be rhs.
+ */
+template <typename T>
+void FloatingBaseModel<T>::solveMassMatrix(const DVec<T> &rhs, DVec<T> &x) {
+  factorMassMatrix();
+  x = rhs;
+  solveLT(x);
+  solveL(x);
+}
+
+/*!
+ * Solve H * X = rhs for several right hand sides using the sparse
+ * factorization of the mass matrix
+ * @param rhs : _nDof x m matrix
+ * @return X = H^-1 * rhs
+ */
+template <typename T>
+DMat<T> FloatingBaseModel<T>::solveMassMatrix(const DMat<T> &rhs) {
+  DMat<T> x;
+  solveMassMatrix(rhs, x);
+  return x;
+}
+
+/*!
+ * Solve H * X = rhs for several right hand sides using the sparse
+ * factorization of the mass matrix
+ * @param rhs : _nDof x m matrix
+ * @param x : result, only resized if it is the wrong size.  May be rhs.
+ */
+template <typename T>
+void FloatingBaseModel<T>::solveMassMatrix(const DMat<T> &rhs, DMat<T> &x) {
+  factorMassMatrix();
+  x = rhs;
+  solveLT(x);
+  solveL(x);
+}
+
+/*!
+ * Computes the inverse of the mass matrix from its sparse factorization.
+ * H^-1 = L^-1 * L^-T, where L^-1 has the same sparsity as L.
+ * @return H^-1 (_nDof x _nDof)
+ */
+template <typename T>
+const DMat<T> &FloatingBaseModel<T>::massMatrixInverse() {
+  if (_massMatrixInverseUpToDate) return _Hinv;
+  factorMassMatrix();
+
+  // _Hinv temporarily holds L^-1.  Row i only has entries for ancestors of i.
+  _Hinv.setZero();
+  for (size_t i = 0; i < _nDof; i++) {
+    _Hinv(i, i) = 1 / _L(i, i);
+    for (int j = dofParent(i); j >= 0; j = dofParent(j)) {
+      T sum = 0;
+      for (int k = dofParent(i); k >= j; k = dofParent(k)) {
+        sum += _L(i, k) * _Hinv(k, j);
+      }
+      _Hinv(i, j) = -sum / _L(i, i);
+    }
+  }
+
+  // H^-1(i, j) = sum over common ancestors k of L^-1(i, k) * L^-1(j, k).
+  // Fill the lower triangle (from the bottom up, so L^-1 is still intact in
+  // the rows that are read) and mirror it.
+  for (int i = _nDof - 1; i >= 0; i--) {
+    for (int j = i; j >= 0; j--) {
+      // walk the ancestors of i and j together down to their common ancestors
+      int a = i, b = j;
+      while (a != b) {
+        if (a > b)
+          a = dofParent(a);
+        else
+          b = dofParent(b);
+      }
+      T sum = 0;
+      for (int k = a; k >= 0; k = dofParent(k)) {
+        sum += _Hinv(i, k) * _Hinv(j, k);
+      }
+      _Hinv(i, j) = sum;
+      _Hinv(j, i) = sum;
+    }
+  }
+  _massMatrixInverseUpToDate = true;
+  return _Hinv;
+}
+
+/*!
+ * Computes the inverse operational space inertia J * H^-1 * J^T using the
+ * sparse factorization of the mass matrix: with Y = L^-T * J^T, this is Y^T Y.
+ * @param J : m x _nDof Jacobian
+ * @return J * H^-1 * J^T (m x m)
+ */
+template <typename T>
+DMat<T> FloatingBaseModel<T>::inverseOperationalSpaceInertia(
+    const DMat<T> &J) {
+  DMat<T> LambdaInv;
+  inverseOperationalSpaceInertia(J, LambdaInv);
   return LambdaInv;
 }
 
+/*!
+ * Computes the inverse operational space inertia J * H^-1 * J^T using the
+ * sparse factorization of the mass matrix
+ * @param J : m x _nDof Jacobian
+ * @param LambdaInv : result (m x m), only resized if it is the wrong size
+ */
+template <typename T>
+void FloatingBaseModel<T>::inverseOperationalSpaceInertia(const DMat<T> &J,
+                                                          DMat<T> &LambdaInv) {
+  factorMassMatrix();
+  _opspWork = J.transpose();
+  solveLT(_opspWork);
+  LambdaInv.noalias() = _opspWork.transpose() * _opspWork;
+}
+
 template class FloatingBaseModel<double>;
 template class FloatingBaseModel<float>;
@@ -0,0 +1,253 @@
+/*! @file QuadrupedSimulator.cpp
+ *  @brief The simulator side of one robot: rigid body dynamics, low level
+ *  boards, actuator models and IMU
+ */
+
+#include "SimUtilities/QuadrupedSimulator.h"
+#include "Dynamics/Cheetah3.h"
+#include "Dynamics/MiniCheetah.h"
+
+/*!
+ * Build the robot with its boards reset.  Set its state with setState before
+ * stepping.
+ * @param robot : the type of robot
+ * @param params : simulator parameters, read every step
+ * @param offset : where the robot starts in the world
+ * @param imuSeed : seed of the IMU noise
+ */
+QuadrupedSimulator::QuadrupedSimulator(RobotType robot,
+                                       SimulatorControlParameters& params,
+                                       const Vec3<double>& offset,
+                                       u64 imuSeed)
+    : _robot(robot), _offset(offset), _simParams(params), _tau(12) {
+  if (_robot != RobotType::MINI_CHEETAH && _robot != RobotType::CHEETAH_3) {
+    throw std::runtime_error("QuadrupedSimulator: unknown robot type");
+  }
+  _quadruped = _robot == RobotType::MINI_CHEETAH ? buildMiniCheetah<double>()
+                                                 : buildCheetah3<double>();
+  _actuators = BatchActuatorModel<double>(_quadruped.buildActuatorModels());
+  _model = _quadruped.buildModel();
+  _simulator =
+      new DynamicsSimulator<double>(_model, (bool)_simParams.use_spring_damper);
+  _simulator->setUseFixedSizeDynamics(_simParams.use_fixed_size_dynamics);
+  _tau.setZero();
+
+  if (_robot == RobotType::MINI_CHEETAH) {
+    for (int leg = 0; leg < 4; leg++) {
+      _spineBoards[leg].init(Quadruped<float>::getSideSign(leg), leg);
+      _spineBoards[leg].data = &_spiData;
+      _spineBoards[leg].cmd = &_spiCommand;
+      _spineBoards[leg].resetData();
+      _spineBoards[leg].resetCommand();
+    }
+  } else {
+    for (int leg = 0; leg < 4; leg++) {
+      _tiBoards[leg].init(Quadruped<float>::getSideSign(leg));
+      _tiBoards[leg].set_link_lengths(_quadruped._abadLinkLength,
+                                      _quadruped._hipLinkLength,
+                                      _quadruped._kneeLinkLength);
+      _tiBoards[leg].reset_ti_board_command();
+      _tiBoards[leg].reset_ti_board_data();
+      _tiBoards[leg].run_ti_board_iteration();
+    }
+  }
+
+  _imuSimulator = new ImuSimulator<double>(_simParams, imuSeed);
+}
+
+QuadrupedSimulator::~QuadrupedSimulator() {
+  delete _imuSimulator;
+  delete _simulator;
+}
+
+/*!
+ * Run the spine boards or TI boards on the current joint state
+ */
+void QuadrupedSimulator::lowLevelControl() {
+  const FBModelState<double>& state = _simulator->getState();
+  if (_robot == RobotType::MINI_CHEETAH) {
+    for (int leg = 0; leg < 4; leg++) {
+      _spiData.q_abad[leg] = state.q[leg * 3 + 0];
+      _spiData.q_hip[leg] = state.q[leg * 3 + 1];
+      _spiData.q_knee[leg] = state.q[leg * 3 + 2];
+
+      _spiData.qd_abad[leg] = state.qd[leg * 3 + 0];
+      _spiData.qd_hip[leg] = state.qd[leg * 3 + 1];
+      _spiData.qd_knee[leg] = state.qd[leg * 3 + 2];
+    }
+
+    SpineBoard::runAll(_spineBoards);
+  } else {
+    for (int leg = 0; leg < 4; leg++) {
+      for (int joint = 0; joint < 3; joint++) {
+        _tiBoards[leg].data->q[joint] = state.q[leg * 3 + joint];
+        _tiBoards[leg].data->dq[joint] = state.qd[leg * 3 + joint];
+      }
+    }
+
+    for (auto& tiBoard : _tiBoards) {
+      tiBoard.run_ti_board_iteration();
+    }
+  }
+}
+
+/*!
+ * Fill in the IMU, the cheater state and the leg data for the controller.
+ * Positions are relative to where the robot started.
+ */
+void QuadrupedSimulator::writeSensorData(SimulatorToRobotMessage& message) {
+  _imuSimulator->updateCheaterState(_simulator->getState(),
+                                    _simulator->getDState(),
+                                    message.cheaterState);
+  message.cheaterState.position -= _offset;
+  _imuSimulator->updateVectornav(_simulator->getState(),
+                                 _simulator->getDState(), &message.vectorNav);
+
+  if (_robot == RobotType::MINI_CHEETAH) {
+    message.spiData = _spiData;
+  } else {
+    for (int i = 0; i < 4; i++) {
+      message.tiBoardData[i] = *_tiBoards[i].data;
+    }
+  }
+}
+
+/*!
+ * Take the board commands from a controller tick
+ */
+void QuadrupedSimulator::readCommands(const RobotToSimulatorMessage& message) {
+  if (_robot == RobotType::MINI_CHEETAH) {
+    _spiCommand = message.spiCommand;
+  } else {
+    for (int i = 0; i < 4; i++) {
+      _tiBoards[i].command = message.tiBoardCommand[i];
+    }
+  }
+  _highLevelIterations++;
+}
+
+/*!
+ * Get the joint torques from the torques the boards want and the actuator
+ * models, and heat the motors for dt seconds
+ */
+void QuadrupedSimulator::updateActuators(double dt) {
+  double tauDes[12];
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++) {
+      tauDes[leg * 3 + joint] = _robot == RobotType::MINI_CHEETAH
+                                    ? _spineBoards[leg].torque_out[joint]
+                                    : _tiBoards[leg].data->tau_des[joint];
+    }
+  }
+  updateThermalModel();
+  _actuators.getTorques(tauDes, _simulator->getState().qd.data(), _tau.data());
+  _actuators.updateTemperatures(dt);
+}
+
+/*!
+ * Step the rigid body dynamics with the torques from updateActuators, and
+ * record the step if a trajectory is open
+ * @param time : simulation time at the end of the step
+ */
+void QuadrupedSimulator::integrate(double time, double dt) {
+  RobotHomingInfo<double> homing;
+  homing.active_flag = _simParams.go_home;
+  homing.position = _simParams.home_pos + _offset;
+  homing.rpy = _simParams.home_rpy;
+  homing.kp_lin = _simParams.home_kp_lin;
+  homing.kd_lin = _simParams.home_kd_lin;
+  homing.kp_ang = _simParams.home_kp_ang;
+  homing.kd_ang = _simParams.home_kd_ang;
+  _simulator->setHoming(homing);
+  _simulator->setIntegrator((DynamicsIntegrator)_simParams.dynamics_integrator,
+                            _simParams.adaptive_contact_dt);
+
+  _simulator->step(dt, _tau, _simParams.floor_kp, _simParams.floor_kd);
+  _trajectoryRecorder.record(time, *_simulator, _tau);
+}
+
+/*!
+ * Turn the motor thermal model on or off to match the simulator parameters.
+ * The thermal settings are read when it is turned on.
+ */
+void QuadrupedSimulator::updateThermalModel() {
+  bool enabled = _simParams.motor_thermal_model != 0;
+  if (enabled == _actuators.thermalModelEnabled()) return;
+  if (enabled) {
+    MotorThermalParameters<double> thermal;
+    thermal.capacity = _simParams.motor_thermal_capacity;
+    thermal.resistance = _simParams.motor_thermal_resistance;
+    thermal.ambient = _simParams.ambient_temperature;
+    _actuators.enableThermalModel(thermal);
+  } else {
+    _actuators.disableThermalModel();
+  }
+}
+
+/*!
+ * Save the state of the robot, with the simulation clock passed in.  The
+ * controller is not part of the snapshot.
+ */
+SimulationSnapshot QuadrupedSimulator::snapshot(
+    double time, double timeOfNextLowLevelControl,
+    double timeOfNextHighLevelControl) {
+  SimulationSnapshot snapshot;
+  snapshot.robot = _robot;
+  snapshot.currentSimTime = time;
+  snapshot.timeOfNextLowLevelControl = timeOfNextLowLevelControl;
+  snapshot.timeOfNextHighLevelControl = timeOfNextHighLevelControl;
+  snapshot.highLevelIterations = _highLevelIterations;
+  _simulator->getSimulatorState(snapshot.dynamics);
+  snapshot.imuNoise = _imuSimulator->getNoiseGenerator();
+  snapshot.spiCommand = _spiCommand;
+  snapshot.spiData = _spiData;
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++) {
+      snapshot.spineTorque[leg][joint] = _spineBoards[leg].torque_out[joint];
+    }
+    snapshot.spineIterations[leg] = _spineBoards[leg].getIterationCount();
+    snapshot.tiBoardCommand[leg] = _tiBoards[leg].command;
+    snapshot.tiBoardData[leg] = _tiBoards[leg].data_structure;
+  }
+  for (int i = 0; i < 12; i++) {
+    snapshot.motorTemperature[i] = _actuators.getTemperatures()[i];
+  }
+  return snapshot;
+}
+
+/*!
+ * Go back to the state in a snapshot of this type of robot.  The clock in the
+ * snapshot is left to the caller, and the trajectory is not truncated.
+ */
+void QuadrupedSimulator::restore(const SimulationSnapshot& snapshot) {
+  if (snapshot.robot != _robot) {
+    throw std::runtime_error("snapshot is of a different robot");
+  }
+  _highLevelIterations = snapshot.highLevelIterations;
+  _simulator->setSimulatorState(snapshot.dynamics);
+  _imuSimulator->setNoiseGenerator(snapshot.imuNoise);
+  _spiCommand = snapshot.spiCommand;
+  _spiData = snapshot.spiData;
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++) {
+      _spineBoards[leg].torque_out[joint] = snapshot.spineTorque[leg][joint];
+    }
+    _spineBoards[leg].setIterationCount(snapshot.spineIterations[leg]);
+    _tiBoards[leg].command = snapshot.tiBoardCommand[leg];
+    _tiBoards[leg].data_structure = snapshot.tiBoardData[leg];
+  }
+  updateThermalModel();
+  _actuators.setTemperatures(snapshot.motorTemperature);
+}
+
+/*!
+ * Start recording every step to a file
+ * @param duration : simulated time to make room for.  The file grows if the
+ * simulation runs longer.
+ */
+void QuadrupedSimulator::openTrajectory(const std::string& fileName,
+                                        double duration) {
+  _trajectoryRecorder.open(fileName, 12, _model._nGroundContact,
+                           _simParams.dynamics_dt,
+                           (size_t)(duration / _simParams.dynamics_dt) + 16);
+}
@@ -0,0 +1,188 @@
+/*! @file SimulationSnapshot.cpp
+ *  @brief Saved state of a running simulation
+ *
+ *  Snapshot files are raw binary in the native byte order: a header, then each
+ *  field in the order it appears in SimulationSnapshot.  Vectors are written as
+ *  a u32 length followed by the values.  The noise generator is written in the
+ *  standard text format of std::mt19937.  Files only load on machines with the
+ *  same endianness as the one which saved them.
+ */
+
+#include "SimUtilities/SimulationSnapshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static const char kSnapshotMagic[8] = {'C', 'H', 'S', 'N', 'A', 'P', 0, 0};
+static const u32 kSnapshotVersion = 2;
+
+namespace {
+
+/*!
+ * Writes the fields of a snapshot to a file
+ */
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(std::ofstream& f) : _f(f) {}
+
+  template <typename P>
+  void pod(const P& x) {
+    _f.write(reinterpret_cast<const char*>(&x), sizeof(P));
+  }
+
+  template <typename M>
+  void fixed(const M& m) {
+    _f.write(reinterpret_cast<const char*>(m.data()),
+             sizeof(double) * m.size());
+  }
+
+  void vector(const DVec<double>& v) {
+    pod((u32)v.rows());
+    fixed(v);
+  }
+
+  void string(const std::string& s) {
+    pod((u32)s.size());
+    _f.write(s.data(), s.size());
+  }
+
+ private:
+  std::ofstream& _f;
+};
+
+/*!
+ * Reads the fields of a snapshot from a file.  Throws if the file ends early.
+ */
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(std::ifstream& f) : _f(f) {}
+
+  template <typename P>
+  void pod(P& x) {
+    read(reinterpret_cast<char*>(&x), sizeof(P));
+  }
+
+  template <typename M>
+  void fixed(M& m) {
+    read(reinterpret_cast<char*>(m.data()), sizeof(double) * m.size());
+  }
+
+  void vector(DVec<double>& v) {
+    u32 n;
+    pod(n);
+    if (n > 1000000) throw std::runtime_error("snapshot vector too long");
+    v.resize(n);
+    fixed(v);
+  }
+
+  void string(std::string& s) {
+    u32 n;
+    pod(n);
+    if (n > 1000000) throw std::runtime_error("snapshot string too long");
+    s.resize(n);
+    read(&s[0], n);
+  }
+
+ private:
+  void read(char* data, size_t size) {
+    _f.read(data, size);
+    if (!_f.good()) throw std::runtime_error("snapshot file is truncated");
+  }
+
+  std::ifstream& _f;
+};
+
+/*!
+ * Visit every field of a snapshot with a SnapshotWriter or SnapshotReader, so
+ * that the two always agree on the file layout
+ */
+template <typename S, typename Snapshot, typename NoiseState>
+void serializeSnapshot(S& s, Snapshot& snapshot, NoiseState& noiseState) {
+  s.pod(snapshot.robot);
+  s.pod(snapshot.currentSimTime);
+  s.pod(snapshot.timeOfNextLowLevelControl);
+  s.pod(snapshot.timeOfNextHighLevelControl);
+  s.pod(snapshot.highLevelIterations);
+
+  auto& d = snapshot.dynamics;
+  s.fixed(d.state.bodyOrientation);
+  s.fixed(d.state.bodyPosition);
+  s.fixed(d.state.bodyVelocity);
+  s.vector(d.state.q);
+  s.vector(d.state.qd);
+  s.fixed(d.dstate.dBodyPosition);
+  s.fixed(d.dstate.dBodyVelocity);
+  s.vector(d.dstate.qdd);
+  s.fixed(d.lastBodyVelocity);
+  s.fixed(d.midpointDState.dBodyPosition);
+  s.fixed(d.midpointDState.dBodyVelocity);
+  s.vector(d.midpointDState.qdd);
+  s.pod(d.midpointPredictionValid);
+  s.vector(d.contactState);
+
+  s.string(noiseState);
+
+  s.pod(snapshot.spiCommand);
+  s.pod(snapshot.spiData);
+  s.pod(snapshot.spineTorque);
+  s.pod(snapshot.spineIterations);
+  s.pod(snapshot.tiBoardCommand);
+  s.pod(snapshot.tiBoardData);
+  s.pod(snapshot.motorTemperature);
+}
+
+}  // namespace
+
+/*!
+ * Write the snapshot to a binary file
+ * @param fileName : file to create or overwrite
+ */
+void SimulationSnapshot::save(const std::string& fileName) const {
+  std::ofstream f(fileName, std::ios::binary | std::ios::trunc);
+  if (!f.good()) {
+    throw std::runtime_error("could not open snapshot file " + fileName);
+  }
+
+  std::ostringstream noise;
+  noise << imuNoise;
+  std::string noiseState = noise.str();
+
+  SnapshotWriter w(f);
+  f.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+  w.pod(kSnapshotVersion);
+  serializeSnapshot(w, *this, noiseState);
+  if (!f.good()) {
+    throw std::runtime_error("could not write snapshot file " + fileName);
+  }
+}
+
+/*!
+ * Read a snapshot written by save
+ * @param fileName : snapshot file
+ */
+void SimulationSnapshot::load(const std::string& fileName) {
+  std::ifstream f(fileName, std::ios::binary);
+  if (!f.good()) {
+    throw std::runtime_error("could not open snapshot file " + fileName);
+  }
+
+  char magic[sizeof(kSnapshotMagic)];
+  u32 version = 0;
+  f.read(magic, sizeof(magic));
+  f.read(reinterpret_cast<char*>(&version), sizeof(version));
+  if (!f.good() || memcmp(magic, kSnapshotMagic, sizeof(magic)) ||
+      version != kSnapshotVersion) {
+    throw std::runtime_error(fileName + " is not a simulation snapshot");
+  }
+
+  std::string noiseState;
+  SnapshotReader r(f);
+  serializeSnapshot(r, *this, noiseState);
+  std::istringstream noise(noiseState);
+  noise >> imuNoise;
+  if (noise.fail()) {
+    throw std::runtime_error("bad IMU noise state in snapshot " + fileName);
+  }
+}
@@ -3,6 +3,9 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
 
 #include "SimUtilities/SpineBoard.h"
 
@@ -134,5 +137,73 @@ void SpineBoard::run() {
     if (torque_out[i] > torque_limits[i]) torque_out[i] = torque_limits[i];
     if (torque_out[i] < -torque_limits[i]) torque_out[i] = -torque_limits[i];
   }
+}
+
+/*!
+ * Run the control of all four spine boards at once, as one batch of the 12
+ * joints.  Gives the same torques as run() on each board, but the softstop and
+ * torque limit logic is branch free so that the loop vectorizes.  Boards that
+ * don't share one command and data, in board order, fall back to run().
+ */
+void SpineBoard::runAll(SpineBoard (&boards)[4]) {
+  SpiCommand* cmd = boards[0].cmd;
+  SpiData* data = boards[0].data;
+  bool batch = cmd != nullptr && data != nullptr;
+  for (s32 leg = 0; leg < 4; leg++) {
+    batch = batch && boards[leg].cmd == cmd && boards[leg].data == data &&
+            boards[leg].board_num == leg;
+  }
+  if (!batch) {
+    for (auto& board : boards) board.run();
+    return;
+  }
 
+  // joint j of leg i is lane j * 4 + i, the layout of the command and data
+  const int n = 12;
+  float q[n], qd[n], qDes[n], qdDes[n], kp[n], kd[n], tauFF[n];
+  float limitP[n], limitN[n], limitTau[n], tau[n];
+  const float* fields[][3] = {
+      {data->q_abad, data->q_hip, data->q_knee},
+      {data->qd_abad, data->qd_hip, data->qd_knee},
+      {cmd->q_des_abad, cmd->q_des_hip, cmd->q_des_knee},
+      {cmd->qd_des_abad, cmd->qd_des_hip, cmd->qd_des_knee},
+      {cmd->kp_abad, cmd->kp_hip, cmd->kp_knee},
+      {cmd->kd_abad, cmd->kd_hip, cmd->kd_knee},
+      {cmd->tau_abad_ff, cmd->tau_hip_ff, cmd->tau_knee_ff}};
+  float* lanes[] = {q, qd, qDes, qdDes, kp, kd, tauFF};
+  for (int field = 0; field < 7; field++) {
+    for (int joint = 0; joint < 3; joint++) {
+      memcpy(lanes[field] + joint * 4, fields[field][joint], 4 * sizeof(float));
+    }
+  }
+
+  const SpineBoard& board = boards[0];
+  const float inf = std::numeric_limits<float>::infinity();
+  for (int lane = 0; lane < n; lane++) {
+    int joint = lane / 4, leg = lane % 4;
+    bool softstop = joint < 2;  // no knee softstop right now
+    limitP[lane] = softstop ? board.q_limit_p[joint] : inf;
+    limitN[lane] = softstop ? board.q_limit_n[joint] : -inf;
+    s32 flags = cmd->flags[leg];
+    limitTau[lane] = !(flags & 0b1)   ? board.disabled_torque[joint]
+                     : (flags & 0b10) ? board.wimp_torque[joint]
+                                      : board.max_torque[joint];
+  }
+
+  for (int i = 0; i < n; i++) {
+    float pd = kp[i] * (qDes[i] - q[i]) + kd[i] * (qdDes[i] - qd[i]) + tauFF[i];
+    float limit = q[i] > limitP[i] ? limitP[i] : limitN[i];
+    float stop = board.kp_softstop * (limit - q[i]) -
+                 board.kd_softstop * (qd[i]) + tauFF[i];
+    float t = q[i] > limitP[i] || q[i] < limitN[i] ? stop : pd;
+    t = std::min(t, limitTau[i]);
+    tau[i] = std::max(t, -limitTau[i]);
+  }
+
+  for (int leg = 0; leg < 4; leg++) {
+    boards[leg].iter_counter++;
+    for (int joint = 0; joint < 3; joint++) {
+      boards[leg].torque_out[joint] = tau[joint * 4 + leg];
+    }
+  }
 }
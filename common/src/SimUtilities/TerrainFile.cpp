@@ -0,0 +1,223 @@
+/*! @file TerrainFile.cpp
+ *  @brief Parser for simulator terrain files
+ */
+
+#include "SimUtilities/TerrainFile.h"
+#include "Math/orientation_tools.h"
+#include "ParamHandler.hpp"
+
+#include <Configuration.h>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/*!
+ * Read a terrain file and call the matching callback for each element in it
+ * @param terrainFileName : path to the terrain yaml file
+ * @param callbacks : functions to add each kind of collision object
+ */
+void parseTerrainFile(const std::string& terrainFileName,
+                      const TerrainFileCallbacks& callbacks) {
+  printf("load terrain %s\n", terrainFileName.c_str());
+  ParamHandler paramHandler(terrainFileName);
+
+  if (!paramHandler.fileOpenedSuccessfully()) {
+    printf("[ERROR] could not open yaml file for terrain\n");
+    throw std::runtime_error("yaml bad");
+  }
+
+  std::vector<std::string> keys = paramHandler.getKeys();
+
+  for (auto& key : keys) {
+    auto load = [&](double& val, const std::string& name) {
+      if (!paramHandler.getValue<double>(key, name, val))
+        throw std::runtime_error("terrain read bad: " + key + " " + name);
+    };
+
+    auto loadVec = [&](double& val, const std::string& name, size_t idx) {
+      std::vector<double> v;
+      if (!paramHandler.getVector<double>(key, name, v))
+        throw std::runtime_error("terrain read bad: " + key + " " + name);
+      val = v.at(idx);
+    };
+
+    auto loadArray = [&](double* val, const std::string& name, size_t idx) {
+      std::vector<double> v;
+      if (!paramHandler.getVector<double>(key, name, v))
+        throw std::runtime_error("terrain read bad: " + key + " " + name);
+      assert(v.size() == idx);
+      for (size_t i = 0; i < idx; i++) val[i] = v[i];
+    };
+
+    printf("terrain element %s\n", key.c_str());
+    std::string typeName;
+    paramHandler.getString(key, "type", typeName);
+    if (typeName == "infinite-plane") {
+      double mu, resti, height, gfxX, gfxY, checkerX, checkerY;
+      load(mu, "mu");
+      load(resti, "restitution");
+      load(height, "height");
+      loadVec(gfxX, "graphicsSize", 0);
+      loadVec(gfxY, "graphicsSize", 1);
+      loadVec(checkerX, "checkers", 0);
+      loadVec(checkerY, "checkers", 1);
+      callbacks.addPlane(mu, resti, height, gfxX, gfxY, checkerX, checkerY);
+    } else if (typeName == "box") {
+      double mu, resti, depth, width, height, transparent;
+      double pos[3];
+      double ori[3];
+      load(mu, "mu");
+      load(resti, "restitution");
+      load(depth, "depth");
+      load(width, "width");
+      load(height, "height");
+      loadArray(pos, "position", 3);
+      loadArray(ori, "orientation", 3);
+      load(transparent, "transparent");
+
+      Mat3<double> R_box = ori::rpyToRotMat(Vec3<double>(ori));
+      R_box.transposeInPlace();  // collisionBox uses "rotation" matrix instead
+                                 // of "transformation"
+      callbacks.addBox(mu, resti, depth, width, height, Vec3<double>(pos),
+                       R_box, transparent != 0.);
+    } else if (typeName == "stairs") {
+      double mu, resti, rise, run, stepsDouble, width, transparent;
+      double pos[3];
+      double ori[3];
+      load(mu, "mu");
+      load(resti, "restitution");
+      load(rise, "rise");
+      load(width, "width");
+      load(run, "run");
+      load(stepsDouble, "steps");
+      loadArray(pos, "position", 3);
+      loadArray(ori, "orientation", 3);
+      load(transparent, "transparent");
+
+      Mat3<double> R = ori::rpyToRotMat(Vec3<double>(ori));
+      Vec3<double> pOff(pos);
+      R.transposeInPlace();  // "graphics" rotation matrix
+
+      size_t steps = (size_t)stepsDouble;
+
+      double heightOffset = rise / 2;
+      double runOffset = run / 2;
+      for (size_t step = 0; step < steps; step++) {
+        Vec3<double> p(runOffset, 0, heightOffset);
+        p = R * p + pOff;
+
+        callbacks.addBox(mu, resti, run, width, heightOffset * 2, p, R,
+                         transparent != 0.);
+
+        heightOffset += rise / 2;
+        runOffset += run;
+      }
+    } else if (typeName == "mesh") {
+      double mu, resti, transparent, grid;
+      Vec3<double> left_corner;
+      std::vector<std::vector<double> > height_map_2d;
+      load(mu, "mu");
+      load(resti, "restitution");
+      load(transparent, "transparent");
+      load(grid, "grid");
+      loadVec(left_corner[0], "left_corner_loc", 0);
+      loadVec(left_corner[1], "left_corner_loc", 1);
+      loadVec(left_corner[2], "left_corner_loc", 2);
+
+      int x_len(0);
+      int y_len(0);
+      bool file_input(false);
+      paramHandler.getBoolean(key, "heightmap_file", file_input);
+      if (file_input) {
+        // Read from text file
+        std::string file_name;
+        paramHandler.getString(key, "heightmap_file_name", file_name);
+        std::ifstream f_height;
+        f_height.open(THIS_COM "/config/" + file_name);
+        if (!f_height.good()) {
+          std::cout << "file reading error: "
+                    << THIS_COM "../config/" + file_name << std::endl;
+        }
+        int i(0);
+        int j(0);
+        double tmp;
+
+        std::string line;
+        std::vector<double> height_map_vec;
+        while (getline(f_height, line)) {
+          std::istringstream iss(line);
+          j = 0;
+          while (iss >> tmp) {
+            height_map_vec.push_back(tmp);
+            ++j;
+          }
+          y_len = j;
+          height_map_2d.push_back(height_map_vec);
+          height_map_vec.clear();
+          ++i;
+        }
+        x_len = i;
+
+      } else {
+        paramHandler.get2DArray(key, "height_map", height_map_2d);
+        x_len = height_map_2d.size();
+        y_len = height_map_2d[0].size();
+      }
+
+      DMat<double> height_map(x_len, y_len);
+      for (int i(0); i < x_len; ++i) {
+        for (int j(0); j < y_len; ++j) {
+          height_map(i, j) = height_map_2d[i][j];
+        }
+      }
+      callbacks.addMesh(mu, resti, grid, left_corner, height_map,
+                        transparent != 0.);
+
+    } else if (typeName == "procedural") {
+      // everything but the friction is optional
+      ProceduralTerrainParameters params;
+      auto loadOptional = [&](double& val, const std::string& name) {
+        paramHandler.getValue<double>(key, name, val);
+      };
+      auto loadOptionalCount = [&](size_t& val, const std::string& name) {
+        double v = val;
+        loadOptional(v, name);
+        if (v < 0)
+          throw std::runtime_error("terrain read bad: " + key + " " + name);
+        val = (size_t)v;
+      };
+      double seed = params.seed;
+      load(params.mu, "mu");
+      load(params.restitution, "restitution");
+      loadOptional(seed, "seed");
+      params.seed = (u64)seed;
+      loadOptional(params.grid, "grid");
+      loadOptional(params.chunkSize, "chunk_size");
+      loadOptionalCount(params.loadRadius, "load_radius");
+      loadOptional(params.height, "height");
+      loadOptional(params.flatRadius, "flat_radius");
+      loadOptional(params.noiseAmplitude, "noise_amplitude");
+      loadOptional(params.noiseWavelength, "noise_wavelength");
+      loadOptionalCount(params.noiseOctaves, "noise_octaves");
+      loadOptional(params.featureSize, "feature_size");
+      loadOptional(params.slopeProbability, "slope_probability");
+      loadOptional(params.slopeHeight, "slope_height");
+      loadOptional(params.slopeGrade, "slope_grade");
+      loadOptional(params.stairsProbability, "stairs_probability");
+      loadOptional(params.stairRise, "stair_rise");
+      loadOptional(params.stairRun, "stair_run");
+      loadOptionalCount(params.stairSteps, "stair_steps");
+      loadOptional(params.gapProbability, "gap_probability");
+      loadOptional(params.gapWidth, "gap_width");
+      loadOptional(params.gapDepth, "gap_depth");
+      if (!callbacks.addProceduralTerrain) {
+        throw std::runtime_error("procedural terrain is not supported here");
+      }
+      callbacks.addProceduralTerrain(params);
+
+    } else {
+      throw std::runtime_error("unknown terrain " + typeName);
+    }
+  }
+}
@@ -0,0 +1,273 @@
+/*! @file TrajectoryRecorder.cpp
+ *  @brief Record every dynamics step of a simulation to a file, and play it
+ *  back
+ */
+
+#include "SimUtilities/TrajectoryRecorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static const char kTrajectoryMagic[8] = {'C', 'H', 'T', 'R', 'A', 'J', 0, 0};
+static const u32 kTrajectoryVersion = 1;
+static_assert(sizeof(TrajectoryFileHeader) == 64,
+              "trajectory file header must be 64 bytes");
+
+/*!
+ * Find the last record at or before a time, assuming the record times
+ * increase.  The index is guessed from the nominal dt, which is exact unless
+ * the step size changed during the recording, then corrected.
+ * @param time : time to look for
+ * @return index of the record, or 0 if the time is before the first record
+ */
+size_t TrajectoryFile::findRecord(double time) const {
+  size_t n = size();
+  if (n == 0) throw std::runtime_error("trajectory has no records");
+
+  double first = getTime(0);
+  if (time <= first) return 0;
+  if (time >= getTime(n - 1)) return n - 1;
+
+  double guess = _header->dt > 0 ? std::floor((time - first) / _header->dt +
+                                              1e-6)
+                                 : 0;
+  size_t i = std::min((size_t)std::max(guess, 0.), n - 1);
+  for (int tries = 0; tries < 2; tries++) {
+    if (getTime(i) > time) {
+      i--;
+    } else if (getTime(i + 1) <= time) {
+      i++;
+    } else {
+      return i;
+    }
+  }
+
+  // the guess was far off, binary search for the last record <= time
+  size_t lo = 0, hi = n - 1;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (getTime(mid) <= time) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/*!
+ * Read a record
+ * @param i : index of the record
+ * @param state : the state of the robot
+ * @param tau : joint torques
+ * @param contactForces : force on each ground contact point
+ */
+void TrajectoryFile::getRecord(
+    size_t i, FBModelState<double>& state, DVec<double>& tau,
+    vectorAligned<Vec3<double>>& contactForces) const {
+  if (i >= size()) throw std::runtime_error("trajectory record out of range");
+  size_t nQ = _header->nQ, nContacts = _header->nContacts;
+  const double* r = record(i) + 1;
+  state.bodyOrientation = Eigen::Map<const Quat<double>>(r);
+  state.bodyPosition = Eigen::Map<const Vec3<double>>(r + 4);
+  state.bodyVelocity = Eigen::Map<const SVec<double>>(r + 7);
+  r += 13;
+  state.q = Eigen::Map<const DVec<double>>(r, nQ);
+  state.qd = Eigen::Map<const DVec<double>>(r + nQ, nQ);
+  tau = Eigen::Map<const DVec<double>>(r + 2 * nQ, nQ);
+  r += 3 * nQ;
+  contactForces.resize(nContacts);
+  for (size_t c = 0; c < nContacts; c++) {
+    contactForces[c] = Eigen::Map<const Vec3<double>>(r + 3 * c);
+  }
+}
+
+/*!
+ * Create a trajectory file, replacing any existing file
+ * @param fileName : file to record to
+ * @param nQ : number of joints
+ * @param nContacts : number of ground contact points
+ * @param dt : nominal time between records, used to find records quickly
+ * @param capacity : number of records to allocate space for
+ */
+void TrajectoryRecorder::open(const std::string& fileName, size_t nQ,
+                              size_t nContacts, double dt, size_t capacity) {
+  close();
+  _fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR |
+                                                                S_IRGRP | S_IROTH);
+  if (_fd < 0) {
+    throw std::runtime_error("could not create trajectory file " + fileName);
+  }
+
+  TrajectoryFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kTrajectoryMagic, sizeof(header.magic));
+  header.version = kTrajectoryVersion;
+  header.nQ = nQ;
+  header.nContacts = nContacts;
+  header.recordSize = sizeof(double) * recordDoubles(nQ, nContacts);
+  header.nRecords = 0;
+  header.dt = dt;
+
+  _capacity = std::max(capacity, (size_t)1);
+  _mappedSize = sizeof(header) + _capacity * header.recordSize;
+  if (ftruncate(_fd, _mappedSize)) {
+    close();
+    throw std::runtime_error("could not allocate trajectory file " + fileName);
+  }
+  void* mem =
+      mmap(nullptr, _mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (mem == MAP_FAILED) {
+    close();
+    throw std::runtime_error("could not map trajectory file " + fileName);
+  }
+  _data = (u8*)mem;
+  _header = (TrajectoryFileHeader*)mem;
+  *_header = header;
+}
+
+/*!
+ * Record the state of the simulator after a step
+ * @param time : simulation time
+ * @param sim : simulator, for the state and contact forces
+ * @param tau : joint torques applied during the step
+ */
+void TrajectoryRecorder::record(double time, DynamicsSimulator<double>& sim,
+                                const DVec<double>& tau) {
+  if (!_header) return;
+  if (_header->nRecords == _capacity) grow();
+
+  size_t nQ = _header->nQ, nContacts = _header->nContacts;
+  double* r = const_cast<double*>(TrajectoryFile::record(_header->nRecords));
+  const FBModelState<double>& state = sim.getState();
+  r[0] = time;
+  Eigen::Map<Quat<double>>(r + 1) = state.bodyOrientation;
+  Eigen::Map<Vec3<double>>(r + 5) = state.bodyPosition;
+  Eigen::Map<SVec<double>>(r + 8) = state.bodyVelocity;
+  r += 14;
+  Eigen::Map<DVec<double>>(r, nQ) = state.q;
+  Eigen::Map<DVec<double>>(r + nQ, nQ) = state.qd;
+  Eigen::Map<DVec<double>>(r + 2 * nQ, nQ) = tau;
+  r += 3 * nQ;
+  for (size_t c = 0; c < nContacts; c++) {
+    Eigen::Map<Vec3<double>>(r + 3 * c) = sim.getContactForce(c);
+  }
+
+  // a reader of the file never sees a record before it is complete
+  std::atomic_thread_fence(std::memory_order_release);
+  _header->nRecords++;
+}
+
+/*!
+ * Drop the records after a time, for when the simulation goes back in time
+ * (for example, when a snapshot is restored)
+ */
+void TrajectoryRecorder::truncate(double time) {
+  if (!_header || _header->nRecords == 0) return;
+  if (time < getTime(0)) {
+    _header->nRecords = 0;
+  } else {
+    _header->nRecords = findRecord(time) + 1;
+  }
+}
+
+/*!
+ * Double the space in the file.  This is the only time recording makes a
+ * system call.
+ */
+void TrajectoryRecorder::grow() {
+  size_t recordSize = _header->recordSize;
+  size_t newCapacity = 2 * _capacity;
+  size_t newSize = sizeof(TrajectoryFileHeader) + newCapacity * recordSize;
+  if (ftruncate(_fd, newSize)) {
+    throw std::runtime_error("could not grow trajectory file");
+  }
+  void* mem = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (mem == MAP_FAILED) {
+    throw std::runtime_error("could not map trajectory file");
+  }
+  munmap(_data, _mappedSize);
+  _data = (u8*)mem;
+  _header = (TrajectoryFileHeader*)mem;
+  _mappedSize = newSize;
+  _capacity = newCapacity;
+}
+
+/*!
+ * Finish the file, trimming the unused space at the end
+ */
+void TrajectoryRecorder::close() {
+  size_t fileSize = 0;
+  if (_header) {
+    fileSize = sizeof(TrajectoryFileHeader) +
+               _header->nRecords * _header->recordSize;
+    munmap(_data, _mappedSize);
+  }
+  if (_fd >= 0) {
+    if (fileSize && ftruncate(_fd, fileSize)) {
+      printf("[TrajectoryRecorder] could not trim trajectory file\n");
+    }
+    ::close(_fd);
+  }
+  _header = nullptr;
+  _data = nullptr;
+  _mappedSize = 0;
+  _capacity = 0;
+  _fd = -1;
+}
+
+/*!
+ * Open a trajectory file for reading
+ * @param fileName : file written by a TrajectoryRecorder
+ */
+void TrajectoryReplayer::open(const std::string& fileName) {
+  close();
+  _fd = ::open(fileName.c_str(), O_RDONLY);
+  if (_fd < 0) {
+    throw std::runtime_error("could not open trajectory file " + fileName);
+  }
+  struct stat s;
+  if (fstat(_fd, &s) || (size_t)s.st_size < sizeof(TrajectoryFileHeader)) {
+    close();
+    throw std::runtime_error(fileName + " is not a trajectory file");
+  }
+  _mappedSize = s.st_size;
+  void* mem = mmap(nullptr, _mappedSize, PROT_READ, MAP_SHARED, _fd, 0);
+  if (mem == MAP_FAILED) {
+    close();
+    throw std::runtime_error("could not map trajectory file " + fileName);
+  }
+  _data = (u8*)mem;
+
+  // keep a copy of the header, so the file is never written
+  memcpy(&_headerCopy, mem, sizeof(_headerCopy));
+  if (memcmp(_headerCopy.magic, kTrajectoryMagic, sizeof(kTrajectoryMagic)) ||
+      _headerCopy.version != kTrajectoryVersion ||
+      _headerCopy.recordSize != sizeof(double) * recordDoubles(
+                                    _headerCopy.nQ, _headerCopy.nContacts)) {
+    munmap(_data, _mappedSize);
+    _data = nullptr;
+    close();
+    throw std::runtime_error(fileName + " is not a trajectory file");
+  }
+  size_t available =
+      (_mappedSize - sizeof(TrajectoryFileHeader)) / _headerCopy.recordSize;
+  if (_headerCopy.nRecords > available) _headerCopy.nRecords = available;
+  _header = &_headerCopy;
+}
+
+void TrajectoryReplayer::close() {
+  if (_data) munmap(_data, _mappedSize);
+  if (_fd >= 0) ::close(_fd);
+  _header = nullptr;
+  _data = nullptr;
+  _mappedSize = 0;
+  _fd = -1;
+}
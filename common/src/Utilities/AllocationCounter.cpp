@@ -0,0 +1,105 @@
+/*! @file AllocationCounter.cpp
+ *  @brief Debug tool for counting heap allocations made by a block of code
+ *
+ * The allocation functions are replaced by wrappers around glibc's internal
+ * __libc_* allocators.  The counter and flag are thread local and use the
+ * initial-exec TLS model so that reading them never allocates.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+#include "Utilities/AllocationCounter.h"
+
+static thread_local bool counting
+    __attribute__((tls_model("initial-exec"))) = false;
+static thread_local uint64_t allocationCount
+    __attribute__((tls_model("initial-exec"))) = 0;
+
+#ifdef __GLIBC__
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+static inline void noteAllocation() {
+  if (counting) allocationCount++;
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+  noteAllocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+  noteAllocation();
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  noteAllocation();
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  noteAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  noteAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  noteAllocation();
+  void* p = __libc_memalign(alignment, size);
+  if (!p) return ENOMEM;
+  *ptr = p;
+  return 0;
+}
+}
+
+#endif
+
+/*!
+ * Reset the count for this thread and start counting
+ */
+void AllocationCounter::start() {
+  allocationCount = 0;
+  counting = true;
+  _running = true;
+}
+
+/*!
+ * Stop counting
+ * @return number of allocations since start()
+ */
+uint64_t AllocationCounter::stop() {
+  if (_running) {
+    counting = false;
+    _running = false;
+  }
+  return allocationCount;
+}
+
+/*!
+ * Get the number of allocations since start()
+ */
+uint64_t AllocationCounter::getCount() const { return allocationCount; }
+
+/*!
+ * Check if the allocation functions are being counted (built with glibc)
+ */
+bool AllocationCounter::hooksInstalled() {
+#ifdef __GLIBC__
+  return true;
+#else
+  return false;
+#endif
+}
@@ -5,10 +5,13 @@
  */
 
 #include "Dynamics/ActuatorModel.h"
+#include "Dynamics/BatchActuatorModel.h"
 #include "Dynamics/Cheetah3.h"
 #include "Dynamics/MiniCheetah.h"
 #include "Dynamics/Quadruped.h"
 
+#include <random>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -110,4 +113,85 @@ TEST(ActuatorModel, cheetah3) {
   EXPECT_TRUE(fpEqual(tauMaxNegative, -208.6, .1));
   EXPECT_TRUE(fpEqual(maxQdMaxTorque, 8.44, .02));
   EXPECT_TRUE(fpEqual(qdMax, 15.94, .1));
-}
\ No newline at end of file
+}
+
+template <typename T>
+void checkBatchMatchesScalar(Quadruped<T> quad, bool friction) {
+  auto models = quad.buildActuatorModels();
+  BatchActuatorModel<T> batch(models);
+  for (auto& model : models) model.setFriction(friction);
+  batch.setFriction(friction);
+
+  // desired torques past the torque limit and speeds past the voltage limit
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<T> tauDist(-300, 300), qdDist(-60, 60);
+  T tauDes[12], qd[12], tau[12];
+  for (int trial = 0; trial < 1000; trial++) {
+    for (int i = 0; i < 12; i++) {
+      tauDes[i] = tauDist(rng);
+      qd[i] = trial % 10 == 0 ? 0 : qdDist(rng);
+    }
+    batch.getTorques(tauDes, qd, tau);
+    for (int i = 0; i < 12; i++) {
+      T expected = models[i % 3].getTorque(tauDes[i], qd[i]);
+      EXPECT_NEAR(expected, tau[i], 1e-5 * (1 + std::abs(expected)));
+    }
+  }
+}
+
+TEST(ActuatorModel, batchMatchesScalar) {
+  checkBatchMatchesScalar(buildMiniCheetah<double>(), true);
+  checkBatchMatchesScalar(buildMiniCheetah<double>(), false);
+  checkBatchMatchesScalar(buildCheetah3<double>(), true);
+  checkBatchMatchesScalar(buildMiniCheetah<float>(), true);
+  checkBatchMatchesScalar(buildCheetah3<float>(), false);
+}
+
+TEST(ActuatorModel, batchThermal) {
+  Quadruped<double> quad = buildMiniCheetah<double>();
+  BatchActuatorModel<double> batch(quad.buildActuatorModels());
+  MotorThermalParameters<double> thermal;
+  thermal.capacity = 10;
+  thermal.resistance = 2;
+  thermal.ambient = 30;
+  batch.enableThermalModel(thermal);
+
+  // joint 0 holds a constant torque, the others are off
+  double tauDes[12] = {}, qd[12] = {}, tau[12];
+  tauDes[0] = 3;
+  batch.getTorques(tauDes, qd, tau);
+  double current = 3. / quad._abadGearRatio / (quad._motorKT * 1.5);
+  EXPECT_NEAR(1.5 * current * current * quad._motorR,
+              batch.getPowerLoss()[0], 1e-9);
+  EXPECT_EQ(0., batch.getPowerLoss()[1]);
+
+  // after five time constants the winding is close to steady state, where
+  // all of the loss goes through the thermal resistance
+  for (int i = 0; i < 100000; i++) {
+    batch.getTorques(tauDes, qd, tau);
+    batch.updateTemperatures(0.001);
+  }
+  double steady = thermal.ambient + batch.getPowerLoss()[0] * 2;
+  EXPECT_NEAR(steady, batch.getTemperatures()[0], 0.01 * (steady - 30));
+  EXPECT_GT(batch.getTemperatures()[0], 30.);
+  EXPECT_EQ(30., batch.getTemperatures()[1]);
+
+  // the hot winding has more resistance, so less torque at the voltage limit
+  BatchActuatorModel<double> cold(quad.buildActuatorModels());
+  double tauHot[12], tauCold[12];
+  for (int i = 0; i < 12; i++) {
+    tauDes[i] = 3;
+    qd[i] = 39;
+  }
+  batch.getTorques(tauDes, qd, tauHot);
+  cold.getTorques(tauDes, qd, tauCold);
+  EXPECT_LT(tauHot[0], tauCold[0]);
+  EXPECT_EQ(tauHot[1], tauCold[1]);
+
+  batch.disableThermalModel();
+  batch.getTorques(tauDes, qd, tauHot);
+  EXPECT_EQ(tauHot[0], tauCold[0]);
+
+  thermal.capacity = 0;
+  EXPECT_THROW(batch.enableThermalModel(thermal), std::runtime_error);
+}
@@ -0,0 +1,382 @@
+/*! @file test_collision.cpp
+ *  @brief Test collision detection, the collision broad phase and terrain files
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+
+#include "Collision/CollisionBox.h"
+#include "Collision/CollisionGrid.h"
+#include "Collision/CollisionMesh.h"
+#include "Collision/CollisionPlane.h"
+#include "Collision/CollisionTerrain.h"
+#include "Math/MathUtilities.h"
+#include "Math/orientation_tools.h"
+#include "SimUtilities/TerrainFile.h"
+#include "Utilities/utilities.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace ori;
+
+/*!
+ * Build a terrain of stairs and scattered rotated boxes on a ground plane and
+ * check that for random points the broad phase never misses an object that
+ * the narrow phase would report a contact with, and that it narrows the
+ * search to a few objects.
+ */
+TEST(Collision, broadPhaseFindsAllContacts) {
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<double> uniform(-1, 1);
+
+  std::vector<std::unique_ptr<Collision<double>>> objects;
+  objects.emplace_back(new CollisionPlane<double>(.7, 0, 0));
+  for (size_t i = 0; i < 20; i++) {
+    objects.emplace_back(new CollisionBox<double>(
+        .7, 0, .3, 2., .15 * (i + 1), Vec3<double>(.3 * i, 0, .075 * (i + 1)),
+        Mat3<double>::Identity()));
+  }
+  for (size_t i = 0; i < 300; i++) {
+    Vec3<double> pos(10 * uniform(gen), 5 + 5 * uniform(gen),
+                     .2 * uniform(gen));
+    Mat3<double> R = coordinateRotation(CoordinateAxis::Z, 3 * uniform(gen)) *
+                     coordinateRotation(CoordinateAxis::X, .3 * uniform(gen));
+    objects.emplace_back(new CollisionBox<double>(
+        .7, 0, .2 + .2 * uniform(gen), .3 + .2 * uniform(gen),
+        .5 + .2 * uniform(gen), pos, R));
+  }
+  DMat<double> heightMap = DMat<double>::Zero(20, 20);
+  objects.emplace_back(new CollisionMesh<double>(
+      .7, 0, .05, Vec3<double>(-5, -3, 0), heightMap));
+
+  std::vector<Collision<double>*> collisions;
+  for (auto& object : objects) collisions.push_back(object.get());
+
+  CollisionGrid<double> grid;
+  grid.build(collisions);
+  EXPECT_GT(grid.getCellCountX(), 1u);
+  EXPECT_GT(grid.getCellCountY(), 1u);
+
+  double penetration;
+  Mat3<double> frame;
+  size_t nContacts = 0, nCandidates = 0;
+  const size_t nPoints = 10000;
+  for (size_t i = 0; i < nPoints; i++) {
+    Vec3<double> p(6 + 7 * uniform(gen), 4 + 7 * uniform(gen),
+                   .4 + .5 * uniform(gen));
+    std::vector<size_t> hits;
+    for (size_t j = 0; j < collisions.size(); j++) {
+      if (collisions[j]->ContactDetection(p, penetration, frame)) {
+        hits.push_back(j);
+      }
+    }
+
+    std::vector<size_t> broadHits;
+    for (size_t j : grid.query(p)) {
+      nCandidates++;
+      if (!grid.overlaps(j, p)) continue;
+      if (collisions[j]->ContactDetection(p, penetration, frame)) {
+        broadHits.push_back(j);
+      }
+    }
+    EXPECT_EQ(hits, broadHits);
+    nContacts += hits.size();
+  }
+
+  EXPECT_GT(nContacts, nPoints / 10);
+  EXPECT_LT(nCandidates, nPoints * 15);
+}
+
+/*!
+ * Check the two-triangle height map surface against a tilted plane, where the
+ * penetration and contact frame are known exactly, and check that the batch
+ * query agrees with the single point query on a random height map.
+ */
+TEST(Collision, heightMapSurface) {
+  const double grid = .05, a = .2, b = -.3;
+  Vec3<double> corner(-1, -2, .1);
+  DMat<double> planeMap(41, 61);
+  for (long i = 0; i < planeMap.rows(); i++) {
+    for (long j = 0; j < planeMap.cols(); j++) {
+      planeMap(i, j) = a * i * grid + b * j * grid;
+    }
+  }
+  CollisionMesh<double> plane(.7, 0, grid, corner, planeMap);
+  Vec3<double> normal = Vec3<double>(-a, -b, 1).normalized();
+
+  std::mt19937 gen(321);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  double penetration;
+  Mat3<double> frame;
+  for (size_t k = 0; k < 1000; k++) {
+    Vec3<double> p(corner[0] + 2 * uniform(gen), corner[1] + 3 * uniform(gen),
+                   0);
+    double height = plane.surfaceHeight(p[0], p[1]);
+    EXPECT_NEAR(a * (p[0] - corner[0]) + b * (p[1] - corner[1]), height,
+                1e-12);
+    p[2] = corner[2] + height - .01;
+    ASSERT_TRUE(plane.ContactDetection(p, penetration, frame));
+    EXPECT_NEAR(-.01 * normal[2], penetration, 1e-12);
+    EXPECT_TRUE(almostEqual(normal, Vec3<double>(frame.col(2)), 1e-12));
+    EXPECT_TRUE(almostEqual(Mat3<double>(Mat3<double>::Identity()),
+                            Mat3<double>(frame.transpose() * frame), 1e-12));
+    EXPECT_NEAR(1, frame.determinant(), 1e-12);
+    p[2] += .02;
+    EXPECT_FALSE(plane.ContactDetection(p, penetration, frame));
+  }
+
+  DMat<double> roughMap(101, 101);
+  for (long i = 0; i < roughMap.size(); i++) {
+    roughMap(i) = .1 * uniform(gen);
+  }
+  CollisionMesh<double> rough(.7, 0, grid, corner, roughMap);
+  std::vector<Vec3<double>> points;
+  for (size_t k = 0; k < 5000; k++) {
+    points.emplace_back(corner[0] - .5 + 6 * uniform(gen),
+                        corner[1] - .5 + 6 * uniform(gen),
+                        corner[2] - .05 + .2 * uniform(gen));
+  }
+  std::vector<uint8_t> inContact;
+  ASSERT_TRUE(rough.BatchContactDetection(points, inContact));
+  ASSERT_EQ(points.size(), inContact.size());
+  size_t nContacts = 0;
+  for (size_t k = 0; k < points.size(); k++) {
+    bool contact = rough.ContactDetection(points[k], penetration, frame);
+    EXPECT_EQ(contact, (bool)inContact[k]);
+    if (contact) {
+      EXPECT_LT(penetration, 0.);
+      nContacts++;
+    }
+  }
+  EXPECT_GT(nContacts, 100u);
+}
+
+/*!
+ * Parse a terrain file with a plane, a box and stairs, and check that each
+ * element reaches the right callback with its values
+ */
+TEST(Collision, terrainFile) {
+  const char* fileName = "test-terrain.yaml";
+  {
+    std::ofstream f(fileName);
+    f << "ground:\n"
+         "  type: \"infinite-plane\"\n"
+         "  mu: 0.5\n"
+         "  restitution: 0.1\n"
+         "  height: -0.2\n"
+         "  graphicsSize: [20, 10]\n"
+         "  checkers: [40, 20]\n"
+         "block:\n"
+         "  type: \"box\"\n"
+         "  mu: 0.7\n"
+         "  restitution: 0\n"
+         "  depth: 2.0\n"
+         "  width: 1.5\n"
+         "  height: 0.3\n"
+         "  position: [1.5, 0, 0.15]\n"
+         "  orientation: [0, 0, 0.5]\n"
+         "  transparent: 1\n"
+         "steps:\n"
+         "  type: \"stairs\"\n"
+         "  steps: 4\n"
+         "  rise: 0.1\n"
+         "  run: 0.2\n"
+         "  width: 1.0\n"
+         "  mu: 0.6\n"
+         "  restitution: 0\n"
+         "  position: [0, 2, 0]\n"
+         "  orientation: [0, 0, 0]\n"
+         "  transparent: 0\n";
+  }
+
+  int planes = 0;
+  std::vector<double> boxHeights;
+  std::vector<Vec3<double>> boxPositions;
+  std::vector<bool> boxTransparent;
+  TerrainFileCallbacks callbacks;
+  callbacks.addPlane = [&](double mu, double resti, double height, double sizeX,
+                           double sizeY, double checkerX, double checkerY) {
+    planes++;
+    EXPECT_EQ(.5, mu);
+    EXPECT_EQ(.1, resti);
+    EXPECT_EQ(-.2, height);
+    EXPECT_EQ(20, sizeX);
+    EXPECT_EQ(10, sizeY);
+    EXPECT_EQ(40, checkerX);
+    EXPECT_EQ(20, checkerY);
+  };
+  callbacks.addBox = [&](double, double, double, double, double height,
+                         const Vec3<double>& pos, const Mat3<double>&,
+                         bool transparent) {
+    boxHeights.push_back(height);
+    boxPositions.push_back(pos);
+    boxTransparent.push_back(transparent);
+  };
+  callbacks.addMesh = [&](double, double, double, const Vec3<double>&,
+                          const DMat<double>&, bool) {
+    ADD_FAILURE() << "no mesh in the file";
+  };
+  parseTerrainFile(fileName, callbacks);
+  std::remove(fileName);
+
+  EXPECT_EQ(1, planes);
+  ASSERT_EQ(5u, boxHeights.size());
+  EXPECT_TRUE(boxTransparent[0]);
+  EXPECT_TRUE(almostEqual(Vec3<double>(1.5, 0, .15), boxPositions[0], 1e-9));
+  for (size_t step = 0; step < 4; step++) {
+    // each step is a box from the ground up to its top
+    EXPECT_NEAR(.1 * (step + 1), boxHeights[step + 1], 1e-9);
+    EXPECT_NEAR(.2 * step + .1, boxPositions[step + 1][0], 1e-9);
+    EXPECT_NEAR(2, boxPositions[step + 1][1], 1e-9);
+    EXPECT_FALSE(boxTransparent[step + 1]);
+  }
+}
+
+/*!
+ * Check that a procedural terrain only depends on its seed, is flat around
+ * the origin, has features elsewhere, and that its chunks sample it
+ */
+TEST(Collision, proceduralTerrain) {
+  ProceduralTerrainParameters params;
+  params.seed = 7;
+  ProceduralTerrain terrain(params), same(params);
+  params.seed = 8;
+  ProceduralTerrain other(params);
+
+  std::mt19937 gen(99);
+  std::uniform_real_distribution<double> uniform(-500, 500);
+  size_t different = 0, bumpy = 0;
+  for (size_t k = 0; k < 2000; k++) {
+    double x = uniform(gen), y = uniform(gen);
+    double h = terrain.height(x, y);
+    EXPECT_EQ(h, same.height(x, y));
+    if (h != other.height(x, y)) different++;
+    if (std::abs(h) > params.stairRise) bumpy++;
+  }
+  EXPECT_GT(different, 1900u);
+  EXPECT_GT(bumpy, 100u);
+
+  for (double r = 0; r < params.flatRadius; r += .1) {
+    EXPECT_EQ(params.height, terrain.height(r * .6, -r * .8));
+  }
+
+  auto chunk = terrain.generateChunk<double>(-3, 5);
+  EXPECT_EQ(-3, chunk->x);
+  EXPECT_EQ(5, chunk->y);
+  const DMat<double>& heights = chunk->mesh.getHeightMap();
+  double grid = chunk->mesh.getGridSize();
+  EXPECT_NEAR(params.chunkSize, (heights.rows() - 3) * grid, 1e-9);
+  const Vec3<double>& corner = chunk->mesh.getLeftCorner();
+  EXPECT_NEAR(-3 * params.chunkSize - grid, corner[0], 1e-9);
+  EXPECT_NEAR(5 * params.chunkSize - grid, corner[1], 1e-9);
+  for (long i = 0; i < heights.rows(); i += 7) {
+    for (long j = 0; j < heights.cols(); j += 5) {
+      EXPECT_EQ(terrain.height(corner[0] + i * grid, corner[1] + j * grid),
+                heights(i, j));
+    }
+  }
+}
+
+/*!
+ * Walk a kilometer over a procedural terrain and check that contacts match
+ * the terrain height, that the number of loaded chunks stays bounded, and
+ * that going back and forth over a chunk edge does not generate chunks
+ */
+TEST(Collision, proceduralTerrainStreaming) {
+  ProceduralTerrainParameters params;
+  params.seed = 3;
+  params.grid = .05;
+  auto terrain = std::make_shared<const ProceduralTerrain>(params);
+  CollisionTerrain<double> collision(terrain);
+  EXPECT_EQ(params.mu, collision.getFrictionCoeff());
+
+  double penetration;
+  Mat3<double> frame;
+  size_t smooth = 0;
+  for (double x = 0; x < 1000; x += .37) {
+    double y = 2 * std::sin(x / 50);
+    double h = terrain->height(x, y);
+
+    // the height map only matches the terrain away from steps and gaps
+    double relief = 0;
+    for (double dx : {-.1, .1}) {
+      for (double dy : {-.1, .1}) {
+        double dh = std::abs(terrain->height(x + dx, y + dy) - h);
+        relief = std::max(relief, dh);
+      }
+    }
+    if (relief < .05) {
+      smooth++;
+      ASSERT_TRUE(collision.ContactDetection(Vec3<double>(x, y, h - .005),
+                                             penetration, frame));
+      EXPECT_LT(penetration, 0.);
+      EXPECT_GT(penetration, -.006);
+      EXPECT_NEAR(1, frame.determinant(), 1e-9);
+      EXPECT_FALSE(collision.ContactDetection(Vec3<double>(x, y, h + .005),
+                                              penetration, frame));
+    } else {
+      collision.ContactDetection(Vec3<double>(x, y, h), penetration, frame);
+    }
+
+    size_t loaded = 0;
+    for (auto& chunk : collision.getChunks()) {
+      if (chunk) loaded++;
+    }
+    ASSERT_LE(loaded, (2 * params.loadRadius + 2) *
+                          (2 * params.loadRadius + 2));
+  }
+  EXPECT_GT(smooth, 2000u);
+
+  // the chunks along the path and the ones beside it, not a kilometer square
+  size_t side = 2 * params.loadRadius + 1;
+  size_t generated = collision.getChunksGenerated();
+  EXPECT_LT(generated, (1000 / params.chunkSize + 10) * side * 2);
+
+  double edge = 250 * params.chunkSize;
+  for (size_t k = 0; k < 20; k++) {
+    double x = edge + (k % 2 ? .01 : -.01);
+    collision.ContactDetection(Vec3<double>(x, 0, 0), penetration, frame);
+  }
+  size_t afterFirstCrossing = collision.getChunksGenerated();
+  for (size_t k = 0; k < 20; k++) {
+    double x = edge + (k % 2 ? .01 : -.01);
+    collision.ContactDetection(Vec3<double>(x, 0, 0), penetration, frame);
+  }
+  EXPECT_EQ(afterFirstCrossing, collision.getChunksGenerated());
+}
+
+/*!
+ * Parse a procedural terrain, with some settings left out
+ */
+TEST(Collision, proceduralTerrainFile) {
+  const char* fileName = "test-procedural-terrain.yaml";
+  {
+    std::ofstream f(fileName);
+    f << "world:\n"
+         "  type: \"procedural\"\n"
+         "  mu: 0.6\n"
+         "  restitution: 0\n"
+         "  seed: 42\n"
+         "  chunk_size: 5\n"
+         "  load_radius: 1\n"
+         "  stairs_probability: 0.5\n";
+  }
+  int terrains = 0;
+  TerrainFileCallbacks callbacks;
+  callbacks.addProceduralTerrain = [&](const ProceduralTerrainParameters& p) {
+    terrains++;
+    ProceduralTerrainParameters defaults;
+    EXPECT_EQ(.6, p.mu);
+    EXPECT_EQ(42u, p.seed);
+    EXPECT_EQ(5, p.chunkSize);
+    EXPECT_EQ(1u, p.loadRadius);
+    EXPECT_EQ(.5, p.stairsProbability);
+    EXPECT_EQ(defaults.grid, p.grid);
+    EXPECT_EQ(defaults.gapDepth, p.gapDepth);
+  };
+  parseTerrainFile(fileName, callbacks);
+  std::remove(fileName);
+  EXPECT_EQ(1, terrains);
+}
@@ -4,10 +4,14 @@
  * Test the dynamics algorithms in DynamicsSimulator and models of Cheetah 3
  */
 
+#include "Collision/ContactImpulse.h"
+#include "Dynamics/BatchFloatingBaseModel.h"
 #include "Dynamics/Cheetah3.h"
 #include "Dynamics/DynamicsSimulator.h"
 #include "Dynamics/FloatingBaseModel.h"
+#include "Dynamics/MiniCheetah.h"
 #include "Dynamics/Quadruped.h"
+#include "Utilities/AllocationCounter.h"
 #include "Utilities/utilities.h"
 
 #include "gmock/gmock.h"
@@ -437,3 +441,601 @@ TEST(Dynamics, simulatorFootPosVelCheetah3) {
   //EXPECT_TRUE(almostEqual(bodyvRef1ML, sim.getModel()._vGC.at(2), .0005));
   EXPECT_TRUE(almostEqual(footvRefML, sim.getModel()._vGC.at(15), .0005));
 }
+
+/*!
+ * Run CRBA, RNEA, Cqd, G, and ABA (with external forces) on the fixed-size
+ * Cheetah 3 model and check that they agree with FloatingBaseModel
+ */
+TEST(Dynamics, fixedSizeModelMatchesCheetah3) {
+  FloatingBaseModel<double> cheetahModel = buildCheetah3<double>().buildModel();
+  FixedQuadrupedModel<double>* fixedModel =
+      new FixedQuadrupedModel<double>(cheetahModel);
+
+  RotMat<double> rBody = coordinateRotation(CoordinateAxis::X, .123) *
+                         coordinateRotation(CoordinateAxis::Z, .232) *
+                         coordinateRotation(CoordinateAxis::Y, .111);
+  SVec<double> bodyVel;
+  bodyVel << 1, 2, 3, 4, 5, 6;
+  FBModelState<double> x;
+  DVec<double> q(12);
+  DVec<double> dq(12);
+  DVec<double> tau(12);
+  for (size_t i = 0; i < 12; i++) {
+    q[i] = i + 1;
+    dq[i] = (i + 1) * 2;
+    tau[i] = (i + 1) * -30.;
+  }
+  x.bodyOrientation = rotationMatrixToQuaternion(rBody.transpose());
+  x.bodyVelocity = bodyVel;
+  x.bodyPosition = Vec3<double>(6, 7, 8);
+  x.q = q;
+  x.qd = dq;
+
+  cheetahModel.setState(x);
+  fixedModel->setState(x);
+
+  DMat<double> H = cheetahModel.massMatrix();
+  DVec<double> Cqd = cheetahModel.generalizedCoriolisForce();
+  DVec<double> G = cheetahModel.generalizedGravityForce();
+  EXPECT_TRUE(almostEqual(H, DMat<double>(fixedModel->massMatrix()), 1e-9));
+  EXPECT_TRUE(almostEqual(
+      Cqd, DVec<double>(fixedModel->generalizedCoriolisForce()), 1e-9));
+  EXPECT_TRUE(almostEqual(
+      G, DVec<double>(fixedModel->generalizedGravityForce()), 1e-9));
+
+  FBModelStateDerivative<double> dx;
+  dx.dBodyVelocity << 455.5224, 62.1684, -70.56, -11.4505, 10.2354, -15.2394;
+  dx.qdd = DVec<double>(12);
+  for (size_t i = 0; i < 12; i++) dx.qdd[i] = 100. * i - 500.;
+  DVec<double> genForce = cheetahModel.inverseDynamics(dx);
+  EXPECT_TRUE(almostEqual(
+      genForce, DVec<double>(fixedModel->inverseDynamics(dx)), 1e-7));
+
+  // ABA with external forces
+  vectorAligned<SVec<double>> forces(18);
+  for (size_t i = 0; i < 18; i++) {
+    for (size_t j = 0; j < 6; j++) {
+      forces[i][j] = i + j + 1;
+    }
+  }
+  cheetahModel._externalForces = forces;
+  fixedModel->setExternalForces(forces);
+
+  FBModelStateDerivative<double> dxRef, dxFixed;
+  cheetahModel.runABA(tau, dxRef);
+  fixedModel->runABA(tau, dxFixed);
+
+  EXPECT_TRUE(almostEqual(dxRef.dBodyPosition, dxFixed.dBodyPosition, 1e-9));
+  EXPECT_TRUE(almostEqual(dxRef.dBodyVelocity, dxFixed.dBodyVelocity, 1e-6));
+  EXPECT_TRUE(almostEqual(dxRef.qdd, dxFixed.qdd, 1e-6));
+
+  delete fixedModel;
+}
+
+/*!
+ * Check the batched ABA and RNEA against FloatingBaseModel for a batch that is
+ * not a multiple of the lane width, run on one and several threads
+ */
+TEST(Dynamics, batchedDynamicsMatchesCheetah3) {
+  FloatingBaseModel<double> cheetahModel = buildCheetah3<double>().buildModel();
+  const size_t nStates = 11;
+
+  FBModelStateBatch<double> xBatch;
+  FBModelStateDerivativeBatch<double> dxBatch;
+  BatchArray<double> tauBatch(nStates, 12);
+  xBatch.resize(nStates, 12);
+  dxBatch.resize(nStates, 12);
+
+  for (size_t k = 0; k < nStates; k++) {
+    const double s = k;
+    RotMat<double> rBody = coordinateRotation(CoordinateAxis::X, .123 * s) *
+                           coordinateRotation(CoordinateAxis::Z, .232 - .1 * s) *
+                           coordinateRotation(CoordinateAxis::Y, .111 + .05 * s);
+    FBModelState<double> x;
+    x.bodyOrientation = rotationMatrixToQuaternion(rBody.transpose());
+    x.bodyPosition = Vec3<double>(6, 7, 8 + s);
+    x.bodyVelocity << 1, 2 - s, 3, 4, 5, 6 + .5 * s;
+    x.q = DVec<double>(12);
+    x.qd = DVec<double>(12);
+    FBModelStateDerivative<double> dx;
+    dx.dBodyVelocity << 455.5224, 62.1684, -70.56, -11.4505, 10.2354, -15.2394;
+    dx.dBodyVelocity *= (1. + .1 * s);
+    dx.qdd = DVec<double>(12);
+    for (size_t i = 0; i < 12; i++) {
+      x.q[i] = i + 1 + .3 * s;
+      x.qd[i] = (i + 1) * 2 - .7 * s;
+      dx.qdd[i] = 100. * i - 500. + 10. * s;
+      tauBatch(k, i) = (i + 1) * -30. + 5. * s;
+    }
+    xBatch.setState(k, x);
+    dxBatch.setDerivative(k, dx);
+  }
+
+  for (size_t nThreads : {1, 3}) {
+    BatchDynamicsEngine<double, 18> engine(cheetahModel, nThreads);
+    EXPECT_EQ(nThreads, engine.getNumThreads());
+
+    FBModelStateDerivativeBatch<double> dxOut;
+    BatchArray<double> genForce;
+    engine.runABA(xBatch, tauBatch, dxOut);
+    engine.inverseDynamics(xBatch, dxBatch, genForce);
+    ASSERT_EQ(nStates, dxOut.size());
+    ASSERT_EQ(nStates, (size_t)genForce.rows());
+
+    for (size_t k = 0; k < nStates; k++) {
+      FBModelState<double> x;
+      FBModelStateDerivative<double> dx, dxRef, dxBatchK;
+      xBatch.getState(k, x);
+      dxBatch.getDerivative(k, dx);
+      cheetahModel.setState(x);
+
+      DVec<double> genForceRef = cheetahModel.inverseDynamics(dx);
+      DVec<double> genForceK = genForce.row(k).transpose().matrix();
+      EXPECT_TRUE(almostEqual(genForceRef, genForceK, 1e-7));
+
+      DVec<double> tau = tauBatch.row(k).transpose().matrix();
+      cheetahModel.runABA(tau, dxRef);
+      dxOut.getDerivative(k, dxBatchK);
+      EXPECT_TRUE(
+          almostEqual(dxRef.dBodyPosition, dxBatchK.dBodyPosition, 1e-9));
+      EXPECT_TRUE(
+          almostEqual(dxRef.dBodyVelocity, dxBatchK.dBodyVelocity, 1e-6));
+      EXPECT_TRUE(almostEqual(dxRef.qdd, dxBatchK.qdd, 1e-6));
+    }
+  }
+}
+
+/*!
+ * Test state used for the derivative tests: arbitrary orientation, velocity
+ * and joint positions
+ */
+static FBModelState<double> derivativeTestState() {
+  RotMat<double> rBody = coordinateRotation(CoordinateAxis::X, .123) *
+                         coordinateRotation(CoordinateAxis::Z, .232) *
+                         coordinateRotation(CoordinateAxis::Y, .111);
+  FBModelState<double> x;
+  x.bodyOrientation = rotationMatrixToQuaternion(rBody.transpose());
+  x.bodyPosition = Vec3<double>(.1, .2, .3);
+  x.bodyVelocity << .4, -.5, .6, 1.1, -.2, .3;
+  x.q = DVec<double>(12);
+  x.qd = DVec<double>(12);
+  for (size_t i = 0; i < 12; i++) {
+    x.q[i] = .1 * (i + 1) - .4;
+    x.qd[i] = .5 * i - 2.;
+  }
+  return x;
+}
+
+/*!
+ * Perturb the state along generalized coordinate j (see
+ * FloatingBaseModel::inverseDynamicsDerivatives for the base coordinates)
+ */
+static FBModelState<double> perturbState(const FBModelState<double>& x,
+                                         size_t j, bool velocity, double h) {
+  FBModelState<double> xp = x;
+  if (velocity) {
+    if (j < 6)
+      xp.bodyVelocity[j] += h;
+    else
+      xp.qd[j - 6] += h;
+  } else if (j < 3) {
+    RotMat<double> R = quaternionToRotationMatrix(x.bodyOrientation);
+    RotMat<double> dR =
+        Eigen::AngleAxis<double>(-h, Vec3<double>::Unit(j)).toRotationMatrix();
+    xp.bodyOrientation = rotationMatrixToQuaternion(RotMat<double>(dR * R));
+  } else if (j < 6) {
+    RotMat<double> R = quaternionToRotationMatrix(x.bodyOrientation);
+    xp.bodyPosition += R.transpose() * Vec3<double>::Unit(j - 3) * h;
+  } else {
+    xp.q[j - 6] += h;
+  }
+  return xp;
+}
+
+/*!
+ * Check the analytical RNEA and forward dynamics derivatives of a model against
+ * central finite differences
+ */
+static void checkDynamicsDerivatives(FloatingBaseModel<double>& model) {
+  FBModelState<double> x = derivativeTestState();
+  const double h = 1e-6;
+
+  FBModelStateDerivative<double> dx;
+  dx.dBodyVelocity << 1.5, -2., .5, 3., -1., 2.;
+  dx.qdd = DVec<double>(12);
+  DVec<double> tau(12);
+  for (size_t i = 0; i < 12; i++) {
+    dx.qdd[i] = 3. * i - 15.;
+    tau[i] = 10. - 2. * i;
+  }
+
+  DMat<double> dtau_dq, dtau_dqd;
+  model.setState(x);
+  model.inverseDynamicsDerivatives(dx, dtau_dq, dtau_dqd);
+
+  FBModelStateDerivative<double> dxABA;
+  DMat<double> dqdd_dq, dqdd_dqd, dqdd_dtau;
+  model.forwardDynamicsDerivatives(tau, dxABA, dqdd_dq, dqdd_dqd, dqdd_dtau);
+
+  // the forward dynamics should match the ABA
+  FBModelStateDerivative<double> dxRef;
+  model.runABA(tau, dxRef);
+  EXPECT_TRUE(almostEqual(dxRef.dBodyVelocity, dxABA.dBodyVelocity, 1e-8));
+  EXPECT_TRUE(almostEqual(dxRef.qdd, dxABA.qdd, 1e-8));
+
+  auto stackedQdd = [](const FBModelStateDerivative<double>& d) {
+    DVec<double> v(18);
+    v << d.dBodyVelocity, d.qdd;
+    return v;
+  };
+
+  DMat<double> fdTauQ(18, 18), fdTauQd(18, 18);
+  DMat<double> fdQddQ(18, 18), fdQddQd(18, 18), fdQddTau(18, 12);
+  for (int velocity = 0; velocity < 2; velocity++) {
+    for (size_t j = 0; j < 18; j++) {
+      FBModelStateDerivative<double> dp, dm;
+      model.setState(perturbState(x, j, velocity, h));
+      DVec<double> tp = model.inverseDynamics(dx);
+      model.runABA(tau, dp);
+      model.setState(perturbState(x, j, velocity, -h));
+      DVec<double> tm = model.inverseDynamics(dx);
+      model.runABA(tau, dm);
+
+      DMat<double>& fdTau = velocity ? fdTauQd : fdTauQ;
+      DMat<double>& fdQdd = velocity ? fdQddQd : fdQddQ;
+      fdTau.col(j) = (tp - tm) / (2 * h);
+      fdQdd.col(j) = (stackedQdd(dp) - stackedQdd(dm)) / (2 * h);
+    }
+  }
+
+  model.setState(x);
+  for (size_t j = 0; j < 12; j++) {
+    FBModelStateDerivative<double> dp, dm;
+    DVec<double> tp = tau, tm = tau;
+    tp[j] += h;
+    tm[j] -= h;
+    model.runABA(tp, dp);
+    model.runABA(tm, dm);
+    fdQddTau.col(j) = (stackedQdd(dp) - stackedQdd(dm)) / (2 * h);
+  }
+
+  EXPECT_TRUE(almostEqual(fdTauQ, dtau_dq, 1e-5));
+  EXPECT_TRUE(almostEqual(fdTauQd, dtau_dqd, 1e-5));
+  EXPECT_TRUE(almostEqual(fdQddQ, dqdd_dq, 1e-4));
+  EXPECT_TRUE(almostEqual(fdQddQd, dqdd_dqd, 1e-4));
+  EXPECT_TRUE(almostEqual(fdQddTau, dqdd_dtau, 1e-4));
+}
+
+TEST(Dynamics, dynamicsDerivativesMatchFiniteDifference) {
+  FloatingBaseModel<double> cheetah3 = buildCheetah3<double>().buildModel();
+  checkDynamicsDerivatives(cheetah3);
+  FloatingBaseModel<double> miniCheetah =
+      buildMiniCheetah<double>().buildModel();
+  checkDynamicsDerivatives(miniCheetah);
+}
+
+/*!
+ * Check the branch-sparse mass matrix factorization and the solves built on it
+ * against dense linear algebra and the operational space algorithms
+ */
+TEST(Dynamics, sparseMassMatrixFactorization) {
+  FloatingBaseModel<double> model = buildCheetah3<double>().buildModel();
+  model.setState(derivativeTestState());
+
+  DMat<double> H = model.massMatrix();
+  model.factorMassMatrix();
+  DMat<double> LtL = model._L.transpose() * model._L;
+  EXPECT_TRUE(almostEqual(H, LtL, 1e-10));
+
+  // L only has entries for dofs on the same branch
+  for (size_t i = 6; i < 18; i++) {
+    for (size_t j = 6; j < i; j++) {
+      if (model._parents[i] != (int)j &&
+          model._parents[model._parents[i]] != (int)j) {
+        EXPECT_EQ(0., model._L(i, j));
+      }
+    }
+  }
+
+  DVec<double> rhs(18);
+  for (size_t i = 0; i < 18; i++) rhs[i] = 1. + i - .1 * i * i;
+  DVec<double> x = model.solveMassMatrix(rhs);
+  EXPECT_TRUE(almostEqual(DVec<double>(H * x), rhs, 1e-9));
+
+  DMat<double> Hinv = H.inverse();
+  EXPECT_TRUE(almostEqual(Hinv, model.massMatrixInverse(), 1e-9));
+
+  // contact inertia of a foot, compared to the force propagator algorithm
+  model.contactJacobians();
+  size_t gc = model._footIndicesGC.at(0);
+  DMat<double> J = model._Jc[gc];
+  DMat<double> lambdaInv = model.inverseOperationalSpaceInertia(J);
+  EXPECT_TRUE(almostEqual(DMat<double>(J * Hinv * J.transpose()), lambdaInv,
+                          1e-9));
+
+  DMat<double> HinvJt = model.solveMassMatrix(DMat<double>(J.transpose()));
+  for (size_t k = 0; k < 3; k++) {
+    DVec<double> dqdd;
+    double li = model.applyTestForce(gc, Vec3<double>::Unit(k), dqdd);
+    EXPECT_NEAR(li, lambdaInv(k, k), 1e-9);
+    EXPECT_TRUE(almostEqual(dqdd, DVec<double>(HinvJt.col(k)), 1e-9));
+  }
+}
+
+/*!
+ * Check that the out-parameter versions of the dynamics algorithms match the
+ * value-returning versions, and that once the output buffers are sized the
+ * dynamics path used by the simulator and controllers does not touch the heap.
+ * The allocation check needs glibc.
+ */
+TEST(Dynamics, dynamicsPathDoesNotAllocate) {
+  FloatingBaseModel<double> model = buildCheetah3<double>().buildModel();
+  FixedQuadrupedModel<double> fixedModel(model);
+  FBModelState<double> x = derivativeTestState();
+  size_t gc = model._footIndicesGC.at(0);
+
+  FBModelStateDerivative<double> dx;
+  dx.dBodyVelocity << .1, .2, -.3, .4, .5, -6.;
+  dx.qdd = DVec<double>(12);
+  DVec<double> tau(12);
+  for (size_t i = 0; i < 12; i++) {
+    dx.qdd[i] = 2. - .3 * i;
+    tau[i] = .7 * i - 4.;
+  }
+  D6Mat<double> directions = D6Mat<double>::Zero(6, 3);
+  directions.bottomRows<3>().setIdentity();
+
+  DMat<double> H, LambdaInv, Jc, opspInv;
+  DVec<double> G, Cqd, genForce, qddTest, Hinvf;
+  FBModelStateDerivative<double> dstate, dstateTest, dstateFixed;
+  dstateTest.qdd = DVec<double>(12);
+
+  auto tick = [&]() {
+    model.setState(x);
+    model.contactJacobians();
+    model.massMatrix(H);
+    model.generalizedGravityForce(G);
+    model.generalizedCoriolisForce(Cqd);
+    model.inverseDynamics(dx, genForce);
+    model.runABA(tau, dstate);
+    model.invContactInertia(gc, directions, LambdaInv);
+    model.applyTestForce(gc, Vec3<double>(1, 2, 3), qddTest);
+    model.applyTestForce(gc, Vec3<double>(1, 2, 3), dstateTest);
+    model.massMatrixInverse();
+    model.solveMassMatrix(genForce, Hinvf);
+    Jc = model._Jc[gc];
+    model.inverseOperationalSpaceInertia(Jc, opspInv);
+
+    fixedModel.setState(x);
+    fixedModel.massMatrix();
+    fixedModel.inverseDynamics(dx);
+    fixedModel.runABA(tau, dstateFixed);
+  };
+
+  tick();  // sizes the output buffers and scratch space
+  AllocationCounter counter;
+  tick();
+  uint64_t allocations = counter.stop();
+
+  model.setState(x);
+  EXPECT_TRUE(almostEqual(H, model.massMatrix(), 1e-12));
+  EXPECT_TRUE(almostEqual(G, model.generalizedGravityForce(), 1e-12));
+  EXPECT_TRUE(almostEqual(Cqd, model.generalizedCoriolisForce(), 1e-12));
+  EXPECT_TRUE(almostEqual(genForce, model.inverseDynamics(dx), 1e-12));
+  EXPECT_TRUE(
+      almostEqual(LambdaInv, model.invContactInertia(gc, directions), 1e-9));
+  EXPECT_TRUE(almostEqual(LambdaInv, opspInv, 1e-9));
+  EXPECT_TRUE(almostEqual(Hinvf, model.solveMassMatrix(genForce), 1e-12));
+  EXPECT_TRUE(almostEqual(dstateTest.qdd, DVec<double>(qddTest.tail(12)), 1e-9));
+
+  if (!AllocationCounter::hooksInstalled()) {
+    GTEST_SKIP() << "heap allocations are only counted with glibc";
+  }
+  EXPECT_EQ(0u, allocations);
+}
+
+/*!
+ * Drop the Cheetah 3 onto a plane with its feet slightly in the ground and
+ * check that the impulse solver stops the feet going further into the ground
+ * and keeps the forces inside the friction cones.  Solving the same step again
+ * is warm started from the first solution and should converge in a few
+ * sweeps without allocating.
+ */
+TEST(Dynamics, contactImpulseSolver) {
+  FloatingBaseModel<double> model = buildCheetah3<double>().buildModel();
+  const double mu = 0.4, dt = 0.001;
+  CollisionPlane<double> ground(mu, 0., 0.);
+  ContactImpulse<double> contact(&model);
+  contact.AddCollision(&ground);
+  contact.UpdateExternalForces(0., 0., dt);
+
+  FBModelState<double> x0;
+  x0.bodyOrientation = rotationMatrixToQuaternion(
+      coordinateRotation(CoordinateAxis::X, .05).transpose());
+  x0.bodyPosition.setZero();
+  x0.bodyVelocity << .1, -.2, .3, .5, .2, -1.;
+  x0.q = DVec<double>::Zero(12);
+  x0.qd = DVec<double>::Zero(12);
+  for (size_t leg = 0; leg < 4; leg++) {
+    x0.q[3 * leg + 1] = -.8;
+    x0.q[3 * leg + 2] = 1.6;
+  }
+  model.setState(x0);
+  model.forwardKinematics();
+  double lowest = 0;
+  for (size_t foot : model._footIndicesGC) {
+    lowest = std::min(lowest, model._pGC.at(foot)[2]);
+  }
+  x0.bodyPosition[2] = -.005 - lowest;  // lowest foot is 5 mm in the ground
+
+  FBModelState<double> x = x0;
+  model.setState(x);
+  contact.UpdateQdot(x);
+  size_t coldIterations = contact.getIterations();
+  EXPECT_GT(coldIterations, 1u);
+
+  model.setState(x);
+  model.forwardKinematics();
+  size_t nInContact = 0;
+  for (size_t gc = 0; gc < model._nGroundContact; gc++) {
+    if (model._pGC.at(gc)[2] >= 0) continue;
+    nInContact++;
+    Vec3<double> f = contact.getGCForce(gc);
+    EXPECT_GE(model._vGC.at(gc)[2], -1e-5);
+    EXPECT_GE(f[2], 0.);
+    EXPECT_LE(f.head<2>().norm(), mu * f[2] + 1e-6);
+  }
+  EXPECT_GT(nInContact, 0u);
+
+  // Same state again: warm started from the first solution
+  x = x0;
+  model.setState(x);
+  AllocationCounter counter;
+  contact.UpdateQdot(x);
+  uint64_t allocations = counter.stop();
+  EXPECT_LT(contact.getIterations(), coldIterations);
+  EXPECT_LT(contact.getResidual(), 1e-6);
+
+  if (AllocationCounter::hooksInstalled()) {
+    EXPECT_EQ(0u, allocations);
+  }
+}
+
+/*!
+ * Let a Mini Cheetah lying on its belly slowly move its legs against the
+ * ground for a few seconds with joint PD control.  Friction with sliding
+ * contacts must not add energy, so the robot should stay on the ground.
+ */
+TEST(Dynamics, contactImpulseSlidingLegs) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, false);
+  sim.addCollisionPlane(0.4, 0., 0.);
+
+  const double qStart[12] = {-0.7, 1.,  2.715,  0.7, 1.,  2.715,
+                             -0.7, -1., -2.715, 0.7, -1., -2.715};
+  const double qEnd[12] = {-0.6, -1., 2.7, 0.6, -1., 2.7,
+                           -0.6, -1., 2.7, 0.6, -1., 2.7};
+  FBModelState<double> x0;
+  x0.bodyOrientation = ori::rpyToQuat(Vec3<double>(0, 0, 1));
+  x0.bodyPosition = Vec3<double>(0, 0, 0.05);
+  x0.bodyVelocity.setZero();
+  x0.q = DVec<double>::Zero(12);
+  x0.qd = DVec<double>::Zero(12);
+  for (size_t i = 0; i < 12; i++) x0.q[i] = qStart[i];
+  sim.setState(x0);
+
+  const double dt = 0.001;
+  DVec<double> tau(12);
+  double highest = 0;
+  for (size_t step = 0; step < 3000; step++) {
+    double s = std::min(1., step * dt / 3.);
+    const FBModelState<double>& x = sim.getState();
+    for (size_t i = 0; i < 12; i++) {
+      double qDes = qStart[i] + s * (qEnd[i] - qStart[i]);
+      tau[i] = std::max(-18., std::min(18., 5. * (qDes - x.q[i]) -
+                                                 0.1 * x.qd[i]));
+    }
+    sim.step(dt, tau, 5e5, 5e3);
+    highest = std::max(highest, sim.getState().bodyPosition[2]);
+  }
+  EXPECT_LT(highest, 0.1);
+  EXPECT_LT(sim.getState().qd.norm(), 20.);
+}
+
+/*!
+ * Simulate Cheetah 3 tumbling through the air with each integrator and
+ * compare against semi-implicit Euler with a very small step.  Then drop it
+ * on the ground with the adaptive integrator, which should only substep once
+ * the feet touch down.
+ */
+TEST(Dynamics, simulatorIntegrators) {
+  FloatingBaseModel<double> model = buildCheetah3<double>().buildModel();
+  RobotHomingInfo<double> noHoming{};
+
+  FBModelState<double> x0;
+  x0.bodyOrientation = rotationMatrixToQuaternion(
+      coordinateRotation(CoordinateAxis::Y, .3).transpose());
+  x0.bodyPosition = Vec3<double>(0, 0, 3);
+  x0.bodyVelocity << 2, -1, 3, .5, 0, 2;
+  x0.q = DVec<double>(12);
+  x0.qd = DVec<double>(12);
+  DVec<double> tau(12);
+  for (size_t i = 0; i < 12; i++) {
+    x0.q[i] = .1 * i - .5;
+    x0.qd[i] = .3 * i - 1.;
+    tau[i] = 2. - .4 * i;
+  }
+
+  auto simulate = [&](DynamicsIntegrator integrator, double dt, double time) {
+    DynamicsSimulator<double> sim(model, true);
+    sim.setHoming(noHoming);
+    sim.setIntegrator(integrator);
+    sim.setState(x0);
+    size_t nSteps = (size_t)std::round(time / dt);
+    for (size_t i = 0; i < nSteps; i++) {
+      sim.step(dt, tau, 5e5, 5e3);
+    }
+    EXPECT_NEAR(1. / dt, sim.getStepsPerSimSecond(), 1e-6 / dt);
+    return sim.getState();
+  };
+
+  auto error = [&](const FBModelState<double>& a,
+                   const FBModelState<double>& b) {
+    return (a.bodyPosition - b.bodyPosition).norm() +
+           (a.bodyOrientation - b.bodyOrientation).norm() +
+           (a.bodyVelocity - b.bodyVelocity).norm() + (a.q - b.q).norm() +
+           (a.qd - b.qd).norm();
+  };
+
+  const double time = .2, dt = .005;
+  FBModelState<double> reference =
+      simulate(DynamicsIntegrator::SEMI_IMPLICIT_EULER, 1e-5, time);
+  double eulerError = error(
+      reference, simulate(DynamicsIntegrator::SEMI_IMPLICIT_EULER, dt, time));
+  double symplecticError =
+      error(reference, simulate(DynamicsIntegrator::SYMPLECTIC, dt, time));
+  double rk4Error =
+      error(reference, simulate(DynamicsIntegrator::RK4, dt, time));
+  EXPECT_LT(symplecticError, eulerError / 4);
+  EXPECT_LT(rk4Error, eulerError / 20);
+
+  // drop from 20 cm onto the ground
+  DynamicsSimulator<double> sim(model, false);
+  sim.addCollisionPlane(.7, 0., 0.);
+  sim.setHoming(noHoming);
+  sim.setIntegrator(DynamicsIntegrator::ADAPTIVE, .0005);
+  FBModelState<double> x = x0;
+  x.bodyOrientation = Quat<double>(1, 0, 0, 0);
+  x.bodyVelocity.setZero();
+  x.qd.setZero();
+  for (size_t leg = 0; leg < 4; leg++) {
+    x.q.segment<3>(3 * leg) = Vec3<double>(0, -.8, 1.6);
+  }
+  model.setState(x);
+  model.forwardKinematics();
+  double lowest = 0;
+  for (size_t gc = 0; gc < model._nGroundContact; gc++) {
+    lowest = std::min(lowest, model._pGC.at(gc)[2] - x.bodyPosition[2]);
+  }
+  x.bodyPosition = Vec3<double>(0, 0, .2 - lowest);
+  sim.setState(x);
+  tau.setZero();
+
+  const double bigDt = .005;
+  size_t step = 0;
+  while (sim.getState().bodyPosition[2] + lowest > .05) {
+    sim.step(bigDt, tau, 0, 0);
+    ASSERT_LT(step++, 100u);
+  }
+  EXPECT_NEAR(1. / bigDt, sim.getStepsPerSimSecond(), 1e-6);
+
+  // substeps of .0005 s while the feet are on the ground
+  sim.resetStepCounter();
+  for (size_t i = 0; i < 40; i++) {
+    sim.step(bigDt, tau, 0, 0);
+  }
+  EXPECT_GT(sim.getStepsPerSimSecond(), 5. / bigDt);
+  for (size_t gc = 0; gc < model._nGroundContact; gc++) {
+    EXPECT_GT(sim.getModel()._pGC.at(gc)[2], -.01);
+  }
+}
@@ -78,4 +78,55 @@ TEST(SharedMemory, MemoryAndSemaphore) {
   sharedObject.get()->semaphore.decrement();  // wait until child writes
   EXPECT_TRUE(valueFromChildSuccess == sharedObject.get()->value);
   sharedObject.closeNew();
-}
\ No newline at end of file
+}
+
+namespace SharedMemoryTestNamespace {
+struct PingPongType {
+  u32 count;
+  SharedMemoryFutex ping, pong;
+};
+}  // namespace SharedMemoryTestNamespace
+
+// pass a counter back and forth between processes with the spinning futex
+TEST(SharedMemory, FutexPingPong) {
+  SharedMemoryObject<PingPongType> sharedObject;
+  std::string memoryName = "/shared-memory-futex-test";
+  sharedObject.createNew(memoryName, true);
+  sharedObject().ping.init(0);
+  sharedObject().pong.init(0);
+
+  // nothing has been posted yet
+  EXPECT_FALSE(sharedObject().pong.tryDecrement());
+  EXPECT_FALSE(sharedObject().pong.decrementTimeout(0, 10000000));
+
+  const u32 rounds = 1000;
+  pid_t pid = fork();
+  if (!pid) {
+    SharedMemoryObject<PingPongType> childView;
+    childView.attach(memoryName);
+    for (u32 i = 0; i < rounds; i++) {
+      childView().ping.decrement();
+      childView().count++;
+      childView().pong.increment();
+    }
+    childView.detach();
+    exit(0);
+  }
+
+  bool allReturned = true;
+  for (u32 i = 0; i < rounds; i++) {
+    sharedObject().count++;
+    sharedObject().ping.increment();
+    allReturned &= sharedObject().pong.decrementTimeout(1, 0);
+  }
+  EXPECT_TRUE(allReturned);
+  EXPECT_EQ(2 * rounds, sharedObject().count);
+  EXPECT_FALSE(sharedObject().pong.tryDecrement());
+
+  // a count posted before waiting isn't lost
+  sharedObject().pong.increment();
+  sharedObject().pong.increment();
+  EXPECT_TRUE(sharedObject().pong.tryDecrement());
+  EXPECT_TRUE(sharedObject().pong.decrementTimeout(0, 1000));
+  sharedObject.closeNew();
+}
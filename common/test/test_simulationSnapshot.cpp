@@ -0,0 +1,207 @@
+/*! @file test_simulationSnapshot.cpp
+ *  @brief Test saving and restoring simulator state
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "ControlParameters/SimulatorParameters.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/MiniCheetah.h"
+#include "SimUtilities/QuadrupedSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
+#include "Utilities/utilities.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+/*!
+ * Mini Cheetah lying on the ground, moving its legs with joint PD control
+ */
+static void stepLegs(DynamicsSimulator<double>& sim, size_t nSteps) {
+  DVec<double> tau(12);
+  for (size_t step = 0; step < nSteps; step++) {
+    const FBModelState<double>& x = sim.getState();
+    for (size_t i = 0; i < 12; i++) {
+      tau[i] = 5. * ((i % 3 == 1 ? -1. : 0.5) - x.q[i]) - 0.1 * x.qd[i];
+    }
+    sim.step(0.001, tau, 5e5, 5e3);
+  }
+}
+
+static FBModelState<double> lyingDown() {
+  const double q0[12] = {-0.7, 1.,  2.715,  0.7, 1.,  2.715,
+                         -0.7, -1., -2.715, 0.7, -1., -2.715};
+  FBModelState<double> x0;
+  x0.bodyOrientation = ori::rpyToQuat(Vec3<double>(0, 0, 1));
+  x0.bodyPosition = Vec3<double>(0, 0, 0.05);
+  x0.bodyVelocity.setZero();
+  x0.q = DVec<double>::Zero(12);
+  x0.qd = DVec<double>::Zero(12);
+  for (size_t i = 0; i < 12; i++) x0.q[i] = q0[i];
+  return x0;
+}
+
+/*!
+ * A restored simulator continues exactly like the one the state was saved
+ * from, for both contact models and with integrator history
+ */
+TEST(SimulationSnapshot, restoredSimulatorMatches) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  FloatingBaseModel<double> forkModel = buildMiniCheetah<double>().buildModel();
+  RobotHomingInfo<double> noHoming{};
+
+  for (bool springDamper : {false, true}) {
+    DynamicsSimulator<double> sim(model, springDamper);
+    DynamicsSimulator<double> fork(forkModel, springDamper);
+    for (auto* s : {&sim, &fork}) {
+      s->addCollisionPlane(0.7, 0., 0.);
+      s->setHoming(noHoming);
+      s->setIntegrator(DynamicsIntegrator::SYMPLECTIC);
+    }
+    sim.setState(lyingDown());
+    fork.setState(lyingDown());
+    stepLegs(sim, 500);
+
+    DynamicsSimulatorState<double> saved;
+    sim.getSimulatorState(saved);
+    EXPECT_EQ((springDamper ? 2 : 3) * model._nGroundContact,
+              (size_t)saved.contactState.rows());
+    EXPECT_GT(saved.contactState.norm(), 0.);
+    fork.setSimulatorState(saved);
+
+    stepLegs(sim, 200);
+    stepLegs(fork, 200);
+    EXPECT_EQ(sim.getState().bodyPosition, fork.getState().bodyPosition);
+    EXPECT_EQ(sim.getState().q, fork.getState().q);
+    EXPECT_EQ(sim.getState().qd, fork.getState().qd);
+  }
+}
+
+// too big for the stack
+static SimulatorToRobotMessage toRobot;
+static RobotToSimulatorMessage toSimulator;
+
+/*!
+ * Step a simulated Mini Cheetah with a joint PD controller on the spine
+ * boards, the way the simulator does
+ */
+static void stepQuadruped(QuadrupedSimulator& sim, double& time,
+                          size_t nSteps) {
+  const double dt = 0.001;
+  for (size_t step = 0; step < nSteps; step++) {
+    sim.lowLevelControl();
+    if (step % 2 == 0) {
+      sim.writeSensorData(toRobot);
+      SpiCommand& cmd = toSimulator.spiCommand;
+      memset(&cmd, 0, sizeof(cmd));
+      for (int leg = 0; leg < 4; leg++) {
+        cmd.q_des_hip[leg] = -0.8f + 0.1f * toRobot.spiData.q_abad[leg];
+        cmd.q_des_knee[leg] = 1.6f;
+        cmd.kp_abad[leg] = cmd.kp_hip[leg] = cmd.kp_knee[leg] = 20.f;
+        cmd.kd_abad[leg] = cmd.kd_hip[leg] = cmd.kd_knee[leg] = 0.5f;
+        cmd.flags[leg] = 1;
+      }
+      sim.readCommands(toSimulator);
+    }
+    sim.updateActuators(dt);
+    time += dt;
+    sim.integrate(time, dt);
+  }
+}
+
+/*!
+ * A QuadrupedSimulator restored from a snapshot continues exactly like the
+ * one the snapshot was taken from, boards and motor temperatures included
+ */
+TEST(SimulationSnapshot, restoredQuadrupedMatches) {
+  SimulatorControlParameters simParams;
+  simParams.initializeFromYamlFile(getConfigDirectoryPath() +
+                                   SIMULATOR_DEFAULT_PARAMETERS);
+  simParams.motor_thermal_model = 1;
+  QuadrupedSimulator sim(RobotType::MINI_CHEETAH, simParams,
+                         Vec3<double>(1, 2, 0), 3);
+  QuadrupedSimulator fork(RobotType::MINI_CHEETAH, simParams,
+                          Vec3<double>(1, 2, 0), 4);
+  for (auto* s : {&sim, &fork}) {
+    s->getSimulator().addCollisionPlane(0.7, 0., 0.);
+    FBModelState<double> x0 = lyingDown();
+    x0.bodyPosition += s->getOffset();
+    s->setState(x0);
+  }
+
+  double time = 0;
+  stepQuadruped(sim, time, 500);
+  SimulationSnapshot snapshot = sim.snapshot(time, time, time);
+  fork.restore(snapshot);
+  EXPECT_EQ(sim.getHighLevelIterations(), fork.getHighLevelIterations());
+
+  double forkTime = time;
+  stepQuadruped(sim, time, 200);
+  stepQuadruped(fork, forkTime, 200);
+  EXPECT_EQ(sim.getState().bodyPosition, fork.getState().bodyPosition);
+  EXPECT_EQ(sim.getState().q, fork.getState().q);
+  EXPECT_EQ(sim.getState().qd, fork.getState().qd);
+  EXPECT_EQ(sim.getTorques(), fork.getTorques());
+
+  // the controller sees the robot relative to where it started
+  sim.writeSensorData(toRobot);
+  EXPECT_EQ(sim.getState().bodyPosition - sim.getOffset(),
+            toRobot.cheaterState.position);
+
+  SimulationSnapshot cheetah3 = snapshot;
+  cheetah3.robot = RobotType::CHEETAH_3;
+  EXPECT_THROW(fork.restore(cheetah3), std::runtime_error);
+}
+
+/*!
+ * A snapshot written to a file reads back the same
+ */
+TEST(SimulationSnapshot, fileRoundTrip) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, true);
+  sim.addCollisionPlane(0.7, 0., 0.);
+  sim.setState(lyingDown());
+  stepLegs(sim, 100);
+
+  SimulationSnapshot snapshot;
+  snapshot.robot = RobotType::CHEETAH_3;
+  snapshot.currentSimTime = 1.25;
+  snapshot.timeOfNextHighLevelControl = 1.252;
+  snapshot.highLevelIterations = 625;
+  sim.getSimulatorState(snapshot.dynamics);
+  snapshot.imuNoise.seed(7);
+  snapshot.imuNoise.discard(100);
+  memset(&snapshot.spiData, 0, sizeof(snapshot.spiData));
+  snapshot.spiData.q_knee[2] = -1.5f;
+  snapshot.tiBoardData[3].tau_des[1] = 4.f;
+  for (int i = 0; i < 12; i++) snapshot.motorTemperature[i] = 25. + i;
+
+  std::string fileName = "test-simulation.snapshot";
+  snapshot.save(fileName);
+  SimulationSnapshot loaded;
+  loaded.load(fileName);
+  remove(fileName.c_str());
+
+  EXPECT_TRUE(loaded.robot == RobotType::CHEETAH_3);
+  EXPECT_EQ(snapshot.currentSimTime, loaded.currentSimTime);
+  EXPECT_EQ(snapshot.timeOfNextHighLevelControl,
+            loaded.timeOfNextHighLevelControl);
+  EXPECT_EQ(snapshot.highLevelIterations, loaded.highLevelIterations);
+  EXPECT_EQ(snapshot.dynamics.state.bodyOrientation,
+            loaded.dynamics.state.bodyOrientation);
+  EXPECT_EQ(snapshot.dynamics.state.q, loaded.dynamics.state.q);
+  EXPECT_EQ(snapshot.dynamics.dstate.qdd, loaded.dynamics.dstate.qdd);
+  EXPECT_EQ(snapshot.dynamics.contactState, loaded.dynamics.contactState);
+  EXPECT_TRUE(snapshot.imuNoise == loaded.imuNoise);
+  EXPECT_EQ(-1.5f, loaded.spiData.q_knee[2]);
+  EXPECT_EQ(4.f, loaded.tiBoardData[3].tau_des[1]);
+  EXPECT_EQ(36., loaded.motorTemperature[11]);
+
+  // not a snapshot
+  FILE* f = fopen(fileName.c_str(), "w");
+  fprintf(f, "not a snapshot\n");
+  fclose(f);
+  EXPECT_THROW(loaded.load(fileName), std::runtime_error);
+  remove(fileName.c_str());
+}
@@ -177,6 +177,73 @@ TEST(Spatial, invert_sxform) {
   EXPECT_TRUE(almostEqual(Xi_ref, Xi, .00001));
 }
 
+/*!
+ * Check the compact SpatialTransform against the equivalent 6x6 transforms
+ */
+TEST(Spatial, compactSpatialTransform) {
+  RotMat<double> R1 = coordinateRotation(CoordinateAxis::X, 1.0) *
+                      coordinateRotation(CoordinateAxis::Y, 2.0) *
+                      coordinateRotation(CoordinateAxis::Z, 3.0);
+  RotMat<double> R2 = coordinateRotation(CoordinateAxis::Z, -.4) *
+                      coordinateRotation(CoordinateAxis::X, .7);
+  Mat6<double> X1 = createSXform(R1, Vec3<double>(4, 5, 6));
+  Mat6<double> X2 = createSXform(R2, Vec3<double>(-.3, .2, 1.1));
+  SpatialTransform<double> C1(X1), C2(X2);
+  SVec<double> v;
+  v << 1, -2, 3, -4, 5, -6;
+
+  EXPECT_TRUE(almostEqual(X1, C1.toMatrix(), 1e-12));
+  EXPECT_TRUE(almostEqual(SVec<double>(X1 * v), C1.apply(v), 1e-12));
+  EXPECT_TRUE(almostEqual(SVec<double>(X1.transpose() * v),
+                          C1.applyTranspose(v), 1e-12));
+  EXPECT_TRUE(
+      almostEqual(SVec<double>(X1.inverse() * v), C1.applyInverse(v), 1e-10));
+  EXPECT_TRUE(almostEqual(Mat6<double>(X1 * X2), (C1 * C2).toMatrix(), 1e-12));
+  EXPECT_TRUE(almostEqual(invertSXform(X1), C1.inverse().toMatrix(), 1e-12));
+  EXPECT_TRUE(almostEqual(sXFormPoint(X1, Vec3<double>(1, 2, 3)),
+                          C1.transformPoint(Vec3<double>(1, 2, 3)), 1e-12));
+  EXPECT_TRUE(
+      almostEqual(jointXform(JointType::Revolute, CoordinateAxis::Y, .3),
+                  jointTransform(JointType::Revolute, CoordinateAxis::Y, .3)
+                      .toMatrix(),
+                  1e-12));
+  EXPECT_TRUE(
+      almostEqual(jointXform(JointType::Prismatic, CoordinateAxis::Z, .3),
+                  jointTransform(JointType::Prismatic, CoordinateAxis::Z, .3)
+                      .toMatrix(),
+                  1e-12));
+}
+
+/*!
+ * Check the 10 parameter RigidBodyInertia against SpatialInertia
+ */
+TEST(Spatial, compactRigidBodyInertia) {
+  Mat3<double> I;
+  I << 1, .2, .3, .2, 4, .5, .3, .5, 6;
+  SpatialInertia<double> IS(42, Vec3<double>(1, -2, 3), I);
+  RigidBodyInertia<double> IR(IS);
+  EXPECT_TRUE(almostEqual(IS.getMatrix(), IR.toMatrix(), 1e-12));
+  EXPECT_TRUE(almostEqual(IS.asMassPropertyVector(), IR.asMassPropertyVector(),
+                          1e-12));
+
+  SVec<double> v;
+  v << 1, -2, 3, -4, 5, -6;
+  SVec<double> Iv = IS.getMatrix() * v;
+  EXPECT_TRUE(almostEqual(Iv, SVec<double>(IR * v), 1e-10));
+
+  RotMat<double> R = coordinateRotation(CoordinateAxis::X, 1.0) *
+                     coordinateRotation(CoordinateAxis::Y, 2.0);
+  Mat6<double> X = createSXform(R, Vec3<double>(4, 5, 6));
+  Mat6<double> ref = X.transpose() * IS.getMatrix() * X;
+  EXPECT_TRUE(almostEqual(
+      ref, IR.transform(SpatialTransform<double>(X)).toMatrix(), 1e-9));
+
+  RigidBodyInertia<double> sum = IR;
+  sum += IR.transform(SpatialTransform<double>(X));
+  EXPECT_TRUE(almostEqual(Mat6<double>(IS.getMatrix() + ref), sum.toMatrix(),
+                          1e-9));
+}
+
 /*!
  * Test the jointXform and jointMotionSubspace functions, which are similar to
  * jcalc
@@ -0,0 +1,82 @@
+/*! @file test_spineBoard.cpp
+ *  @brief Test the batched spine board control against the single board code
+ */
+
+#include <cmath>
+#include <random>
+
+#include "SimUtilities/SpineBoard.h"
+
+#include "gtest/gtest.h"
+
+TEST(SpineBoard, runAllMatchesRun) {
+  SpiCommand cmd;
+  SpiData data;
+  SpineBoard single[4], batch[4];
+  for (int leg = 0; leg < 4; leg++) {
+    for (SpineBoard* board : {&single[leg], &batch[leg]}) {
+      board->init(leg % 2 ? 1.f : -1.f, leg);
+      board->cmd = &cmd;
+      board->data = &data;
+    }
+  }
+
+  // positions past the softstops and gains big enough to hit the limits
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> q(-7, 7), qd(-30, 30), kp(0, 40),
+      kd(0, 2), ff(-10, 10);
+  for (int trial = 0; trial < 1000; trial++) {
+    for (int i = 0; i < 4; i++) {
+      data.q_abad[i] = q(rng) / 3;
+      data.q_hip[i] = q(rng);
+      data.q_knee[i] = q(rng);
+      data.qd_abad[i] = qd(rng);
+      data.qd_hip[i] = qd(rng);
+      data.qd_knee[i] = qd(rng);
+      cmd.q_des_abad[i] = q(rng) / 3;
+      cmd.q_des_hip[i] = q(rng);
+      cmd.q_des_knee[i] = q(rng);
+      cmd.qd_des_abad[i] = qd(rng);
+      cmd.qd_des_hip[i] = qd(rng);
+      cmd.qd_des_knee[i] = qd(rng);
+      cmd.kp_abad[i] = kp(rng);
+      cmd.kp_hip[i] = kp(rng);
+      cmd.kp_knee[i] = kp(rng);
+      cmd.kd_abad[i] = kd(rng);
+      cmd.kd_hip[i] = kd(rng);
+      cmd.kd_knee[i] = kd(rng);
+      cmd.tau_abad_ff[i] = ff(rng);
+      cmd.tau_hip_ff[i] = ff(rng);
+      cmd.tau_knee_ff[i] = ff(rng);
+      cmd.flags[i] = (trial + i) % 4;
+    }
+
+    for (auto& board : single) board.run();
+    SpineBoard::runAll(batch);
+    // the compiler may contract the batched and single board arithmetic
+    // into FMAs differently, so they only match up to rounding
+    for (int leg = 0; leg < 4; leg++) {
+      for (int joint = 0; joint < 3; joint++) {
+        float tau = single[leg].torque_out[joint];
+        EXPECT_NEAR(tau, batch[leg].torque_out[joint],
+                    1e-5f * std::fabs(tau) + 1e-6f);
+      }
+      EXPECT_EQ(single[leg].getIterationCount(),
+                batch[leg].getIterationCount());
+    }
+  }
+}
+
+TEST(SpineBoard, runAllFallsBack) {
+  // boards without data run one at a time, which zeros the torque
+  SpineBoard boards[4];
+  for (int leg = 0; leg < 4; leg++) {
+    boards[leg].init(1.f, leg);
+    boards[leg].torque_out[0] = 1.f;
+  }
+  SpineBoard::runAll(boards);
+  for (auto& board : boards) {
+    EXPECT_EQ(0.f, board.torque_out[0]);
+    EXPECT_EQ(1, board.getIterationCount());
+  }
+}
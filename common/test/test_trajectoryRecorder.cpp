@@ -0,0 +1,95 @@
+/*! @file test_trajectoryRecorder.cpp
+ *  @brief Test recording and replaying simulator trajectories
+ */
+
+#include <cstdio>
+
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/MiniCheetah.h"
+#include "SimUtilities/TrajectoryRecorder.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+/*!
+ * Record a Mini Cheetah falling onto the ground, then read it back
+ */
+TEST(TrajectoryRecorder, recordAndReplay) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, false);
+  sim.addCollisionPlane(0.7, 0., 0.);
+  FBModelState<double> x0;
+  x0.bodyOrientation = ori::rpyToQuat(Vec3<double>(0.1, 0, 1));
+  x0.bodyPosition = Vec3<double>(0, 0, 0.3);
+  x0.bodyVelocity.setZero();
+  x0.q = DVec<double>::Zero(12);
+  x0.qd = DVec<double>::Zero(12);
+  sim.setState(x0);
+
+  const double dt = 0.001;
+  const size_t nSteps = 500;
+  std::string fileName = "test-trajectory.traj";
+  size_t nGC = model._nGroundContact;
+  DVec<double> tau(12);
+  vectorAligned<FBModelState<double>> states;
+  std::vector<DVec<double>> torques;
+  vectorAligned<Vec3<double>> forces;
+
+  {
+    TrajectoryRecorder recorder;
+    // start small so the file has to grow
+    recorder.open(fileName, 12, nGC, dt, 16);
+    for (size_t i = 0; i < nSteps; i++) {
+      for (size_t j = 0; j < 12; j++) tau[j] = std::sin(0.01 * i + j);
+      sim.step(dt, tau, 5e5, 5e3);
+      recorder.record((i + 1) * dt, sim, tau);
+      states.push_back(sim.getState());
+      torques.push_back(tau);
+      forces.push_back(sim.getContactForce(nGC - 1));
+    }
+    EXPECT_EQ(nSteps, recorder.size());
+    EXPECT_EQ(199u, recorder.findRecord(0.2));
+
+    // going back in time drops the later records
+    recorder.record(0.5005, sim, tau);
+    recorder.truncate(0.5);
+    EXPECT_EQ(nSteps, recorder.size());
+  }
+
+  TrajectoryReplayer replayer;
+  replayer.open(fileName);
+  ASSERT_EQ(nSteps, replayer.size());
+  EXPECT_EQ(12u, replayer.getNumJoints());
+  EXPECT_EQ(nGC, replayer.getNumContacts());
+
+  EXPECT_EQ(0u, replayer.findRecord(-1.));
+  EXPECT_EQ(nSteps - 1, replayer.findRecord(10.));
+  for (size_t i = 0; i < nSteps; i += 37) {
+    EXPECT_EQ(i, replayer.findRecord((i + 1.5) * dt));
+  }
+
+  FBModelState<double> state;
+  DVec<double> recordedTau;
+  vectorAligned<Vec3<double>> recordedForces;
+  for (size_t i = 0; i < nSteps; i += 37) {
+    replayer.getRecord(i, state, recordedTau, recordedForces);
+    EXPECT_EQ((i + 1) * dt, replayer.getTime(i));
+    EXPECT_EQ(states[i].bodyOrientation, state.bodyOrientation);
+    EXPECT_EQ(states[i].bodyPosition, state.bodyPosition);
+    EXPECT_EQ(states[i].bodyVelocity, state.bodyVelocity);
+    EXPECT_EQ(states[i].q, state.q);
+    EXPECT_EQ(states[i].qd, state.qd);
+    EXPECT_EQ(torques[i], recordedTau);
+    EXPECT_EQ(forces[i], recordedForces[nGC - 1]);
+  }
+
+  // the robot is on the ground at the end
+  replayer.getRecord(nSteps - 1, state, recordedTau, recordedForces);
+  double totalForce = 0;
+  for (auto& f : recordedForces) totalForce += f.norm();
+  EXPECT_GT(totalForce, 0.);
+  replayer.close();
+  remove(fileName.c_str());
+
+  EXPECT_THROW(replayer.open(fileName), std::runtime_error);
+}
@@ -5,6 +5,7 @@
  */
 
 #include "Math/MathUtilities.h"
+#include "Utilities/TripleBuffer.h"
 #include "Utilities/utilities.h"
 #include "cppTypes.h"
 
@@ -12,6 +13,7 @@
 #include "gtest/gtest.h"
 
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include "include/Utilities/Utilities_print.h"
 
@@ -77,4 +79,50 @@ TEST(Utilities, colorPrint) {
   printf_color(PrintColor::Magenta, "magenta\n");
   printf_color(PrintColor::Cyan, "cyan\n");
   printf_color(PrintColor::Default, "default!\n");
-}
\ No newline at end of file
+}
+
+TEST(Utilities, tripleBuffer) {
+  TripleBuffer<int> buffer;
+  EXPECT_FALSE(buffer.consume());
+
+  buffer.writeBuffer() = 1;
+  buffer.publish();
+  buffer.writeBuffer() = 2;
+  buffer.publish();
+  EXPECT_TRUE(buffer.consume());
+  EXPECT_EQ(2, buffer.readBuffer());
+  EXPECT_FALSE(buffer.consume());
+  EXPECT_EQ(2, buffer.readBuffer());
+
+  buffer.writeBuffer() = 3;
+  buffer.publish();
+  EXPECT_TRUE(buffer.consume());
+  EXPECT_EQ(3, buffer.readBuffer());
+}
+
+TEST(Utilities, tripleBufferThreaded) {
+  struct Frame {
+    int values[64];
+  };
+  TripleBuffer<Frame> buffer;
+  const int nFrames = 100000;
+
+  std::thread producer([&]() {
+    for (int frame = 1; frame <= nFrames; frame++) {
+      Frame& f = buffer.writeBuffer();
+      for (int& v : f.values) v = frame;
+      buffer.publish();
+    }
+  });
+
+  // the consumer only ever sees whole frames, in order
+  int last = 0;
+  while (last < nFrames) {
+    if (!buffer.consume()) continue;
+    const Frame& f = buffer.readBuffer();
+    EXPECT_GT(f.values[0], last);
+    for (int v : f.values) ASSERT_EQ(f.values[0], v);
+    last = f.values[0];
+  }
+  producer.join();
+}
@@ -0,0 +1,159 @@
+/*! @file BatchSimulation.h
+ *  @brief Headless simulation of many robot/controller pairs.
+ *
+ *  A BatchSimulation steps a robot with the same QuadrupedSimulator as the
+ *  simulator GUI, but without graphics, shared memory or real-time pacing:
+ *  the RobotRunner is called directly every high-level control tick.  runBatch
+ *  runs a list of BatchJobs on a pool of threads, as fast as possible.
+ */
+
+#ifndef PROJECT_BATCHSIMULATION_H
+#define PROJECT_BATCHSIMULATION_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ControlParameters/RobotParameters.h"
+#include "ControlParameters/SimulatorParameters.h"
+#include "RobotController.h"
+#include "RobotRunner.h"
+#include "SimUtilities/QuadrupedSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
+#include "SimUtilities/SimulatorMessage.h"
+
+/*!
+ * A parameter change at a given time during a headless simulation
+ */
+struct BatchParameterChange {
+  double time;
+  std::string collection;  // "simulator", "robot" or "user"
+  std::string name;
+  std::string value;
+};
+
+/*!
+ * Everything needed to set up one headless simulation.  File names are
+ * relative to the config directory.
+ */
+struct BatchJob {
+  std::string name;
+  RobotType robot = RobotType::MINI_CHEETAH;
+  std::string terrainFile = "default-terrain.yaml";
+  std::string userParameterFile;  // empty if the controller has none
+  double duration = 5.;           // simulated seconds
+  u64 seed = 0;                   // IMU noise seed
+
+  // initial state, the robot lies on the ground by default
+  Vec3<double> bodyPosition = Vec3<double>(0, 0, 0.05);
+  Vec3<double> bodyRPY = Vec3<double>(0, 0, 1);
+  std::vector<double> q = {-0.7, 1.,  2.715,  0.7, 1.,  2.715,
+                           -0.7, -1., -2.715, 0.7, -1., -2.715};
+
+  GamepadCommand gamepadCommand;  // held for the whole run
+
+  // parameter name, value (in ControlParameter::setFromString format)
+  std::vector<std::pair<std::string, std::string>> simulatorOverrides;
+  std::vector<std::pair<std::string, std::string>> robotOverrides;
+  std::vector<std::pair<std::string, std::string>> userOverrides;
+  std::vector<BatchParameterChange> schedule;  // sorted by time
+
+  // if set, start from this state instead of the initial state above, with a
+  // new controller.  duration is still measured from time 0.
+  std::shared_ptr<const SimulationSnapshot> snapshot;
+  double snapshotPeriod = 0.5;  // how often to save state in case of a failure
+
+  bool recordTrajectory = true;  // if set, sim-batch fills in trajectoryFile
+  std::string trajectoryFile;    // record every dynamics step, if not empty
+};
+
+/*!
+ * Summary of a finished headless simulation
+ */
+struct BatchResult {
+  std::string name;
+  bool ok = false;     // ran to the end without an error
+  bool fell = false;   // body tipped over more than 90 degrees
+  std::string error;
+  double simTime = 0;
+  double wallTime = 0;
+  u64 controlIterations = 0;
+  double stepsPerSimSecond = 0;
+  Vec3<double> finalPosition = Vec3<double>::Zero();
+  Vec3<double> finalRPY = Vec3<double>::Zero();
+  double minHeight = 0;   // lowest body height
+  double maxTilt = 0;     // largest roll or pitch magnitude
+
+  // the last state saved before the robot fell or the run failed
+  std::shared_ptr<const SimulationSnapshot> failureSnapshot;
+};
+
+/*!
+ * One robot and its controller, simulated without graphics
+ */
+class BatchSimulation {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  BatchSimulation(const BatchJob& job, RobotController* controller,
+                  std::mutex* controllerMutex = nullptr);
+  ~BatchSimulation();
+
+  BatchResult run();
+  void step(double dt, double dtLowLevelControl, double dtHighLevelControl);
+
+  const FBModelState<double>& getRobotState() {
+    return _quadrupedSim->getState();
+  }
+
+  SimulationSnapshot snapshot();
+  void restore(const SimulationSnapshot& snapshot);
+
+ private:
+  void highLevelControl();
+  ControlParameters& lookupCollection(const std::string& collection);
+
+  BatchJob _job;
+  SimulatorControlParameters _simParams;
+  RobotControlParameters _robotParams;
+  RobotController* _controller;
+  std::mutex* _controllerMutex;
+
+  QuadrupedSimulator* _quadrupedSim = nullptr;
+
+  // the messages the shared memory would hold
+  SimulatorToRobotMessage _simToRobot;
+  RobotToSimulatorMessage _robotToSim;
+  PeriodicTaskManager _taskManager;
+  RobotRunner* _robotRunner = nullptr;
+  bool _firstControllerRun = true;
+
+  double _currentSimTime = 0.;
+  double _timeOfNextLowLevelControl = 0.;
+  double _timeOfNextHighLevelControl = 0.;
+  size_t _nextParameterChange = 0;
+};
+
+std::vector<BatchJob> loadBatchJobs(const std::string& fileName);
+
+std::vector<BatchResult> runBatch(
+    const std::vector<BatchJob>& jobs,
+    const std::function<RobotController*()>& makeController, size_t nThreads,
+    bool serializeControllers);
+
+std::vector<BatchResult> forkBatch(
+    const SimulationSnapshot& snapshot, const std::vector<BatchJob>& jobs,
+    const std::function<RobotController*()>& makeController, size_t nThreads,
+    bool serializeControllers);
+
+void writeBatchResult(const BatchResult& result, const std::string& fileName);
+void writeBatchSummary(const std::vector<BatchResult>& results,
+                       const std::string& fileName);
+
+int batch_main_helper(int argc, char** argv,
+                      const std::function<RobotController*()>& makeController,
+                      bool reentrantController);
+
+#endif  // PROJECT_BATCHSIMULATION_H
@@ -35,6 +35,7 @@ public:
 protected:
   Quadruped<float>* _quadruped = nullptr;
   FloatingBaseModel<float>* _model = nullptr;
+  FixedQuadrupedModel<float>* _fixedModel = nullptr;
   LegController<float>* _legController = nullptr;
   StateEstimatorContainer<float>* _stateEstimator = nullptr;
   StateEstimate<float>* _stateEstimate = nullptr;
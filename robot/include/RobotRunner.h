@@ -54,11 +54,15 @@ class RobotRunner : public PeriodicTask {
   RobotControlParameters* controlParameters;
   VisualizationData* visualizationData;
   CheetahVisualization* cheetahMainVisualization;
+  bool publishLcm = true;  // publish leg control and state estimator data
+  bool skipStartup = false;  // no warm-up or leg initialization, for a robot
+                             // which is already running (from a snapshot)
 
  private:
   float _ini_yaw;
 
   int iter = 0;
+  int _countIni = 0;  // ticks since start, for the leg controller warm-up
 
   void setupStep();
   void finalizeStep();
@@ -78,7 +82,9 @@ class RobotRunner : public PeriodicTask {
   // Contact Estimator to calculate estimated forces and contacts
 
   FloatingBaseModel<float> _model;
+  FixedQuadrupedModel<float> _fixedModel;
   u64 _iterations = 0;
+  u64 _maxAllocationsPerTick = 0;  // only reported with COUNT_ALLOCATIONS
 };
 
 #endif  // PROJECT_ROBOTRUNNER_H
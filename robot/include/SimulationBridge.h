@@ -1,7 +1,8 @@
 /*! @file SimulationBridge.h
  *  @brief  The SimulationBridge runs a RobotController and connects it to a
  * Simulator, using shared memory. It is the simulation version of the
- * HardwareBridge.
+ * HardwareBridge.  It can also be linked into the simulator and run in its
+ * process, see InProcessRobot.
  */
 
 #ifndef PROJECT_SIMULATIONDRIVER_H
@@ -16,32 +17,43 @@
 #include "Utilities/PeriodicTask.h"
 #include "Utilities/SharedMemory.h"
 
-class SimulationBridge {
+class SimulationBridge : public InProcessRobot {
  public:
-  explicit SimulationBridge(RobotType robot, RobotController* robot_ctrl) : 
+  explicit SimulationBridge(RobotType robot, RobotController* robot_ctrl,
+                            bool ownsController = false) :
     _robot(robot) {
      _fakeTaskManager = new PeriodicTaskManager;
     _robotRunner = new RobotRunner(robot_ctrl, _fakeTaskManager, 0, "robot-task");
     _userParams = robot_ctrl->getUserControlParameters();
+    if (ownsController) _ownedController = robot_ctrl;
 
  }
-  void run();
+  void run(size_t simulatorRobot = 0);
+  void handleSimulatorMessage(SimulatorSyncronizedMessage& message) override;
   void handleControlParameters();
   void runRobotControl();
   ~SimulationBridge() {
     delete _fakeTaskManager;
     delete _robotRunner;
+    delete _ownedController;
   }
   void run_sbus();
 
  private:
+  bool handleMessage();
+
   PeriodicTaskManager taskManager;
+  bool _firstMessage = true;
   bool _firstControllerRun = true;
+  bool _inProcess = false;
+  RobotController* _ownedController = nullptr;
   PeriodicTaskManager* _fakeTaskManager = nullptr;
   RobotType _robot;
   RobotRunner* _robotRunner = nullptr;
   SimulatorMode _simMode;
   SharedMemoryObject<SimulatorSyncronizedMessage> _sharedMemory;
+  // _sharedMemory(), or the simulator's own message when in-process
+  SimulatorSyncronizedMessage* _message = nullptr;
   RobotControlParameters _robotParams;
   ControlParameters* _userParams = nullptr;
   u64 _iterations = 0;
@@ -0,0 +1,610 @@
+/*! @file BatchSimulation.cpp
+ *  @brief Headless simulation of many robot/controller pairs.
+ */
+
+#include "BatchSimulation.h"
+#include "Dynamics/Cheetah3.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Math/orientation_tools.h"
+#include "SimUtilities/TerrainFile.h"
+#include "Utilities/Timer.h"
+#include "Utilities/utilities.h"
+
+#include <dynacore_yaml-cpp/yaml.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+/*!
+ * Set up the robot, the terrain, the low level boards and the controller.
+ * The controller is initialized on the first high level control tick.
+ * @param job : robot, terrain, initial state and parameters to simulate
+ * @param controller : the controller to run.  Not owned.
+ * @param controllerMutex : if not null, held while the controller runs, for
+ * controllers which are not safe to run in several threads at once
+ */
+BatchSimulation::BatchSimulation(const BatchJob& job,
+                                 RobotController* controller,
+                                 std::mutex* controllerMutex)
+    : _job(job),
+      _controller(controller),
+      _controllerMutex(controllerMutex),
+      _simToRobot(),
+      _robotToSim() {
+  auto applyOverrides =
+      [](ControlParameters& params,
+         const std::vector<std::pair<std::string, std::string>>& overrides) {
+        for (auto& kv : overrides) {
+          if (!params.collection.lookup(kv.first).setFromString(kv.second)) {
+            throw std::runtime_error("can't set parameter " + kv.first +
+                                     " to " + kv.second);
+          }
+        }
+      };
+
+  // parameters
+  _simParams.initializeFromYamlFile(getConfigDirectoryPath() +
+                                    SIMULATOR_DEFAULT_PARAMETERS);
+  if (!_simParams.isFullyInitialized()) {
+    throw std::runtime_error(
+        "not all simulator parameters initialized. Missing:\n" +
+        _simParams.generateUnitializedList());
+  }
+  applyOverrides(_simParams, _job.simulatorOverrides);
+  if (_job.robot == RobotType::MINI_CHEETAH) {
+    _robotParams.initializeFromYamlFile(getConfigDirectoryPath() +
+                                        MINI_CHEETAH_DEFAULT_PARAMETERS);
+  } else {
+    _robotParams.initializeFromYamlFile(getConfigDirectoryPath() +
+                                        CHEETAH_3_DEFAULT_PARAMETERS);
+  }
+  applyOverrides(_robotParams, _job.robotOverrides);
+
+  ControlParameters* userParams = _controller->getUserControlParameters();
+  if (userParams) {
+    if (!_job.userParameterFile.empty()) {
+      userParams->initializeFromYamlFile(getConfigDirectoryPath() +
+                                         _job.userParameterFile);
+    }
+    applyOverrides(*userParams, _job.userOverrides);
+  } else if (!_job.userOverrides.empty()) {
+    throw std::runtime_error("controller has no user parameters to override");
+  }
+
+  // dynamics, boards and IMU
+  _quadrupedSim =
+      new QuadrupedSimulator(_job.robot, _simParams, Vec3<double>::Zero(),
+                             _job.seed);
+  DynamicsSimulator<double>* simulator = &_quadrupedSim->getSimulator();
+
+  TerrainFileCallbacks terrain;
+  terrain.addPlane = [&](double mu, double resti, double height, double,
+                         double, double, double) {
+    simulator->addCollisionPlane(mu, resti, height);
+  };
+  terrain.addBox = [&](double mu, double resti, double depth, double width,
+                       double height, const Vec3<double>& pos,
+                       const Mat3<double>& ori, bool) {
+    simulator->addCollisionBox(mu, resti, depth, width, height, pos, ori);
+  };
+  terrain.addMesh = [&](double mu, double resti, double grid,
+                        const Vec3<double>& leftCorner,
+                        const DMat<double>& heightMap, bool) {
+    simulator->addCollisionMesh(mu, resti, grid, leftCorner, heightMap);
+  };
+  terrain.addProceduralTerrain =
+      [&](const ProceduralTerrainParameters& params) {
+        simulator->addCollisionTerrain(
+            std::make_shared<const ProceduralTerrain>(params));
+      };
+  parseTerrainFile(getConfigDirectoryPath() + _job.terrainFile, terrain);
+
+  if (_job.q.size() != 12) {
+    throw std::runtime_error("initial joint position needs 12 values");
+  }
+  FBModelState<double> x0;
+  x0.bodyOrientation = ori::rpyToQuat(_job.bodyRPY);
+  x0.bodyPosition = _job.bodyPosition;
+  x0.bodyVelocity.setZero();
+  x0.q = DVec<double>::Zero(12);
+  x0.qd = DVec<double>::Zero(12);
+  for (size_t i = 0; i < 12; i++) {
+    x0.q[i] = _job.q[i];
+  }
+  _quadrupedSim->setState(x0);
+
+  if (!_job.trajectoryFile.empty()) {
+    _quadrupedSim->openTrajectory(_job.trajectoryFile, _job.duration);
+  }
+
+  // controller, wired to the messages instead of shared memory
+  _simToRobot.gamepadCommand = _job.gamepadCommand;
+  _simToRobot.robotType = _job.robot;
+  _robotRunner = new RobotRunner(_controller, &_taskManager, 0, "robot-task");
+  _robotRunner->publishLcm = false;
+  _robotRunner->driverCommand = &_simToRobot.gamepadCommand;
+  _robotRunner->spiData = &_simToRobot.spiData;
+  _robotRunner->tiBoardData = _simToRobot.tiBoardData;
+  _robotRunner->robotType = _job.robot;
+  _robotRunner->vectorNavData = &_simToRobot.vectorNav;
+  _robotRunner->cheaterState = &_simToRobot.cheaterState;
+  _robotRunner->spiCommand = &_robotToSim.spiCommand;
+  _robotRunner->tiBoardCommand = _robotToSim.tiBoardCommand;
+  _robotRunner->controlParameters = &_robotParams;
+  _robotRunner->visualizationData = &_robotToSim.visualizationData;
+  _robotRunner->cheetahMainVisualization =
+      &_robotToSim.mainCheetahVisualization;
+
+  if (_job.snapshot) {
+    restore(*_job.snapshot);
+    _robotRunner->skipStartup = true;
+  }
+}
+
+BatchSimulation::~BatchSimulation() {
+  delete _robotRunner;
+  delete _quadrupedSim;
+}
+
+/*!
+ * Simulate for the duration of the job, or until the robot falls over
+ * @return summary of the run
+ */
+BatchResult BatchSimulation::run() {
+  BatchResult result;
+  result.name = _job.name;
+  result.minHeight = _quadrupedSim->getState().bodyPosition[2];
+  Timer timer;
+  _quadrupedSim->getSimulator().resetStepCounter();
+  std::shared_ptr<SimulationSnapshot> lastSnapshot;
+  double timeOfNextSnapshot = _currentSimTime;
+
+  try {
+    while (_currentSimTime < _job.duration) {
+      if (_job.snapshotPeriod > 0 && _currentSimTime >= timeOfNextSnapshot) {
+        if (!lastSnapshot) lastSnapshot.reset(new SimulationSnapshot);
+        *lastSnapshot = snapshot();
+        timeOfNextSnapshot += _job.snapshotPeriod;
+      }
+      step(_simParams.dynamics_dt, _simParams.low_level_dt,
+           _simParams.high_level_dt);
+
+      const FBModelState<double>& state = _quadrupedSim->getState();
+      Vec3<double> rpy = ori::quatToRPY(state.bodyOrientation);
+      result.minHeight = std::min(result.minHeight, state.bodyPosition[2]);
+      result.maxTilt = std::max(
+          result.maxTilt, std::max(std::abs(rpy[0]), std::abs(rpy[1])));
+      if (result.maxTilt > M_PI / 2) {
+        result.fell = true;
+        break;
+      }
+    }
+    result.ok = true;
+  } catch (std::exception& e) {
+    result.error = e.what();
+  }
+
+  if (!result.ok || result.fell) {
+    result.failureSnapshot = lastSnapshot;
+  }
+
+  const FBModelState<double>& state = _quadrupedSim->getState();
+  result.simTime = _currentSimTime;
+  result.wallTime = timer.getSeconds();
+  result.controlIterations = _quadrupedSim->getHighLevelIterations();
+  result.stepsPerSimSecond =
+      _quadrupedSim->getSimulator().getStepsPerSimSecond();
+  result.finalPosition = state.bodyPosition;
+  result.finalRPY = ori::quatToRPY(state.bodyOrientation);
+  return result;
+}
+
+/*!
+ * Take a single timestep of dt seconds, like Simulation::step
+ */
+void BatchSimulation::step(double dt, double dtLowLevelControl,
+                           double dtHighLevelControl) {
+  // Low level control (if needed)
+  if (_currentSimTime >= _timeOfNextLowLevelControl) {
+    _quadrupedSim->lowLevelControl();
+    _timeOfNextLowLevelControl = _timeOfNextLowLevelControl + dtLowLevelControl;
+  }
+
+  // High level control
+  if (_currentSimTime >= _timeOfNextHighLevelControl) {
+    while (_nextParameterChange < _job.schedule.size() &&
+           _job.schedule[_nextParameterChange].time <= _currentSimTime) {
+      const BatchParameterChange& change = _job.schedule[_nextParameterChange];
+      if (!lookupCollection(change.collection)
+               .collection.lookup(change.name)
+               .setFromString(change.value)) {
+        throw std::runtime_error("can't set parameter " + change.name +
+                                 " to " + change.value);
+      }
+      _nextParameterChange++;
+    }
+    highLevelControl();
+    _timeOfNextHighLevelControl =
+        _timeOfNextHighLevelControl + dtHighLevelControl;
+  }
+
+  // actuator models and dynamics
+  _quadrupedSim->updateActuators(dt);
+  _currentSimTime += dt;
+  _quadrupedSim->integrate(_currentSimTime, dt);
+}
+
+/*!
+ * Save the state of the simulator, like Simulation::snapshot
+ */
+SimulationSnapshot BatchSimulation::snapshot() {
+  return _quadrupedSim->snapshot(_currentSimTime, _timeOfNextLowLevelControl,
+                                 _timeOfNextHighLevelControl);
+}
+
+/*!
+ * Go back to the state in a snapshot of this robot, like Simulation::restore.
+ * The controller is not restored.
+ */
+void BatchSimulation::restore(const SimulationSnapshot& snapshot) {
+  _quadrupedSim->restore(snapshot);
+  _currentSimTime = snapshot.currentSimTime;
+  _timeOfNextLowLevelControl = snapshot.timeOfNextLowLevelControl;
+  _timeOfNextHighLevelControl = snapshot.timeOfNextHighLevelControl;
+  _quadrupedSim->getTrajectory().truncate(_currentSimTime);
+}
+
+/*!
+ * Get the parameters named in a BatchParameterChange
+ */
+ControlParameters& BatchSimulation::lookupCollection(
+    const std::string& collection) {
+  if (collection == "simulator") return _simParams;
+  if (collection == "robot") return _robotParams;
+  if (collection == "user" && _controller->getUserControlParameters()) {
+    return *_controller->getUserControlParameters();
+  }
+  throw std::runtime_error("unknown parameter collection " + collection);
+}
+
+/*!
+ * Fill in the sensor data and run the controller in this thread
+ */
+void BatchSimulation::highLevelControl() {
+  _quadrupedSim->writeSensorData(_simToRobot);
+
+  {
+    std::unique_lock<std::mutex> lock;
+    if (_controllerMutex) {
+      lock = std::unique_lock<std::mutex>(*_controllerMutex);
+    }
+    if (_firstControllerRun) {
+      if (!_robotParams.isFullyInitialized()) {
+        throw std::runtime_error(
+            "not all robot parameters initialized. Missing:\n" +
+            _robotParams.generateUnitializedList());
+      }
+      ControlParameters* userParams = _controller->getUserControlParameters();
+      if (userParams && !userParams->isFullyInitialized()) {
+        throw std::runtime_error(
+            "not all user parameters initialized. Missing:\n" +
+            userParams->generateUnitializedList());
+      }
+      _robotRunner->init();
+      _firstControllerRun = false;
+    }
+    _robotRunner->run();
+  }
+
+  _quadrupedSim->readCommands(_robotToSim);
+}
+
+/*!
+ * Read a list of jobs from a yaml file.  Each top level key is a job name;
+ * see config/sim-batch-example.yaml for the fields.
+ * @param fileName : path to the job file
+ * @return the jobs, in file order
+ */
+std::vector<BatchJob> loadBatchJobs(const std::string& fileName) {
+  dynacore_YAML::Node config;
+  try {
+    config = dynacore_YAML::LoadFile(fileName);
+  } catch (std::exception& e) {
+    throw std::runtime_error("could not open batch job file " + fileName);
+  }
+
+  auto readOverrides =
+      [](const dynacore_YAML::Node& node,
+         std::vector<std::pair<std::string, std::string>>& overrides) {
+        if (!node) return;
+        for (auto it = node.begin(); it != node.end(); it++) {
+          std::string value;
+          if (it->second.IsSequence()) {
+            // Vec3 parameters are written like [1, 2, 3]
+            value = "[";
+            for (size_t i = 0; i < it->second.size(); i++) {
+              if (i) value += ", ";
+              value += it->second[i].as<std::string>();
+            }
+            value += "]";
+          } else {
+            value = it->second.as<std::string>();
+          }
+          overrides.emplace_back(it->first.as<std::string>(), value);
+        }
+      };
+
+  auto readVec3 = [](const dynacore_YAML::Node& node, Vec3<double>& v) {
+    if (!node) return;
+    std::vector<double> vv = node.as<std::vector<double>>();
+    if (vv.size() != 3) throw std::runtime_error("expected 3 values");
+    v = Vec3<double>(vv[0], vv[1], vv[2]);
+  };
+
+  auto readVec2 = [](const dynacore_YAML::Node& node, Vec2<float>& v) {
+    if (!node) return;
+    std::vector<float> vv = node.as<std::vector<float>>();
+    if (vv.size() != 2) throw std::runtime_error("expected 2 values");
+    v = Vec2<float>(vv[0], vv[1]);
+  };
+
+  std::vector<BatchJob> jobs;
+  for (auto it = config.begin(); it != config.end(); it++) {
+    BatchJob job;
+    job.name = it->first.as<std::string>();
+    const dynacore_YAML::Node& node = it->second;
+    try {
+      if (node["robot"]) {
+        std::string robot = node["robot"].as<std::string>();
+        if (robot == "mini-cheetah") {
+          job.robot = RobotType::MINI_CHEETAH;
+        } else if (robot == "cheetah-3") {
+          job.robot = RobotType::CHEETAH_3;
+        } else {
+          throw std::runtime_error("unknown robot " + robot);
+        }
+      }
+      if (node["terrain"]) job.terrainFile = node["terrain"].as<std::string>();
+      if (node["user_parameters"])
+        job.userParameterFile = node["user_parameters"].as<std::string>();
+      if (node["duration"]) job.duration = node["duration"].as<double>();
+      if (node["seed"]) job.seed = node["seed"].as<u64>();
+      if (node["snapshot"]) {
+        std::shared_ptr<SimulationSnapshot> snapshot(new SimulationSnapshot);
+        snapshot->load(node["snapshot"].as<std::string>());
+        job.snapshot = snapshot;
+      }
+      if (node["snapshot_period"])
+        job.snapshotPeriod = node["snapshot_period"].as<double>();
+      if (node["record_trajectory"])
+        job.recordTrajectory = node["record_trajectory"].as<bool>();
+      readVec3(node["body_position"], job.bodyPosition);
+      readVec3(node["body_rpy"], job.bodyRPY);
+      if (node["q"]) job.q = node["q"].as<std::vector<double>>();
+      readVec2(node["left_stick"], job.gamepadCommand.leftStickAnalog);
+      readVec2(node["right_stick"], job.gamepadCommand.rightStickAnalog);
+      readOverrides(node["simulator_overrides"], job.simulatorOverrides);
+      readOverrides(node["robot_overrides"], job.robotOverrides);
+      readOverrides(node["user_overrides"], job.userOverrides);
+      if (node["schedule"]) {
+        // [time, collection, name, value]
+        for (size_t i = 0; i < node["schedule"].size(); i++) {
+          const dynacore_YAML::Node& c = node["schedule"][i];
+          if (c.size() != 4) {
+            throw std::runtime_error(
+                "schedule entries are [time, collection, name, value]");
+          }
+          job.schedule.push_back({c[0].as<double>(), c[1].as<std::string>(),
+                                  c[2].as<std::string>(),
+                                  c[3].as<std::string>()});
+        }
+        std::stable_sort(job.schedule.begin(), job.schedule.end(),
+                         [](const BatchParameterChange& a,
+                            const BatchParameterChange& b) {
+                           return a.time < b.time;
+                         });
+      }
+    } catch (std::exception& e) {
+      throw std::runtime_error("bad batch job " + job.name + ": " + e.what());
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+/*!
+ * Run jobs on a pool of threads.  Each job gets its own controller.
+ * @param jobs : jobs to run
+ * @param makeController : creates a new controller
+ * @param nThreads : number of threads, or 0 to use one per core
+ * @param serializeControllers : run only one controller at a time, for
+ * controllers with global state.  The dynamics still run in parallel.
+ * @return one result per job, in the same order
+ */
+std::vector<BatchResult> runBatch(
+    const std::vector<BatchJob>& jobs,
+    const std::function<RobotController*()>& makeController, size_t nThreads,
+    bool serializeControllers) {
+  std::vector<BatchResult> results(jobs.size());
+  std::atomic<size_t> nextJob(0);
+  std::mutex controllerMutex;
+  std::mutex printMutex;
+
+  auto worker = [&]() {
+    for (;;) {
+      size_t i = nextJob++;
+      if (i >= jobs.size()) return;
+      std::unique_ptr<RobotController> controller;
+      try {
+        controller.reset(makeController());
+        std::unique_ptr<BatchSimulation> sim(new BatchSimulation(
+            jobs[i], controller.get(),
+            serializeControllers ? &controllerMutex : nullptr));
+        results[i] = sim->run();
+      } catch (std::exception& e) {
+        results[i].name = jobs[i].name;
+        results[i].ok = false;
+        results[i].error = e.what();
+      }
+
+      std::lock_guard<std::mutex> lock(printMutex);
+      printf("[BatchSimulation] %s: %s, %.2f s simulated in %.2f s\n",
+             results[i].name.c_str(),
+             !results[i].ok ? "ERROR" : (results[i].fell ? "fell" : "ok"),
+             results[i].simTime, results[i].wallTime);
+    }
+  };
+
+  if (nThreads == 0) {
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  nThreads = std::min(nThreads, jobs.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nThreads; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+/*!
+ * Continue one simulation in several different ways at once, for example to
+ * try several controller gains from the same moment.  Each job starts from
+ * the snapshot with its own controller, parameters and gamepad command; its
+ * initial state and terrain should match the simulation the snapshot came
+ * from.
+ * @param snapshot : state to start every job from
+ * @param jobs : jobs to run, see runBatch
+ * @return one result per job, in the same order
+ */
+std::vector<BatchResult> forkBatch(
+    const SimulationSnapshot& snapshot, const std::vector<BatchJob>& jobs,
+    const std::function<RobotController*()>& makeController, size_t nThreads,
+    bool serializeControllers) {
+  std::shared_ptr<const SimulationSnapshot> shared(
+      new SimulationSnapshot(snapshot));
+  std::vector<BatchJob> forks = jobs;
+  for (auto& job : forks) {
+    job.snapshot = shared;
+  }
+  return runBatch(forks, makeController, nThreads, serializeControllers);
+}
+
+/*!
+ * Write the result of a single job as a small yaml file
+ */
+void writeBatchResult(const BatchResult& result, const std::string& fileName) {
+  std::ofstream f(fileName);
+  if (!f.good()) {
+    throw std::runtime_error("could not open " + fileName);
+  }
+  f << "name: " << result.name << "\n";
+  f << "ok: " << result.ok << "\n";
+  f << "fell: " << result.fell << "\n";
+  f << "error: \"" << result.error << "\"\n";
+  f << "sim_time: " << result.simTime << "\n";
+  f << "wall_time: " << result.wallTime << "\n";
+  f << "control_iterations: " << result.controlIterations << "\n";
+  f << "steps_per_sim_second: " << result.stepsPerSimSecond << "\n";
+  f << "final_position: [" << result.finalPosition[0] << ", "
+    << result.finalPosition[1] << ", " << result.finalPosition[2] << "]\n";
+  f << "final_rpy: [" << result.finalRPY[0] << ", " << result.finalRPY[1]
+    << ", " << result.finalRPY[2] << "]\n";
+  f << "min_height: " << result.minHeight << "\n";
+  f << "max_tilt: " << result.maxTilt << "\n";
+}
+
+/*!
+ * Write one line per job to a csv file
+ */
+void writeBatchSummary(const std::vector<BatchResult>& results,
+                       const std::string& fileName) {
+  std::ofstream f(fileName);
+  if (!f.good()) {
+    throw std::runtime_error("could not open " + fileName);
+  }
+  f << "name,ok,fell,sim_time,wall_time,control_iterations,"
+       "steps_per_sim_second,x,y,z,roll,pitch,yaw,min_height,max_tilt\n";
+  for (auto& r : results) {
+    f << r.name << "," << r.ok << "," << r.fell << "," << r.simTime << ","
+      << r.wallTime << "," << r.controlIterations << ","
+      << r.stepsPerSimSecond << "," << r.finalPosition[0] << ","
+      << r.finalPosition[1] << "," << r.finalPosition[2] << ","
+      << r.finalRPY[0] << "," << r.finalRPY[1] << "," << r.finalRPY[2] << ","
+      << r.minHeight << "," << r.maxTilt << "\n";
+  }
+}
+
+/*!
+ * Print a message describing the command line arguments for sim-batch
+ */
+static void printBatchUsage() {
+  printf(
+      "Usage: sim-batch [job-file] [output-dir] [threads]\n\twhere job-file: "
+      "  yaml file with one entry per job\n\t      output-dir: where results "
+      "are written (default sim-batch-results)\n\t      threads:    number "
+      "of threads (default one per core)\n");
+}
+
+/*!
+ * Run the jobs in a job file and write the results.  Call this from main.
+ * @param makeController : creates a new instance of the controller
+ * @param reentrantController : if false, only one instance of the controller
+ * runs at a time
+ * @return 0 if every job ran without an error
+ */
+int batch_main_helper(int argc, char** argv,
+                      const std::function<RobotController*()>& makeController,
+                      bool reentrantController) {
+  if (argc < 2 || argc > 4) {
+    printBatchUsage();
+    return EXIT_FAILURE;
+  }
+  std::string outputDir = argc > 2 ? argv[2] : "sim-batch-results";
+  size_t nThreads = argc > 3 ? std::stoul(argv[3]) : 0;
+
+  std::vector<BatchJob> jobs = loadBatchJobs(argv[1]);
+  printf("[BatchSimulation] %lu jobs from %s\n", (unsigned long)jobs.size(),
+         argv[1]);
+  if (mkdir(outputDir.c_str(), 0755) && errno != EEXIST) {
+    printf("[ERROR] could not create %s\n", outputDir.c_str());
+    return EXIT_FAILURE;
+  }
+
+  for (auto& job : jobs) {
+    if (job.recordTrajectory) {
+      job.trajectoryFile = outputDir + "/" + job.name + ".traj";
+    }
+  }
+
+  Timer timer;
+  std::vector<BatchResult> results =
+      runBatch(jobs, makeController, nThreads, !reentrantController);
+
+  size_t nErrors = 0, nFell = 0;
+  double simTime = 0;
+  for (auto& result : results) {
+    writeBatchResult(result, outputDir + "/" + result.name + ".yaml");
+    if (result.failureSnapshot) {
+      result.failureSnapshot->save(outputDir + "/" + result.name +
+                                   ".snapshot");
+    }
+    if (!result.ok) nErrors++;
+    if (result.fell) nFell++;
+    simTime += result.simTime;
+  }
+  writeBatchSummary(results, outputDir + "/summary.csv");
+  printf(
+      "[BatchSimulation] %lu jobs, %lu errors, %lu fell. %.1f s simulated in "
+      "%.1f s\n",
+      (unsigned long)results.size(), (unsigned long)nErrors,
+      (unsigned long)nFell, simTime, timer.getSeconds());
+  return nErrors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
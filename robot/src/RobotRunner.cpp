@@ -15,6 +15,7 @@
 #include "Utilities/Utilities_print.h"
 #include "ParamHandler.hpp"
 #include "Utilities/Timer.h"
+#include "Utilities/AllocationCounter.h"
 #include "Controllers/PositionVelocityEstimator.h"
 #include "rt/rt_interface_lcm.h"
 
@@ -43,7 +44,9 @@ void RobotRunner::init() {
 
   // Initialize the model and robot data
   _model = _quadruped.buildModel();
+  _fixedModel.setModel(_model);
   _jpos_initializer = new JPosInitializer<float>(3., controlParameters->controller_dt);
+  if (skipStartup) _countIni = 50;
   
   // Always initialize the leg controller and state entimator
   _legController = new LegController<float>(_quadruped);
@@ -63,6 +66,7 @@ void RobotRunner::init() {
 
   // Controller initializations
   _robot_ctrl->_model = &_model;
+  _robot_ctrl->_fixedModel = &_fixedModel;
   _robot_ctrl->_quadruped = &_quadruped;
   _robot_ctrl->_legController = _legController;
   _robot_ctrl->_stateEstimator = _stateEstimator;
@@ -82,6 +86,9 @@ void RobotRunner::init() {
  * to run each of their respective steps.
  */
 void RobotRunner::run() {
+#ifdef COUNT_ALLOCATIONS
+  AllocationCounter allocationCounter;
+#endif
   // Run the state estimator step
   //_stateEstimator->run(cheetahMainVisualization);
   _stateEstimator->run();
@@ -91,26 +98,25 @@ void RobotRunner::run() {
   // Update the data from the robot
   setupStep();
 
-  static int count_ini(0);
-  ++count_ini;
-  if (count_ini < 10) {
+  ++_countIni;
+  if (_countIni < 10) {
     _legController->setEnabled(false);
-  } else if (20 < count_ini && count_ini < 30) {
+  } else if (20 < _countIni && _countIni < 30) {
     _legController->setEnabled(false);
-  } else if (40 < count_ini && count_ini < 50) {
+  } else if (40 < _countIni && _countIni < 50) {
     _legController->setEnabled(false);
   } else {
     _legController->setEnabled(true);
 
     if( (main_control_settings.mode == 0) && controlParameters->use_rc ) {
-      if(count_ini%1000 ==0)   printf("ESTOP!\n");
+      if(_countIni%1000 ==0)   printf("ESTOP!\n");
         for (int leg = 0; leg < 4; leg++) {
           _legController->commands[leg].zero();
         }
         _robot_ctrl->Estop();
      }else {
       // Controller
-      if (!_jpos_initializer->IsInitialized(_legController)) {
+      if (!skipStartup && !_jpos_initializer->IsInitialized(_legController)) {
         Mat3<float> kpMat;
         Mat3<float> kdMat;
         kpMat << 5, 0, 0, 0, 5, 0, 0, 0, 5;
@@ -148,6 +154,16 @@ void RobotRunner::run() {
 
   // Sets the leg controller commands for the robot appropriate commands
   finalizeStep();
+
+#ifdef COUNT_ALLOCATIONS
+  // report whenever a tick allocates more than any tick before it
+  u64 allocations = allocationCounter.stop();
+  if (allocations > _maxAllocationsPerTick) {
+    _maxAllocationsPerTick = allocations;
+    printf("[RobotRunner] %lu heap allocations in control tick %lu\n",
+           (unsigned long)allocations, (unsigned long)_iterations);
+  }
+#endif
 }
 
 /*!
@@ -201,11 +217,13 @@ void RobotRunner::finalizeStep() {
   } else {
     assert(false);
   }
-  _legController->setLcm(&leg_control_data_lcm, &leg_control_command_lcm);
-  _stateEstimate.setLcm(state_estimator_lcm);
-  _lcm.publish("leg_control_command", &leg_control_command_lcm);
-  _lcm.publish("leg_control_data", &leg_control_data_lcm);
-  _lcm.publish("state_estimator", &state_estimator_lcm);
+  if (publishLcm) {
+    _legController->setLcm(&leg_control_data_lcm, &leg_control_command_lcm);
+    _stateEstimate.setLcm(state_estimator_lcm);
+    _lcm.publish("leg_control_command", &leg_control_command_lcm);
+    _lcm.publish("leg_control_data", &leg_control_data_lcm);
+    _lcm.publish("state_estimator", &state_estimator_lcm);
+  }
   _iterations++;
 }
 
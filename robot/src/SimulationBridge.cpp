@@ -13,79 +13,102 @@
 
 /*!
  * Connect to a simulation
+ * @param simulatorRobot : which robot of the simulation to control
  */
-void SimulationBridge::run() {
+void SimulationBridge::run(size_t simulatorRobot) {
   // init shared memory:
-  _sharedMemory.attach(DEVELOPMENT_SIMULATOR_SHARED_MEMORY_NAME);
-  _sharedMemory().init();
+  _sharedMemory.attach(simulatorSharedMemoryName(simulatorRobot));
+  _message = _sharedMemory.get();
+  _message->init();
 
-  install_segfault_handler(_sharedMemory().robotToSim.errorMessage);
+  install_segfault_handler(_message->robotToSim.errorMessage);
 
   // init Quadruped Controller
 
   try {
     printf("[Simulation Driver] Starting main loop...\n");
-    bool firstRun = true;
     for (;;) {
       // wait for our turn to access the shared memory
       // on the first loop, this gives the simulator a chance to put stuff in
       // shared memory before we start
-      _sharedMemory().waitForSimulator();
-
-      if (firstRun) {
-        firstRun = false;
-        // check that the robot type is correct:
-        if (_robot != _sharedMemory().simToRobot.robotType) {
-          printf(
-            "simulator and simulatorDriver don't agree on which robot we are "
-            "simulating (robot %d, sim %d)\n",
-            (int)_robot, (int)_sharedMemory().simToRobot.robotType);
-          throw std::runtime_error("robot mismatch!");
-        }
-      }
+      _message->waitForSimulator();
 
-      // the simulator tells us which mode to run in
-      _simMode = _sharedMemory().simToRobot.mode;
-      switch (_simMode) {
-        case SimulatorMode::RUN_CONTROL_PARAMETERS:  // there is a new control
-          // parameter request
-          handleControlParameters();
-          break;
-        case SimulatorMode::RUN_CONTROLLER:  // the simulator is ready for the
-          // next robot controller run
-          _iterations++;
-          runRobotControl();
-          break;
-        case SimulatorMode::DO_NOTHING:  // the simulator is just checking to see
-          // if we are alive yet
-          break;
-        case SimulatorMode::EXIT:  // the simulator is done with us
-          printf("[Simulation Driver] Transitioned to exit mode\n");
-          return;
-          break;
-        default:
-          throw std::runtime_error("unknown simulator mode");
+      if (!handleMessage()) {
+        return;
       }
 
       // tell the simulator we are done
-      _sharedMemory().robotIsDone();
+      _message->robotIsDone();
     }
   } catch (std::exception& e) {
-    strncpy(_sharedMemory().robotToSim.errorMessage, e.what(), sizeof(_sharedMemory().robotToSim.errorMessage));
-    _sharedMemory().robotToSim.errorMessage[sizeof(_sharedMemory().robotToSim.errorMessage) - 1] = '\0';
+    strncpy(_message->robotToSim.errorMessage, e.what(), sizeof(_message->robotToSim.errorMessage));
+    _message->robotToSim.errorMessage[sizeof(_message->robotToSim.errorMessage) - 1] = '\0';
     throw e;
   }
 
 }
 
+/*!
+ * Run in the simulator's process: handle the message the simulator has just
+ * finished with.  Exceptions are left for the simulator to report.
+ */
+void SimulationBridge::handleSimulatorMessage(
+    SimulatorSyncronizedMessage& message) {
+  _inProcess = true;
+  _message = &message;
+  handleMessage();
+}
+
+/*!
+ * Do what the simulator asks for in the current message
+ * @return false if the simulator is done with us
+ */
+bool SimulationBridge::handleMessage() {
+  if (_firstMessage) {
+    _firstMessage = false;
+    // check that the robot type is correct:
+    if (_robot != _message->simToRobot.robotType) {
+      printf(
+        "simulator and simulatorDriver don't agree on which robot we are "
+        "simulating (robot %d, sim %d)\n",
+        (int)_robot, (int)_message->simToRobot.robotType);
+      throw std::runtime_error("robot mismatch!");
+    }
+  }
+
+  // the simulator tells us which mode to run in
+  _simMode = _message->simToRobot.mode;
+  switch (_simMode) {
+    case SimulatorMode::RUN_CONTROL_PARAMETERS:  // there is a new control
+      // parameter request
+      handleControlParameters();
+      break;
+    case SimulatorMode::RUN_CONTROLLER:  // the simulator is ready for the
+      // next robot controller run
+      _iterations++;
+      runRobotControl();
+      break;
+    case SimulatorMode::DO_NOTHING:  // the simulator is just checking to see
+      // if we are alive yet
+      break;
+    case SimulatorMode::EXIT:  // the simulator is done with us
+      printf("[Simulation Driver] Transitioned to exit mode\n");
+      return false;
+      break;
+    default:
+      throw std::runtime_error("unknown simulator mode");
+  }
+  return true;
+}
+
 /*!
  * This function handles a a control parameter message from the simulator
  */
 void SimulationBridge::handleControlParameters() {
   ControlParameterRequest& request =
-      _sharedMemory().simToRobot.controlParameterRequest;
+      _message->simToRobot.controlParameterRequest;
   ControlParameterResponse& response =
-      _sharedMemory().robotToSim.controlParameterResponse;
+      _message->robotToSim.controlParameterResponse;
   if (request.requestNumber <= response.requestNumber) {
     // nothing to do!
     printf(
@@ -232,25 +255,28 @@ void SimulationBridge::runRobotControl() {
 
 
     _robotRunner->driverCommand =
-        &_sharedMemory().simToRobot.gamepadCommand;
-    _robotRunner->spiData = &_sharedMemory().simToRobot.spiData;
-    _robotRunner->tiBoardData = _sharedMemory().simToRobot.tiBoardData;
+        &_message->simToRobot.gamepadCommand;
+    _robotRunner->spiData = &_message->simToRobot.spiData;
+    _robotRunner->tiBoardData = _message->simToRobot.tiBoardData;
     _robotRunner->robotType = _robot;
-    _robotRunner->vectorNavData = &_sharedMemory().simToRobot.vectorNav;
-    _robotRunner->cheaterState = &_sharedMemory().simToRobot.cheaterState;
-    _robotRunner->spiCommand = &_sharedMemory().robotToSim.spiCommand;
+    _robotRunner->vectorNavData = &_message->simToRobot.vectorNav;
+    _robotRunner->cheaterState = &_message->simToRobot.cheaterState;
+    _robotRunner->spiCommand = &_message->robotToSim.spiCommand;
     _robotRunner->tiBoardCommand =
-        _sharedMemory().robotToSim.tiBoardCommand;
+        _message->robotToSim.tiBoardCommand;
     _robotRunner->controlParameters = &_robotParams;
     _robotRunner->visualizationData =
-        &_sharedMemory().robotToSim.visualizationData;
+        &_message->robotToSim.visualizationData;
     _robotRunner->cheetahMainVisualization =
-        &_sharedMemory().robotToSim.mainCheetahVisualization;
+        &_message->robotToSim.mainCheetahVisualization;
 
     _robotRunner->init();
     _firstControllerRun = false;
 
-    sbus_thread = new std::thread(&SimulationBridge::run_sbus, this);
+    // in the simulator's process, the simulator may be started many times
+    if (!_inProcess) {
+      sbus_thread = new std::thread(&SimulationBridge::run_sbus, this);
+    }
   }
   _robotRunner->run();
 }
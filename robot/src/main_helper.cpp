@@ -7,6 +7,7 @@
  */
 
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
 
 #include "HardwareBridge.h"
@@ -21,16 +22,17 @@ MasterConfig gMasterConfig;
  */
 void printUsage() {
   printf(
-      "Usage: robot [robot-id] [sim-or-robot]\n\twhere robot-id:     3 for "
-      "cheetah 3, m for mini-cheetah\n\t      sim-or-robot: s for sim, r for "
-      "robot\n");
+      "Usage: robot [robot-id] [sim-or-robot] [sim-robot-index]\n\twhere "
+      "robot-id:     3 for cheetah 3, m for mini-cheetah\n\t      "
+      "sim-or-robot: s for sim, r for robot\n\t      sim-robot-index: which "
+      "robot of the simulation to control (optional, default 0)\n");
 }
 
 /*!
  * Setup and run the given robot controller
  */
 int main_helper(int argc, char** argv, RobotController* ctrl) {
-  if (argc != 3) {
+  if (argc != 3 && argc != 4) {
     printUsage();
     return EXIT_FAILURE;
   }
@@ -53,6 +55,16 @@ int main_helper(int argc, char** argv, RobotController* ctrl) {
     return EXIT_FAILURE;
   }
 
+  size_t simulatorRobot = 0;
+  if (argc == 4) {
+    char* end;
+    simulatorRobot = strtoul(argv[3], &end, 10);
+    if (!gMasterConfig.simulated || *end) {
+      printUsage();
+      return EXIT_FAILURE;
+    }
+  }
+
   printf("[Quadruped] Cheetah Software\n");
   printf("        Quadruped:  %s\n",
          gMasterConfig._robot == RobotType::MINI_CHEETAH ? "Mini Cheetah"
@@ -65,11 +77,11 @@ int main_helper(int argc, char** argv, RobotController* ctrl) {
   if (gMasterConfig.simulated) {
     if (gMasterConfig._robot == RobotType::MINI_CHEETAH) {
       SimulationBridge simulationBridge(gMasterConfig._robot, ctrl);
-      simulationBridge.run();
+      simulationBridge.run(simulatorRobot);
       printf("[Quadruped] SimDriver run() has finished!\n");
     } else if (gMasterConfig._robot == RobotType::CHEETAH_3) {
       SimulationBridge simulationBridge(gMasterConfig._robot, ctrl);
-      simulationBridge.run();
+      simulationBridge.run(simulatorRobot);
     } else {
       printf("[ERROR] unknown robot\n");
       assert(false);
@@ -0,0 +1,86 @@
+/*! @file test_robotRunner.cpp
+ *  @brief Test the control loop run by RobotRunner, without a simulator
+ */
+
+#include "ControlParameters/SimulatorParameters.h"
+#include "RobotRunner.h"
+#include "SimUtilities/SimulatorMessage.h"
+#include "Utilities/AllocationCounter.h"
+#include "Utilities/utilities.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+/*!
+ * Joint PD to a standing posture, with a little feedforward from the state
+ * estimate so that the estimators are used
+ */
+class HoldController : public RobotController {
+ public:
+  void initializeController() override {}
+
+  void runController() override {
+    for (int leg = 0; leg < 4; leg++) {
+      LegControllerCommand<float>& command = _legController->commands[leg];
+      command.qDes = Vec3<float>(0, -.8f, 1.6f);
+      command.qdDes.setZero();
+      command.kpJoint = Vec3<float>(20, 20, 20).asDiagonal();
+      command.kdJoint = Vec3<float>(.5, .5, .5).asDiagonal();
+      command.tauFeedForward =
+          Vec3<float>(0, 0, 2 * (.25f - _stateEstimate->position[2]));
+    }
+  }
+
+  void updateVisualization() override {}
+  ControlParameters* getUserControlParameters() override { return nullptr; }
+};
+
+// zero initialized, like the shared memory
+static SimulatorToRobotMessage toRobot;
+static RobotToSimulatorMessage toSimulator;
+
+/*!
+ * Once it is running, a control tick of a Mini Cheetah doesn't touch the heap
+ */
+TEST(RobotRunner, controlTickDoesNotAllocate) {
+  RobotControlParameters robotParams;
+  robotParams.initializeFromYamlFile(getConfigDirectoryPath() +
+                                     MINI_CHEETAH_DEFAULT_PARAMETERS);
+  robotParams.use_rc = 0;  // no e-stop from the missing remote
+
+  toRobot.robotType = RobotType::MINI_CHEETAH;
+  toRobot.vectorNav.quat = Quat<float>(0, 0, 0, 1);  // x, y, z, w
+  toRobot.vectorNav.accelerometer = Vec3<float>(0, 0, 9.81f);
+
+  HoldController controller;
+  PeriodicTaskManager taskManager;
+  RobotRunner runner(&controller, &taskManager, 0, "robot-task");
+  runner.publishLcm = false;
+  runner.skipStartup = true;
+  runner.driverCommand = &toRobot.gamepadCommand;
+  runner.spiData = &toRobot.spiData;
+  runner.tiBoardData = toRobot.tiBoardData;
+  runner.robotType = RobotType::MINI_CHEETAH;
+  runner.vectorNavData = &toRobot.vectorNav;
+  runner.cheaterState = &toRobot.cheaterState;
+  runner.spiCommand = &toSimulator.spiCommand;
+  runner.tiBoardCommand = toSimulator.tiBoardCommand;
+  runner.controlParameters = &robotParams;
+  runner.visualizationData = &toSimulator.visualizationData;
+  runner.cheetahMainVisualization = &toSimulator.mainCheetahVisualization;
+  runner.init();
+
+  // the first ticks size buffers and print
+  for (int i = 0; i < 10; i++) runner.run();
+
+  AllocationCounter counter;
+  runner.run();
+  uint64_t allocations = counter.stop();
+
+  // the controller ran and commanded the legs
+  EXPECT_NE(0.f, toSimulator.spiCommand.kp_knee[0]);
+
+  if (!AllocationCounter::hooksInstalled()) {
+    GTEST_SKIP() << "heap allocations are only counted with glibc";
+  }
+  EXPECT_EQ(0u, allocations);
+}
@@ -0,0 +1,35 @@
+function t = read_trajectory(file_name)
+% READ_TRAJECTORY Read a trajectory file written by the simulator or sim-batch
+%   t = read_trajectory('sim-batch-results/trot-forward.traj');
+%   plot(t.time, t.position(:, 3));
+% Each field has one row per dynamics step.  See read_trajectory.py for the
+% file layout.
+
+f = fopen(file_name, 'r', 'ieee-le');
+if f < 0
+    error('could not open %s', file_name);
+end
+magic = fread(f, 8, '*char')';
+version = fread(f, 1, 'uint32');
+nq = fread(f, 1, 'uint32');
+nc = fread(f, 1, 'uint32');
+record_size = fread(f, 1, 'uint32');
+n = fread(f, 1, 'uint64');
+t.dt = fread(f, 1, 'double');
+if ~strncmp(magic, 'CHTRAJ', 6) || version ~= 1 || record_size ~= 8 * (14 + 3 * nq + 3 * nc)
+    fclose(f);
+    error('%s is not a trajectory file', file_name);
+end
+fseek(f, 64, 'bof');
+r = fread(f, [record_size / 8, n], 'double')';
+fclose(f);
+
+t.time = r(:, 1);
+t.quat = r(:, 2:5);
+t.position = r(:, 6:8);
+t.body_velocity = r(:, 9:14);
+t.q = r(:, 15:14 + nq);
+t.qd = r(:, 15 + nq:14 + 2 * nq);
+t.tau = r(:, 15 + 2 * nq:14 + 3 * nq);
+t.contact_force = reshape(r(:, 15 + 3 * nq:end), n, 3, nc);
+end
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""Read a trajectory file written by the simulator or sim-batch.
+
+The file is a 64 byte header followed by one record of doubles per dynamics
+step:
+    time, quat (w, x, y, z), position (3), body velocity (angular, linear),
+    q (nq), qd (nq), tau (nq), contact force (3 per ground contact point)
+
+    import read_trajectory
+    t = read_trajectory.load("sim-batch-results/trot-forward.traj")
+    plot(t["time"], t["position"][:, 2])
+
+The arrays are views into a memory map of the file, so loading is instant.
+Run this file with a trajectory file to print a summary.
+"""
+
+import sys
+
+import numpy as np
+
+HEADER = np.dtype([("magic", "S8"), ("version", "<u4"), ("nq", "<u4"),
+                   ("n_contacts", "<u4"), ("record_size", "<u4"),
+                   ("n_records", "<u8"), ("dt", "<f8"), ("reserved", "V24")])
+
+
+def load(file_name):
+    header = np.fromfile(file_name, dtype=HEADER, count=1)[0]
+    if header["magic"] != b"CHTRAJ" or header["version"] != 1:
+        raise ValueError(file_name + " is not a trajectory file")
+    nq = int(header["nq"])
+    nc = int(header["n_contacts"])
+    record = np.dtype([("time", "<f8"), ("quat", "<f8", 4),
+                       ("position", "<f8", 3), ("body_velocity", "<f8", 6),
+                       ("q", "<f8", nq), ("qd", "<f8", nq), ("tau", "<f8", nq),
+                       ("contact_force", "<f8", (nc, 3))])
+    assert record.itemsize == header["record_size"]
+    records = np.memmap(file_name, dtype=record, mode="r",
+                        offset=HEADER.itemsize, shape=(int(header["n_records"]),))
+    trajectory = {name: records[name] for name in record.names}
+    trajectory["dt"] = float(header["dt"])
+    return trajectory
+
+
+def find(trajectory, time):
+    """Index of the last record at or before time"""
+    return max(int(np.searchsorted(trajectory["time"], time, "right")) - 1, 0)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print("usage: read_trajectory.py <file.traj>")
+        sys.exit(1)
+    t = load(sys.argv[1])
+    print("%d records, %.3f to %.3f s, dt %g" %
+          (len(t["time"]), t["time"][0], t["time"][-1], t["dt"]))
+    print("final position", t["position"][-1])
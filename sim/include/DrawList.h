@@ -18,6 +18,7 @@
 #include "Dynamics/DynamicsSimulator.h"
 #include "Dynamics/FloatingBaseModel.h"
 #include "Dynamics/spatial.h"
+#include "RenderSnapshot.h"
 #include "SimUtilities/VisualizationData.h"
 #include "cppTypes.h"
 #include "obj_loader.h"
@@ -218,6 +219,44 @@ class DrawList {
     }
   }
 
+  /*!
+   * Update the robots, camera origin, contacts and debugging visualizations
+   * from a snapshot published by the simulation.  The visualizations are
+   * drawn straight from the snapshot, so it must not change until the next
+   * call.
+   * @param snapshot : the latest snapshot
+   */
+  void updateFromRenderSnapshot(RenderSnapshot &snapshot) {
+    for (size_t r = 0; r < snapshot.nRobots; r++) {
+      const RenderRobotPose &pose = snapshot.robots[r];
+      for (size_t i = 0; i < pose.nLinks; i++) {
+        _kinematicXform.at(pose.graphicsID + i) = pose.links[i];
+      }
+    }
+
+    if (snapshot.updateCameraOrigin) {
+      _cameraOrigin = snapshot.cameraOrigin;
+    }
+
+    if (_nTotalGC != snapshot.nContacts) {
+      _nTotalGC = snapshot.nContacts;
+      _cp_touch.assign(_nTotalGC, true);
+      _cp_pos.assign(_nTotalGC, std::vector<double>(3));
+      _cp_force.assign(_nTotalGC, std::vector<double>(3));
+      _additionalInfoFirstVisit = false;
+    }
+    for (size_t i(0); i < _nTotalGC; ++i) {
+      for (size_t j(0); j < 3; ++j) {
+        _cp_pos[i][j] = snapshot.contactPosition[i][j];
+        _cp_force[i][j] = snapshot.contactForce[i][j];
+      }
+    }
+
+    _terrainChunks = snapshot.terrainChunks;
+    _nTerrainChunks = snapshot.nTerrainChunks;
+    _visualizationData = &snapshot.visualizationData;
+  }
+
   /*!
    * Updates the position of a checkerboard to match an infinite collision plane
    * The infinite collision plane only specifies orientation, so we
@@ -280,6 +319,11 @@ class DrawList {
   const double &getHeightMapMin() { return _height_map_min; }
   const double &getGridSize() { return _grid_size; }
 
+  size_t getNumTerrainChunks() { return _nTerrainChunks; }
+  const TerrainChunk<double> &getTerrainChunk(size_t i) {
+    return *_terrainChunks[i];
+  }
+
   const Vec3<double> &getCameraOrigin() { return _cameraOrigin; }
   vectorAligned<SolidColor> _instanceColor;
   std::vector<QMatrix4x4> _kinematicXform;
@@ -319,6 +363,10 @@ class DrawList {
   DMat<double> _height_map;
   double _height_map_max, _height_map_min;
 
+  // procedural terrain chunks of the last render snapshot
+  const std::shared_ptr<const TerrainChunk<double>> *_terrainChunks = nullptr;
+  size_t _nTerrainChunks = 0;
+
   Vec3<double> _cameraOrigin;
 
   size_t _cheetah3LoadIndex = 0, _miniCheetahLoadIndex = 0,
@@ -10,6 +10,8 @@
 
 #include "DrawList.h"
 #include "Math/FirstOrderIIRFilter.h"
+#include "RenderSnapshot.h"
+#include "Utilities/TripleBuffer.h"
 #include "obj_loader.h"
 
 #include <QMatrix4x4>
@@ -27,6 +29,7 @@
 #include <QScreen>
 #include <QWheelEvent>
 
+#include <atomic>
 #include <mutex>
 #include "GameController.h"
 
@@ -48,7 +51,22 @@ class Graphics3D : public QOpenGLWidget, protected QOpenGLFunctions {
   // set robot state
   double _fps = 0;
   DrawList _drawList;
-  char infoString[200] = "";
+  char infoString[400] = "";
+
+  /*!
+   * Get the snapshot to fill for the next frame.  Only the simulation thread
+   * may use it, until it calls publishRenderSnapshot.
+   */
+  RenderSnapshot &getRenderSnapshot() { return _renderSnapshots.writeBuffer(); }
+
+  /*!
+   * Give the filled snapshot to the render thread, which draws it on its next
+   * frame.  Never waits for the render thread.
+   */
+  void publishRenderSnapshot() {
+    _renderSnapshots.publish();
+    update();
+  }
 
   GamepadCommand &getDriverCommand() { return _driverCommand; }
   GameController &getGameController() { return _gameController; }
@@ -56,6 +74,12 @@ class Graphics3D : public QOpenGLWidget, protected QOpenGLFunctions {
   void resetGameController() { _gameController.findNewController(); }
 
   bool IsPaused() { return _pause; }
+
+  /*!
+   * Get the number of steps to scrub the replay since the last call, forward
+   * (.) or backward (,) while paused
+   */
+  int takeReplayScrub() { return _replayScrub.exchange(0); }
   bool wantTurbo() { return _turbo; }
   bool wantSloMo() { return _sloMo; }
 
@@ -84,6 +108,7 @@ class Graphics3D : public QOpenGLWidget, protected QOpenGLFunctions {
   GamepadCommand _driverCommand;
 
   std::mutex _gfxMutex;
+  TripleBuffer<RenderSnapshot> _renderSnapshots;
   void scrollGround();
   void updateCameraMatrix();
   void renderDrawlist();
@@ -172,6 +197,7 @@ class Graphics3D : public QOpenGLWidget, protected QOpenGLFunctions {
                      float &r, float &g, float &b);
 
   bool _pause = false;
+  std::atomic<int> _replayScrub{0};
 
   // Vision data visualization
   Vec3<float> _points[5001];
@@ -196,6 +222,7 @@ class Graphics3D : public QOpenGLWidget, protected QOpenGLFunctions {
   bool _obstacle_update = false;
 
   void _drawHeightMap();
+  void _TerrainChunkDrawing();
   void _drawVelArrow();
   void _drawObstacleField();
 };
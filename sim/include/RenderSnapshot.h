@@ -0,0 +1,169 @@
+/*! @file RenderSnapshot.h
+ *  @brief Everything the 3D window needs to draw one frame of the simulation
+ *
+ *  The simulation thread fills a RenderSnapshot from the dynamics simulator
+ *  once per frame and publishes it through a TripleBuffer.  The render thread
+ *  draws from the latest snapshot, so it never reads the simulator while it
+ *  is being stepped and the two threads never wait on each other.
+ */
+
+#ifndef PROJECT_RENDERSNAPSHOT_H
+#define PROJECT_RENDERSNAPSHOT_H
+
+#include <QMatrix4x4>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "Collision/CollisionTerrain.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "SimUtilities/VisualizationData.h"
+#include "cppTypes.h"
+#include "sim_utilities.h"
+
+#define RENDER_SNAPSHOT_MAX_ROBOTS 16  // each simulated robot is drawn twice
+#define RENDER_SNAPSHOT_MAX_LINKS 32
+#define RENDER_SNAPSHOT_MAX_CONTACTS 256
+#define RENDER_SNAPSHOT_MAX_TERRAIN_CHUNKS 256
+
+/*!
+ * Transforms of the moving bodies of one robot in the draw list
+ */
+struct RenderRobotPose {
+  size_t graphicsID = 0;  // draw list id of the first body
+  size_t nLinks = 0;
+  QMatrix4x4 links[RENDER_SNAPSHOT_MAX_LINKS];
+};
+
+struct RenderSnapshot {
+  size_t nRobots = 0;
+  RenderRobotPose robots[RENDER_SNAPSHOT_MAX_ROBOTS];
+
+  bool updateCameraOrigin = false;
+  Vec3<double> cameraOrigin = Vec3<double>::Zero();
+
+  size_t nContacts = 0;
+  Vec3<double> contactPosition[RENDER_SNAPSHOT_MAX_CONTACTS];
+  Vec3<double> contactForce[RENDER_SNAPSHOT_MAX_CONTACTS];
+
+  // procedural terrain chunks are shared with the simulation, not copied
+  size_t nTerrainChunks = 0;
+  std::shared_ptr<const TerrainChunk<double>>
+      terrainChunks[RENDER_SNAPSHOT_MAX_TERRAIN_CHUNKS];
+
+  VisualizationData visualizationData;
+  char infoString[400] = "";
+
+  /*!
+   * Start a new frame
+   */
+  void clear() {
+    nRobots = 0;
+    nContacts = 0;
+    updateCameraOrigin = false;
+    for (size_t i = 0; i < nTerrainChunks; i++) terrainChunks[i].reset();
+    nTerrainChunks = 0;
+  }
+
+  /*!
+   * Add the body transforms of a robot.  Doesn't run the simulator - just
+   * pulls _Xa from the DynamicsSimulator, like DrawList::updateRobotFromModel
+   * @param model  : the simulator
+   * @param id     : the id returned from the loadCheetah3 or loadMiniCheetah
+   * function.
+   * @param updateOrigin : make the camera follow this robot
+   */
+  template <typename T>
+  void addRobot(DynamicsSimulator<T>& model, size_t id,
+                bool updateOrigin = false) {
+    if (nRobots == RENDER_SNAPSHOT_MAX_ROBOTS) {
+      throw std::runtime_error("too many robots in render snapshot");
+    }
+    RenderRobotPose& pose = robots[nRobots++];
+    pose.graphicsID = id;
+    pose.nLinks = 0;
+    for (size_t modelID = 5; modelID < model.getNumBodies() &&
+                             pose.nLinks < RENDER_SNAPSHOT_MAX_LINKS;
+         modelID++) {
+      pose.links[pose.nLinks++] =
+          spatialTransformToQT(model.getModel()._Xa.at(modelID));
+    }
+
+    if (updateOrigin) {
+      updateCameraOrigin = true;
+      cameraOrigin = model.getState().bodyPosition.template cast<double>();
+    }
+  }
+
+  /*!
+   * Add the ground contact points and forces of a robot
+   * @param model  : simulator with the contact point positions
+   * @param forces : force on each contact point, or nullptr to use the
+   * forces in the simulator
+   */
+  template <typename T>
+  void addContacts(DynamicsSimulator<T>& model,
+                   const vectorAligned<Vec3<T>>* forces = nullptr) {
+    for (size_t i = 0; i < model.getTotalNumGC() &&
+                       nContacts < RENDER_SNAPSHOT_MAX_CONTACTS;
+         i++, nContacts++) {
+      contactPosition[nContacts] =
+          model.getModel()._pGC[i].template cast<double>();
+      if (forces && i < forces->size()) {
+        contactForce[nContacts] = (*forces)[i].template cast<double>();
+      } else {
+        contactForce[nContacts] =
+            model.getContactForce(i).template cast<double>();
+      }
+    }
+  }
+
+  /*!
+   * Add the loaded chunks of a procedural terrain, skipping chunks which are
+   * already in the frame (robots close to each other load the same chunks)
+   */
+  template <typename T>
+  void addTerrainChunks(const CollisionTerrain<T>& terrain) {
+    for (auto& chunk : terrain.getChunks()) {
+      if (!chunk || nTerrainChunks == RENDER_SNAPSHOT_MAX_TERRAIN_CHUNKS) {
+        continue;
+      }
+      bool inFrame = false;
+      for (size_t i = 0; i < nTerrainChunks && !inFrame; i++) {
+        inFrame = terrainChunks[i]->x == chunk->x &&
+                  terrainChunks[i]->y == chunk->y;
+      }
+      if (!inFrame) terrainChunks[nTerrainChunks++] = chunk;
+    }
+  }
+
+  /*!
+   * Copy the debugging visualizations from the robot, only copying the items
+   * which are in use
+   */
+  void setVisualizationData(const VisualizationData& data) {
+    VisualizationData& v = visualizationData;
+    v.num_spheres = std::min(data.num_spheres, (size_t)VISUALIZATION_MAX_ITEMS);
+    v.num_blocks = std::min(data.num_blocks, (size_t)VISUALIZATION_MAX_ITEMS);
+    v.num_arrows = std::min(data.num_arrows, (size_t)VISUALIZATION_MAX_ITEMS);
+    v.num_cones = std::min(data.num_cones, (size_t)VISUALIZATION_MAX_ITEMS);
+    v.num_paths = std::min(data.num_paths, (size_t)VISUALIZATION_MAX_PATHS);
+    v.num_meshes = std::min(data.num_meshes, (size_t)VISUALIZATION_MAX_MESHES);
+    std::copy(data.spheres, data.spheres + v.num_spheres, v.spheres);
+    std::copy(data.blocks, data.blocks + v.num_blocks, v.blocks);
+    std::copy(data.arrows, data.arrows + v.num_arrows, v.arrows);
+    std::copy(data.cones, data.cones + v.num_cones, v.cones);
+    std::copy(data.meshes, data.meshes + v.num_meshes, v.meshes);
+    for (size_t i = 0; i < v.num_paths; i++) {
+      const PathVisualization& from = data.paths[i];
+      PathVisualization& to = v.paths[i];
+      to.num_points =
+          std::min(from.num_points, (size_t)VISUALIZATION_MAX_PATH_POINTS);
+      to.color = from.color;
+      std::copy(from.position, from.position + to.num_points, to.position);
+    }
+  }
+};
+
+#endif  // PROJECT_RENDERSNAPSHOT_H
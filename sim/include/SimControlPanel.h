@@ -7,6 +7,7 @@
 #define SIMCONTROLPANEL_H
 
 #include <QMainWindow>
+#include <functional>
 #include <thread>
 #include "ControlParameters/SimulatorParameters.h"
 #include "Graphics3D.h"
@@ -39,7 +40,10 @@ class SimControlPanel : public QMainWindow {
   Q_OBJECT
 
  public:
-  explicit SimControlPanel(QWidget* parent = nullptr);
+  explicit SimControlPanel(
+      QWidget* parent = nullptr,
+      std::function<InProcessRobot*(RobotType)> makeInProcessRobot = nullptr,
+      bool reentrantController = false);
   ~SimControlPanel();
 
 
@@ -120,6 +124,10 @@ public slots:
   bool _ignoreTableCallbacks = false;
   bool _loadedUserSettings = false;
   std::string _terrainFileName;
+  // when set, simulations run the controller in the simulator's process
+  std::function<InProcessRobot*(RobotType)> _makeInProcessRobot;
+  bool _reentrantController;
+  std::vector<InProcessRobot*> _inProcessRobots;
 
   // Vision data Drawing
   void handleHeightmapLCM(const lcm::ReceiveBuffer* rbuf, const std::string& chan, 
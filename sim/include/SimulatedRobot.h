@@ -0,0 +1,195 @@
+/*! @file SimulatedRobot.h
+ *  @brief One robot of a Simulation: its rigid body simulator, low level
+ *  boards, IMU and the connection to its controller
+ *
+ *  Robots in a simulation share the terrain but not each other: every robot
+ *  has its own DynamicsSimulator with its own copy of the collision set, so
+ *  robots can be stepped on separate threads.  Each robot starts at an offset
+ *  in the world, and its controller sees positions relative to that offset,
+ *  so every controller runs as if its robot was alone at the origin.
+ */
+
+#ifndef PROJECT_SIMULATEDROBOT_H
+#define PROJECT_SIMULATEDROBOT_H
+
+#include "ControlParameters/ControlParameterInterface.h"
+#include "ControlParameters/SimulatorParameters.h"
+#include "RenderSnapshot.h"
+#include "SimUtilities/QuadrupedSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
+#include "SimUtilities/SimulatorMessage.h"
+#include "Utilities/SharedMemory.h"
+#include "Utilities/Timer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "simulator_lcmt.hpp"
+
+/*!
+ * Wall time spent in each part of SimulatedRobot::step (s)
+ */
+struct SimPhaseTimes {
+  double dynamics = 0;          // integration, not including collisions
+  double collision = 0;         // contact detection and contact forces
+  double lowLevelControl = 0;   // low level boards and actuator models
+  double highLevelControl = 0;  // handing off to the controller and back
+};
+
+class SimulatedRobot {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  SimulatedRobot(size_t index, RobotType robot,
+                 SimulatorControlParameters& params,
+                 const Vec3<double>& offset);
+  ~SimulatedRobot();
+
+  size_t getIndex() const { return _index; }
+
+  /*!
+   * Get where the robot starts in the world.  Its controller sees positions
+   * relative to this.
+   */
+  const Vec3<double>& getOffset() const { return _quadrupedSim.getOffset(); }
+
+  /*!
+   * Run the robot controller in this process instead of connecting to a
+   * separate robot program.
+   * @param robot : the controller
+   * @param controllerMutex : if set, held while the controller runs, for
+   * controllers which can't run at the same time as another instance
+   */
+  void setInProcessRobot(InProcessRobot* robot,
+                         std::mutex* controllerMutex = nullptr) {
+    _inProcessRobot = robot;
+    _controllerMutex = controllerMutex;
+  }
+
+  bool connect(const bool& wantStop);
+  bool sendControlParameter(const std::string& name,
+                            ControlParameterValue value,
+                            ControlParameterValueKind kind, bool isUser);
+  void stop();
+
+  /*!
+   * Get the error from the controller after a failed step, connect or
+   * sendControlParameter.  Empty if the controller stopped responding.
+   */
+  const char* getErrorMessage() {
+    return _sharedMemory().robotToSim.errorMessage;
+  }
+
+  bool step(double time, double dt, bool runLowLevelControl,
+            bool runHighLevelControl, const GamepadCommand* gamepadCommand);
+
+  void addCollisionPlane(double mu, double resti, double height) {
+    getSimulator().addCollisionPlane(mu, resti, height);
+  }
+  void addCollisionBox(double mu, double resti, double depth, double width,
+                       double height, const Vec3<double>& pos,
+                       const Mat3<double>& ori) {
+    getSimulator().addCollisionBox(mu, resti, depth, width, height, pos, ori);
+  }
+  void addCollisionMesh(double mu, double resti, double grid_size,
+                        const Vec3<double>& left_corner_loc,
+                        const DMat<double>& height_map) {
+    getSimulator().addCollisionMesh(mu, resti, grid_size, left_corner_loc,
+                                    height_map);
+  }
+  void addCollisionTerrain(std::shared_ptr<const ProceduralTerrain> terrain) {
+    _terrains.push_back(getSimulator().addCollisionTerrain(terrain));
+  }
+
+  void setState(const FBModelState<double>& state) {
+    _quadrupedSim.setState(state);
+  }
+  const FBModelState<double>& getState() { return _quadrupedSim.getState(); }
+  DynamicsSimulator<double>& getSimulator() {
+    return _quadrupedSim.getSimulator();
+  }
+
+  /*!
+   * Get the time spent in each part of step since the last resetPhaseTimes
+   */
+  SimPhaseTimes getPhaseTimes() const {
+    SimPhaseTimes times = _phaseTimes;
+    times.collision = _quadrupedSim.getSimulator().getCollisionSeconds();
+    times.dynamics -= times.collision;
+    return times;
+  }
+  void resetPhaseTimes() {
+    _phaseTimes = SimPhaseTimes();
+    getSimulator().resetStepCounter();
+  }
+
+  SimulationSnapshot snapshot(double time, double timeOfNextLowLevelControl,
+                              double timeOfNextHighLevelControl);
+  void restore(const SimulationSnapshot& snapshot);
+
+  void openTrajectory(const std::string& fileName) {
+    // room for a minute, the file grows after that
+    _quadrupedSim.openTrajectory(fileName, 60.);
+  }
+  void truncateTrajectory(double time) {
+    _quadrupedSim.getTrajectory().truncate(time);
+  }
+  bool hasTrajectory() { return _quadrupedSim.getTrajectory().size() > 0; }
+
+  /*!
+   * Set the draw list ids of the robot and of the controller's estimate of
+   * the robot
+   */
+  void setGraphicsIDs(size_t simRobotID, size_t controllerRobotID) {
+    _simRobotID = simRobotID;
+    _controllerRobotID = controllerRobotID;
+  }
+  void addToRenderSnapshot(RenderSnapshot& frame, bool cameraFollows,
+                           bool replaying, double replayTime);
+  void copyVisualizationData(RenderSnapshot& frame);
+
+  /*!
+   * Get the time spent handing the message to the robot and back for each
+   * tick since the last clearHandoffLatencies (us)
+   */
+  const std::vector<double>& getHandoffLatencies() { return _handoffLatencies; }
+  void clearHandoffLatencies() { _handoffLatencies.clear(); }
+
+  void buildLcmMessage(simulator_lcmt& message, double time);
+
+ private:
+  bool highLevelControl(const GamepadCommand* gamepadCommand);
+  void signalRobot();
+  bool waitForRobot();
+  bool loadRecordedState(double time);
+
+  size_t _index;
+  RobotType _robot;
+  SimulatorControlParameters& _simParams;
+
+  std::mutex _robotMutex;
+  SharedMemoryObject<SimulatorSyncronizedMessage> _sharedMemory;
+  InProcessRobot* _inProcessRobot = nullptr;
+  std::mutex* _controllerMutex = nullptr;
+  std::atomic<bool> _stopping;
+  bool _connected = false;
+
+  QuadrupedSimulator _quadrupedSim;
+  std::vector<double> _handoffLatencies;
+  SimPhaseTimes _phaseTimes;
+
+  // drawing the controller's estimate and replaying the recording
+  size_t _simRobotID = 0, _controllerRobotID = 0;
+  FBModelState<double> _robotControllerState;
+  FloatingBaseModel<double> _robotDataModel;
+  DynamicsSimulator<double>* _robotDataSimulator = nullptr;
+  FloatingBaseModel<double> _replayModel;
+  DynamicsSimulator<double>* _replaySimulator = nullptr;
+  std::vector<CollisionTerrain<double>*> _terrains;
+  vectorAligned<Vec3<double>> _replayForces;
+  DVec<double> _replayTau;
+};
+
+#endif  // PROJECT_SIMULATEDROBOT_H
@@ -9,19 +9,17 @@
 #include "ControlParameters/ControlParameterInterface.h"
 #include "ControlParameters/RobotParameters.h"
 #include "ControlParameters/SimulatorParameters.h"
-#include "Dynamics/Cheetah3.h"
-#include "Dynamics/MiniCheetah.h"
 #include "Dynamics/Quadruped.h"
 #include "Graphics3D.h"
-#include "SimUtilities/ImuSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
 #include "SimUtilities/SimulatorMessage.h"
-#include "SimUtilities/SpineBoard.h"
-#include "SimUtilities/ti_boardcontrol.h"
-#include "Utilities/SharedMemory.h"
+#include "SimulatedRobot.h"
 #include "Utilities/Timer.h"
 
+#include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -29,10 +27,14 @@
 #include "simulator_lcmt.hpp"
 
 #define SIM_LCM_NAME "simulator_state"
+#define SIM_TRAJECTORY_FILE "simulator-trajectory.traj"
+#define SIM_MAX_ROBOTS (RENDER_SNAPSHOT_MAX_ROBOTS / 2)
 
 /*!
  * Top-level control of a simulation.
- * A simulation includes 1 robot and 1 controller
+ * A simulation includes num_robots robots (see the simulator parameters), each
+ * with its own controller, on one terrain.  Robots don't collide with each
+ * other, so each one is stepped on its own thread.
  * It does not include the graphics window: this must be set with the setWindow
  * method
  */
@@ -45,10 +47,10 @@ class Simulation {
                       std::function<void(void)> ui_update);
 
   /*!
-   * Explicitly set the state of the robot
+   * Explicitly set the state of a robot
    */
-  void setRobotState(FBModelState<double>& state) {
-    _simulator->setState(state);
+  void setRobotState(FBModelState<double>& state, size_t robot = 0) {
+    _robots.at(robot)->setState(state);
   }
 
   void step(double dt, double dtLowLevelControl, double dtHighLevelControl);
@@ -65,9 +67,7 @@ class Simulation {
                         const Vec3<double>& left_corner_loc,
                         const DMat<double>& height_map, bool addToWindow = true,
                         bool transparent = true);
-
-  void lowLevelControl();
-  void highLevelControl();
+  void addProceduralTerrain(const ProceduralTerrainParameters& params);
 
   /*!
    * Updates the graphics from the connected window
@@ -75,6 +75,8 @@ class Simulation {
   void updateGraphics();
 
   void runAtSpeed(std::function<void(std::string)> error_callback, bool graphics = true);
+  bool runFor(double duration, std::function<void(std::string)> errorCallback,
+              bool stepThreads = true);
   void sendControlParameter(const std::string& name,
                             ControlParameterValue value,
                             ControlParameterValueKind kind,
@@ -87,22 +89,44 @@ class Simulation {
   }
 
   ~Simulation() {
-    delete _simulator;
-    delete _robotDataSimulator;
-    delete _imuSimulator;
+    stopStepThreads();
+    for (auto* robot : _robots) delete robot;
     delete _lcm;
   }
 
-  const FBModelState<double>& getRobotState() { return _simulator->getState(); }
+  size_t getNumRobots() { return _robots.size(); }
+
+  /*!
+   * Get where a robot started in the world
+   */
+  const Vec3<double>& getRobotOffset(size_t robot) {
+    return _robots.at(robot)->getOffset();
+  }
+
+  const FBModelState<double>& getRobotState(size_t robot = 0) {
+    return _robots.at(robot)->getState();
+  }
+
+  SimulationSnapshot snapshot(size_t robot = 0);
+  void restore(const SimulationSnapshot& snapshot, size_t robot = 0);
 
   void stop() {
     _running = false;  // kill simulation loop
     _wantStop = true;  // if we're still trying to connect, this will kill us
 
-    if (_connected) {
-      _sharedMemory().simToRobot.mode = SimulatorMode::EXIT;
-      _sharedMemory().simulatorIsDone();
-    }
+    for (auto* robot : _robots) robot->stop();
+  }
+
+  /*!
+   * Run the controller of a robot in this process instead of connecting to a
+   * separate robot program.  Must be set before the simulation is started.
+   * Unless reentrantController is set, in-process controllers take turns, in
+   * case they share global state.
+   */
+  void setInProcessRobot(InProcessRobot* robot, size_t index = 0,
+                         bool reentrantController = false) {
+    _robots.at(index)->setInProcessRobot(
+        robot, reentrantController ? nullptr : &_inProcessControllerMutex);
   }
 
   SimulatorControlParameters& getSimParams() { return _simParams; }
@@ -118,32 +142,49 @@ class Simulation {
                        bool addGraphics = true);
 
  private:
-  void handleControlError();
+  /*!
+   * A run of steps which each robot takes on its own
+   */
+  struct StepChunk {
+    u64 nSteps = 0;
+    double dt = 0, dtLowLevelControl = 0, dtHighLevelControl = 0;
+    double time = 0, timeOfNextLowLevelControl = 0,
+           timeOfNextHighLevelControl = 0;
+    bool hasGamepadCommand = false;
+    GamepadCommand gamepadCommand;
+  };
+
+  void handleControlError(SimulatedRobot& robot);
+  void reportHandoffLatency();
+  bool stepRobots(u64 nSteps, double dt, double dtLowLevelControl,
+                  double dtHighLevelControl);
+  bool runRobotSteps(size_t robot);
+  void startStepThreads();
+  void stopStepThreads();
+  void stepThread(size_t robot, u64 generation);
   Graphics3D* _window = nullptr;
 
-  std::mutex _robotMutex;
-  SharedMemoryObject<SimulatorSyncronizedMessage> _sharedMemory;
-  ImuSimulator<double>* _imuSimulator = nullptr;
+  std::vector<SimulatedRobot*> _robots;
+  std::mutex _inProcessControllerMutex;
   SimulatorControlParameters& _simParams;
   ControlParameters& _userParams;
   RobotControlParameters _robotParams;
-
-  size_t _simRobotID, _controllerRobotID;
-  Quadruped<double> _quadruped;
-  FBModelState<double> _robotControllerState;
-  FloatingBaseModel<double> _model;
-  FloatingBaseModel<double> _robotDataModel;
-  DVec<double> _tau;
-  DynamicsSimulator<double>* _simulator = nullptr;
-  DynamicsSimulator<double>* _robotDataSimulator = nullptr;
-  std::vector<ActuatorModel<double>> _actuatorModels;
-  SpiCommand _spiCommand;
-  SpiData _spiData;
-  SpineBoard _spineBoards[4];
-  TI_BoardControl _tiBoards[4];
   RobotType _robot;
   lcm::LCM* _lcm = nullptr;
 
+  bool _replaying = false;
+  double _replayTime = 0.;
+
+  // robots 1 and up each step on their own thread, robot 0 on the caller's
+  StepChunk _chunk;
+  std::vector<char> _robotOk;  // if each robot's last chunk went without error
+  std::vector<std::thread> _stepThreads;
+  std::mutex _stepMutex;
+  std::condition_variable _stepStart, _stepDone;
+  u64 _stepGeneration = 0;
+  size_t _stepThreadsBusy = 0;
+  bool _stepThreadsExit = false;
+
   std::function<void(void)> _uiUpdate;
   std::function<void(std::string)> _errorCallback;
   bool _running = false;
@@ -153,7 +194,8 @@ class Simulation {
   double _currentSimTime = 0.;
   double _timeOfNextLowLevelControl = 0.;
   double _timeOfNextHighLevelControl = 0.;
-  s64 _highLevelIterations = 0;
+  std::vector<double> _handoffLatencies;  // us, since the last report
+  double _handoffP50 = 0, _handoffP99 = 0;
   simulator_lcmt _simLCM;
 };
 
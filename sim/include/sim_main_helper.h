@@ -0,0 +1,21 @@
+/*!
+ * @file sim_main_helper.h
+ * @brief Function which should be called in main to start the simulator.
+ *
+ * This header doesn't include Qt, so a robot controller can be linked into the
+ * simulator without knowing about the GUI.
+ */
+
+#ifndef SIM_MAIN_HELPER_H
+#define SIM_MAIN_HELPER_H
+
+#include <functional>
+
+#include "SimUtilities/SimulatorMessage.h"
+
+int sim_main_helper(
+    int argc, char** argv,
+    std::function<InProcessRobot*(RobotType)> makeInProcessRobot = nullptr,
+    bool reentrantController = false);
+
+#endif  // SIM_MAIN_HELPER_H
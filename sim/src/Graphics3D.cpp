@@ -17,6 +17,8 @@
 #endif
 
 #include <unistd.h>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 // background color
@@ -90,6 +92,7 @@ Graphics3D::Graphics3D(QWidget *parent)
       _freeCamFilter(1, 60, _v0)
 {
   std::cout << "[SIM GRAPHICS] New graphics window. \n";
+  _drawList._visualizationData = &_renderSnapshots.readBuffer().visualizationData;
 
   _r[0] = 0.2422;
   _g[0] = 0.1504;
@@ -291,6 +294,12 @@ void Graphics3D::keyPressEvent(QKeyEvent *e) {
       _pause = true;
   }
 
+  if (_pause && e->key() == Qt::Key_Comma) {
+    _replayScrub--;
+  } else if (_pause && e->key() == Qt::Key_Period) {
+    _replayScrub++;
+  }
+
   if(e->key() == Qt::Key_T) {
     _turbo = true;
   }
@@ -504,6 +513,11 @@ void Graphics3D::paintGL() {
   // update joystick:
   _gameController.updateGamepadCommand(_driverCommand);
   if (!_animating) return;
+  if (_renderSnapshots.consume()) {
+    RenderSnapshot &snapshot = _renderSnapshots.readBuffer();
+    _drawList.updateFromRenderSnapshot(snapshot);
+    memcpy(infoString, snapshot.infoString, sizeof(infoString));
+  }
   if (_frame % 60 == 0) {
     qint64 now = QDateTime::currentMSecsSinceEpoch();
     _fps = (60.f * 1000.f / (now - last_frame_ms));
@@ -528,6 +542,7 @@ void Graphics3D::paintGL() {
   }
 
   _MeshObstacleDrawing();
+  _TerrainChunkDrawing();
 
   glDisable(GL_DEPTH_TEST);
   painter2.setPen(QColor(100, 100, 100, 255));
@@ -766,6 +781,59 @@ void Graphics3D::_MeshObstacleDrawing() {
   glPopAttrib();
 }
 
+/*!
+ * Draw the loaded chunks of a procedural terrain as a wireframe colored by
+ * height, with about 40 lines across each chunk in each direction
+ */
+void Graphics3D::_TerrainChunkDrawing() {
+  size_t nChunks = _drawList.getNumTerrainChunks();
+  if (!nChunks) return;
+
+  double height_min = _drawList.getTerrainChunk(0).minHeight;
+  double height_max = _drawList.getTerrainChunk(0).maxHeight;
+  for (size_t c = 1; c < nChunks; c++) {
+    height_min = std::min(height_min, _drawList.getTerrainChunk(c).minHeight);
+    height_max = std::max(height_max, _drawList.getTerrainChunk(c).maxHeight);
+  }
+  double height_gap = std::max(height_max - height_min, 1e-3);
+
+  glLoadMatrixf(_cameraMatrix.data());
+  glPushAttrib(GL_LIGHTING_BIT);
+  glDisable(GL_LIGHTING);
+
+  float color_r(0.f);
+  float color_g(0.f);
+  float color_b(0.f);
+  auto vertex = [&](const CollisionMesh<double> &mesh, long i, long j) {
+    double height = mesh.getHeightMap()(i, j);
+    getHeightColor((height - height_min) / height_gap, color_r, color_g,
+                   color_b);
+    glColor4f(color_r, color_g, color_b, 1.0f);
+    glVertex3d(mesh.getLeftCorner()[0] + i * mesh.getGridSize(),
+               mesh.getLeftCorner()[1] + j * mesh.getGridSize(), height);
+  };
+
+  for (size_t c = 0; c < nChunks; c++) {
+    const CollisionMesh<double> &mesh = _drawList.getTerrainChunk(c).mesh;
+    // the first and last rows and columns overlap the neighboring chunks
+    long last = mesh.getHeightMap().rows() - 2;
+    long stride = std::max(1L, (last - 1) / 40);
+    for (long i = 1; i <= last; i += stride) {
+      glBegin(GL_LINE_STRIP);
+      for (long j = 1; j <= last; j += stride) vertex(mesh, i, j);
+      glEnd();
+    }
+    for (long j = 1; j <= last; j += stride) {
+      glBegin(GL_LINE_STRIP);
+      for (long i = 1; i <= last; i += stride) vertex(mesh, i, j);
+      glEnd();
+    }
+  }
+
+  glEnable(GL_LIGHTING);
+  glPopAttrib();
+}
+
 void Graphics3D::getHeightColor(const double &h, float &r, float &g, float &b) {
   // 0 :  0.2422    0.1504    0.6603
   // 1/7:  0.2810    0.3228    0.9579
@@ -70,11 +70,16 @@ std::string SimControlPanel::getDefaultUserParameterFileName() {
 /*!
  * Init sim window
  */
-SimControlPanel::SimControlPanel(QWidget* parent)
+SimControlPanel::SimControlPanel(
+    QWidget* parent,
+    std::function<InProcessRobot*(RobotType)> makeInProcessRobot,
+    bool reentrantController)
     : QMainWindow(parent),
       ui(new Ui::SimControlPanel),
       _userParameters("user-parameters"),
       _terrainFileName(getConfigDirectoryPath() + DEFAULT_TERRAIN_FILE),
+      _makeInProcessRobot(makeInProcessRobot),
+      _reentrantController(reentrantController),
       _heightmapLCM(getLcmUrl(255)),
       _pointsLCM(getLcmUrl(255)),
       _indexmapLCM(getLcmUrl(255)),
@@ -273,6 +278,7 @@ void SimControlPanel::handleSpiDebug(const lcm::ReceiveBuffer *rbuf, const std::
 
 SimControlPanel::~SimControlPanel() {
   delete _simulation;
+  for (auto* robot : _inProcessRobots) delete robot;
   delete _interfaceTaskManager;
   delete _robotInterface;
   delete _graphicsWindow;
@@ -383,6 +389,15 @@ void SimControlPanel::on_startButton_clicked() {
       loadSimulationParameters(_simulation->getSimParams());
       loadRobotParameters(_simulation->getRobotParams());
 
+      if (_makeInProcessRobot) {
+        printf("[SimControlPanel] Initialize in-process robot controllers...\n");
+        for (size_t i = 0; i < _simulation->getNumRobots(); i++) {
+          _inProcessRobots.push_back(_makeInProcessRobot(robotType));
+          _simulation->setInProcessRobot(_inProcessRobots.back(), i,
+                                         _reentrantController);
+        }
+      }
+
       // terrain
       printf("[SimControlParameter] Load terrain...\n");
       _simulation->loadTerrainFile(_terrainFileName);
@@ -453,9 +468,11 @@ void SimControlPanel::on_stopButton_clicked() {
   delete _interfaceTaskManager;
   delete _robotInterface;
   delete _simulation;
+  for (auto* robot : _inProcessRobots) delete robot;
   delete _graphicsWindow;
 
   _simulation = nullptr;
+  _inProcessRobots.clear();
   _graphicsWindow = nullptr;
   _robotInterface = nullptr;
   _interfaceTaskManager = nullptr;
@@ -854,7 +871,11 @@ void SimControlPanel::on_goHomeButton_clicked() {
   homeState.q << -0.05, -0.8, 1.7, 0.05, -0.8, 1.7, -0.05, -0.8, 1.7, 0.05, -0.8, 1.7;
   homeState.qd = homeState.q;
 
-  _simulation->setRobotState(homeState);
+  for (size_t i = 0; i < _simulation->getNumRobots(); i++) {
+    FBModelState<double> robotHomeState = homeState;
+    robotHomeState.bodyPosition += _simulation->getRobotOffset(i);
+    _simulation->setRobotState(robotHomeState, i);
+  }
 }
 
 void SimControlPanel::on_kickButton_clicked() {
@@ -865,7 +886,9 @@ void SimControlPanel::on_kickButton_clicked() {
       ui->kickLinearX->text().toDouble(), ui->kickLinearY->text().toDouble(),
       ui->kickLinearZ->text().toDouble();
 
-  FBModelState<double> state = _simulation->getRobotState();
-  state.bodyVelocity += kickVelocity;
-  _simulation->setRobotState(state);
+  for (size_t i = 0; i < _simulation->getNumRobots(); i++) {
+    FBModelState<double> state = _simulation->getRobotState(i);
+    state.bodyVelocity += kickVelocity;
+    _simulation->setRobotState(state, i);
+  }
 }
@@ -0,0 +1,448 @@
+/*! @file SimulatedRobot.cpp
+ *  @brief One robot of a Simulation: its rigid body simulator, low level
+ *  boards, IMU and the connection to its controller
+ */
+
+#include "SimulatedRobot.h"
+
+#include <unistd.h>
+#include <cstring>
+
+/*!
+ * Build the robot, lying on the ground at its offset, and create the shared
+ * memory for its controller.  Call with the simulator parameters locked.
+ * @param index : which robot of the simulation this is, which picks its shared
+ * memory (see simulatorSharedMemoryName)
+ * @param robot : the type of robot
+ * @param params : simulator parameters, shared by all robots
+ * @param offset : where the robot starts in the world
+ */
+SimulatedRobot::SimulatedRobot(size_t index, RobotType robot,
+                               SimulatorControlParameters& params,
+                               const Vec3<double>& offset)
+    : _index(index),
+      _robot(robot),
+      _simParams(params),
+      _stopping(false),
+      _quadrupedSim(robot, params, offset) {
+  // models to draw the controller's estimate and the recording
+  _robotDataModel = _quadrupedSim.getQuadruped().buildModel();
+  _replayModel = _quadrupedSim.getQuadruped().buildModel();
+  _robotDataSimulator = new DynamicsSimulator<double>(_robotDataModel, false);
+  _replaySimulator = new DynamicsSimulator<double>(_replayModel, false);
+
+  DVec<double> zero12(12);
+  for (u32 i = 0; i < 12; i++) {
+    zero12[i] = 0.;
+  }
+
+  // set some sane defaults:
+  _robotControllerState.q = zero12;
+  _robotControllerState.qd = zero12;
+  FBModelState<double> x0;
+  x0.bodyOrientation = rotationMatrixToQuaternion(
+      ori::coordinateRotation(CoordinateAxis::Z, 1.));
+  // Mini Cheetah
+  x0.bodyPosition.setZero();
+  x0.bodyVelocity.setZero();
+  x0.q = zero12;
+  x0.qd = zero12;
+
+  // Mini Cheetah Initial Posture
+  // x0.bodyPosition[2] = -0.49;
+  // Cheetah 3
+  // x0.bodyPosition[2] = -0.34;
+  // x0.q[0] = -0.807;
+  // x0.q[1] = -1.2;
+  // x0.q[2] = 2.4;
+
+  // x0.q[3] = 0.807;
+  // x0.q[4] = -1.2;
+  // x0.q[5] = 2.4;
+
+  // x0.q[6] = -0.807;
+  // x0.q[7] = -1.2;
+  // x0.q[8] = 2.4;
+
+  // x0.q[9] = 0.807;
+  // x0.q[10] = -1.2;
+  // x0.q[11] = 2.4;
+
+  // Initial (Mini Cheetah stand)
+  // x0.bodyPosition[2] = -0.185;
+  // Cheetah 3
+  // x0.bodyPosition[2] = -0.075;
+
+  // x0.q[0] = -0.03;
+  // x0.q[1] = -0.79;
+  // x0.q[2] = 1.715;
+
+  // x0.q[3] = 0.03;
+  // x0.q[4] = -0.79;
+  // x0.q[5] = 1.715;
+
+  // x0.q[6] = -0.03;
+  // x0.q[7] = -0.72;
+  // x0.q[8] = 1.715;
+
+  // x0.q[9] = 0.03;
+  // x0.q[10] = -0.72;
+  // x0.q[11] = 1.715;
+
+  // Cheetah lies on the ground
+  //x0.bodyPosition[2] = -0.45;
+  x0.bodyPosition[2] = 0.05;
+  x0.q[0] = -0.7;
+  x0.q[1] = 1.;
+  x0.q[2] = 2.715;
+
+  x0.q[3] = 0.7;
+  x0.q[4] = 1.;
+  x0.q[5] = 2.715;
+
+  x0.q[6] = -0.7;
+  x0.q[7] = -1.0;
+  x0.q[8] = -2.715;
+
+  x0.q[9] = 0.7;
+  x0.q[10] = -1.0;
+  x0.q[11] = -2.715;
+
+  x0.bodyPosition += offset;
+  _quadrupedSim.setState(x0);
+  _robotDataSimulator->setState(x0);
+
+  // init shared memory
+  _sharedMemory.createNew(simulatorSharedMemoryName(_index), true);
+  _sharedMemory().setHandoff((SimulatorHandoff)_simParams.robot_handoff);
+  _sharedMemory().init();
+  _sharedMemory().simToRobot.robotType = _robot;
+}
+
+SimulatedRobot::~SimulatedRobot() {
+  delete _robotDataSimulator;
+  delete _replaySimulator;
+}
+
+/*!
+ * Wait for the controller to answer.  Blocks until the robot program is
+ * started, checking wantStop at 10 Hz.
+ * @return false if the controller had an error, or if we gave up because of
+ * wantStop
+ */
+bool SimulatedRobot::connect(const bool& wantStop) {
+  _robotMutex.lock();
+  _sharedMemory().simToRobot.mode = SimulatorMode::DO_NOTHING;
+  signalRobot();
+
+  if (_inProcessRobot) {
+    // nothing to wait for, but this checks that the robot type matches
+    if (!waitForRobot()) {
+      _robotMutex.unlock();
+      return false;
+    }
+  } else {
+    // this loop will check to see if the robot is connected at 10 Hz
+    // doing this in a loop allows us to click the "stop" button in the GUI
+    // and escape from here before the robot code connects, if needed
+    while (!_sharedMemory().tryWaitForRobot()) {
+      if (wantStop) {
+        _robotMutex.unlock();
+        return false;
+      }
+      usleep(100000);
+    }
+  }
+  _connected = true;
+  _robotMutex.unlock();
+  return true;
+}
+
+/*!
+ * Set a parameter in the controller
+ * @return false if the controller had an error
+ */
+bool SimulatedRobot::sendControlParameter(const std::string& name,
+                                          ControlParameterValue value,
+                                          ControlParameterValueKind kind,
+                                          bool isUser) {
+  ControlParameterRequest& request =
+      _sharedMemory().simToRobot.controlParameterRequest;
+  ControlParameterResponse& response =
+      _sharedMemory().robotToSim.controlParameterResponse;
+
+  // first check no pending message
+  assert(request.requestNumber == response.requestNumber);
+
+  // new message
+  request.requestNumber++;
+
+  // message data
+  request.requestKind = isUser ? ControlParameterRequestKind::SET_USER_PARAM_BY_NAME : ControlParameterRequestKind::SET_ROBOT_PARAM_BY_NAME;
+  strcpy(request.name, name.c_str());
+  request.value = value;
+  request.parameterKind = kind;
+  printf("%s\n", request.toString().c_str());
+
+  // run robot:
+  _robotMutex.lock();
+  _sharedMemory().simToRobot.mode = SimulatorMode::RUN_CONTROL_PARAMETERS;
+  signalRobot();
+
+  // wait for robot code to finish
+  if (!waitForRobot()) {
+    request.requestNumber = response.requestNumber; // so if we come back we won't be off by 1
+    _robotMutex.unlock();
+    return false;
+  }
+  _robotMutex.unlock();
+
+  // verify response is good
+  assert(response.requestNumber == request.requestNumber);
+  assert(response.parameterKind == request.parameterKind);
+  assert(std::string(response.name) == request.name);
+  return true;
+}
+
+/*!
+ * Tell a robot program that the simulation is over
+ */
+void SimulatedRobot::stop() {
+  _stopping = true;
+  if (_connected && !_inProcessRobot) {
+    _sharedMemory().simToRobot.mode = SimulatorMode::EXIT;
+    _sharedMemory().simulatorIsDone();
+  }
+}
+
+/*!
+ * Tell the robot code that the message is ready.  An in-process robot is run
+ * by waitForRobot instead.
+ */
+void SimulatedRobot::signalRobot() {
+  if (!_inProcessRobot) {
+    _sharedMemory().simulatorIsDone();
+  }
+}
+
+/*!
+ * Wait for the robot code to handle the message, or run it directly when it
+ * is in this process.
+ * @return false if the robot timed out or had an error
+ */
+bool SimulatedRobot::waitForRobot() {
+  if (!_inProcessRobot) {
+    return _sharedMemory().waitForRobotWithTimeout();
+  }
+
+  if (_controllerMutex) _controllerMutex->lock();
+  try {
+    _inProcessRobot->handleSimulatorMessage(_sharedMemory());
+  } catch (std::exception& e) {
+    if (_controllerMutex) _controllerMutex->unlock();
+    auto& errorMessage = _sharedMemory().robotToSim.errorMessage;
+    strncpy(errorMessage, e.what(), sizeof(errorMessage) - 1);
+    errorMessage[sizeof(errorMessage) - 1] = '\0';
+    return false;
+  }
+  if (_controllerMutex) _controllerMutex->unlock();
+  return true;
+}
+
+/*!
+ * Take a single timestep of dt seconds
+ * @param time : simulation time at the end of the step
+ * @param gamepadCommand : joystick to send to the controller, if any
+ * @return false if the controller had an error
+ */
+bool SimulatedRobot::step(double time, double dt, bool runLowLevelControl,
+                          bool runHighLevelControl,
+                          const GamepadCommand* gamepadCommand) {
+  Timer phaseTimer;
+
+  // Low level control (if needed)
+  if (runLowLevelControl) {
+    _quadrupedSim.lowLevelControl();
+  }
+  double lowLevelTime = phaseTimer.getSeconds();
+
+  // High level control
+  phaseTimer.start();
+  if (runHighLevelControl) {
+    if (!highLevelControl(gamepadCommand)) return false;
+  }
+  _phaseTimes.highLevelControl += phaseTimer.getSeconds();
+
+  // actuator model:
+  phaseTimer.start();
+  _quadrupedSim.updateActuators(dt);
+  _phaseTimes.lowLevelControl += lowLevelTime + phaseTimer.getSeconds();
+
+  // dynamics
+  phaseTimer.start();
+  _quadrupedSim.integrate(time, dt);
+  _phaseTimes.dynamics += phaseTimer.getSeconds();
+  return true;
+}
+
+/*!
+ * Run the controller once
+ * @return false if the controller had an error
+ */
+bool SimulatedRobot::highLevelControl(const GamepadCommand* gamepadCommand) {
+  // send joystick data to robot:
+  if (gamepadCommand) {
+    _sharedMemory().simToRobot.gamepadCommand = *gamepadCommand;
+    _sharedMemory().simToRobot.gamepadCommand.applyDeadband(
+        _simParams.game_controller_deadband);
+  }
+
+  // send IMU and leg data to robot, relative to where the robot started:
+  _quadrupedSim.writeSensorData(_sharedMemory().simToRobot);
+
+  // signal to the robot that it can start running
+  // the _robotMutex is used to prevent qt (which runs in its own thread) from
+  // sending a control parameter while the robot code is already running.
+  _robotMutex.lock();
+  _sharedMemory().simToRobot.mode = SimulatorMode::RUN_CONTROLLER;
+  signalRobot();
+
+  // first make sure we haven't killed the robot code
+  if (_stopping) {
+    _robotMutex.unlock();
+    return true;
+  }
+
+  // next try waiting at most 1 second:
+  if (!waitForRobot()) {
+    _robotMutex.unlock();
+    return false;
+  }
+  _robotMutex.unlock();
+
+  if (!_inProcessRobot) {
+    _handoffLatencies.push_back(_sharedMemory().lastHandoffLatency() / 1.e3);
+  }
+
+  // update
+  _quadrupedSim.readCommands(_sharedMemory().robotToSim);
+  return true;
+}
+
+void SimulatedRobot::buildLcmMessage(simulator_lcmt& message, double time) {
+  message.time = time;
+  message.timesteps = _quadrupedSim.getHighLevelIterations();
+  DynamicsSimulator<double>& simulator = _quadrupedSim.getSimulator();
+  auto& state = simulator.getState();
+  auto& dstate = simulator.getDState();
+
+  Vec3<double> rpy = ori::quatToRPY(state.bodyOrientation);
+  RotMat<double> Rbody = ori::quaternionToRotationMatrix(state.bodyOrientation);
+  Vec3<double> omega = Rbody.transpose() * state.bodyVelocity.head<3>();
+  Vec3<double> v = Rbody.transpose() * state.bodyVelocity.tail<3>();
+
+  for (size_t i = 0; i < 4; i++) {
+    message.quat[i] = state.bodyOrientation[i];
+  }
+
+  for (size_t i = 0; i < 3; i++) {
+    message.vb[i] = state.bodyVelocity[i + 3];  // linear velocity in body frame
+    message.rpy[i] = rpy[i];
+    for (size_t j = 0; j < 3; j++) {
+      message.R[i][j] = Rbody(i, j);
+    }
+    message.omegab[i] = state.bodyVelocity[i];
+    message.omega[i] = omega[i];
+    message.p[i] = state.bodyPosition[i];
+    message.v[i] = v[i];
+    message.vbd[i] = dstate.dBodyVelocity[i + 3];
+  }
+
+  for (size_t leg = 0; leg < 4; leg++) {
+    for (size_t joint = 0; joint < 3; joint++) {
+      message.q[leg][joint] = state.q[leg * 3 + joint];
+      message.qd[leg][joint] = state.qd[leg * 3 + joint];
+      message.qdd[leg][joint] = dstate.qdd[leg * 3 + joint];
+      message.tau[leg][joint] = _quadrupedSim.getTorques()[leg * 3 + joint];
+      size_t gcID = simulator.getModel()._footIndicesGC.at(leg);
+      message.p_foot[leg][joint] = simulator.getModel()._pGC.at(gcID)[joint];
+      message.f_foot[leg][joint] = simulator.getContactForce(gcID)[joint];
+    }
+  }
+}
+
+/*!
+ * Save the state of the robot.  The controller keeps running from its own
+ * state, it is not part of the snapshot.
+ */
+SimulationSnapshot SimulatedRobot::snapshot(double time,
+                                            double timeOfNextLowLevelControl,
+                                            double timeOfNextHighLevelControl) {
+  return _quadrupedSim.snapshot(time, timeOfNextLowLevelControl,
+                                timeOfNextHighLevelControl);
+}
+
+/*!
+ * Go back to the state in a snapshot of this type of robot.  The clock in the
+ * snapshot is not used, it belongs to the whole simulation.
+ */
+void SimulatedRobot::restore(const SimulationSnapshot& snapshot) {
+  _quadrupedSim.restore(snapshot);
+}
+
+/*!
+ * Add the robot, the controller's estimate of the robot and the contact
+ * forces to a frame
+ * @param cameraFollows : make the camera follow this robot
+ * @param replaying : draw the robot from the recording instead
+ * @param replayTime : time to draw from the recording
+ */
+void SimulatedRobot::addToRenderSnapshot(RenderSnapshot& frame,
+                                         bool cameraFollows, bool replaying,
+                                         double replayTime) {
+  auto& estimate = _sharedMemory().robotToSim.mainCheetahVisualization;
+  _robotControllerState.bodyOrientation = estimate.quat.cast<double>();
+  _robotControllerState.bodyPosition =
+      estimate.p.cast<double>() + _quadrupedSim.getOffset();
+  for (int i = 0; i < 12; i++) _robotControllerState.q[i] = estimate.q[i];
+  _robotDataSimulator->setState(_robotControllerState);
+  _robotDataSimulator->forwardKinematics();  // calc all body positions
+  frame.addRobot(*_robotDataSimulator, _controllerRobotID, false);
+
+  if (replaying && loadRecordedState(replayTime)) {
+    frame.addRobot(*_replaySimulator, _simRobotID, cameraFollows);
+    frame.addContacts(*_replaySimulator, &_replayForces);
+  } else {
+    frame.addRobot(_quadrupedSim.getSimulator(), _simRobotID, cameraFollows);
+    frame.addContacts(_quadrupedSim.getSimulator());
+  }
+  for (auto* terrain : _terrains) frame.addTerrainChunks(*terrain);
+}
+
+/*!
+ * Copy the debugging visualizations of the controller to a frame
+ */
+void SimulatedRobot::copyVisualizationData(RenderSnapshot& frame) {
+  // the robot only writes visualizations while it runs, which is never
+  // during a frame unless a parameter is being sent
+  _robotMutex.lock();
+  frame.setVisualizationData(_sharedMemory().robotToSim.visualizationData);
+  _robotMutex.unlock();
+}
+
+/*!
+ * Put the robot as it was at an earlier time, from the trajectory recording
+ * (see the record_trajectory parameter), in the replay simulator.  This
+ * doesn't change the simulation.
+ * @return false if there is no recording
+ */
+bool SimulatedRobot::loadRecordedState(double time) {
+  TrajectoryRecorder& recorder = _quadrupedSim.getTrajectory();
+  if (!recorder.size()) return false;
+  FBModelState<double> state;
+  recorder.getRecord(recorder.findRecord(time), state, _replayTau,
+                     _replayForces);
+  _replaySimulator->setState(state);
+  _replaySimulator->forwardKinematics();
+  return true;
+}
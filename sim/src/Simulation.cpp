@@ -1,23 +1,49 @@
 #include "Simulation.h"
 #include "Dynamics/Quadruped.h"
-#include "ParamHandler.hpp"
+#include "SimUtilities/TerrainFile.h"
 
 #include <Configuration.h>
+#include <algorithm>
 #include <include/GameController.h>
 #include <unistd.h>
-#include <fstream>
 
 // if DISABLE_HIGH_LEVEL_CONTROL is defined, the simulator will run freely,
 // without trying to connect to a robot
 //#define DISABLE_HIGH_LEVEL_CONTROL
 
+/*!
+ * Advance the simulation clock by one dynamics step
+ * @param runLowLevelControl : set if the low level control runs this step
+ * @param runHighLevelControl : set if the controller runs this step
+ */
+static void tickClock(double& time, double& timeOfNextLowLevelControl,
+                      double& timeOfNextHighLevelControl, double dt,
+                      double dtLowLevelControl, double dtHighLevelControl,
+                      bool& runLowLevelControl, bool& runHighLevelControl) {
+  runLowLevelControl = time >= timeOfNextLowLevelControl;
+  if (runLowLevelControl) {
+    timeOfNextLowLevelControl = timeOfNextLowLevelControl + dtLowLevelControl;
+  }
+
+  runHighLevelControl = time >= timeOfNextHighLevelControl;
+  if (runHighLevelControl) {
+    timeOfNextHighLevelControl =
+        timeOfNextHighLevelControl + dtHighLevelControl;
+  }
+#ifdef DISABLE_HIGH_LEVEL_CONTROL
+  runHighLevelControl = false;
+#endif
+
+  time += dt;
+}
+
 /*!
  * Initialize the simulator here.  It is _not_ okay to block here waiting for
  * the robot to connect. Use firstRun() instead!
  */
 Simulation::Simulation(RobotType robot, Graphics3D* window,
                        SimulatorControlParameters& params, ControlParameters& userParams, std::function<void(void)> uiUpdate)
-    : _simParams(params), _userParams(userParams), _tau(12) {
+    : _simParams(params), _userParams(userParams) {
   _uiUpdate = uiUpdate;
   // init parameters
   printf("[Simulation] Load parameters...\n");
@@ -30,6 +56,11 @@ Simulation::Simulation(RobotType robot, Graphics3D* window,
         _simParams.generateUnitializedList().c_str());
     throw std::runtime_error("simulator not initialized");
   }
+  if (_simParams.num_robots < 1 || _simParams.num_robots > SIM_MAX_ROBOTS) {
+    _simParams.unlockMutex();
+    throw std::runtime_error("num_robots must be between 1 and " +
+                             std::to_string(SIM_MAX_ROBOTS));
+  }
 
   // init LCM
   if (_simParams.sim_state_lcm) {
@@ -41,152 +72,29 @@ Simulation::Simulation(RobotType robot, Graphics3D* window,
     }
   }
 
-  // init quadruped info
-  printf("[Simulation] Build quadruped...\n");
+  // init robots, in a row along the y axis
   _robot = robot;
-  _quadruped = _robot == RobotType::MINI_CHEETAH ? buildMiniCheetah<double>()
-                                                 : buildCheetah3<double>();
-  printf("[Simulation] Build actuator model...\n");
-  _actuatorModels = _quadruped.buildActuatorModels();
   _window = window;
-
-  // init graphics
-  if (_window) {
-    printf("[Simulation] Setup Cheetah graphics...\n");
-    Vec4<float> truthColor, seColor;
-    truthColor << 0.2, 0.4, 0.2, 0.6;
-    seColor << 0.4, 0.2, 0.2, 0.6;
-    _simRobotID = _robot == RobotType::MINI_CHEETAH ? window->setupMiniCheetah(truthColor, true)
-                                                    : window->setupCheetah3(truthColor, true);
-    _controllerRobotID = _robot == RobotType::MINI_CHEETAH
-                             ? window->setupMiniCheetah(seColor, false)
-                             : window->setupCheetah3(seColor, false);
-  }
-
-  // init rigid body dynamics
-  printf("[Simulation] Build rigid body model...\n");
-  _model = _quadruped.buildModel();
-  _robotDataModel = _quadruped.buildModel();
-  _simulator =
-      new DynamicsSimulator<double>(_model, (bool)_simParams.use_spring_damper);
-  _robotDataSimulator = new DynamicsSimulator<double>(_robotDataModel, false);
-
-  DVec<double> zero12(12);
-  for (u32 i = 0; i < 12; i++) {
-    zero12[i] = 0.;
-  }
-
-  // set some sane defaults:
-  _tau = zero12;
-  _robotControllerState.q = zero12;
-  _robotControllerState.qd = zero12;
-  FBModelState<double> x0;
-  x0.bodyOrientation = rotationMatrixToQuaternion(
-      ori::coordinateRotation(CoordinateAxis::Z, 1.));
-  // Mini Cheetah
-  x0.bodyPosition.setZero();
-  x0.bodyVelocity.setZero();
-  x0.q = zero12;
-  x0.qd = zero12;
-
-  // Mini Cheetah Initial Posture
-  // x0.bodyPosition[2] = -0.49;
-  // Cheetah 3
-  // x0.bodyPosition[2] = -0.34;
-  // x0.q[0] = -0.807;
-  // x0.q[1] = -1.2;
-  // x0.q[2] = 2.4;
-
-  // x0.q[3] = 0.807;
-  // x0.q[4] = -1.2;
-  // x0.q[5] = 2.4;
-
-  // x0.q[6] = -0.807;
-  // x0.q[7] = -1.2;
-  // x0.q[8] = 2.4;
-
-  // x0.q[9] = 0.807;
-  // x0.q[10] = -1.2;
-  // x0.q[11] = 2.4;
-
-  // Initial (Mini Cheetah stand)
-  // x0.bodyPosition[2] = -0.185;
-  // Cheetah 3
-  // x0.bodyPosition[2] = -0.075;
-
-  // x0.q[0] = -0.03;
-  // x0.q[1] = -0.79;
-  // x0.q[2] = 1.715;
-
-  // x0.q[3] = 0.03;
-  // x0.q[4] = -0.79;
-  // x0.q[5] = 1.715;
-
-  // x0.q[6] = -0.03;
-  // x0.q[7] = -0.72;
-  // x0.q[8] = 1.715;
-
-  // x0.q[9] = 0.03;
-  // x0.q[10] = -0.72;
-  // x0.q[11] = 1.715;
-
-  // Cheetah lies on the ground
-  //x0.bodyPosition[2] = -0.45;
-  x0.bodyPosition[2] = 0.05;
-  x0.q[0] = -0.7;
-  x0.q[1] = 1.;
-  x0.q[2] = 2.715;
-
-  x0.q[3] = 0.7;
-  x0.q[4] = 1.;
-  x0.q[5] = 2.715;
-
-  x0.q[6] = -0.7;
-  x0.q[7] = -1.0;
-  x0.q[8] = -2.715;
-
-  x0.q[9] = 0.7;
-  x0.q[10] = -1.0;
-  x0.q[11] = -2.715;
-
-
-  setRobotState(x0);
-  _robotDataSimulator->setState(x0);
-
-  printf("[Simulation] Setup low-level control...\n");
-  // init spine:
-  if (_robot == RobotType::MINI_CHEETAH) {
-    for (int leg = 0; leg < 4; leg++) {
-      _spineBoards[leg].init(Quadruped<float>::getSideSign(leg), leg);
-      _spineBoards[leg].data = &_spiData;
-      _spineBoards[leg].cmd = &_spiCommand;
-      _spineBoards[leg].resetData();
-      _spineBoards[leg].resetCommand();
-    }
-  } else if (_robot == RobotType::CHEETAH_3) {
-    // init ti board
-    for (int leg = 0; leg < 4; leg++) {
-      _tiBoards[leg].init(Quadruped<float>::getSideSign(leg));
-      _tiBoards[leg].set_link_lengths(_quadruped._abadLinkLength,
-                                      _quadruped._hipLinkLength,
-                                      _quadruped._kneeLinkLength);
-      _tiBoards[leg].reset_ti_board_command();
-      _tiBoards[leg].reset_ti_board_data();
-      _tiBoards[leg].run_ti_board_iteration();
+  for (size_t i = 0; i < (size_t)_simParams.num_robots; i++) {
+    printf("[Simulation] Build robot %zu...\n", i);
+    Vec3<double> offset(0, i * _simParams.robot_spacing, 0);
+    _robots.push_back(new SimulatedRobot(i, _robot, _simParams, offset));
+    if (_window) {
+      Vec4<float> truthColor, seColor;
+      truthColor << 0.2, 0.4, 0.2, 0.6;
+      seColor << 0.4, 0.2, 0.2, 0.6;
+      size_t simRobotID = _robot == RobotType::MINI_CHEETAH
+                              ? window->setupMiniCheetah(truthColor, true)
+                              : window->setupCheetah3(truthColor, true);
+      size_t controllerRobotID = _robot == RobotType::MINI_CHEETAH
+                                     ? window->setupMiniCheetah(seColor, false)
+                                     : window->setupCheetah3(seColor, false);
+      _robots.back()->setGraphicsIDs(simRobotID, controllerRobotID);
     }
-  } else {
-    assert(false);
+    printf("[Simulation] Robot %zu connects through shared memory %s\n", i,
+           simulatorSharedMemoryName(i).c_str());
   }
-
-  // init shared memory
-  printf("[Simulation] Setup shared memory...\n");
-  _sharedMemory.createNew(DEVELOPMENT_SIMULATOR_SHARED_MEMORY_NAME, true);
-  _sharedMemory().init();
-
-  // shared memory fields:
-  _sharedMemory().simToRobot.robotType = _robot;
-  _window->_drawList._visualizationData =
-      &_sharedMemory().robotToSim.visualizationData;
+  _robotOk.resize(_robots.size(), true);
 
   // load robot control parameters
   printf("[Simulation] Load control parameters...\n");
@@ -205,75 +113,108 @@ Simulation::Simulation(RobotType robot, Graphics3D* window,
            _robotParams.generateUnitializedList().c_str());
     throw std::runtime_error("not all parameters initialized from ini file");
   }
-  // init IMU simulator
-  printf("[Simulation] Setup IMU simulator...\n");
-  _imuSimulator = new ImuSimulator<double>(_simParams);
+  if (_simParams.record_trajectory) {
+    for (auto* r : _robots) {
+      std::string fileName = SIM_TRAJECTORY_FILE;
+      if (r->getIndex() > 0) {
+        fileName = "simulator-trajectory-" + std::to_string(r->getIndex()) +
+                   ".traj";
+      }
+      printf("[Simulation] Record trajectory to %s\n", fileName.c_str());
+      r->openTrajectory(fileName);
+    }
+  }
 
   _simParams.unlockMutex();
   printf("[Simulation] Ready!\n");
 }
 
+/*!
+ * Set a parameter in the controller of every robot
+ */
 void Simulation::sendControlParameter(const std::string& name,
                                       ControlParameterValue value,
                                       ControlParameterValueKind kind, bool isUser) {
-  ControlParameterRequest& request =
-      _sharedMemory().simToRobot.controlParameterRequest;
-  ControlParameterResponse& response =
-      _sharedMemory().robotToSim.controlParameterResponse;
-
-  // first check no pending message
-  assert(request.requestNumber == response.requestNumber);
-
-  // new message
-  request.requestNumber++;
-
-  // message data
-  request.requestKind = isUser ? ControlParameterRequestKind::SET_USER_PARAM_BY_NAME : ControlParameterRequestKind::SET_ROBOT_PARAM_BY_NAME;
-  strcpy(request.name, name.c_str());
-  request.value = value;
-  request.parameterKind = kind;
-  printf("%s\n", request.toString().c_str());
-
-  // run robot:
-  _robotMutex.lock();
-  _sharedMemory().simToRobot.mode = SimulatorMode::RUN_CONTROL_PARAMETERS;
-  _sharedMemory().simulatorIsDone();
-
-  // wait for robot code to finish
-  if (_sharedMemory().waitForRobotWithTimeout()) {
-  } else {
-    handleControlError();
-    request.requestNumber = response.requestNumber; // so if we come back we won't be off by 1
-    _robotMutex.unlock();
-    return;
+  for (auto* robot : _robots) {
+    if (!robot->sendControlParameter(name, value, kind, isUser)) {
+      handleControlError(*robot);
+      return;
+    }
   }
+}
+
+/*!
+ * Print percentiles of the time spent handing the message to the robot and
+ * back since the last report, not counting the controller itself
+ */
+void Simulation::reportHandoffLatency() {
+  std::vector<double>& l = _handoffLatencies;
+  l.clear();
+  for (auto* robot : _robots) {
+    l.insert(l.end(), robot->getHandoffLatencies().begin(),
+             robot->getHandoffLatencies().end());
+    robot->clearHandoffLatencies();
+  }
+  if (l.empty()) return;
+  auto percentile = [&](double p) {
+    auto nth = l.begin() + (size_t)(p * (l.size() - 1));
+    std::nth_element(l.begin(), nth, l.end());
+    return *nth;
+  };
+  _handoffP50 = percentile(0.5);
+  double p90 = percentile(0.9);
+  _handoffP99 = percentile(0.99);
+  double max = percentile(1.);
+  printf(
+      "[Simulation] robot handoff latency over %zu ticks (us): p50 %.1f p90 "
+      "%.1f p99 %.1f max %.1f\n",
+      l.size(), _handoffP50, p90, _handoffP99, max);
+}
 
-  //_sharedMemory().waitForRobot();
-  _robotMutex.unlock();
+/*!
+ * Save the state of one robot and the simulation clock.  The controller keeps
+ * running from its own state, it is not part of the snapshot.  Call this
+ * between steps, from the simulation thread or while paused.
+ */
+SimulationSnapshot Simulation::snapshot(size_t robot) {
+  return _robots.at(robot)->snapshot(_currentSimTime,
+                                     _timeOfNextLowLevelControl,
+                                     _timeOfNextHighLevelControl);
+}
 
-  // verify response is good
-  assert(response.requestNumber == request.requestNumber);
-  assert(response.parameterKind == request.parameterKind);
-  assert(std::string(response.name) == request.name);
+/*!
+ * Go back to the state in a snapshot of this type of robot.  The other robots
+ * keep their state, but the clock of the whole simulation goes back.  Call
+ * this between steps, from the simulation thread or while paused.
+ */
+void Simulation::restore(const SimulationSnapshot& snapshot, size_t robot) {
+  _robots.at(robot)->restore(snapshot);
+  _currentSimTime = snapshot.currentSimTime;
+  _timeOfNextLowLevelControl = snapshot.timeOfNextLowLevelControl;
+  _timeOfNextHighLevelControl = snapshot.timeOfNextHighLevelControl;
+  for (auto* r : _robots) r->truncateTrajectory(_currentSimTime);
 }
 
 /*!
  * Report a control error.  This doesn't throw and exception and will return so you can clean up
  */
-void Simulation::handleControlError() {
+void Simulation::handleControlError(SimulatedRobot& robot) {
   _wantStop = true;
   _running = false;
   _connected = false;
   _uiUpdate();
-  if(!_sharedMemory().robotToSim.errorMessage[0]) {
+  std::string which =
+      _robots.size() > 1 ? " of robot " + std::to_string(robot.getIndex())
+                         : "";
+  if(!robot.getErrorMessage()[0]) {
     printf(
-      "[ERROR] Control code timed-out!\n");
-    _errorCallback("Control code has stopped responding without giving an error message.\nIt has likely crashed - "
+      "[ERROR] Control code%s timed-out!\n", which.c_str());
+    _errorCallback("Control code" + which + " has stopped responding without giving an error message.\nIt has likely crashed - "
                    "check the output of the control code for more information");
 
   } else {
-    printf("[ERROR] Control code has an error!\n");
-    _errorCallback("Control code has an error:\n" + std::string(_sharedMemory().robotToSim.errorMessage));
+    printf("[ERROR] Control code%s has an error!\n", which.c_str());
+    _errorCallback("Control code" + which + " has an error:\n" + std::string(robot.getErrorMessage()));
   }
 
 }
@@ -283,26 +224,17 @@ void Simulation::handleControlError() {
  * here that blocks on having the robot connected.
  */
 void Simulation::firstRun() {
-  // connect to robot
-  _robotMutex.lock();
-  _sharedMemory().simToRobot.mode = SimulatorMode::DO_NOTHING;
-  _sharedMemory().simulatorIsDone();
-
-  printf("[Simulation] Waiting for robot...\n");
-
-  // this loop will check to see if the robot is connected at 10 Hz
-  // doing this in a loop allows us to click the "stop" button in the GUI
-  // and escape from here before the robot code connects, if needed
-  while (!_sharedMemory().tryWaitForRobot()) {
-    if (_wantStop) {
+  // connect to robots
+  for (auto* robot : _robots) {
+    printf("[Simulation] Waiting for robot %zu...\n", robot->getIndex());
+    if (!robot->connect(_wantStop)) {
+      if (!_wantStop) handleControlError(*robot);
       return;
     }
-    usleep(100000);
   }
   printf("Success! the robot is alive\n");
   _connected = true;
   _uiUpdate();
-  _robotMutex.unlock();
 
   // send all control parameters
   printf("[Simulation] Send robot control parameters to robot...\n");
@@ -322,208 +254,143 @@ void Simulation::firstRun() {
  */
 void Simulation::step(double dt, double dtLowLevelControl,
                       double dtHighLevelControl) {
-  // Low level control (if needed)
-  if (_currentSimTime >= _timeOfNextLowLevelControl) {
-    lowLevelControl();
-    _timeOfNextLowLevelControl = _timeOfNextLowLevelControl + dtLowLevelControl;
-  }
-
-  // High level control
-  if (_currentSimTime >= _timeOfNextHighLevelControl) {
-#ifndef DISABLE_HIGH_LEVEL_CONTROL
-    highLevelControl();
-#endif
-    _timeOfNextHighLevelControl =
-        _timeOfNextHighLevelControl + dtHighLevelControl;
-  }
+  stepRobots(1, dt, dtLowLevelControl, dtHighLevelControl);
+}
 
-  // actuator model:
-  if (_robot == RobotType::MINI_CHEETAH) {
-    for (int leg = 0; leg < 4; leg++) {
-      for (int joint = 0; joint < 3; joint++) {
-        _tau[leg * 3 + joint] = _actuatorModels[joint].getTorque(
-            _spineBoards[leg].torque_out[joint],
-            _simulator->getState().qd[leg * 3 + joint]);
-      }
-    }
-  } else if (_robot == RobotType::CHEETAH_3) {
-    for (int leg = 0; leg < 4; leg++) {
-      for (int joint = 0; joint < 3; joint++) {
-        _tau[leg * 3 + joint] = _actuatorModels[joint].getTorque(
-            _tiBoards[leg].data->tau_des[joint],
-            _simulator->getState().qd[leg * 3 + joint]);
-      }
+/*!
+ * Take nSteps timesteps of dt seconds.  Robots don't interact, so each robot
+ * takes all of the steps on its own thread before the threads meet again.
+ * @return false if a controller had an error, which has been reported
+ */
+bool Simulation::stepRobots(u64 nSteps, double dt, double dtLowLevelControl,
+                            double dtHighLevelControl) {
+  _chunk.nSteps = nSteps;
+  _chunk.dt = dt;
+  _chunk.dtLowLevelControl = dtLowLevelControl;
+  _chunk.dtHighLevelControl = dtHighLevelControl;
+  _chunk.time = _currentSimTime;
+  _chunk.timeOfNextLowLevelControl = _timeOfNextLowLevelControl;
+  _chunk.timeOfNextHighLevelControl = _timeOfNextHighLevelControl;
+  _chunk.hasGamepadCommand = _window != nullptr;
+  if (_window) _chunk.gamepadCommand = _window->getDriverCommand();
+
+  if (_stepThreads.empty()) {
+    for (size_t i = 0; i < _robots.size(); i++) {
+      _robotOk[i] = runRobotSteps(i);
     }
   } else {
-    assert(false);
-  }
+    _stepMutex.lock();
+    _stepThreadsBusy = _stepThreads.size();
+    _stepGeneration++;
+    _stepMutex.unlock();
+    _stepStart.notify_all();
 
-  // dynamics
-  _currentSimTime += dt;
-
-  // Set Homing Information
-  RobotHomingInfo<double> homing;
-  homing.active_flag = _simParams.go_home;
-  homing.position = _simParams.home_pos;
-  homing.rpy = _simParams.home_rpy;
-  homing.kp_lin = _simParams.home_kp_lin;
-  homing.kd_lin = _simParams.home_kd_lin;
-  homing.kp_ang = _simParams.home_kp_ang;
-  homing.kd_ang = _simParams.home_kd_ang;
-  _simulator->setHoming(homing);
-
-  _simulator->step(dt, _tau, _simParams.floor_kp, _simParams.floor_kd);
-}
+    _robotOk[0] = runRobotSteps(0);
 
-void Simulation::lowLevelControl() {
-  if (_robot == RobotType::MINI_CHEETAH) {
-    // update spine board data:
-    for (int leg = 0; leg < 4; leg++) {
-      _spiData.q_abad[leg] = _simulator->getState().q[leg * 3 + 0];
-      _spiData.q_hip[leg] = _simulator->getState().q[leg * 3 + 1];
-      _spiData.q_knee[leg] = _simulator->getState().q[leg * 3 + 2];
-
-      _spiData.qd_abad[leg] = _simulator->getState().qd[leg * 3 + 0];
-      _spiData.qd_hip[leg] = _simulator->getState().qd[leg * 3 + 1];
-      _spiData.qd_knee[leg] = _simulator->getState().qd[leg * 3 + 2];
-    }
-
-    // run spine board control:
-    for (auto& spineBoard : _spineBoards) {
-      spineBoard.run();
-    }
+    std::unique_lock<std::mutex> lock(_stepMutex);
+    _stepDone.wait(lock, [this] { return _stepThreadsBusy == 0; });
+  }
 
-  } else if (_robot == RobotType::CHEETAH_3) {
-    // update data
-    for (int leg = 0; leg < 4; leg++) {
-      for (int joint = 0; joint < 3; joint++) {
-        _tiBoards[leg].data->q[joint] =
-            _simulator->getState().q[leg * 3 + joint];
-        _tiBoards[leg].data->dq[joint] =
-            _simulator->getState().qd[leg * 3 + joint];
-      }
-    }
+  // every robot has the same clock
+  bool runLowLevelControl, runHighLevelControl;
+  for (u64 i = 0; i < nSteps; i++) {
+    tickClock(_currentSimTime, _timeOfNextLowLevelControl,
+              _timeOfNextHighLevelControl, dt, dtLowLevelControl,
+              dtHighLevelControl, runLowLevelControl, runHighLevelControl);
+  }
 
-    // run control
-    for (auto& tiBoard : _tiBoards) {
-      tiBoard.run_ti_board_iteration();
+  for (size_t i = 0; i < _robots.size(); i++) {
+    if (!_robotOk[i]) {
+      handleControlError(*_robots[i]);
+      return false;
     }
-  } else {
-    assert(false);
   }
+  return true;
 }
 
+/*!
+ * Take the steps of the current chunk for one robot
+ * @return false if the controller had an error
+ */
+bool Simulation::runRobotSteps(size_t robot) {
+  const StepChunk& c = _chunk;
+  double time = c.time;
+  double timeOfNextLowLevelControl = c.timeOfNextLowLevelControl;
+  double timeOfNextHighLevelControl = c.timeOfNextHighLevelControl;
+  bool runLowLevelControl, runHighLevelControl;
+  for (u64 i = 0; i < c.nSteps; i++) {
+    double startTime = time;
+    tickClock(time, timeOfNextLowLevelControl, timeOfNextHighLevelControl,
+              c.dt, c.dtLowLevelControl, c.dtHighLevelControl,
+              runLowLevelControl, runHighLevelControl);
+
+    // the state of the first robot goes out over LCM every control tick
+    if (robot == 0 && runHighLevelControl && _lcm) {
+      _robots[0]->buildLcmMessage(_simLCM, startTime);
+      _lcm->publish(SIM_LCM_NAME, &_simLCM);
+    }
 
-
-void Simulation::highLevelControl() {
-  // send joystick data to robot:
-  _sharedMemory().simToRobot.gamepadCommand = _window->getDriverCommand();
-  _sharedMemory().simToRobot.gamepadCommand.applyDeadband(
-      _simParams.game_controller_deadband);
-
-  // send IMU data to robot:
-  _imuSimulator->updateCheaterState(_simulator->getState(),
-                                    _simulator->getDState(),
-                                    _sharedMemory().simToRobot.cheaterState);
-
-  _imuSimulator->updateVectornav(_simulator->getState(),
-                                   _simulator->getDState(),
-                                   &_sharedMemory().simToRobot.vectorNav);
-
-
-  // send leg data to robot
-  if (_robot == RobotType::MINI_CHEETAH) {
-    _sharedMemory().simToRobot.spiData = _spiData;
-  } else if (_robot == RobotType::CHEETAH_3) {
-    for (int i = 0; i < 4; i++) {
-      _sharedMemory().simToRobot.tiBoardData[i] = *_tiBoards[i].data;
+    if (!_robots[robot]->step(time, c.dt, runLowLevelControl,
+                              runHighLevelControl,
+                              c.hasGamepadCommand ? &c.gamepadCommand
+                                                  : nullptr)) {
+      return false;
     }
-  } else {
-    assert(false);
   }
+  return true;
+}
 
-  // signal to the robot that it can start running
-  // the _robotMutex is used to prevent qt (which runs in its own thread) from
-  // sending a control parameter while the robot code is already running.
-  _robotMutex.lock();
-  _sharedMemory().simToRobot.mode = SimulatorMode::RUN_CONTROLLER;
-  _sharedMemory().simulatorIsDone();
-
-  // wait for robot code to finish (and send LCM while waiting)
-  if (_lcm) {
-    buildLcmMessage();
-    _lcm->publish(SIM_LCM_NAME, &_simLCM);
+/*!
+ * Start a thread for each robot but the first, which steps on the thread
+ * calling stepRobots
+ */
+void Simulation::startStepThreads() {
+  _stepThreadsExit = false;
+  u64 generation = _stepGeneration;
+  for (size_t i = 1; i < _robots.size(); i++) {
+    _stepThreads.emplace_back(
+        [this, i, generation]() { stepThread(i, generation); });
   }
+}
 
-  // first make sure we haven't killed the robot code
-  if (_wantStop) return;
+void Simulation::stopStepThreads() {
+  _stepMutex.lock();
+  _stepThreadsExit = true;
+  _stepMutex.unlock();
+  _stepStart.notify_all();
+  for (auto& thread : _stepThreads) thread.join();
+  _stepThreads.clear();
+}
 
-  // next try waiting at most 1 second:
-  if (_sharedMemory().waitForRobotWithTimeout()) {
-  } else {
-    handleControlError();
-    _robotMutex.unlock();
-    return;
-  }
-  _robotMutex.unlock();
+/*!
+ * Step one robot each time stepRobots starts a chunk
+ * @param generation : the chunk before the thread was started
+ */
+void Simulation::stepThread(size_t robot, u64 generation) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_stepMutex);
+      _stepStart.wait(lock, [&] {
+        return _stepThreadsExit || _stepGeneration != generation;
+      });
+      if (_stepThreadsExit) return;
+      generation = _stepGeneration;
+    }
 
-  // update
-  if (_robot == RobotType::MINI_CHEETAH) {
-    _spiCommand = _sharedMemory().robotToSim.spiCommand;
+    _robotOk[robot] = runRobotSteps(robot);
 
-    // pretty_print(_spiCommand.q_des_abad, "q des abad", 4);
-    // pretty_print(_spiCommand.q_des_hip, "q des hip", 4);
-    // pretty_print(_spiCommand.q_des_knee, "q des knee", 4);
-  } else if (_robot == RobotType::CHEETAH_3) {
-    for (int i = 0; i < 4; i++) {
-      _tiBoards[i].command = _sharedMemory().robotToSim.tiBoardCommand[i];
-    }
-  } else {
-    assert(false);
+    _stepMutex.lock();
+    _stepThreadsBusy--;
+    _stepMutex.unlock();
+    _stepDone.notify_one();
   }
-
-  _highLevelIterations++;
 }
 
+/*!
+ * Fill the LCM message with the state of the first robot
+ */
 void Simulation::buildLcmMessage() {
-  _simLCM.time = _currentSimTime;
-  _simLCM.timesteps = _highLevelIterations;
-  auto& state = _simulator->getState();
-  auto& dstate = _simulator->getDState();
-
-  Vec3<double> rpy = ori::quatToRPY(state.bodyOrientation);
-  RotMat<double> Rbody = ori::quaternionToRotationMatrix(state.bodyOrientation);
-  Vec3<double> omega = Rbody.transpose() * state.bodyVelocity.head<3>();
-  Vec3<double> v = Rbody.transpose() * state.bodyVelocity.tail<3>();
-
-  for (size_t i = 0; i < 4; i++) {
-    _simLCM.quat[i] = state.bodyOrientation[i];
-  }
-
-  for (size_t i = 0; i < 3; i++) {
-    _simLCM.vb[i] = state.bodyVelocity[i + 3];  // linear velocity in body frame
-    _simLCM.rpy[i] = rpy[i];
-    for (size_t j = 0; j < 3; j++) {
-      _simLCM.R[i][j] = Rbody(i, j);
-    }
-    _simLCM.omegab[i] = state.bodyVelocity[i];
-    _simLCM.omega[i] = omega[i];
-    _simLCM.p[i] = state.bodyPosition[i];
-    _simLCM.v[i] = v[i];
-    _simLCM.vbd[i] = dstate.dBodyVelocity[i + 3];
-  }
-
-  for (size_t leg = 0; leg < 4; leg++) {
-    for (size_t joint = 0; joint < 3; joint++) {
-      _simLCM.q[leg][joint] = state.q[leg * 3 + joint];
-      _simLCM.qd[leg][joint] = state.qd[leg * 3 + joint];
-      _simLCM.qdd[leg][joint] = dstate.qdd[leg * 3 + joint];
-      _simLCM.tau[leg][joint] = _tau[leg * 3 + joint];
-      size_t gcID = _simulator->getModel()._footIndicesGC.at(leg);
-      _simLCM.p_foot[leg][joint] = _simulator->getModel()._pGC.at(gcID)[joint];
-      _simLCM.f_foot[leg][joint] = _simulator->getContactForce(gcID)[joint];
-    }
-  }
+  _robots[0]->buildLcmMessage(_simLCM, _currentSimTime);
 }
 
 /*!
@@ -536,7 +403,7 @@ void Simulation::buildLcmMessage() {
 void Simulation::addCollisionPlane(double mu, double resti, double height,
                                    double sizeX, double sizeY, double checkerX,
                                    double checkerY, bool addToWindow) {
-  _simulator->addCollisionPlane(mu, resti, height);
+  for (auto* robot : _robots) robot->addCollisionPlane(mu, resti, height);
   if (addToWindow && _window) {
     _window->lockGfxMutex();
     Checkerboard checker(sizeX, sizeY, checkerX, checkerY);
@@ -564,7 +431,9 @@ void Simulation::addCollisionBox(double mu, double resti, double depth,
                                  const Vec3<double>& pos,
                                  const Mat3<double>& ori, bool addToWindow,
                                  bool transparent) {
-  _simulator->addCollisionBox(mu, resti, depth, width, height, pos, ori);
+  for (auto* robot : _robots) {
+    robot->addCollisionBox(mu, resti, depth, width, height, pos, ori);
+  }
   if (addToWindow && _window) {
     _window->lockGfxMutex();
     _window->_drawList.addBox(depth, width, height, pos, ori, transparent);
@@ -576,8 +445,9 @@ void Simulation::addCollisionMesh(double mu, double resti, double grid_size,
                                   const Vec3<double>& left_corner_loc,
                                   const DMat<double>& height_map,
                                   bool addToWindow, bool transparent) {
-  _simulator->addCollisionMesh(mu, resti, grid_size, left_corner_loc,
-                               height_map);
+  for (auto* robot : _robots) {
+    robot->addCollisionMesh(mu, resti, grid_size, left_corner_loc, height_map);
+  }
   if (addToWindow && _window) {
     _window->lockGfxMutex();
     _window->_drawList.addMesh(grid_size, left_corner_loc, height_map,
@@ -586,10 +456,22 @@ void Simulation::addCollisionMesh(double mu, double resti, double grid_size,
   }
 }
 
+/*!
+ * Add a procedural terrain to the simulator.  Every robot generates the
+ * chunks around itself, and the loaded chunks are drawn with each frame.
+ * @param params : settings of the terrain
+ */
+void Simulation::addProceduralTerrain(
+    const ProceduralTerrainParameters& params) {
+  auto terrain = std::make_shared<const ProceduralTerrain>(params);
+  for (auto* robot : _robots) robot->addCollisionTerrain(terrain);
+}
+
 /*!
  * Runs the simulator in the current thread until the _running variable is set
- * to false. Updates graphics at 60 fps if desired. Runs simulation at the
- * desired speed
+ * to false. Updates graphics every render_dt seconds of wall time if desired.
+ * Runs simulation at the desired speed, or as fast as possible in turbo or
+ * with unlimited_speed set, in which case it never sleeps.
  * @param dt
  */
 void Simulation::runAtSpeed(std::function<void(std::string)> errorCallback, bool graphics) {
@@ -600,34 +482,44 @@ void Simulation::runAtSpeed(std::function<void(std::string)> errorCallback, bool
   if (_wantStop) return;
   assert(!_running);
   _running = true;
+  startStepThreads();
   Timer frameTimer;
   Timer freeRunTimer;
   u64 desiredSteps = 0;
   u64 steps = 0;
 
-  double frameTime = 1. / 60.;
   double lastSimTime = 0;
+  Timer handoffReportTimer;
 
   printf(
       "[Simulator] Starting run loop (dt %f, dt-low-level %f, dt-high-level %f "
-      "speed %f graphics %d)...\n",
+      "speed %f unlimited %d graphics %d)...\n",
       _simParams.dynamics_dt, _simParams.low_level_dt, _simParams.high_level_dt,
-      _simParams.simulation_speed, graphics);
+      _simParams.simulation_speed, (int)_simParams.unlimited_speed, graphics);
 
   while (_running) {
     double dt = _simParams.dynamics_dt;
     double dtLowLevelControl = _simParams.low_level_dt;
     double dtHighLevelControl = _simParams.high_level_dt;
-    _desiredSimSpeed = (_window && _window->wantTurbo()) ? 100.f : _simParams.simulation_speed;
+    double frameTime = _simParams.render_dt;
+    bool paused = _window && _window->IsPaused();
+    bool unlimited = _simParams.unlimited_speed ||
+                     (_window && _window->wantTurbo());
+    _desiredSimSpeed = _simParams.simulation_speed;
     if(_window && _window->wantSloMo()) {
       _desiredSimSpeed /= 10.;
+      unlimited = false;
     }
-    u64 nStepsPerFrame = (u64)(((1. / 60.) / dt) * _desiredSimSpeed);
-    if (!_window->IsPaused() && steps < desiredSteps) {
-      _simParams.lockMutex();   
-      step(dt, dtLowLevelControl, dtHighLevelControl);
+    u64 nStepsPerFrame = (u64)((frameTime / dt) * _desiredSimSpeed);
+    if (!paused && (unlimited || steps < desiredSteps)) {
+      // robots meet between chunks of about 5 ms of simulated time
+      u64 nSteps = (u64)std::max(1., 0.005 / dt);
+      if (!unlimited) nSteps = std::min(desiredSteps - steps, nSteps);
+      _simParams.lockMutex();
+      stepRobots(nSteps, dt, dtLowLevelControl, dtHighLevelControl);
       _simParams.unlockMutex();
-      steps++;
+      steps += nSteps;
+      if (unlimited) desiredSteps = steps;  // don't catch up after turbo
     } else {
       double timeRemaining = frameTime - frameTimer.getSeconds();
       if (timeRemaining > 0) {
@@ -638,205 +530,151 @@ void Simulation::runAtSpeed(std::function<void(std::string)> errorCallback, bool
       double realElapsedTime = frameTimer.getSeconds();
       frameTimer.start();
       if (graphics && _window) {
-        double simRate = (_currentSimTime - lastSimTime) / realElapsedTime;
+        // scrub through the recording while paused
+        int scrub = _window->takeReplayScrub();
+        if (_window->IsPaused() && _robots[0]->hasTrajectory() &&
+            (scrub || _replaying)) {
+          if (!_replaying) _replayTime = _currentSimTime;
+          _replayTime = std::min(_currentSimTime,
+                                 std::max(0., _replayTime + scrub * .01));
+          _replaying = true;
+        } else {
+          _replaying = false;
+        }
+
+        double simElapsedTime = _currentSimTime - lastSimTime;
+        double simRate = simElapsedTime / realElapsedTime;
         lastSimTime = _currentSimTime;
-        sprintf(_window->infoString,
-                "[Simulation Run %5.2fx]\n"
+
+        // wall time of each phase of robot 0 per simulated second
+        SimPhaseTimes phases = _robots[0]->getPhaseTimes();
+        double msPerSimSecond =
+            simElapsedTime > 0 ? 1000. / simElapsedTime : 0.;
+
+        RenderSnapshot& frame = _window->getRenderSnapshot();
+        char speed[16];
+        if (unlimited) {
+          sprintf(speed, "max");
+        } else {
+          sprintf(speed, "%5.2fx", _desiredSimSpeed);
+        }
+        sprintf(frame.infoString,
+                "[Simulation Run %s]\n"
                 "real-time:  %8.3f\n"
                 "sim-time:   %8.3f\n"
-                "rate:       %8.3f\n",
-                _desiredSimSpeed, freeRunTimer.getSeconds(), _currentSimTime,
-                simRate);
+                "rate:       %8.3f\n"
+                "steps/sim-s:%8.0f\n"
+                "handoff us: %5.1f/%5.1f\n"
+                "ms per sim-s\n"
+                "  dynamics: %8.1f\n"
+                "  collision:%8.1f\n"
+                "  low-level:%8.1f\n"
+                "  handoff:  %8.1f\n",
+                speed, freeRunTimer.getSeconds(), _currentSimTime, simRate,
+                _robots[0]->getSimulator().getStepsPerSimSecond(), _handoffP50,
+                _handoffP99, phases.dynamics * msPerSimSecond,
+                phases.collision * msPerSimSecond,
+                phases.lowLevelControl * msPerSimSecond,
+                phases.highLevelControl * msPerSimSecond);
+        if (_robots.size() > 1) {
+          size_t len = strlen(frame.infoString);
+          snprintf(frame.infoString + len, sizeof(frame.infoString) - len,
+                   "robots:     %8zu\n", _robots.size());
+        }
+        if (_replaying) {
+          size_t len = strlen(frame.infoString);
+          snprintf(frame.infoString + len, sizeof(frame.infoString) - len,
+                   "replay:     %8.3f\n", _replayTime);
+        }
+        for (auto* robot : _robots) robot->resetPhaseTimes();
         updateGraphics();
       }
-      if (!_window->IsPaused() && (desiredSteps - steps) < nStepsPerFrame)
+      if (handoffReportTimer.getSeconds() > 5.) {
+        handoffReportTimer.start();
+        reportHandoffLatency();
+      }
+      if (!paused && (desiredSteps - steps) < nStepsPerFrame)
         desiredSteps += nStepsPerFrame;
     }
   }
+  stopStepThreads();
 }
 
-void Simulation::loadTerrainFile(const std::string& terrainFileName,
-                                 bool addGraphics) {
-  printf("load terrain %s\n", terrainFileName.c_str());
-  ParamHandler paramHandler(terrainFileName);
-
-  if (!paramHandler.fileOpenedSuccessfully()) {
-    printf("[ERROR] could not open yaml file for terrain\n");
-    throw std::runtime_error("yaml bad");
+/*!
+ * Run the simulation as fast as possible for some simulated time, without
+ * graphics, in the current thread.  Connects to the robots first, like
+ * runAtSpeed.
+ * @param duration : simulated time to run for (s)
+ * @param stepThreads : step each robot on its own thread, otherwise step them
+ * one after the other
+ * @return false if a controller had an error, which has been reported to
+ * errorCallback, or if the simulation was stopped
+ */
+bool Simulation::runFor(double duration,
+                        std::function<void(std::string)> errorCallback,
+                        bool stepThreads) {
+  _errorCallback = errorCallback;
+  firstRun();
+  if (_wantStop) return false;
+  assert(!_running);
+  _running = true;
+  if (stepThreads) startStepThreads();
+
+  double dt = _simParams.dynamics_dt;
+  u64 totalSteps = (u64)(duration / dt + 0.5);
+  u64 chunkSteps = (u64)std::max(1., 0.005 / dt);
+  for (u64 steps = 0; _running && steps < totalSteps; steps += chunkSteps) {
+    chunkSteps = std::min(chunkSteps, totalSteps - steps);
+    _simParams.lockMutex();
+    stepRobots(chunkSteps, dt, _simParams.low_level_dt,
+               _simParams.high_level_dt);
+    _simParams.unlockMutex();
   }
 
-  std::vector<std::string> keys = paramHandler.getKeys();
-
-  for (auto& key : keys) {
-    auto load = [&](double& val, const std::string& name) {
-      if (!paramHandler.getValue<double>(key, name, val))
-        throw std::runtime_error("terrain read bad: " + key + " " + name);
-    };
-
-    auto loadVec = [&](double& val, const std::string& name, size_t idx) {
-      std::vector<double> v;
-      if (!paramHandler.getVector<double>(key, name, v))
-        throw std::runtime_error("terrain read bad: " + key + " " + name);
-      val = v.at(idx);
-    };
-
-    auto loadArray = [&](double* val, const std::string& name, size_t idx) {
-      std::vector<double> v;
-      if (!paramHandler.getVector<double>(key, name, v))
-        throw std::runtime_error("terrain read bad: " + key + " " + name);
-      assert(v.size() == idx);
-      for (size_t i = 0; i < idx; i++) val[i] = v[i];
-    };
-
-    printf("terrain element %s\n", key.c_str());
-    std::string typeName;
-    paramHandler.getString(key, "type", typeName);
-    if (typeName == "infinite-plane") {
-      double mu, resti, height, gfxX, gfxY, checkerX, checkerY;
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(height, "height");
-      loadVec(gfxX, "graphicsSize", 0);
-      loadVec(gfxY, "graphicsSize", 1);
-      loadVec(checkerX, "checkers", 0);
-      loadVec(checkerY, "checkers", 1);
-      addCollisionPlane(mu, resti, height, gfxX, gfxY, checkerX, checkerY,
-                        addGraphics);
-    } else if (typeName == "box") {
-      double mu, resti, depth, width, height, transparent;
-      double pos[3];
-      double ori[3];
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(depth, "depth");
-      load(width, "width");
-      load(height, "height");
-      loadArray(pos, "position", 3);
-      loadArray(ori, "orientation", 3);
-      load(transparent, "transparent");
-
-      Mat3<double> R_box = ori::rpyToRotMat(Vec3<double>(ori));
-      R_box.transposeInPlace();  // collisionBox uses "rotation" matrix instead
-                                 // of "transformation"
-      addCollisionBox(mu, resti, depth, width, height, Vec3<double>(pos), R_box,
-                      addGraphics, transparent != 0.);
-    } else if (typeName == "stairs") {
-      double mu, resti, rise, run, stepsDouble, width, transparent;
-      double pos[3];
-      double ori[3];
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(rise, "rise");
-      load(width, "width");
-      load(run, "run");
-      load(stepsDouble, "steps");
-      loadArray(pos, "position", 3);
-      loadArray(ori, "orientation", 3);
-      load(transparent, "transparent");
-
-      Mat3<double> R = ori::rpyToRotMat(Vec3<double>(ori));
-      Vec3<double> pOff(pos);
-      R.transposeInPlace();  // "graphics" rotation matrix
-
-      size_t steps = (size_t)stepsDouble;
-
-      double heightOffset = rise / 2;
-      double runOffset = run / 2;
-      for (size_t step = 0; step < steps; step++) {
-        Vec3<double> p(runOffset, 0, heightOffset);
-        p = R * p + pOff;
-
-        addCollisionBox(mu, resti, run, width, heightOffset * 2, p, R,
-                        addGraphics, transparent != 0.);
-
-        heightOffset += rise / 2;
-        runOffset += run;
-      }
-    } else if (typeName == "mesh") {
-      double mu, resti, transparent, grid;
-      Vec3<double> left_corner;
-      std::vector<std::vector<double> > height_map_2d;
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(transparent, "transparent");
-      load(grid, "grid");
-      loadVec(left_corner[0], "left_corner_loc", 0);
-      loadVec(left_corner[1], "left_corner_loc", 1);
-      loadVec(left_corner[2], "left_corner_loc", 2);
-
-      int x_len(0);
-      int y_len(0);
-      bool file_input(false);
-      paramHandler.getBoolean(key, "heightmap_file", file_input);
-      if (file_input) {
-        // Read from text file
-        std::string file_name;
-        paramHandler.getString(key, "heightmap_file_name", file_name);
-        std::ifstream f_height;
-        f_height.open(THIS_COM "/config/" + file_name);
-        if (!f_height.good()) {
-          std::cout << "file reading error: "
-                    << THIS_COM "../config/" + file_name << std::endl;
-        }
-        int i(0);
-        int j(0);
-        double tmp;
-
-        std::string line;
-        std::vector<double> height_map_vec;
-        while (getline(f_height, line)) {
-          std::istringstream iss(line);
-          j = 0;
-          while (iss >> tmp) {
-            height_map_vec.push_back(tmp);
-            ++j;
-          }
-          y_len = j;
-          height_map_2d.push_back(height_map_vec);
-          height_map_vec.clear();
-          // printf("y len: %d\n", y_len);
-          ++i;
-        }
-        x_len = i;
-
-      } else {
-        paramHandler.get2DArray(key, "height_map", height_map_2d);
-        x_len = height_map_2d.size();
-        y_len = height_map_2d[0].size();
-        // printf("x, y len: %d, %d\n", x_len, y_len);
-      }
-
-      DMat<double> height_map(x_len, y_len);
-      for (int i(0); i < x_len; ++i) {
-        for (int j(0); j < y_len; ++j) {
-          height_map(i, j) = height_map_2d[i][j];
-          // printf("height (%d, %d) : %f\n", i, j, height_map(i,j) );
-        }
-      }
-      addCollisionMesh(mu, resti, grid, left_corner, height_map, addGraphics,
-                       transparent != 0.);
+  stopStepThreads();
+  bool ok = _running;
+  _running = false;
+  return ok;
+}
 
-    } else {
-      throw std::runtime_error("unknown terrain " + typeName);
-    }
-  }
+void Simulation::loadTerrainFile(const std::string& terrainFileName,
+                                 bool addGraphics) {
+  TerrainFileCallbacks terrain;
+  terrain.addPlane = [&](double mu, double resti, double height, double sizeX,
+                         double sizeY, double checkerX, double checkerY) {
+    addCollisionPlane(mu, resti, height, sizeX, sizeY, checkerX, checkerY,
+                      addGraphics);
+  };
+  terrain.addBox = [&](double mu, double resti, double depth, double width,
+                       double height, const Vec3<double>& pos,
+                       const Mat3<double>& ori, bool transparent) {
+    addCollisionBox(mu, resti, depth, width, height, pos, ori, addGraphics,
+                    transparent);
+  };
+  terrain.addMesh = [&](double mu, double resti, double grid,
+                        const Vec3<double>& leftCorner,
+                        const DMat<double>& heightMap, bool transparent) {
+    addCollisionMesh(mu, resti, grid, leftCorner, heightMap, addGraphics,
+                     transparent);
+  };
+  terrain.addProceduralTerrain =
+      [&](const ProceduralTerrainParameters& params) {
+        addProceduralTerrain(params);
+      };
+  parseTerrainFile(terrainFileName, terrain);
 }
 
+/*!
+ * Publish the state of the simulation to the window, which draws it on its
+ * own thread.  This only copies, so drawing never slows down the simulation.
+ */
 void Simulation::updateGraphics() {
-  _robotControllerState.bodyOrientation =
-      _sharedMemory().robotToSim.mainCheetahVisualization.quat.cast<double>();
-  _robotControllerState.bodyPosition =
-      _sharedMemory().robotToSim.mainCheetahVisualization.p.cast<double>();
-  for (int i = 0; i < 12; i++)
-    _robotControllerState.q[i] =
-        _sharedMemory().robotToSim.mainCheetahVisualization.q[i];
-  _robotDataSimulator->setState(_robotControllerState);
-  _robotDataSimulator->forwardKinematics();  // calc all body positions
-  _window->_drawList.updateRobotFromModel(*_simulator, _simRobotID, true);
-  _window->_drawList.updateRobotFromModel(*_robotDataSimulator,
-                                          _controllerRobotID, false);
-  _window->_drawList.updateAdditionalInfo(*_simulator);
-  _window->update();
+  RenderSnapshot& frame = _window->getRenderSnapshot();
+  frame.clear();
+  for (auto* robot : _robots) {
+    robot->addToRenderSnapshot(frame, robot->getIndex() == 0, _replaying,
+                               _replayTime);
+  }
+  _robots[0]->copyVisualizationData(frame);
+  _window->publishRenderSnapshot();
 }
-
-
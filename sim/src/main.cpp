@@ -2,40 +2,11 @@
  *  @brief Main function for simulator
  */
 
-#include "Collision/CollisionPlane.h"
-#include "DrawList.h"
-#include "Dynamics/Cheetah3.h"
-#include "Dynamics/DynamicsSimulator.h"
-#include "Dynamics/FloatingBaseModel.h"
-#include "Dynamics/MiniCheetah.h"
-#include "Dynamics/Quadruped.h"
-#include "Graphics3D.h"
-#include "SimControlPanel.h"
-#include "Simulation.h"
-#include "Utilities/utilities.h"
-#include "Utilities/SegfaultHandler.h"
-
-#include <QApplication>
-#include <QSurfaceFormat>
-
-#include <stdio.h>
-#include <unistd.h>
-#include <thread>
+#include "sim_main_helper.h"
 
 /*!
- * Setup QT and run a simulation
+ * Run the simulator, connecting to a robot program through shared memory
  */
 int main(int argc, char *argv[]) {
-  install_segfault_handler(nullptr);
-  // set up Qt
-  QApplication a(argc, argv);
-
-  // open simulator UI
-  SimControlPanel panel;
-  panel.show();
-
-  // run the Qt program
-  a.exec();
-
-  return 0;
+  return sim_main_helper(argc, argv);
 }
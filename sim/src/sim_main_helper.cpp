@@ -0,0 +1,36 @@
+/*! @file sim_main_helper.cpp
+ *  @brief Setup Qt and run the simulator GUI
+ */
+
+#include "sim_main_helper.h"
+#include "SimControlPanel.h"
+#include "Utilities/SegfaultHandler.h"
+
+#include <QApplication>
+#include <QSurfaceFormat>
+
+/*!
+ * Setup QT and run a simulation
+ * @param makeInProcessRobot : if set, creates the robot controller for each
+ * simulation in this process, instead of connecting to a robot program through
+ * shared memory
+ * @param reentrantController : if set, the controllers of several robots run
+ * at the same time, otherwise they take turns
+ */
+int sim_main_helper(
+    int argc, char** argv,
+    std::function<InProcessRobot*(RobotType)> makeInProcessRobot,
+    bool reentrantController) {
+  install_segfault_handler(nullptr);
+  // set up Qt
+  QApplication a(argc, argv);
+
+  // open simulator UI
+  SimControlPanel panel(nullptr, makeInProcessRobot, reentrantController);
+  panel.show();
+
+  // run the Qt program
+  a.exec();
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+/*! @file test_simulation.cpp
+ *  @brief Test running simulations without graphics: several robots stepped
+ *  on their own threads, and controllers in the simulator's process or in
+ *  their own
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ControlParameters/SimulatorParameters.h"
+#include "Simulation.h"
+#include "SimulationBridge.h"
+#include "Utilities/utilities.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace SimulationTestNamespace {
+
+/*!
+ * Hold the legs in a standing posture with joint PD, with a little feedforward
+ * from the state estimate so that the estimators are part of the test.  Each
+ * robot bends its knees differently, so robots which get mixed up show.
+ */
+class StandController : public RobotController {
+ public:
+  explicit StandController(float knee) : _knee(knee) {}
+
+  void initializeController() override {}
+
+  void runController() override {
+    for (int leg = 0; leg < 4; leg++) {
+      LegControllerCommand<float>& command = _legController->commands[leg];
+      command.qDes = Vec3<float>(0, -_knee / 2, _knee);
+      command.qdDes.setZero();
+      command.kpJoint = Vec3<float>(20, 20, 20).asDiagonal();
+      command.kdJoint = Vec3<float>(.5, .5, .5).asDiagonal();
+      command.tauFeedForward =
+          Vec3<float>(0, 0, 2 * (.25f - _stateEstimate->position[2]));
+    }
+  }
+
+  void updateVisualization() override {}
+  ControlParameters* getUserControlParameters() override { return nullptr; }
+
+ private:
+  float _knee;
+};
+
+/*!
+ * Simulate Mini Cheetahs standing up on flat ground for 4 seconds (the first
+ * 3 are the JPosInitializer)
+ * @param stepThreads : step each robot on its own thread
+ * @param inProcess : run the controllers in this process, otherwise fork a
+ * robot program for each robot, which connects through shared memory
+ * @return the state of each robot at the end
+ */
+vectorAligned<FBModelState<double>> runStandUp(size_t nRobots,
+                                               bool stepThreads,
+                                               bool inProcess,
+                                               SimulatorHandoff handoff) {
+  SimulatorControlParameters simParams;
+  simParams.initializeFromYamlFile(getConfigDirectoryPath() +
+                                   SIMULATOR_DEFAULT_PARAMETERS);
+  simParams.num_robots = nRobots;
+  simParams.robot_handoff = (s64)handoff;
+  simParams.record_trajectory = 0;
+  simParams.sim_state_lcm = 0;
+  ControlParameters userParams("user-parameters");
+
+  Simulation sim(RobotType::MINI_CHEETAH, nullptr, simParams, userParams,
+                 []() {});
+  sim.addCollisionPlane(.7, 0, 0);
+  sim.getRobotParams().use_rc = 0;
+
+  std::vector<std::unique_ptr<StandController>> controllers;
+  std::vector<std::unique_ptr<SimulationBridge>> bridges;
+  std::vector<pid_t> pids;
+  for (size_t i = 0; i < nRobots; i++) {
+    controllers.emplace_back(new StandController(1.5f + .1f * i));
+    if (inProcess) {
+      bridges.emplace_back(
+          new SimulationBridge(RobotType::MINI_CHEETAH, controllers[i].get()));
+      // the controllers share nothing, so they can run at the same time
+      sim.setInProcessRobot(bridges[i].get(), i, true);
+    } else {
+      fflush(stdout);  // or the child prints it again
+      pid_t pid = fork();
+      if (!pid) {
+        // child is the robot program
+        SimulationBridge bridge(RobotType::MINI_CHEETAH, controllers[i].get());
+        bridge.run(i);
+        exit(0);
+      }
+      pids.push_back(pid);
+    }
+  }
+
+  std::string error;
+  bool ok = sim.runFor(
+      4., [&](std::string message) { error = message; }, stepThreads);
+  EXPECT_TRUE(ok) << error;
+
+  vectorAligned<FBModelState<double>> states;
+  for (size_t i = 0; i < nRobots; i++) {
+    states.push_back(sim.getRobotState(i));
+    states.back().bodyPosition -= sim.getRobotOffset(i);
+  }
+
+  // always stop the robot programs
+  sim.stop();
+  for (pid_t pid : pids) {
+    int status;
+    waitpid(pid, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  return states;
+}
+
+void expectSameStates(const vectorAligned<FBModelState<double>>& a,
+                      const vectorAligned<FBModelState<double>>& b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    EXPECT_TRUE(a[i].bodyOrientation == b[i].bodyOrientation &&
+                a[i].bodyPosition == b[i].bodyPosition &&
+                a[i].bodyVelocity == b[i].bodyVelocity && a[i].q == b[i].q &&
+                a[i].qd == b[i].qd)
+        << "robot " << i << " differs";
+  }
+}
+
+}  // namespace SimulationTestNamespace
+
+using namespace SimulationTestNamespace;
+
+/*!
+ * Robots stepped on their own threads end up exactly where they do when
+ * stepped one after the other
+ */
+TEST(Simulation, stepThreadsMatchSequential) {
+  const size_t nRobots = 3;
+  auto threaded =
+      runStandUp(nRobots, true, true, SimulatorHandoff::SEMAPHORE);
+  auto sequential =
+      runStandUp(nRobots, false, true, SimulatorHandoff::SEMAPHORE);
+
+  // every robot stood up, each in its own way
+  ASSERT_EQ(nRobots, sequential.size());
+  for (size_t i = 0; i < nRobots; i++) {
+    EXPECT_GT(sequential[i].bodyPosition[2], .15);
+    if (i > 0) {
+      EXPECT_NE(sequential[i].q, sequential[i - 1].q);
+    }
+  }
+
+  expectSameStates(sequential, threaded);
+}
+
+/*!
+ * A controller called directly by the simulator must see the same messages as
+ * one in a separate process, with either handoff, so the whole simulation
+ * matches bit for bit
+ */
+TEST(Simulation, inProcessMatchesSharedMemory) {
+  const size_t nRobots = 2;
+  auto inProcess = runStandUp(nRobots, true, true, SimulatorHandoff::SEMAPHORE);
+  auto semaphore =
+      runStandUp(nRobots, true, false, SimulatorHandoff::SEMAPHORE);
+  auto futex = runStandUp(nRobots, true, false, SimulatorHandoff::SPIN_FUTEX);
+
+  // the robots stood up, so the controllers really ran
+  ASSERT_EQ(nRobots, inProcess.size());
+  EXPECT_GT(inProcess[0].bodyPosition[2], .15);
+
+  expectSameStates(inProcess, semaphore);
+  expectSameStates(inProcess, futex);
+}
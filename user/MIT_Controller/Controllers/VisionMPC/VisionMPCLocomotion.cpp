@@ -2,7 +2,7 @@
 #include <Utilities/Utilities_print.h>
 
 #include "VisionMPCLocomotion.h"
-#include "VisionMPC_interface.h"
+#include "../convexMPC/SolverMPC.h"
 
 
 ///////////////
@@ -117,13 +117,14 @@ VisionMPCLocomotion::VisionMPCLocomotion(float _dt, int _iterations_between_mpc,
   pronking(horizonLength, Vec4<int>(0,0,0,0),Vec4<int>(4,4,4,4),"Pronking"),
   galloping(horizonLength, Vec4<int>(0,2,7,9),Vec4<int>(3,3,3,3),"Galloping"),
   standing(horizonLength, Vec4<int>(0,0,0,0),Vec4<int>(10,10,10,10),"Standing"),
-  trotRunning(horizonLength, Vec4<int>(0,5,5,0),Vec4<int>(3,3,3,3),"Trot Running")
+  trotRunning(horizonLength, Vec4<int>(0,5,5,0),Vec4<int>(3,3,3,3),"Trot Running"),
+  _denseMPC(new ConvexMPCSolver())
 {
   _parameters = parameters;
   dtMPC = dt * iterationsBetweenMPC;
   printf("[Vision MPC] dt: %.3f iterations: %d, dtMPC: %.3f\n",
       dt, iterationsBetweenMPC, dtMPC);
-  vision_setup_problem(dtMPC, horizonLength, 0.4, 120);
+  _denseMPC->setup(dtMPC, horizonLength, 0.4, 120);
   rpy_comp[0] = 0;
   rpy_comp[1] = 0;
   rpy_comp[2] = 0;
@@ -135,6 +136,8 @@ VisionMPCLocomotion::VisionMPCLocomotion(float _dt, int _iterations_between_mpc,
     firstSwing[i] = true;
 }
 
+VisionMPCLocomotion::~VisionMPCLocomotion() = default;
+
 void VisionMPCLocomotion::initialize(){
   for(int i = 0; i < 4; i++) firstSwing[i] = true;
   firstRun = true;
@@ -558,14 +561,14 @@ void VisionMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
   }
 
   dtMPC = dt * iterationsBetweenMPC;
-  vision_setup_problem(dtMPC,horizonLength,0.4,120);
-  vision_update_problem_data_floats(p,v,q,w,r,yaw,weights,trajAll,alpha,mpcTable);
+  _denseMPC->setup(dtMPC,horizonLength,0.4,120);
+  _denseMPC->solve(p,v,q,w,r,yaw,weights,trajAll,alpha,mpcTable);
 
   for(int leg = 0; leg < 4; leg++)
   {
     Vec3<float> f;
     for(int axis = 0; axis < 3; axis++)
-      f[axis] = vision_get_solution(leg*3 + axis);
+      f[axis] = _denseMPC->getSolution(leg*3 + axis);
 
     f_ff[leg] = -seResult.rBody * f;
     // Update for WBC
@@ -4,6 +4,9 @@
 #include <Controllers/FootSwingTrajectory.h>
 #include <FSM_States/ControlFSMData.h>
 #include "cppTypes.h"
+#include <memory>
+
+class ConvexMPCSolver;
 
 using Eigen::Array4f;
 using Eigen::Array4i;
@@ -40,6 +43,7 @@ private:
 class VisionMPCLocomotion {
 public:
   VisionMPCLocomotion(float _dt, int _iterations_between_mpc, MIT_UserParameters* parameters);
+  ~VisionMPCLocomotion();
   void initialize();
 
   template<typename T>
@@ -101,6 +105,8 @@ private:
   float trajAll[12*36];
 
   MIT_UserParameters* _parameters = nullptr;
+
+  std::unique_ptr<ConvexMPCSolver> _denseMPC;
 };
 
 
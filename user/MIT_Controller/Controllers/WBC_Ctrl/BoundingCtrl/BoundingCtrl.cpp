@@ -239,11 +239,10 @@ void BoundingCtrl<T>::_ContactTaskUpdate(void * input, ControlFSMData<T> & data)
   _vel_des[1] = data._desiredStateCommand->data.stateDes(7) ;
   _vel_des[2] = 0.;
 
-  static bool first_visit(true);
-  if(first_visit){
+  if(_b_first_visit){
     _curr_time = 0.;
     _FirstVisit();
-    first_visit = false;
+    _b_first_visit = false;
   }
   
   // Clear all
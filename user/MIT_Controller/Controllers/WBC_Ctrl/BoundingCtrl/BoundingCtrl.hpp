@@ -28,6 +28,7 @@ class BoundingCtrl : public WBC_Ctrl<T> {
 
   T _curr_time;
   T dt;
+  bool _b_first_visit = true;
 
   bool _b_front_swing;
   bool _b_hind_swing;
@@ -165,7 +165,7 @@ void WBC_Ctrl<T>::_UpdateModel(const StateEstimate<T> & state_est,
   _A = _model.getMassMatrix();
   _grav = _model.getGravityForce();
   _coriolis = _model.getCoriolisForce();
-  _Ainv = _A.inverse();
+  _Ainv = _model.massMatrixInverse();
 }
 
 
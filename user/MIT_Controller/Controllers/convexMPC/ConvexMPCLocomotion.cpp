@@ -3,7 +3,7 @@
 #include <Utilities/Utilities_print.h>
 
 #include "ConvexMPCLocomotion.h"
-#include "convexMPC_interface.h"
+#include "SolverMPC.h"
 #include "../../../../common/FootstepPlanner/GraphSearch.h"
 
 //#define DRAW_DEBUG_SWINGS
@@ -132,13 +132,15 @@ ConvexMPCLocomotion::ConvexMPCLocomotion(float _dt, int _iterations_between_mpc,
   trotRunning(horizonLength, Vec4<int>(0,5,5,0),Vec4<int>(4,4,4,4),"Trot Running"),
   walking(horizonLength, Vec4<int>(0,3,5,8), Vec4<int>(5,5,5,5), "Walking"),
   walking2(horizonLength, Vec4<int>(0,5,5,0), Vec4<int>(7,7,7,7), "Walking2"),
-  pacing(horizonLength, Vec4<int>(5,0,5,0),Vec4<int>(5,5,5,5),"Pacing")
+  pacing(horizonLength, Vec4<int>(5,0,5,0),Vec4<int>(5,5,5,5),"Pacing"),
+  _denseCMPC(new ConvexMPCSolver())
 {
   _parameters = parameters;
   dtMPC = dt * iterationsBetweenMPC;
   printf("[Convex MPC] dt: %.3f iterations: %d, dtMPC: %.3f\n",
       dt, iterationsBetweenMPC, dtMPC);
-  setup_problem(dtMPC, horizonLength, 0.4, 120);
+  _denseCMPC->setup(dtMPC, horizonLength, 0.4, 120);
+  _mpcLatency = dt;
   rpy_comp[0] = 0;
   rpy_comp[1] = 0;
   rpy_comp[2] = 0;
@@ -151,6 +153,8 @@ ConvexMPCLocomotion::ConvexMPCLocomotion(float _dt, int _iterations_between_mpc,
 
   initSparseMPC();
 }
+ConvexMPCLocomotion::~ConvexMPCLocomotion() = default;
+
 void ConvexMPCLocomotion::initialize(){
   for(int i = 0; i < 4; i++) firstSwing[i] = true;
   firstRun = true;
@@ -362,6 +366,8 @@ void ConvexMPCLocomotion::run(ControlFSMData<float>& data) {
   Vec4<float> swingStates = gait->getSwingState();
   int* mpcTable = gait->mpc_gait();
   updateMPCIfNeeded(mpcTable, data, omniMode);
+  if(_parameters->cmpc_async > 0.5 && _parameters->cmpc_use_sparse < 0.5)
+    applyMPCPlan(data);
 
 //  StateEstimator* se = hw_i->state_estimator;
   Vec4<float> se_contactState(0,0,0,0);
@@ -706,8 +712,7 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
 
   Timer t1;
   dtMPC = dt * iterationsBetweenMPC;
-  setup_problem(dtMPC,horizonLength,0.4,120);
-  update_x_drag(x_comp_integral);
+  float x_drag = x_comp_integral;
   if(vxy[0] > 0.3 || vxy[0] < -0.3) {
     //x_comp_integral += _parameters->cmpc_x_drag * pxy_err[0] * dtMPC / vxy[0];
     x_comp_integral += _parameters->cmpc_x_drag * pz_err * dtMPC / vxy[0];
@@ -715,13 +720,58 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
 
   //printf("pz err: %.3f, pz int: %.3f\n", pz_err, x_comp_integral);
 
-  update_solver_settings(_parameters->jcqp_max_iter, _parameters->jcqp_rho,
+  if(_parameters->cmpc_async > 0.5) {
+    // solve from the state predicted for when the plan is expected back,
+    // assuming constant linear and angular velocity until then
+    ConvexMPCRequest& request = _mpcThread.request();
+    float latency = _mpcLatency;
+    request.requestTime = iterationCounter * dt;
+    request.time = request.requestTime + latency;
+    request.dt = dtMPC;
+    request.horizon = horizonLength;
+    request.mu = 0.4;
+    request.f_max = 120;
+    request.max_iterations = _parameters->jcqp_max_iter;
+    request.rho = _parameters->jcqp_rho;
+    request.sigma = _parameters->jcqp_sigma;
+    request.solver_alpha = _parameters->jcqp_alpha;
+    request.terminate = _parameters->jcqp_terminate;
+    request.use_jcqp = _parameters->use_jcqp;
+    request.x_drag = x_drag;
+
+    Vec3<float> pPredicted = seResult.position + latency * seResult.vWorld;
+    Quat<float> qPredicted =
+      ori::integrateQuat(seResult.orientation, seResult.omegaWorld, latency);
+    for(int i = 0; i < 3; i++) {
+      request.p[i] = pPredicted[i];
+      request.v[i] = v[i];
+      request.w[i] = w[i];
+    }
+    for(int i = 0; i < 4; i++)
+      request.q[i] = qPredicted[i];
+    for(int i = 0; i < 12; i++) {
+      request.r[i] = pFoot[i%4][i/4] - pPredicted[i/4];
+      request.weights[i] = weights[i];
+    }
+    request.yaw = yaw + latency * seResult.omegaWorld[2];
+    request.alpha = alpha;
+    for(int i = 0; i < 12 * horizonLength; i++)
+      request.traj[i] = trajAll[i];
+    for(int i = 0; i < 4 * horizonLength; i++)
+      request.gait[i] = mpcTable[i];
+    _mpcThread.submit();
+    return;
+  }
+
+  _denseCMPC->setup(dtMPC,horizonLength,0.4,120);
+  _denseCMPC->setXDrag(x_drag);
+  _denseCMPC->setSolverSettings(_parameters->jcqp_max_iter, _parameters->jcqp_rho,
                          _parameters->jcqp_sigma, _parameters->jcqp_alpha, _parameters->jcqp_terminate, _parameters->use_jcqp);
   //t1.stopPrint("Setup MPC");
 
   Timer t2;
   //cout << "dtMPC: " << dtMPC << "\n";
-  update_problem_data_floats(p,v,q,w,r,yaw,weights,trajAll,alpha,mpcTable);
+  _denseCMPC->solve(p,v,q,w,r,yaw,weights,trajAll,alpha,mpcTable);
   //t2.stopPrint("Run MPC");
   //printf("MPC Solve time %f ms\n", t2.getMs());
 
@@ -729,7 +779,7 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
   {
     Vec3<float> f;
     for(int axis = 0; axis < 3; axis++)
-      f[axis] = get_solution(leg*3 + axis);
+      f[axis] = _denseCMPC->getSolution(leg*3 + axis);
 
     //printf("[%d] %7.3f %7.3f %7.3f\n", leg, f[0], f[1], f[2]);
 
@@ -739,6 +789,31 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
   }
 }
 
+void ConvexMPCLocomotion::applyMPCPlan(ControlFSMData<float> &data) {
+  auto& seResult = data._stateEstimator->getResult();
+  // control time rather than wall time, so plans line up with the gait in
+  // simulations which run faster than real time
+  double time = iterationCounter * dt;
+
+  if(_mpcThread.consume()) {
+    float latency = time - _mpcThread.plan().requestTime;
+    _mpcLatency = .9f * _mpcLatency + .1f * latency;
+  }
+
+  const ConvexMPCPlan& plan = _mpcThread.plan();
+  if(plan.horizon == 0) return;
+
+  for(int leg = 0; leg < 4; leg++)
+  {
+    const float* force = plan.force(leg, time);
+    Vec3<float> f(force[0], force[1], force[2]);
+
+    f_ff[leg] = -seResult.rBody * f;
+    // Update for WBC
+    Fr_des[leg] = f;
+  }
+}
+
 void ConvexMPCLocomotion::solveSparseMPC(int *mpcTable, ControlFSMData<float> &data) {
   // X0, contact trajectory, state trajectory, feet, get result!
   (void)mpcTable;
@@ -5,6 +5,10 @@
 #include <FSM_States/ControlFSMData.h>
 #include <SparseCMPC/SparseCMPC.h>
 #include "cppTypes.h"
+#include "ConvexMPCThread.h"
+#include <memory>
+
+class ConvexMPCSolver;
 
 using Eigen::Array4f;
 using Eigen::Array4i;
@@ -48,6 +52,7 @@ private:
 class ConvexMPCLocomotion {
 public:
   ConvexMPCLocomotion(float _dt, int _iterations_between_mpc, MIT_UserParameters* parameters);
+  ~ConvexMPCLocomotion();
   void initialize();
 
   template<typename T>
@@ -76,6 +81,7 @@ private:
 
   void updateMPCIfNeeded(int* mpcTable, ControlFSMData<float>& data, bool omniMode);
   void solveDenseMPC(int *mpcTable, ControlFSMData<float> &data);
+  void applyMPCPlan(ControlFSMData<float> &data);
   void solveSparseMPC(int *mpcTable, ControlFSMData<float> &data);
   void initSparseMPC();
   int iterationsBetweenMPC;
@@ -108,6 +114,12 @@ private:
   vectorAligned<Vec12<double>> _sparseTrajectory;
 
   SparseCMPC _sparseCMPC;
+  std::unique_ptr<ConvexMPCSolver> _denseCMPC;
+
+  // with cmpc_async the dense MPC solves on its own thread, and each control
+  // tick takes the force of the latest plan for the current time
+  ConvexMPCThread _mpcThread;
+  float _mpcLatency;  // expected control time from request to plan
 
 };
 
@@ -0,0 +1,95 @@
+#include "ConvexMPCThread.h"
+#include "SolverMPC.h"
+#include <Utilities/Timer.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <stdio.h>
+
+ConvexMPCThread::ConvexMPCThread() : _solver(new ConvexMPCSolver()) {}
+
+ConvexMPCThread::~ConvexMPCThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+  }
+  _cv.notify_one();
+  if(_thread.joinable())
+    _thread.join();
+}
+
+void ConvexMPCThread::submit()
+{
+  _requests.publish();
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending = true;
+    if(!_running)
+    {
+      _running = true;
+      _thread = std::thread(&ConvexMPCThread::run, this);
+    }
+  }
+  _cv.notify_one();
+}
+
+void ConvexMPCThread::run()
+{
+  //the thread inherits the scheduling of the control loop, so step below it
+  int policy;
+  sched_param param;
+  pthread_getschedparam(pthread_self(), &policy, &param);
+  if((policy == SCHED_FIFO || policy == SCHED_RR) &&
+     param.sched_priority > sched_get_priority_min(policy))
+  {
+    param.sched_priority--;
+    if(pthread_setschedparam(pthread_self(), policy, &param) != 0)
+      printf("[MPC ERROR] Failed to lower the MPC thread priority.\n");
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  for(;;)
+  {
+    _cv.wait(lock, [this] { return _pending || !_running; });
+    if(!_running) return;
+    _pending = false;
+    lock.unlock();
+
+    if(_requests.consume())
+      solve(_requests.readBuffer());
+
+    lock.lock();
+  }
+}
+
+void ConvexMPCThread::solve(const ConvexMPCRequest& request)
+{
+  Timer timer;
+  try
+  {
+    _solver->setup(request.dt, request.horizon, request.mu, request.f_max);
+    _solver->setSolverSettings(request.max_iterations, request.rho,
+                               request.sigma, request.solver_alpha,
+                               request.terminate, request.use_jcqp);
+    _solver->setXDrag(request.x_drag);
+    _solver->solve(request.p, request.v, request.q, request.w, request.r,
+                   request.yaw, request.weights, request.traj, request.alpha,
+                   request.gait);
+  }
+  catch(std::exception& e)
+  {
+    printf("[MPC ERROR] %s\n", e.what());
+    return;
+  }
+
+  ConvexMPCPlan& plan = _plans.writeBuffer();
+  plan.time = request.time;
+  plan.requestTime = request.requestTime;
+  plan.dt = request.dt;
+  plan.horizon = request.horizon;
+  for(int i = 0; i < 12 * request.horizon; i++)
+    plan.forces[i] = _solver->getSolution(i);
+  plan.solve_time_ms = timer.getMs();
+  _plans.publish();
+}
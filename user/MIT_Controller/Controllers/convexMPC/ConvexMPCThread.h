@@ -0,0 +1,110 @@
+#ifndef _convex_mpc_thread
+#define _convex_mpc_thread
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "convexMPC_interface.h"
+#include "Utilities/TripleBuffer.h"
+
+class ConvexMPCSolver;
+
+/*!
+ * Everything one MPC solve needs.  The state is the state at time, which the
+ * caller may have predicted ahead of the time the request is made.
+ */
+struct ConvexMPCRequest
+{
+  double time;          // control time of the state
+  double requestTime;   // control time the request was made
+
+  float dt, mu, f_max;
+  int horizon;
+
+  int max_iterations;
+  double rho, sigma, solver_alpha, terminate, use_jcqp;
+  float x_drag;
+
+  float p[3], v[3], q[4], w[3], r[12];
+  float yaw;
+  float weights[12];
+  float alpha;
+  float traj[12*K_MAX_GAIT_SEGMENTS];
+  int gait[4*K_MAX_GAIT_SEGMENTS];
+};
+
+/*!
+ * Forces planned by one MPC solve.  Force k is applied from time + k * dt
+ * until the next one starts.
+ */
+struct ConvexMPCPlan
+{
+  double time = 0;
+  double requestTime = 0;
+  float dt = 0;
+  int horizon = 0;  // zero if there is no plan yet
+  float solve_time_ms = 0;
+  float forces[12*K_MAX_GAIT_SEGMENTS];
+
+  /*!
+   * Get the force (world frame) of a leg at a control time.  Before the plan
+   * starts this is the first force and after it ends the last one.
+   */
+  const float* force(int leg, double t) const
+  {
+    int k = (int)((t - time) / dt);
+    if(k < 0) k = 0;
+    if(k > horizon - 1) k = horizon - 1;
+    return &forces[12*k + 3*leg];
+  }
+};
+
+/*!
+ * Runs a ConvexMPCSolver on its own thread, so the control loop does not wait
+ * for the solve.  The control loop fills request() and submits it, and takes
+ * finished plans with consume().  Both go through triple buffers, so neither
+ * thread ever waits on the other: a request submitted while the solver is
+ * busy replaces any request still waiting, and only the latest plan is kept.
+ *
+ * The thread is started by the first submit, one priority level below the
+ * thread that submits if that thread is real time.
+ */
+class ConvexMPCThread
+{
+public:
+  ConvexMPCThread();
+  ~ConvexMPCThread();
+  ConvexMPCThread(const ConvexMPCThread&) = delete;
+  ConvexMPCThread& operator=(const ConvexMPCThread&) = delete;
+
+  /*!
+   * Get the request to fill.  It belongs to the caller until submit.
+   */
+  ConvexMPCRequest& request() { return _requests.writeBuffer(); }
+  void submit();
+
+  /*!
+   * Take the latest plan.
+   * @return true if a new plan finished since the last consume
+   */
+  bool consume() { return _plans.consume(); }
+  const ConvexMPCPlan& plan() { return _plans.readBuffer(); }
+
+private:
+  void run();
+  void solve(const ConvexMPCRequest& request);
+
+  std::unique_ptr<ConvexMPCSolver> _solver;
+  TripleBuffer<ConvexMPCRequest> _requests;
+  TripleBuffer<ConvexMPCPlan> _plans;
+
+  std::thread _thread;
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  bool _pending = false;
+  bool _running = false;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "RiccatiMPC.h"
+#include <algorithm>
+#include <cmath>
+
+void RiccatiMPC::resize(int horizon)
+{
+  _stages.resize(horizon);
+}
+
+//residuals of the KKT conditions at the current point
+void RiccatiMPC::computeResiduals(const Mat13& A, const Vec13& x0)
+{
+  int N = _stages.size();
+  for(int k = 0; k < N; k++)
+  {
+    Stage& st = _stages[k];
+    const Vec13& x_prev = k == 0 ? x0 : _stages[k-1].x;
+    int m = st.m;
+
+    st.ru = _r * st.u + st.B.transpose() * st.p;
+    st.ru += st.D.topRows(m).transpose() * st.lam.head(m);
+    st.rx = _q.cwiseProduct(st.x - st.xd) - st.p;
+    if(k + 1 < N)
+      st.rx += A.transpose() * _stages[k+1].p;
+    st.rd = A * x_prev + st.B * st.u - st.x;
+    st.ri.head(m) = st.D.topRows(m) * st.u + st.s.head(m) - st.d.head(m);
+  }
+}
+
+//backward Riccati recursion for the parts of the Newton step which only
+//depend on the current slacks and multipliers, not on the right hand side
+void RiccatiMPC::factor(const Mat13& A)
+{
+  int N = _stages.size();
+  _stages[N-1].P = _q.asDiagonal();
+  for(int k = N - 1; k >= 0; k--)
+  {
+    Stage& st = _stages[k];
+    int m = st.m;
+
+    Vec20 sigma;
+    sigma.head(m) = st.lam.head(m).cwiseQuotient(st.s.head(m));
+    Mat12 Huu = st.D.topRows(m).transpose() * sigma.head(m).asDiagonal() *
+                st.D.topRows(m);
+    Huu.diagonal().array() += _r;
+
+    Mat13x12 PB = st.P * st.B;
+    Huu += st.B.transpose() * PB;
+    st.Hux = PB.transpose() * A;
+    st.Huu.compute(Huu);
+    st.K = -st.Huu.solve(st.Hux);
+
+    if(k > 0)
+    {
+      Mat13 P = A.transpose() * st.P * A + st.Hux.transpose() * st.K;
+      P.diagonal() += _q;
+      _stages[k-1].P = 0.5 * (P + P.transpose());
+    }
+  }
+}
+
+//solve for the Newton step with the complementarity residual in rc
+void RiccatiMPC::solveNewton(const Mat13& A)
+{
+  int N = _stages.size();
+  _stages[N-1].pi = _stages[N-1].rx;
+  for(int k = N - 1; k >= 0; k--)
+  {
+    Stage& st = _stages[k];
+    int m = st.m;
+
+    Vec20 r;
+    r.head(m) = (st.lam.head(m).cwiseProduct(st.ri.head(m)) - st.rc.head(m))
+                .cwiseQuotient(st.s.head(m));
+    Vec13 v = st.P * st.rd + st.pi;
+    Vec12 hu = st.ru + st.D.topRows(m).transpose() * r.head(m) +
+               st.B.transpose() * v;
+    st.kff = -st.Huu.solve(hu);
+
+    if(k > 0)
+      _stages[k-1].pi = _stages[k-1].rx + A.transpose() * v +
+                        st.Hux.transpose() * st.kff;
+  }
+
+  Vec13 dx_prev = Vec13::Zero();
+  for(int k = 0; k < N; k++)
+  {
+    Stage& st = _stages[k];
+    int m = st.m;
+
+    st.du = st.K * dx_prev + st.kff;
+    st.dx = A * dx_prev + st.B * st.du + st.rd;
+    st.dp = st.P * st.dx + st.pi;
+    st.ds.head(m) = -st.ri.head(m) - st.D.topRows(m) * st.du;
+    st.dlam.head(m) = -(st.rc.head(m) +
+                        st.lam.head(m).cwiseProduct(st.ds.head(m)))
+                      .cwiseQuotient(st.s.head(m));
+    dx_prev = st.dx;
+  }
+}
+
+//largest step (up to 1) which keeps the slacks and multipliers positive,
+//scaled by fraction
+double RiccatiMPC::maxStep(double fraction)
+{
+  double step = 1. / fraction;
+  for(const Stage& st : _stages)
+  {
+    for(int i = 0; i < st.m; i++)
+    {
+      if(st.ds[i] < 0) step = std::min(step, -st.s[i] / st.ds[i]);
+      if(st.dlam[i] < 0) step = std::min(step, -st.lam[i] / st.dlam[i]);
+    }
+  }
+  return std::min(1., fraction * step);
+}
+
+bool RiccatiMPC::solve(const Mat13& A, const Mat13x12& B, const Vec13& Q,
+                       double alpha, double mu, double f_max, const Vec13& x0,
+                       const float* traj, const u8* gait, double* u)
+{
+  int N = _stages.size();
+  double c = 1. / mu;
+  int total = 0;
+
+  //constraints, and a starting point on the dynamics with zero force
+  Vec13 x = x0;
+  for(int k = 0; k < N; k++)
+  {
+    Stage& st = _stages[k];
+    st.B = B;
+    st.m = 0;
+    for(int leg = 0; leg < 4; leg++)
+    {
+      u8 contact = gait[k*4 + leg];
+      if(!contact)
+      {
+        st.B.middleCols(leg*3, 3).setZero();
+        continue;
+      }
+      Eigen::Matrix<double,5,3> cone;
+      cone << -c,  0, -1,
+               c,  0, -1,
+               0, -c, -1,
+               0,  c, -1,
+               0,  0,  1;
+      st.D.middleRows(st.m, 5).setZero();
+      st.D.block(st.m, leg*3, 5, 3) = cone;
+      st.d.segment(st.m, 5) << 0, 0, 0, 0, contact * f_max;
+      st.m += 5;
+    }
+    total += st.m;
+
+    for(int i = 0; i < 12; i++)
+      st.xd[i] = traj[12*k + i];
+    st.xd[12] = 0;
+
+    st.u.setZero();
+    x = A * x;
+    st.x = x;
+    st.p.setZero();
+    st.s.head(st.m).setOnes();
+    st.lam.head(st.m).setOnes();
+  }
+
+  //scale the cost so that the forces and the multipliers are in newtons
+  _q = Q / alpha;
+  _r = 1;
+
+  //starting point: take the full affine step from the zero force rollout,
+  //then move the slacks and multipliers back into the interior
+  computeResiduals(A, x0);
+  factor(A);
+  for(Stage& st : _stages)
+    st.rc.head(st.m) = st.s.head(st.m).cwiseProduct(st.lam.head(st.m));
+  solveNewton(A);
+  for(Stage& st : _stages)
+  {
+    int m = st.m;
+    st.u += st.du;
+    st.x += st.dx;
+    st.p += st.dp;
+    st.s.head(m) = (st.s.head(m) + st.ds.head(m)).cwiseAbs().cwiseMax(1.);
+    st.lam.head(m) =
+      (st.lam.head(m) + st.dlam.head(m)).cwiseAbs().cwiseMax(1.);
+  }
+
+  bool converged = false;
+  int it = 0;
+  for(; it < maxIterations; it++)
+  {
+    computeResiduals(A, x0);
+
+    double gap = 0, residual = 0;
+    for(const Stage& st : _stages)
+    {
+      int m = st.m;
+      gap += st.s.head(m).dot(st.lam.head(m));
+      residual = std::max(residual, st.ru.cwiseAbs().maxCoeff());
+      residual = std::max(residual, st.rx.cwiseAbs().maxCoeff());
+      residual = std::max(residual, st.rd.cwiseAbs().maxCoeff());
+      if(m) residual = std::max(residual, st.ri.head(m).cwiseAbs().maxCoeff());
+    }
+    double mu_gap = total ? gap / total : 0;
+    if(residual < tolerance && mu_gap < tolerance)
+    {
+      converged = true;
+      break;
+    }
+
+    factor(A);
+
+    //predictor: the affine scaling step
+    for(Stage& st : _stages)
+      st.rc.head(st.m) = st.s.head(st.m).cwiseProduct(st.lam.head(st.m));
+    solveNewton(A);
+    double step = maxStep(1.);
+
+    //corrector: aim for the centering Mehrotra's heuristic picks, and
+    //correct for the second order term of the predictor
+    double gap_aff = 0;
+    for(const Stage& st : _stages)
+    {
+      int m = st.m;
+      gap_aff += (st.s.head(m) + step * st.ds.head(m))
+                 .dot(st.lam.head(m) + step * st.dlam.head(m));
+    }
+    double sigma = total ? std::pow(gap_aff / gap, 3) : 0;
+    for(Stage& st : _stages)
+    {
+      int m = st.m;
+      st.rc.head(m) = st.s.head(m).cwiseProduct(st.lam.head(m)) +
+                      st.ds.head(m).cwiseProduct(st.dlam.head(m));
+      st.rc.head(m).array() -= sigma * mu_gap;
+    }
+    solveNewton(A);
+    step = maxStep(0.995);
+
+    for(Stage& st : _stages)
+    {
+      int m = st.m;
+      st.u += step * st.du;
+      st.x += step * st.dx;
+      st.p += step * st.dp;
+      st.s.head(m) += step * st.ds.head(m);
+      st.lam.head(m) += step * st.dlam.head(m);
+    }
+  }
+  _iterations = it;
+
+  for(int k = 0; k < N; k++)
+    for(int i = 0; i < 12; i++)
+      u[12*k + i] = _stages[k].u[i];
+  return converged;
+}
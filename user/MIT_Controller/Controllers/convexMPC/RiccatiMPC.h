@@ -0,0 +1,98 @@
+#ifndef _riccati_mpc
+#define _riccati_mpc
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+#include <vector>
+#include "common_types.h"
+
+/*!
+ * Interior point solver for the convex MPC which keeps the problem in stages
+ * (the state and the forces of each horizon step) instead of condensing it
+ * into a dense QP.  Each Newton step is solved with a Riccati recursion, so
+ * the cost grows linearly with the horizon instead of cubically.
+ *
+ * minimize   sum_k (x_k+1 - xd_k+1)' Q (x_k+1 - xd_k+1) + alpha |u_k|^2
+ * subject to x_k+1 = A x_k + B u_k
+ *            the forces of legs in stance are in the friction pyramid and
+ *            below gait * f_max, the forces of the other legs are zero
+ *
+ * This is the same problem as the dense QP in SolverMPC.cpp.  It is solved
+ * with Mehrotra's predictor-corrector method, from an infeasible start.
+ */
+class RiccatiMPC
+{
+public:
+  typedef Eigen::Matrix<double,13,13> Mat13;
+  typedef Eigen::Matrix<double,13,12> Mat13x12;
+  typedef Eigen::Matrix<double,12,13> Mat12x13;
+  typedef Eigen::Matrix<double,12,12> Mat12;
+  typedef Eigen::Matrix<double,20,12> Mat20x12;
+  typedef Eigen::Matrix<double,13,1> Vec13;
+  typedef Eigen::Matrix<double,12,1> Vec12;
+  typedef Eigen::Matrix<double,20,1> Vec20;
+
+  void resize(int horizon);
+
+  /*!
+   * Solve the MPC
+   * @param A : discrete time dynamics
+   * @param B : discrete time force input, for all four legs
+   * @param Q : state weights
+   * @param alpha : force weight
+   * @param x0 : initial state
+   * @param traj : desired states of steps 1 to horizon, 12 per step
+   * @param gait : contact of each leg at each step, 4 per step
+   * @param u : the forces of each step, 12 per step
+   * @return true if the solver converged
+   */
+  bool solve(const Mat13& A, const Mat13x12& B, const Vec13& Q, double alpha,
+             double mu, double f_max, const Vec13& x0, const float* traj,
+             const u8* gait, double* u);
+
+  int getIterations() const { return _iterations; }
+
+  int maxIterations = 50;
+  double tolerance = 1e-6;  // on the residuals and the complementarity
+
+private:
+  struct Stage
+  {
+    Mat13x12 B;       // zero columns for legs which are not in stance
+    Mat20x12 D;       // inequality constraints D u <= d, first m rows used
+    Vec20 d;
+    int m;
+
+    Vec12 u;
+    Vec13 x, xd, p;   // state after this step, its target and costate
+    Vec20 s, lam;     // slack and multiplier of the inequalities
+
+    Vec12 ru;         // residuals
+    Vec13 rx, rd;
+    Vec20 ri, rc;
+
+    Mat13 P;          // cost to go of x, and its gradient
+    Vec13 pi;
+    Mat12x13 Hux, K;  // feedback from the state before this step
+    Vec12 kff;
+    Eigen::LLT<Mat12> Huu;
+
+    Vec12 du;
+    Vec13 dx, dp;
+    Vec20 ds, dlam;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  void computeResiduals(const Mat13& A, const Vec13& x0);
+  void factor(const Mat13& A);
+  void solveNewton(const Mat13& A);
+  double maxStep(double fraction);
+
+  std::vector<Stage, Eigen::aligned_allocator<Stage>> _stages;
+  Vec13 _q;   // Hessian of the cost, scaled so the force term is 1
+  double _r;
+  int _iterations = 0;
+};
+
+#endif
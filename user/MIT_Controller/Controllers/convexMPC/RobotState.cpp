@@ -5,6 +5,7 @@
 
 using std::cout;
 using std::endl;
+using Eigen::Matrix;
 
 void RobotState::set(flt* p_, flt* v_, flt* q_, flt* w_, flt* r_,flt yaw_)
 {
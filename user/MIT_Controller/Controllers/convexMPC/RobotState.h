@@ -4,9 +4,6 @@
 #include <eigen3/Eigen/Dense>
 #include "common_types.h"
 
-using Eigen::Matrix;
-using Eigen::Quaternionf;
-
 #include "common_types.h"
 class RobotState
 {
@@ -14,12 +11,12 @@ class RobotState
         void set(flt* p, flt* v, flt* q, flt* w, flt* r, flt yaw);
         //void compute_rotations();
         void print();
-        Matrix<fpt,3,1> p,v,w;
-        Matrix<fpt,3,4> r_feet;
-        Matrix<fpt,3,3> R;
-        Matrix<fpt,3,3> R_yaw;
-        Matrix<fpt,3,3> I_body;
-        Quaternionf q;
+        Eigen::Matrix<fpt,3,1> p,v,w;
+        Eigen::Matrix<fpt,3,4> r_feet;
+        Eigen::Matrix<fpt,3,3> R;
+        Eigen::Matrix<fpt,3,3> R_yaw;
+        Eigen::Matrix<fpt,3,3> I_body;
+        Eigen::Quaternionf q;
         fpt yaw;
         fpt m = 9;
     //private:
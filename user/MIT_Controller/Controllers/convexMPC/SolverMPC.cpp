@@ -2,12 +2,13 @@
 #include "common_types.h"
 #include "convexMPC_interface.h"
 #include "RobotState.h"
+#include "RiccatiMPC.h"
 #include <eigen3/Eigen/Dense>
 #include <cmath>
-#include <eigen3/unsupported/Eigen/MatrixFunctions>
-//#include <unsupported/Eigen/MatrixFunctions>
 #include <qpOASES.hpp>
 #include <stdio.h>
+#include <string.h>
+#include <stdexcept>
 #include <sys/time.h>
 #include <Utilities/Timer.h>
 #include <JCQP/QpProblem.h>
@@ -16,62 +17,56 @@
 #define BIG_NUMBER 5e10
 //big enough to act like infinity, small enough to avoid numerical weirdness.
 
-RobotState rs;
 using std::cout;
 using std::endl;
 using Eigen::Dynamic;
+using Eigen::Matrix;
+using Eigen::Quaternionf;
 
-//qpOASES::real_t a;
-
-Matrix<fpt,Dynamic,13> A_qp;
-Matrix<fpt,Dynamic,Dynamic> B_qp;
-Matrix<fpt,13,12> Bdt;
-Matrix<fpt,13,13> Adt;
-Matrix<fpt,25,25> ABc,expmm;
-Matrix<fpt,Dynamic,Dynamic> S;
-Matrix<fpt,Dynamic,1> X_d;
-Matrix<fpt,Dynamic,1> U_b;
-Matrix<fpt,Dynamic,Dynamic> fmat;
-
-Matrix<fpt,Dynamic,Dynamic> qH;
-Matrix<fpt,Dynamic,1> qg;
-
-Matrix<fpt,Dynamic,Dynamic> eye_12h;
-
-qpOASES::real_t* H_qpoases;
-qpOASES::real_t* g_qpoases;
-qpOASES::real_t* A_qpoases;
-qpOASES::real_t* lb_qpoases;
-qpOASES::real_t* ub_qpoases;
-qpOASES::real_t* q_soln;
-
-qpOASES::real_t* H_red;
-qpOASES::real_t* g_red;
-qpOASES::real_t* A_red;
-qpOASES::real_t* lb_red;
-qpOASES::real_t* ub_red;
-qpOASES::real_t* q_red;
-u8 real_allocated = 0;
-
+ConvexMPCSolver::ConvexMPCSolver()
+{
+  memset(&problem_configuration, 0, sizeof(problem_configuration));
+  memset(&update, 0, sizeof(update));
+}
 
-char var_elim[2000];
-char con_elim[2000];
+ConvexMPCSolver::~ConvexMPCSolver()
+{
+  reset_warm_start();
+  if(real_allocated)
+  {
+    free(H_qpoases);
+    free(g_qpoases);
+    free(A_qpoases);
+    free(lb_qpoases);
+    free(ub_qpoases);
+    free(q_soln);
+    free(H_red);
+    free(g_red);
+    free(A_red);
+    free(lb_red);
+    free(ub_red);
+    free(q_red);
+  }
+}
 
-mfp* get_q_soln()
+void ConvexMPCSolver::reset_warm_start()
 {
-  return q_soln;
+  delete warm_problem;
+  warm_problem = nullptr;
+  warm_vars = 0;
+  warm_cons = 0;
 }
 
-s8 near_zero(fpt a)
+static s8 near_zero(fpt a)
 {
   return (a < 0.01 && a > -.01) ;
 }
 
-s8 near_one(fpt a)
+static s8 near_one(fpt a)
 {
   return near_zero(a-1);
 }
-void matrix_to_real(qpOASES::real_t* dst, Matrix<fpt,Dynamic,Dynamic> src, s16 rows, s16 cols)
+static void matrix_to_real(qpOASES::real_t* dst, const Matrix<fpt,Dynamic,Dynamic>& src, s16 rows, s16 cols)
 {
   s32 a = 0;
   for(s16 r = 0; r < rows; r++)
@@ -85,39 +80,38 @@ void matrix_to_real(qpOASES::real_t* dst, Matrix<fpt,Dynamic,Dynamic> src, s16 r
 }
 
 
-void c2qp(Matrix<fpt,13,13> Ac, Matrix<fpt,13,12> Bc,fpt dt,s16 horizon)
+//exact discretization.  In A the body rates only drive the orientation, and
+//the velocities (and gravity) only drive the position and the z velocity, so
+//A^3 = 0.  The series for exp([A B; 0 0] dt) then ends after the cubic term:
+//Adt = I + A dt + A^2 dt^2/2 and Bdt = B dt + A B dt^2/2 + A^2 B dt^3/6.
+void ConvexMPCSolver::c2d(const Matrix<fpt,13,13>& Ac, const Matrix<fpt,13,12>& Bc,fpt dt)
 {
-  ABc.setZero();
-  ABc.block(0,0,13,13) = Ac;
-  ABc.block(0,13,13,12) = Bc;
-  ABc = dt*ABc;
-  expmm = ABc.exp();
-  Adt = expmm.block(0,0,13,13);
-  Bdt = expmm.block(0,13,13,12);
+  Matrix<fpt,13,13> A2 = Ac * Ac;
+  Matrix<fpt,13,12> AB = Ac * Bc;
+  Adt = Matrix<fpt,13,13>::Identity() + dt*Ac + (dt*dt/2)*A2;
+  Bdt = dt*Bc + (dt*dt/2)*AB + (dt*dt*dt/6)*(Ac*AB);
 #ifdef K_PRINT_EVERYTHING
   cout<<"Adt: \n"<<Adt<<"\nBdt:\n"<<Bdt<<endl;
 #endif
+}
+
+//condense the horizon: x = A_qp x_0 + B_qp u.  Block (r, c) of B_qp is
+//Adt^(r-c) Bdt, so each power is computed once and copied down its diagonal.
+void ConvexMPCSolver::c2qp(s16 horizon)
+{
   if(horizon > 19) {
     throw std::runtime_error("horizon is too long!");
   }
 
-  Matrix<fpt,13,13> powerMats[20];
-  powerMats[0].setIdentity();
-  for(int i = 1; i < horizon+1; i++) {
-    powerMats[i] = Adt * powerMats[i-1];
-  }
-
-  for(s16 r = 0; r < horizon; r++)
+  Matrix<fpt,13,13> powerMat = Adt;
+  Matrix<fpt,13,12> powerB = Bdt;
+  for(s16 a_num = 0; a_num < horizon; a_num++)
   {
-    A_qp.block(13*r,0,13,13) = powerMats[r+1];//Adt.pow(r+1);
-    for(s16 c = 0; c < horizon; c++)
-    {
-      if(r >= c)
-      {
-        s16 a_num = r-c;
-        B_qp.block(13*r,12*c,13,12) = powerMats[a_num] /*Adt.pow(a_num)*/ * Bdt;
-      }
-    }
+    A_qp.block(13*a_num,0,13,13) = powerMat;
+    for(s16 c = 0; c + a_num < horizon; c++)
+      B_qp.block(13*(c + a_num),12*c,13,12) = powerB;
+    powerMat = Adt * powerMat;
+    powerB = Adt * powerB;
   }
 
 #ifdef K_PRINT_EVERYTHING
@@ -125,8 +119,12 @@ void c2qp(Matrix<fpt,13,13> Ac, Matrix<fpt,13,12> Bc,fpt dt,s16 horizon)
 #endif
 }
 
-void resize_qp_mats(s16 horizon)
+void ConvexMPCSolver::resize_qp_mats(s16 horizon)
 {
+  //everything not assigned by solve_mpc stays zero, so only clear on resize
+  if(real_allocated && horizon == allocated_horizon)
+    return;
+
   int mcount = 0;
   int h2 = horizon*horizon;
 
@@ -136,8 +134,11 @@ void resize_qp_mats(s16 horizon)
   B_qp.resize(13*horizon, 12*horizon);
   mcount += 13*h2*12;
 
-  S.resize(13*horizon, 13*horizon);
-  mcount += 13*13*h2;
+  S.resize(13*horizon, Eigen::NoChange);
+  mcount += 13*horizon;
+
+  SB_qp.resize(13*horizon, 12*horizon);
+  mcount += 13*h2*12;
 
   X_d.resize(13*horizon, Eigen::NoChange);
   mcount += 13*horizon;
@@ -154,20 +155,22 @@ void resize_qp_mats(s16 horizon)
   qg.resize(12*horizon, Eigen::NoChange);
   mcount += 12*horizon;
 
-  eye_12h.resize(12*horizon, 12*horizon);
-  mcount += 12*12*horizon;
-
   //printf("realloc'd %d floating point numbers.\n",mcount);
   mcount = 0;
 
   A_qp.setZero();
   B_qp.setZero();
   S.setZero();
+  SB_qp.setZero();
   X_d.setZero();
   U_b.setZero();
   fmat.setZero();
+  S_built = 0;
+  fmat_mu = 0;
   qH.setZero();
-  eye_12h.setIdentity();
+
+  reset_warm_start();
+  riccati_mpc.resize(horizon);
 
   //TODO: use realloc instead of free/malloc on size changes
 
@@ -214,6 +217,7 @@ void resize_qp_mats(s16 horizon)
   q_red = (qpOASES::real_t*)malloc(12*horizon*sizeof(qpOASES::real_t));
   mcount += 12*horizon;
   real_allocated = 1;
+  allocated_horizon = horizon;
 
   //printf("malloc'd %d floating point numbers.\n",mcount);
 
@@ -288,15 +292,100 @@ void print_update_data(update_data_t* update, s16 horizon)
 }
 
 
-Matrix<fpt,13,1> x_0;
-Matrix<fpt,3,3> I_world;
-Matrix<fpt,13,13> A_ct;
-Matrix<fpt,13,12> B_ct_r;
+//solve the reduced problem with qpOASES.  If the same constraints were
+//eliminated as in the last solve, shifted forward by one horizon step, warm
+//start from the working set of the last solve, shifted the same way (the last
+//step keeps its working set).  Otherwise, or if the warm start fails, cold
+//start.  The warm start goes through init() with a guessed working set rather
+//than hotstart(): the Hessian changes every solve, so hotstart() would first
+//refactor for the old working set and then again for the shifted one.
+void ConvexMPCSolver::solve_qpoases_warm(update_data_t* data,
+                                         int num_constraints, int new_vars,
+                                         int new_cons, const int* con_ind)
+{
+  const int step_cons = 20;
+  bool shifted = warm_vars == new_vars && warm_cons == new_cons;
+  for(int i = 0; shifted && i < num_constraints - step_cons; i++)
+    shifted = con_elim[i] == warm_con_elim[i + step_cons];
 
+  if(!warm_problem || warm_problem->getNV() != new_vars ||
+     warm_problem->getNC() != new_cons)
+  {
+    delete warm_problem;
+    warm_problem = new qpOASES::SQProblem(new_vars, new_cons);
+    qpOASES::Options op;
+    op.setToMPC();
+    op.printLevel = qpOASES::PL_NONE;
+    warm_problem->setOptions(op);
+  }
 
-void solve_mpc(update_data_t* update, problem_setup* setup)
+  int iterations = 0;
+  bool solved = false;
+  if(shifted)
+  {
+    qpOASES::Constraints guess(new_cons);
+    for(int i = 0; i < new_cons; i++)
+    {
+      int old = con_ind[i] + step_cons;
+      if(old >= num_constraints) old -= step_cons;
+      qpOASES::real_t ws = warm_working_set[old];
+      guess.setupConstraint(i, ws < -0.5 ? qpOASES::ST_LOWER :
+                               ws > 0.5 ? qpOASES::ST_UPPER :
+                               qpOASES::ST_INACTIVE);
+    }
+
+    qpOASES::int_t nWSR = 100;
+    solved = warm_problem->init(H_red, g_red, A_red, NULL, NULL,
+                                lb_red, ub_red, nWSR, NULL, NULL, NULL,
+                                NULL, &guess) == qpOASES::SUCCESSFUL_RETURN;
+    iterations += nWSR;
+  }
+  data->qp_warm_started = solved;
+
+  if(!solved)
+  {
+    qpOASES::int_t nWSR = 100;
+    solved = warm_problem->init(H_red, g_red, A_red, NULL, NULL,
+                                lb_red, ub_red, nWSR) ==
+             qpOASES::SUCCESSFUL_RETURN;
+    iterations += nWSR;
+  }
+  data->qp_iterations = iterations;
+
+  if(warm_problem->getPrimalSolution(q_red) != qpOASES::SUCCESSFUL_RETURN)
+    printf("failed to solve!\n");
+
+  if(!solved)
+  {
+    warm_vars = 0;
+    warm_cons = 0;
+    return;
+  }
+
+  warm_problem->getWorkingSetConstraints(red_working_set);
+  for(int i = 0; i < num_constraints; i++)
+  {
+    warm_working_set[i] = 0;
+    warm_con_elim[i] = con_elim[i];
+  }
+  for(int i = 0; i < new_cons; i++)
+    warm_working_set[con_ind[i]] = red_working_set[i];
+  warm_vars = new_vars;
+  warm_cons = new_cons;
+}
+
+
+void ConvexMPCSolver::solve_mpc(update_data_t* data, problem_setup* setup)
 {
-  rs.set(update->p, update->v, update->q, update->w, update->r, update->yaw);
+  Timer total_timer;
+  Timer stage_timer;
+  data->discretize_time_ms = 0;
+  data->condense_time_ms = 0;
+  data->reduce_time_ms = 0;
+  data->qp_iterations = 0;
+  data->qp_warm_started = 0;
+
+  rs.set(data->p, data->v, data->q, data->w, data->r, data->yaw);
 #ifdef K_PRINT_EVERYTHING
 
   printf("-----------------\n");
@@ -308,7 +397,7 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
     printf("    ROBOT DATA   \n");
     printf("-----------------\n");
     rs.print();
-    print_update_data(update,setup->horizon);
+    print_update_data(data,setup->horizon);
 #endif
 
   //roll pitch yaw
@@ -320,7 +409,7 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
   I_world = rs.R_yaw * rs.I_body * rs.R_yaw.transpose(); //original
   //I_world = rs.R_yaw.transpose() * rs.I_body * rs.R_yaw;
   //cout<<rs.R_yaw<<endl;
-  ct_ss_mats(I_world,rs.m,rs.r_feet,rs.R_yaw,A_ct,B_ct_r, update->x_drag);
+  ct_ss_mats(I_world,rs.m,rs.r_feet,rs.R_yaw,A_ct,B_ct_r, data->x_drag);
 
 
 #ifdef K_PRINT_EVERYTHING
@@ -329,21 +418,50 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
     cout<<"A CT: \n"<<A_ct<<endl;
     cout<<"B CT (simplified): \n"<<B_ct_r<<endl;
 #endif
+  data->model_time_ms = stage_timer.getMs();
+  stage_timer.start();
+  c2d(A_ct,B_ct_r,setup->dt);
+  data->discretize_time_ms = stage_timer.getMs();
+  stage_timer.start();
+
+  //the stage-wise solver skips condensing, which is cubic in the horizon
+  if(data->use_jcqp == 3)
+  {
+    Matrix<double,13,1> weights;
+    for(u8 i = 0; i < 12; i++)
+      weights(i) = data->weights[i];
+    weights(12) = 0;
+    if(!riccati_mpc.solve(Adt.cast<double>(), Bdt.cast<double>(), weights,
+                          data->alpha, setup->mu, setup->f_max,
+                          x_0.cast<double>(), data->traj, data->gait,
+                          q_soln))
+      printf("failed to solve!\n");
+    data->qp_iterations = riccati_mpc.getIterations();
+    data->solve_time_ms = stage_timer.getMs();
+    data->total_time_ms = total_timer.getMs();
+    return;
+  }
+
   //QP matrices
-  c2qp(A_ct,B_ct_r,setup->dt,setup->horizon);
+  c2qp(setup->horizon);
 
   //weights
-  Matrix<fpt,13,1> full_weight;
-  for(u8 i = 0; i < 12; i++)
-    full_weight(i) = update->weights[i];
-  full_weight(12) = 0.f;
-  S.diagonal() = full_weight.replicate(setup->horizon,1);
+  if(!S_built || memcmp(S_weights, data->weights, sizeof(S_weights)))
+  {
+    Matrix<fpt,13,1> full_weight;
+    for(u8 i = 0; i < 12; i++)
+      full_weight(i) = data->weights[i];
+    full_weight(12) = 0.f;
+    S = full_weight.replicate(setup->horizon,1);
+    memcpy(S_weights, data->weights, sizeof(S_weights));
+    S_built = 1;
+  }
 
   //trajectory
   for(s16 i = 0; i < setup->horizon; i++)
   {
     for(s16 j = 0; j < 12; j++)
-      X_d(13*i+j,0) = update->traj[12*i+j];
+      X_d(13*i+j,0) = data->traj[12*i+j];
   }
   //cout<<"XD:\n"<<X_d<<endl;
 
@@ -359,7 +477,7 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
       U_b(5*k + 1) = BIG_NUMBER;
       U_b(5*k + 2) = BIG_NUMBER;
       U_b(5*k + 3) = BIG_NUMBER;
-      U_b(5*k + 4) = update->gait[i*4 + j] * setup->f_max;
+      U_b(5*k + 4) = data->gait[i*4 + j] * setup->f_max;
       k++;
     }
   }
@@ -367,27 +485,42 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
 
 
   fpt mu = 1.f/setup->mu;
-  Matrix<fpt,5,3> f_block;
+  if(mu != fmat_mu)
+  {
+    Matrix<fpt,5,3> f_block;
 
-  f_block <<  mu, 0,  1.f,
-    -mu, 0,  1.f,
-    0,  mu, 1.f,
-    0, -mu, 1.f,
-    0,   0, 1.f;
+    f_block <<  mu, 0,  1.f,
+      -mu, 0,  1.f,
+      0,  mu, 1.f,
+      0, -mu, 1.f,
+      0,   0, 1.f;
 
-  for(s16 i = 0; i < setup->horizon*4; i++)
-  {
-    fmat.block(i*5,i*3,5,3) = f_block;
+    for(s16 i = 0; i < setup->horizon*4; i++)
+    {
+      fmat.block(i*5,i*3,5,3) = f_block;
+    }
+    matrix_to_real(A_qpoases,fmat,setup->horizon*20, setup->horizon*12);
+    for(s16 i = 0; i < 20*setup->horizon; i++)
+      lb_qpoases[i] = 0.0f;
+    fmat_mu = mu;
   }
 
 
 
+  //S is diagonal, so B_qp' S B_qp is a rank data with sqrt(S) B_qp, and
+  //only its lower half needs computing
+  SB_qp.noalias() = S.cwiseSqrt().asDiagonal() * B_qp;
+  qH.setZero();
+  qH.selfadjointView<Eigen::Lower>().rankUpdate(SB_qp.transpose(), 2.f);
+  qH.triangularView<Eigen::StrictlyUpper>() = qH.transpose();
+  qH.diagonal().array() += 2*data->alpha;
+  qg.noalias() = 2*B_qp.transpose()*S.cwiseProduct(A_qp*x_0 - X_d);
 
-  qH = 2*(B_qp.transpose()*S*B_qp + update->alpha*eye_12h);
-  qg = 2*B_qp.transpose()*S*(A_qp*x_0 - X_d);
+  data->condense_time_ms = stage_timer.getMs();
+  stage_timer.start();
 
-  QpProblem<double> jcqp(setup->horizon*12, setup->horizon*20);
-  if(update->use_jcqp == 1) {
+  if(data->use_jcqp == 1) {
+    QpProblem<double> jcqp(setup->horizon*12, setup->horizon*20);
     jcqp.A = fmat.cast<double>();
     jcqp.P = qH.cast<double>();
     jcqp.q = qg.cast<double>();
@@ -395,31 +528,28 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
     for(s16 i = 0; i < 20*setup->horizon; i++)
       jcqp.l[i] = 0.;
 
-    jcqp.settings.sigma = update->sigma;
-    jcqp.settings.alpha = update->solver_alpha;
-    jcqp.settings.terminate = update->terminate;
-    jcqp.settings.rho = update->rho;
-    jcqp.settings.maxIterations = update->max_iterations;
-    jcqp.runFromDense(update->max_iterations, true, false);
+    jcqp.settings.sigma = data->sigma;
+    jcqp.settings.alpha = data->solver_alpha;
+    jcqp.settings.terminate = data->terminate;
+    jcqp.settings.rho = data->rho;
+    jcqp.settings.maxIterations = data->max_iterations;
+    jcqp.runFromDense(data->max_iterations, true, false);
+
+    for(int i = 0; i < 12 * setup->horizon; i++) {
+      q_soln[i] = jcqp.getSolution()[i];
+    }
   } else {
 
 
 
     matrix_to_real(H_qpoases,qH,setup->horizon*12, setup->horizon*12);
     matrix_to_real(g_qpoases,qg,setup->horizon*12, 1);
-    matrix_to_real(A_qpoases,fmat,setup->horizon*20, setup->horizon*12);
     matrix_to_real(ub_qpoases,U_b,setup->horizon*20, 1);
 
-    for(s16 i = 0; i < 20*setup->horizon; i++)
-      lb_qpoases[i] = 0.0f;
-
     s16 num_constraints = 20*setup->horizon;
     s16 num_variables = 12*setup->horizon;
 
 
-    qpOASES::int_t nWSR = 100;
-
-
     int new_vars = num_variables;
     int new_cons = num_constraints;
 
@@ -434,7 +564,9 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
     {
       if(! (near_zero(lb_qpoases[i]) && near_zero(ub_qpoases[i]))) continue;
       double* c_row = &A_qpoases[i*num_variables];
-      for(int j = 0; j < num_variables; j++)
+      //fmat is block diagonal, each row only touches the force of its leg
+      int leg_col = (i/5)*3;
+      for(int j = leg_col; j < leg_col + 3; j++)
       {
         if(near_one(c_row[j]))
         {
@@ -509,23 +641,11 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
         lb_red[i] = lb_qpoases[old];
       }
 
-      if(update->use_jcqp == 0) {
-        Timer solve_timer;
-        qpOASES::QProblem problem_red (new_vars, new_cons);
-        qpOASES::Options op;
-        op.setToMPC();
-        op.printLevel = qpOASES::PL_NONE;
-        problem_red.setOptions(op);
-        //int_t nWSR = 50000;
-
+      data->reduce_time_ms = stage_timer.getMs();
+      stage_timer.start();
 
-        int rval = problem_red.init(H_red, g_red, A_red, NULL, NULL, lb_red, ub_red, nWSR);
-        (void)rval;
-        int rval2 = problem_red.getPrimalSolution(q_red);
-        if(rval2 != qpOASES::SUCCESSFUL_RETURN)
-          printf("failed to solve!\n");
-
-        // printf("solve time: %.3f ms, size %d, %d\n", solve_timer.getMs(), new_vars, new_cons);
+      if(data->use_jcqp == 0) {
+        solve_qpoases_warm(data, num_constraints, new_vars, new_cons, con_ind);
 
 
         vc = 0;
@@ -582,12 +702,12 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
 //        for(s16 i = 0; i < 20*setup->horizon; i++)
 //          jcqp.l[i] = 0.;
 
-        reducedProblem.settings.sigma = update->sigma;
-        reducedProblem.settings.alpha = update->solver_alpha;
-        reducedProblem.settings.terminate = update->terminate;
-        reducedProblem.settings.rho = update->rho;
-        reducedProblem.settings.maxIterations = update->max_iterations;
-        reducedProblem.runFromDense(update->max_iterations, true, false);
+        reducedProblem.settings.sigma = data->sigma;
+        reducedProblem.settings.alpha = data->solver_alpha;
+        reducedProblem.settings.terminate = data->terminate;
+        reducedProblem.settings.rho = data->rho;
+        reducedProblem.settings.maxIterations = data->max_iterations;
+        reducedProblem.runFromDense(data->max_iterations, true, false);
 
         vc = 0;
         for(int kk = 0; kk < num_variables; kk++)
@@ -610,11 +730,8 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
 
 
 
-  if(update->use_jcqp == 1) {
-    for(int i = 0; i < 12 * setup->horizon; i++) {
-      q_soln[i] = jcqp.getSolution()[i];
-    }
-  }
+  data->solve_time_ms = stage_timer.getMs();
+  data->total_time_ms = total_timer.getMs();
 
 
 
@@ -625,3 +742,79 @@ void solve_mpc(update_data_t* update, problem_setup* setup)
 
 
 }
+
+void ConvexMPCSolver::setup(double dt, int horizon, double mu, double f_max)
+{
+  if(horizon < 1 || horizon > K_MAX_GAIT_SEGMENTS) {
+    throw std::runtime_error("horizon is too long!");
+  }
+
+#ifdef K_DEBUG
+  printf("[MPC] Got new problem configuration!\n");
+    printf("[MPC] Prediction horizon length: %d\n      Force limit: %.3f, friction %.3f\n      dt: %.3f\n",
+            horizon,f_max,mu,dt);
+#endif
+
+  problem_configuration.horizon = horizon;
+  problem_configuration.f_max = f_max;
+  problem_configuration.mu = mu;
+  problem_configuration.dt = dt;
+
+  resize_qp_mats(horizon);
+}
+
+void ConvexMPCSolver::setSolverSettings(int max_iter, double rho, double sigma,
+                                        double solver_alpha, double terminate,
+                                        double use_jcqp)
+{
+  update.max_iterations = max_iter;
+  update.rho = rho;
+  update.sigma = sigma;
+  update.solver_alpha = solver_alpha;
+  update.terminate = terminate;
+  if(use_jcqp > 2.5)
+    update.use_jcqp = 3;
+  else if(use_jcqp > 1.5)
+    update.use_jcqp = 2;
+  else if(use_jcqp > 0.5)
+    update.use_jcqp = 1;
+  else
+    update.use_jcqp = 0;
+}
+
+void ConvexMPCSolver::setXDrag(float x_drag)
+{
+  update.x_drag = x_drag;
+}
+
+void ConvexMPCSolver::solve(const float* p, const float* v, const float* q,
+                            const float* w, const float* r, float yaw,
+                            const float* weights,
+                            const float* state_trajectory, float alpha,
+                            const int* gait)
+{
+  if(!real_allocated) {
+    throw std::runtime_error("MPC solve before setup!");
+  }
+
+  s16 horizon = problem_configuration.horizon;
+  update.alpha = alpha;
+  update.yaw = yaw;
+  for(s16 i = 0; i < 4*horizon; i++)
+    update.gait[i] = gait[i];
+  memcpy(update.p, p, sizeof(float)*3);
+  memcpy(update.v, v, sizeof(float)*3);
+  memcpy(update.q, q, sizeof(float)*4);
+  memcpy(update.w, w, sizeof(float)*3);
+  memcpy(update.r, r, sizeof(float)*12);
+  memcpy(update.weights, weights, sizeof(float)*12);
+  memcpy(update.traj, state_trajectory, sizeof(float)*12*horizon);
+  solve_mpc(&update, &problem_configuration);
+  has_solved = 1;
+}
+
+double ConvexMPCSolver::getSolution(int index) const
+{
+  if(!has_solved) return 0.f;
+  return q_soln[index];
+}
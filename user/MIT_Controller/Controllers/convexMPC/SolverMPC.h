@@ -5,13 +5,12 @@
 #include <eigen3/Eigen/Dense>
 #include "common_types.h"
 #include "convexMPC_interface.h"
+#include "RobotState.h"
+#include "RiccatiMPC.h"
+#include <qpOASES.hpp>
 #include <iostream>
 #include <stdio.h>
 
-using Eigen::Matrix;
-using Eigen::Quaternionf;
-using Eigen::Quaterniond;
-
 template <class T>
 void print_array(T* array, u16 rows, u16 cols)
 {
@@ -52,11 +51,121 @@ T sq(T a)
 }
 
 
-void solve_mpc(update_data_t* update, problem_setup* setup);
+void quat_to_rpy(Eigen::Quaternionf q, Eigen::Matrix<fpt,3,1>& rpy);
+void ct_ss_mats(Eigen::Matrix<fpt,3,3> I_world, fpt m, Eigen::Matrix<fpt,3,4> r_feet, Eigen::Matrix<fpt,3,3> R_yaw, Eigen::Matrix<fpt,13,13>& A, Eigen::Matrix<fpt,13,12>& B, float x_drag);
+
+/*!
+ * Convex MPC solver.  Each solver has its own problem data and workspace, so
+ * several can be used at once, and solve in parallel threads (for example to
+ * compare the plans of two gaits).  A single solver is not thread safe.
+ */
+class ConvexMPCSolver
+{
+public:
+  ConvexMPCSolver();
+  ~ConvexMPCSolver();
+  ConvexMPCSolver(const ConvexMPCSolver&) = delete;
+  ConvexMPCSolver& operator=(const ConvexMPCSolver&) = delete;
+
+  /*!
+   * Set the problem parameters.  The workspace is only reallocated when the
+   * horizon changes.
+   */
+  void setup(double dt, int horizon, double mu, double f_max);
+  void setSolverSettings(int max_iter, double rho, double sigma,
+                         double solver_alpha, double terminate,
+                         double use_jcqp);
+  void setXDrag(float x_drag);
+
+  /*!
+   * Solve the MPC for the current state
+   * @param r : foot positions relative to the body, x of each leg first
+   * @param state_trajectory : desired states, 12 per horizon step
+   * @param gait : contact of each leg, 4 per horizon step
+   */
+  void solve(const float* p, const float* v, const float* q, const float* w,
+             const float* r, float yaw, const float* weights,
+             const float* state_trajectory, float alpha, const int* gait);
+
+  /*!
+   * Get the force of the solution, 12 per horizon step.  Zero until the first
+   * solve.
+   */
+  double getSolution(int index) const;
+  const update_data_t& getUpdateData() const { return update; }
+  const problem_setup& getProblemSetup() const { return problem_configuration; }
+
+private:
+  void resize_qp_mats(s16 horizon);
+  void c2d(const Eigen::Matrix<fpt,13,13>& Ac, const Eigen::Matrix<fpt,13,12>& Bc,fpt dt);
+  void c2qp(s16 horizon);
+  void reset_warm_start();
+  void solve_qpoases_warm(update_data_t* data, int num_constraints,
+                          int new_vars, int new_cons, const int* con_ind);
+  void solve_mpc(update_data_t* data, problem_setup* setup);
+
+  problem_setup problem_configuration;
+  update_data_t update;
+  u8 has_solved = 0;
+
+  RobotState rs;
+  Eigen::Matrix<fpt,13,1> x_0;
+  Eigen::Matrix<fpt,3,3> I_world;
+  Eigen::Matrix<fpt,13,13> A_ct;
+  Eigen::Matrix<fpt,13,12> B_ct_r;
+
+  Eigen::Matrix<fpt,Eigen::Dynamic,13> A_qp;
+  Eigen::Matrix<fpt,Eigen::Dynamic,Eigen::Dynamic> B_qp;
+  Eigen::Matrix<fpt,13,12> Bdt;
+  Eigen::Matrix<fpt,13,13> Adt;
+  Eigen::Matrix<fpt,Eigen::Dynamic,1> S; //diagonal of the state weights
+  Eigen::Matrix<fpt,Eigen::Dynamic,Eigen::Dynamic> SB_qp; //sqrt(S) * B_qp
+  Eigen::Matrix<fpt,Eigen::Dynamic,1> X_d;
+  Eigen::Matrix<fpt,Eigen::Dynamic,1> U_b;
+  Eigen::Matrix<fpt,Eigen::Dynamic,Eigen::Dynamic> fmat;
+
+  Eigen::Matrix<fpt,Eigen::Dynamic,Eigen::Dynamic> qH;
+  Eigen::Matrix<fpt,Eigen::Dynamic,1> qg;
+
+  //parameters S and fmat (and its copy in A_qpoases) were built for, so they
+  //are only rebuilt when a parameter changes
+  float S_weights[12];
+  u8 S_built = 0;
+  fpt fmat_mu = 0;
+
+  qpOASES::real_t* H_qpoases = nullptr;
+  qpOASES::real_t* g_qpoases = nullptr;
+  qpOASES::real_t* A_qpoases = nullptr;
+  qpOASES::real_t* lb_qpoases = nullptr;
+  qpOASES::real_t* ub_qpoases = nullptr;
+  qpOASES::real_t* q_soln = nullptr;
+
+  qpOASES::real_t* H_red = nullptr;
+  qpOASES::real_t* g_red = nullptr;
+  qpOASES::real_t* A_red = nullptr;
+  qpOASES::real_t* lb_red = nullptr;
+  qpOASES::real_t* ub_red = nullptr;
+  qpOASES::real_t* q_red = nullptr;
+  u8 real_allocated = 0;
+  s16 allocated_horizon = 0;
+
+  char var_elim[2000];
+  char con_elim[2000];
+
+  // The qpOASES problem is kept between solves so that each solve can warm
+  // start from the working set of the last one, shifted forward by one horizon
+  // step.  qpOASES keeps pointers to H_red and A_red, so they are only
+  // reallocated when the horizon changes, which also drops the problem.
+  qpOASES::SQProblem* warm_problem = nullptr;
+  int warm_vars = 0;
+  int warm_cons = 0;
+  char warm_con_elim[2000];
+  qpOASES::real_t warm_working_set[2000];  // -1 lower, 1 upper, 0 inactive
+  qpOASES::real_t red_working_set[2000];
+
+  RiccatiMPC riccati_mpc;
 
-void quat_to_rpy(Quaternionf q, Matrix<fpt,3,1>& rpy);
-void ct_ss_mats(Matrix<fpt,3,3> I_world, fpt m, Matrix<fpt,3,4> r_feet, Matrix<fpt,3,3> R_yaw, Matrix<fpt,13,13>& A, Matrix<fpt,13,12>& B);
-void resize_qp_mats(s16 horizon);
-void c2qp(Matrix<fpt,13,13> Ac, Matrix<fpt,13,12> Bc,fpt dt,s16 horizon);
-mfp* get_q_soln();
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
 #endif
@@ -1,6 +1,6 @@
 #ifndef _convexmpc_interface
 #define _convexmpc_interface
-#define K_MAX_GAIT_SEGMENTS 36
+#define K_MAX_GAIT_SEGMENTS 64
 
 //#include "common_types.h"
 
@@ -29,17 +29,29 @@ struct update_data_t
   float weights[12];
   float traj[12*K_MAX_GAIT_SEGMENTS];
   float alpha;
-  unsigned char gait[K_MAX_GAIT_SEGMENTS];
+  unsigned char gait[4*K_MAX_GAIT_SEGMENTS];
   unsigned char hack_pad[1000];
   int max_iterations;
   double rho, sigma, solver_alpha, terminate;
   int use_jcqp;
   float x_drag;
+
+  // written by the solver
+  int qp_iterations;   // qpOASES working set recalculations, or
+                       // interior point iterations
+  int qp_warm_started; // qpOASES started from the last working set
+  float model_time_ms;      // continuous time dynamics
+  float discretize_time_ms;
+  float condense_time_ms;   // dense QP cost, zero for the stage-wise solver
+  float reduce_time_ms;     // removing the zero force legs from the QP
+  float solve_time_ms;      // the QP solver itself
+  float total_time_ms;
 };
 
 EXTERNC void setup_problem(double dt, int horizon, double mu, double f_max);
 EXTERNC void update_problem_data(double* p, double* v, double* q, double* w, double* r, double yaw, double* weights, double* state_trajectory, double alpha, int* gait);
 EXTERNC double get_solution(int index);
+EXTERNC const update_data_t* get_update_data();
 EXTERNC void update_solver_settings(int max_iter, double rho, double sigma, double solver_alpha, double terminate, double use_jcqp);
 EXTERNC void update_problem_data_floats(float* p, float* v, float* q, float* w,
                                         float* r, float yaw, float* weights,
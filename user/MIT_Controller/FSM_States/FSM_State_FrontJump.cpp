@@ -83,9 +83,8 @@ void FSM_State_FrontJump<T>::run() {
 
 template <typename T>
 bool FSM_State_FrontJump<T>::_Initialization() { // do away with this?
-  static bool test_initialized(false);
-  if (!test_initialized) {
-    test_initialized = true;
+  if (!_b_test_initialized) {
+    _b_test_initialized = true;
     printf("[Cheetah Test] Test initialization is done\n");
   }
   if (_count < _waiting_count) {
@@ -55,6 +55,7 @@ class FSM_State_FrontJump : public FSM_State<T> {
   DataReader* _data_reader;
   bool _b_running = true;
   bool _b_first_visit = true;
+  bool _b_test_initialized = false;
   int _count = 0;
   int _waiting_count = 6;
   float _curr_time = 0;
@@ -49,10 +49,9 @@ void FSM_State_JointPD<T>::run() {
   Vec3<T> qdDes;
   qdDes << 0, 0, 0;
 
-  static double progress(0.);
-  progress += this->_data->controlParameters->controller_dt;
+  _progress += this->_data->controlParameters->controller_dt;
   double movement_duration(3.0);
-  double ratio = progress/movement_duration;
+  double ratio = _progress/movement_duration;
   if(ratio > 1.) ratio = 1.;
 
   this->jointPDControl(0, ratio*qDes + (1. - ratio)*_ini_jpos.head(3), qdDes);
@@ -31,6 +31,7 @@ class FSM_State_JointPD : public FSM_State<T> {
   // Keep track of the control iterations
   int iter = 0;
   DVec<T> _ini_jpos;
+  double _progress = 0.;  // time spent moving to the PD target
 };
 
 #endif  // FSM_STATE_JOINTPD_H
@@ -12,6 +12,7 @@ public:
         INIT_PARAMETER(cmpc_use_sparse),
         INIT_PARAMETER(use_wbc),
         INIT_PARAMETER(cmpc_bonus_swing),
+        INIT_PARAMETER(cmpc_async),
         INIT_PARAMETER(Kp_body),
         INIT_PARAMETER(Kd_body),
         INIT_PARAMETER(Kp_ori),
@@ -43,6 +44,7 @@ public:
   DECLARE_PARAMETER(double, cmpc_use_sparse);
   DECLARE_PARAMETER(double, use_wbc);
   DECLARE_PARAMETER(double, cmpc_bonus_swing);
+  DECLARE_PARAMETER(double, cmpc_async);
 
   DECLARE_PARAMETER(Vec3<double>, Kp_body);
   DECLARE_PARAMETER(Vec3<double>, Kd_body);
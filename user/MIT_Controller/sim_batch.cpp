@@ -0,0 +1,17 @@
+/*!
+ * @file sim_batch.cpp
+ * @brief Main Function for headless batch simulation of the MIT Controller
+ *
+ * Runs every job in a job file without graphics or shared memory.  See
+ * config/sim-batch-example.yaml.
+ */
+
+#include <BatchSimulation.h>
+#include "MIT_Controller.hpp"
+
+int main(int argc, char** argv) {
+  // each MIT_Controller owns all of its state, including its MPC solvers, so
+  // the controllers run in parallel
+  return batch_main_helper(
+      argc, argv, []() { return new MIT_Controller(); }, true);
+}
@@ -0,0 +1,22 @@
+/*!
+ * @file sim_main.cpp
+ * @brief Simulator with the MIT Controller running in the simulator's process
+ *
+ * Each simulation started from the GUI gets a new controller, called directly
+ * every control tick instead of through shared memory.
+ */
+
+#include <SimulationBridge.h>
+#include <sim_main_helper.h>
+#include "MIT_Controller.hpp"
+
+int main(int argc, char** argv) {
+  // MIT_Controllers don't share state, so the robots' controllers run in
+  // parallel
+  return sim_main_helper(
+      argc, argv,
+      [](RobotType robot) {
+        return new SimulationBridge(robot, new MIT_Controller(), true);
+      },
+      true);
+}